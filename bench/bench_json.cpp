@@ -0,0 +1,63 @@
+// JSON throughput on multi-MB LLM responses: provider body decoding (json_pick), whole-plan parsing
+// and streamed plan parsing. Build with -DBUILD_BENCHMARKS=ON, run: bench_json [MB] [rounds]
+#include <ai-autoshell/ai/json_pull.hpp>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace autoshell::ai;
+
+static std::string escape(const std::string& in) {
+    std::string out; out.reserve(in.size() + in.size() / 8);
+    for (char c : in) {
+        if (c == '"' || c == '\\') { out.push_back('\\'); out.push_back(c); }
+        else if (c == '\n') out += "\\n";
+        else out.push_back(c);
+    }
+    return out;
+}
+
+template <class F> static void run(const char* name, std::size_t bytes, int rounds, F&& f) {
+    std::size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) sink += f();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("%-28s %8.1f MB/s  (%zu bytes x %d, check %zu)\n", name, bytes * rounds / s / 1e6, bytes, rounds, sink);
+}
+
+int main(int argc, char** argv) {
+    std::size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 10;
+    // Piano grande: step con descrizioni e comandi quotati (molti escape una volta incapsulato)
+    std::string plan = "{\"request\":\"bench\",\"steps\":[";
+    for (int i = 1; plan.size() < mb * 1000000; ++i) {
+        if (i > 1) plan += ",\n";
+        plan += "{\"id\":\"s" + std::to_string(i) + "\",\"description\":\"Write \\\"part " + std::to_string(i) +
+                "\\\" of the report {1..3}\",\"command\":\"printf '%s\\\\n' \\\"line " + std::to_string(i) +
+                " \\u00e8\\\" >> report.txt\",\"confirm\":false}";
+    }
+    plan += "]}";
+    std::string body = "{\"id\":\"chatcmpl-1\",\"object\":\"chat.completion\",\"choices\":[{\"index\":0,\"message\":{\"role\":\"assistant\",\"content\":\"" +
+                       escape(plan) + "\"},\"finish_reason\":\"stop\"}],\"usage\":{\"prompt_tokens\":120,\"completion_tokens\":99999,\"total_tokens\":100119}}";
+
+    run("json_pick (provider body)", body.size(), rounds, [&] {
+        auto f = json_pick(body, {{"choices", "0", "message", "content"}, {"usage", "total_tokens"}});
+        return f[0] ? f[0]->size() : 0;
+    });
+    run("JsonReader tokens", plan.size(), rounds, [&] {
+        JsonReader r(plan);
+        std::size_t n = 0;
+        for (auto t = r.next(); t != JsonReader::Token::End && t != JsonReader::Token::Error; t = r.next()) ++n;
+        return n;
+    });
+    run("parse_plan_json", plan.size(), rounds, [&] { return parse_plan_json(plan).steps.size(); });
+    run("PlanStreamParser (64 B)", plan.size(), rounds, [&] {
+        PlanStreamParser p;
+        std::size_t n = 0;
+        for (std::size_t off = 0; off < plan.size(); off += 64) n += p.feed(std::string_view(plan).substr(off, 64)).size();
+        return n;
+    });
+    return 0;
+}
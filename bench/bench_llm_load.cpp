@@ -0,0 +1,125 @@
+// Load test of the provider clients (make_llm + shared HttpTransport) against the local mock LLM
+// server, or an external endpoint. Reports throughput, latency percentiles, time to first byte and
+// the connections opened, per provider. Build with -DBUILD_BENCHMARKS=ON, run: bench_llm_load
+//   [--provider openai|ollama|claude|gemini|all] [-n 200] [-c 16] [--stream] [--latency SPEC]
+//   [--chunk-ms N] [--error-429 R] [--error-500 R] [--timeout-rate R] [--retries N] [--endpoint URL]
+#include "mock_llm_server.hpp"
+#include <ai-autoshell/ai/http.hpp>
+#include <ai-autoshell/ai/llm.hpp>
+#include <ai-autoshell/ai/telemetry.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace autoshell::ai;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Run {
+    std::string provider;
+    std::size_t ok = 0, errors = 0, connections = 0;
+    long long completion_tokens = 0;
+    double seconds = 0;
+    LatencyHistogram latency, ttfb; // us
+};
+
+Run run(const LLMConfig& cfg, int requests, int concurrency, bool stream) {
+    Run out;
+    out.provider = cfg.provider;
+    auto client = make_llm(cfg);
+    auto before = HttpTransport::shared().stats().connections;
+    std::atomic<int> next{0};
+    std::mutex mu;
+    auto t0 = Clock::now();
+    std::vector<std::thread> pool;
+    for (int w = 0; w < concurrency; ++w) pool.emplace_back([&] {
+        while (next++ < requests) {
+            auto start = Clock::now();
+            std::int64_t first_us = -1;
+            auto r = stream ? client->complete_stream("list the files in the current directory", [&](std::string_view) {
+                                  if (first_us < 0) first_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+                              })
+                            : client->complete("list the files in the current directory");
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+            if (!stream && r) first_us = r->timing.ttfb_us;
+            std::lock_guard<std::mutex> lk(mu);
+            if (!r || r->source == "error") { ++out.errors; continue; }
+            ++out.ok;
+            out.latency.record(us);
+            if (first_us >= 0) out.ttfb.record(first_us);
+            if (r->completion_tokens > 0) out.completion_tokens += r->completion_tokens;
+        }
+    });
+    for (auto& t : pool) t.join();
+    out.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    out.connections = HttpTransport::shared().stats().connections - before;
+    return out;
+}
+
+double ms(std::int64_t us) { return us < 0 ? 0.0 : us / 1000.0; }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string provider = "all", endpoint;
+    int requests = 200, concurrency = 16, retries = 0;
+    bool stream = false;
+    MockLLMOptions o;
+    o.latency = MockLLMOptions::Latency::LogNormal; o.latency_ms = 50; o.latency_sigma = 0.5;
+    o.chunk_ms = 2;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto need = [&] { if (!v) { std::fprintf(stderr, "%s: missing value\n", a.c_str()); std::exit(2); } ++i; return std::string(v); };
+        if (a == "--provider") provider = need();
+        else if (a == "-n") requests = std::atoi(need().c_str());
+        else if (a == "-c") concurrency = std::max(1, std::atoi(need().c_str()));
+        else if (a == "--stream") stream = true;
+        else if (a == "--latency") { if (!parse_mock_latency(need(), o)) { std::fprintf(stderr, "bad --latency %s\n", v); return 2; } }
+        else if (a == "--chunk-ms") o.chunk_ms = std::atoi(need().c_str());
+        else if (a == "--error-429") o.rate_429 = std::atof(need().c_str());
+        else if (a == "--error-500") o.rate_500 = std::atof(need().c_str());
+        else if (a == "--timeout-rate") o.rate_timeout = std::atof(need().c_str());
+        else if (a == "--retries") retries = std::atoi(need().c_str());
+        else if (a == "--endpoint") endpoint = need();
+        else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); return 2; }
+    }
+    if (!endpoint.empty() && provider == "all") { std::fprintf(stderr, "--endpoint needs a single --provider\n"); return 2; }
+    o.retry_after_s = 0; // un 429 senza attesa lunga: misura il costo del retry, non il sonno
+
+    MockLLMServer srv(o);
+    if (endpoint.empty() && !srv.ok()) { std::fprintf(stderr, "cannot start the mock server\n"); return 1; }
+    std::vector<std::string> providers = provider == "all" ? std::vector<std::string>{"openai", "ollama", "claude", "gemini"}
+                                                           : std::vector<std::string>{provider};
+    std::printf("%d requests, %d concurrent, %s%s\n", requests, concurrency, stream ? "streaming" : "non-streaming",
+                endpoint.empty() ? "" : (", " + endpoint).c_str());
+    std::printf("%-8s %6s %6s %9s %8s %8s %8s %8s %9s %6s %9s\n", "provider", "ok", "err", "req/s", "p50 ms", "p95 ms", "p99 ms",
+                "max ms", "ttfb p50", "conns", "tok/s");
+    int failed = 0;
+    for (auto& p : providers) {
+        LLMConfig cfg;
+        cfg.enabled = true; cfg.provider = p; cfg.model = "mock-model"; cfg.api_key = "mock";
+        cfg.endpoint = endpoint.empty() ? srv.endpoint(p) : endpoint;
+        cfg.timeout_seconds = 10;
+        cfg.retries = retries; cfg.backoff_base_ms = 10;
+        if (o.rate_timeout > 0) cfg.attempt_timeout_ms = 2000; // una richiesta appesa non blocca il worker 10 s
+        auto r = run(cfg, requests, concurrency, stream);
+        if (r.ok == 0) ++failed;
+        std::printf("%-8s %6zu %6zu %9.1f %8.1f %8.1f %8.1f %8.1f %9.1f %6zu %9.0f\n", r.provider.c_str(), r.ok, r.errors,
+                    (r.ok + r.errors) / r.seconds, ms(r.latency.percentile(50)), ms(r.latency.percentile(95)),
+                    ms(r.latency.percentile(99)), ms(r.latency.max()), ms(r.ttfb.percentile(50)), r.connections,
+                    r.completion_tokens / r.seconds);
+    }
+    if (endpoint.empty()) {
+        auto st = srv.stats();
+        std::printf("mock: %zu requests, %zu connections, injected 429 %zu / 500 %zu / timeouts %zu\n", st.requests, st.connections,
+                    st.throttled, st.server_errors, st.timeouts);
+    }
+    return failed ? 1 : 0;
+}
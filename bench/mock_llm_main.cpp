@@ -0,0 +1,51 @@
+// Standalone mock LLM server for offline runs and CI: point llm_endpoint at it.
+//   mock_llm_server [--port N] [--latency fixed:200|uniform:100-400|lognormal:200,0.6] [--chunk-ms N]
+//                   [--chunk-bytes N] [--error-429 R] [--error-500 R] [--timeout-rate R] [--retry-after S]
+//                   [--plans FILE] [--seed N]
+// --plans: one canned answer per line (plan JSON), served round-robin. Runs until SIGINT/SIGTERM.
+#include "mock_llm_server.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace autoshell::ai;
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+int main(int argc, char** argv) {
+    MockLLMOptions o;
+    o.port = 18080;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto need = [&] { if (!v) { std::fprintf(stderr, "%s: missing value\n", a.c_str()); std::exit(2); } ++i; return std::string(v); };
+        if (a == "--port") o.port = std::atoi(need().c_str());
+        else if (a == "--latency") { if (!parse_mock_latency(need(), o)) { std::fprintf(stderr, "bad --latency %s\n", v); return 2; } }
+        else if (a == "--chunk-ms") o.chunk_ms = std::atoi(need().c_str());
+        else if (a == "--chunk-bytes") o.chunk_bytes = std::strtoul(need().c_str(), nullptr, 10);
+        else if (a == "--error-429") o.rate_429 = std::atof(need().c_str());
+        else if (a == "--error-500") o.rate_500 = std::atof(need().c_str());
+        else if (a == "--timeout-rate") o.rate_timeout = std::atof(need().c_str());
+        else if (a == "--retry-after") o.retry_after_s = std::atoi(need().c_str());
+        else if (a == "--seed") o.seed = std::strtoull(need().c_str(), nullptr, 10);
+        else if (a == "--plans") {
+            std::ifstream in(need());
+            if (!in) { std::fprintf(stderr, "cannot read %s\n", v); return 2; }
+            for (std::string line; std::getline(in, line);) if (!line.empty()) o.plans.push_back(line);
+        } else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); return 2; }
+    }
+    MockLLMServer srv(o);
+    if (!srv.ok()) { std::fprintf(stderr, "cannot listen on 127.0.0.1:%d\n", o.port); return 1; }
+    std::signal(SIGINT, [](int) { g_stop = 1; });
+    std::signal(SIGTERM, [](int) { g_stop = 1; });
+    std::printf("mock LLM server on 127.0.0.1:%d\n", srv.port());
+    for (const char* p : {"openai", "ollama", "claude", "gemini"}) std::printf("  %-7s llm_endpoint=%s\n", p, srv.endpoint(p).c_str());
+    std::fflush(stdout);
+    while (!g_stop) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto st = srv.stats();
+    std::printf("requests %zu (streamed %zu) connections %zu | 429 %zu, 500 %zu, timeouts %zu\n",
+                st.requests, st.streamed, st.connections, st.throttled, st.server_errors, st.timeouts);
+}
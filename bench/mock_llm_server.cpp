@@ -0,0 +1,286 @@
+// Local mock LLM server (OpenAI / Ollama / Anthropic / Gemini wire formats)
+#include "mock_llm_server.hpp"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+
+namespace autoshell::ai {
+
+namespace {
+
+const char* kDefaultPlan =
+    R"({"request":"mock plan","steps":[{"id":"s1","description":"List files","command":"ls -la","confirm":false},)"
+    R"({"id":"s2","description":"Disk usage","command":"du -sh .","confirm":false}]})";
+
+std::string esc(const std::string& in) {
+    std::string out;
+    for (unsigned char c : in) {
+        if (c == '"' || c == '\\') { out += '\\'; out += static_cast<char>(c); }
+        else if (c == '\n') out += "\\n";
+        else if (c < 0x20) { char b[8]; std::snprintf(b, sizeof(b), "\\u%04x", c); out += b; }
+        else out += static_cast<char>(c);
+    }
+    return out;
+}
+
+std::string chunk(const std::string& data) {
+    char len[16];
+    std::snprintf(len, sizeof(len), "%zx\r\n", data.size());
+    return len + data + "\r\n";
+}
+
+std::string lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+} // namespace
+
+bool parse_mock_latency(const std::string& spec, MockLLMOptions& o) {
+    auto colon = spec.find(':');
+    std::string kind = colon == std::string::npos ? "fixed" : spec.substr(0, colon);
+    std::string args = colon == std::string::npos ? spec : spec.substr(colon + 1);
+    try {
+        if (kind == "fixed") { o.latency = MockLLMOptions::Latency::Fixed; o.latency_ms = std::stoi(args); return o.latency_ms >= 0; }
+        if (kind == "uniform") {
+            auto dash = args.find('-');
+            if (dash == std::string::npos) return false;
+            o.latency = MockLLMOptions::Latency::Uniform;
+            o.latency_ms = std::stoi(args.substr(0, dash)); o.latency_max_ms = std::stoi(args.substr(dash + 1));
+            return o.latency_ms >= 0 && o.latency_max_ms >= o.latency_ms;
+        }
+        if (kind == "lognormal") {
+            auto comma = args.find(',');
+            o.latency = MockLLMOptions::Latency::LogNormal;
+            o.latency_ms = std::stoi(args.substr(0, comma));
+            if (comma != std::string::npos) o.latency_sigma = std::stod(args.substr(comma + 1));
+            return o.latency_ms > 0 && o.latency_sigma >= 0;
+        }
+    } catch (...) {}
+    return false;
+}
+
+MockLLMServer::MockLLMServer(MockLLMOptions opts) : m_opts(std::move(opts)), m_rng(m_opts.seed) {
+    if (m_opts.plans.empty()) m_opts.plans.push_back(kDefaultPlan);
+    m_opts.chunk_bytes = std::max<std::size_t>(1, m_opts.chunk_bytes);
+    m_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_fd < 0) return;
+    int one = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a{};
+    a.sin_family = AF_INET; a.sin_addr.s_addr = htonl(INADDR_LOOPBACK); a.sin_port = htons(static_cast<std::uint16_t>(m_opts.port));
+    socklen_t len = sizeof(a);
+    if (bind(m_fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) != 0 || listen(m_fd, 128) != 0 ||
+        getsockname(m_fd, reinterpret_cast<sockaddr*>(&a), &len) != 0) { close(m_fd); m_fd = -1; return; }
+    m_port = ntohs(a.sin_port);
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+    m_thread = std::thread([this] { loop(); });
+}
+
+MockLLMServer::~MockLLMServer() {
+    m_stop = true;
+    if (m_thread.joinable()) m_thread.join();
+    for (auto& c : m_conns) close(c.fd);
+    if (m_fd >= 0) close(m_fd);
+}
+
+std::string MockLLMServer::endpoint(const std::string& provider) const {
+    std::string base = "http://127.0.0.1:" + std::to_string(m_port);
+    if (provider == "ollama") return base + "/api/generate";
+    if (provider == "claude") return base + "/v1/messages";
+    if (provider == "gemini") return base + "/v1beta/models/"; // il client aggiunge <model>:generateContent?key=...
+    return base + "/v1/chat/completions";
+}
+
+void MockLLMServer::fail_next(int n, int status) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    for (int i = 0; i < n; ++i) m_forced.push_back(status);
+}
+
+MockLLMServer::Stats MockLLMServer::stats() const {
+    std::lock_guard<std::mutex> lk(m_mu);
+    return m_stats;
+}
+
+int MockLLMServer::draw_latency_ms() {
+    switch (m_opts.latency) {
+    case MockLLMOptions::Latency::Uniform:
+        return std::uniform_int_distribution<int>(m_opts.latency_ms, std::max(m_opts.latency_ms, m_opts.latency_max_ms))(m_rng);
+    case MockLLMOptions::Latency::LogNormal:
+        return static_cast<int>(std::lround(std::lognormal_distribution<double>(std::log(std::max(1, m_opts.latency_ms)), m_opts.latency_sigma)(m_rng)));
+    default:
+        return m_opts.latency_ms;
+    }
+}
+
+void MockLLMServer::loop() {
+    std::vector<pollfd> fds;
+    while (!m_stop) {
+        flush_due();
+        int timeout = 10;
+        if (!m_due.empty()) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(m_due.begin()->first - Clock::now()).count();
+            timeout = static_cast<int>(std::clamp<long long>(ms, 0, 10));
+        }
+        fds.assign(1, pollfd{m_fd, POLLIN, 0});
+        for (auto& c : m_conns) fds.push_back({c.fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), timeout) <= 0) continue;
+        std::vector<int> closed;
+        for (std::size_t i = 1; i < fds.size(); ++i) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            auto& c = m_conns[i - 1];
+            char buf[16384];
+            ssize_t n = read(c.fd, buf, sizeof(buf));
+            if (n <= 0) { closed.push_back(c.fd); continue; }
+            c.in.append(buf, static_cast<std::size_t>(n));
+            serve(c);
+        }
+        for (int fd : closed) {
+            for (auto it = m_due.begin(); it != m_due.end();) it = it->second.first == fd ? m_due.erase(it) : std::next(it);
+            std::erase_if(m_conns, [&](const Conn& c) { return c.fd == fd; });
+            close(fd);
+        }
+        if (fds[0].revents & POLLIN) {
+            for (int c; (c = accept(m_fd, nullptr, nullptr)) >= 0;) {
+                m_conns.push_back(Conn{c, {}});
+                std::lock_guard<std::mutex> lk(m_mu);
+                ++m_stats.connections;
+            }
+        }
+    }
+}
+
+void MockLLMServer::serve(Conn& c) {
+    for (;;) {
+        auto hdr_end = c.in.find("\r\n\r\n");
+        if (hdr_end == std::string::npos) return;
+        std::string head = lower(c.in.substr(0, hdr_end));
+        std::size_t clen = 0;
+        auto cl = head.find("content-length:");
+        if (cl != std::string::npos) clen = std::strtoul(head.c_str() + cl + 15, nullptr, 10);
+        if (c.in.size() < hdr_end + 4 + clen) {
+            // curl aspetta il 100 Continue prima di mandare un body grande
+            if (!c.continued && head.find("expect: 100-continue") != std::string::npos) {
+                static const char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                (void)!write(c.fd, cont, sizeof(cont) - 1);
+                c.continued = true;
+            }
+            return;
+        }
+        auto sp1 = c.in.find(' '), sp2 = c.in.find(' ', sp1 + 1);
+        std::string path = sp1 < hdr_end && sp2 < hdr_end ? c.in.substr(sp1 + 1, sp2 - sp1 - 1) : "/";
+        std::string body = c.in.substr(hdr_end + 4, clen);
+        c.in.erase(0, hdr_end + 4 + clen);
+        c.continued = false;
+        answer(c, path, body);
+    }
+}
+
+void MockLLMServer::schedule(Conn& c, Clock::time_point at, std::string data) {
+    m_due.emplace(at, std::make_pair(c.fd, std::move(data))); // a parita' di istante resta l'ordine di inserimento
+    c.free_at = std::max(c.free_at, at);
+}
+
+void MockLLMServer::flush_due() {
+    auto now = Clock::now();
+    while (!m_due.empty() && m_due.begin()->first <= now) {
+        auto& [fd, data] = m_due.begin()->second;
+        for (std::size_t off = 0; off < data.size();) {
+            ssize_t n = write(fd, data.data() + off, data.size() - off);
+            if (n <= 0) break;
+            off += static_cast<std::size_t>(n);
+        }
+        m_due.erase(m_due.begin());
+    }
+}
+
+void MockLLMServer::answer(Conn& c, const std::string& path, const std::string& body) {
+    std::string provider = path.find("/chat/completions") != std::string::npos ? "openai"
+                         : path.find("/api/generate") != std::string::npos ? "ollama"
+                         : path.find("/v1/messages") != std::string::npos ? "claude"
+                         : path.find("enerateContent") != std::string::npos ? "gemini" : "";
+    bool stream = provider == "gemini" ? path.find(":streamGenerateContent") != std::string::npos
+                                       : body.find("\"stream\":true") != std::string::npos;
+    int fail = 200;
+    {
+        std::lock_guard<std::mutex> lk(m_mu);
+        ++m_stats.requests;
+        if (!m_forced.empty()) { fail = m_forced.front(); m_forced.erase(m_forced.begin()); }
+        else {
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(m_rng);
+            if (u < m_opts.rate_429) fail = 429;
+            else if (u < m_opts.rate_429 + m_opts.rate_500) fail = 500;
+            else if (u < m_opts.rate_429 + m_opts.rate_500 + m_opts.rate_timeout) fail = 0;
+        }
+        if (fail == 429) ++m_stats.throttled;
+        else if (fail == 500) ++m_stats.server_errors;
+        else if (fail == 0) ++m_stats.timeouts;
+        else if (stream && !provider.empty()) ++m_stats.streamed;
+    }
+    if (c.free_at == Clock::time_point::max()) return; // dietro una richiesta appesa: nessuna risposta
+    auto at = std::max(Clock::now() + std::chrono::milliseconds(draw_latency_ms()), c.free_at);
+    auto plain = [&](const std::string& status, const std::string& extra, const std::string& json) {
+        schedule(c, at, "HTTP/1.1 " + status + "\r\nContent-Type: application/json\r\n" + extra +
+                        "Content-Length: " + std::to_string(json.size()) + "\r\n\r\n" + json);
+    };
+    if (fail == 0) { c.free_at = Clock::time_point::max(); return; } // appeso: il client scade o chiude
+    if (provider.empty()) return plain("404 Not Found", "", R"j({"error":{"message":"unknown path (mock)"}})j");
+    if (fail == 429) return plain("429 Too Many Requests", "Retry-After: " + std::to_string(m_opts.retry_after_s) + "\r\n",
+                                  R"j({"error":{"message":"rate limited (mock)","type":"rate_limit_error"}})j");
+    if (fail == 500) return plain("500 Internal Server Error", "", R"j({"error":{"message":"internal error (mock)","type":"server_error"}})j");
+
+    const std::string& text = m_opts.plans[m_next_plan++ % m_opts.plans.size()];
+    const int p = m_opts.prompt_tokens, k = m_opts.cached_tokens, o = m_opts.completion_tokens;
+    std::string usage_openai = R"("usage":{"prompt_tokens":)" + std::to_string(p) + R"(,"completion_tokens":)" + std::to_string(o) +
+                               R"(,"total_tokens":)" + std::to_string(p + o) + R"(,"prompt_tokens_details":{"cached_tokens":)" + std::to_string(k) + "}}";
+    std::string usage_gemini = R"("usageMetadata":{"promptTokenCount":)" + std::to_string(p) + R"(,"candidatesTokenCount":)" + std::to_string(o) +
+                               R"(,"totalTokenCount":)" + std::to_string(p + o) + R"(,"cachedContentTokenCount":)" + std::to_string(k) + "}";
+    if (!stream) {
+        std::string json;
+        if (provider == "openai")
+            json = R"({"id":"mock","object":"chat.completion","choices":[{"index":0,"message":{"role":"assistant","content":")" + esc(text) +
+                   R"("},"finish_reason":"stop"}],)" + usage_openai + "}";
+        else if (provider == "ollama")
+            json = R"({"model":"mock","response":")" + esc(text) + R"(","done":true,"prompt_eval_count":)" + std::to_string(p) +
+                   R"(,"eval_count":)" + std::to_string(o) + "}";
+        else if (provider == "claude")
+            json = R"({"type":"message","content":[{"type":"text","text":")" + esc(text) + R"("}],"usage":{"input_tokens":)" + std::to_string(p - k) +
+                   R"(,"output_tokens":)" + std::to_string(o) + R"(,"cache_read_input_tokens":)" + std::to_string(k) + "}}";
+        else
+            json = R"({"candidates":[{"content":{"parts":[{"text":")" + esc(text) + R"("}],"role":"model"}}],)" + usage_gemini + "}";
+        return plain("200 OK", "", json);
+    }
+
+    // Streaming: un evento per pezzo di testo, chunked encoding, il primo con gli header
+    std::vector<std::string> events;
+    for (std::size_t off = 0; off < text.size(); off += m_opts.chunk_bytes) {
+        std::string piece = esc(text.substr(off, m_opts.chunk_bytes));
+        if (provider == "openai") events.push_back(R"(data: {"id":"mock","object":"chat.completion.chunk","choices":[{"index":0,"delta":{"content":")" + piece + "\"}}]}\n\n");
+        else if (provider == "ollama") events.push_back(R"({"model":"mock","response":")" + piece + "\",\"done\":false}\n");
+        else if (provider == "claude") events.push_back("event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":{\"type\":\"text_delta\",\"text\":\"" + piece + "\"}}\n\n");
+        else events.push_back(R"(data: {"candidates":[{"content":{"parts":[{"text":")" + piece + "\"}],\"role\":\"model\"}}]}\n\n");
+    }
+    std::string last;
+    if (provider == "openai") last = R"(data: {"id":"mock","object":"chat.completion.chunk","choices":[],)" + usage_openai + "}\n\ndata: [DONE]\n\n";
+    else if (provider == "ollama") last = R"({"model":"mock","response":"","done":true,"prompt_eval_count":)" + std::to_string(p) + R"(,"eval_count":)" + std::to_string(o) + "}\n";
+    else if (provider == "claude") last = "event: message_delta\ndata: {\"type\":\"message_delta\",\"usage\":{\"output_tokens\":" + std::to_string(o) + "}}\n\nevent: message_stop\ndata: {\"type\":\"message_stop\"}\n\n";
+    else last = R"(data: {"candidates":[{"content":{"parts":[{"text":""}],"role":"model"}}],)" + usage_gemini + "}\n\n";
+    std::string head = std::string("HTTP/1.1 200 OK\r\nContent-Type: ") + (provider == "ollama" ? "application/x-ndjson" : "text/event-stream") +
+                       "\r\nTransfer-Encoding: chunked\r\n\r\n";
+    if (provider == "claude")
+        head += chunk("event: message_start\ndata: {\"type\":\"message_start\",\"message\":{\"usage\":{\"input_tokens\":" + std::to_string(p - k) +
+                      ",\"output_tokens\":1,\"cache_read_input_tokens\":" + std::to_string(k) + "}}}\n\n");
+    auto gap = std::chrono::milliseconds(m_opts.chunk_ms);
+    for (std::size_t i = 0; i < events.size(); ++i)
+        schedule(c, at + gap * static_cast<int>(i), (i == 0 ? head : std::string()) + chunk(events[i]));
+    schedule(c, at + gap * static_cast<int>(events.empty() ? 0 : events.size() - 1), (events.empty() ? head : std::string()) + chunk(last) + "0\r\n\r\n");
+}
+
+} // namespace autoshell::ai
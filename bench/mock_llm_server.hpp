@@ -0,0 +1,86 @@
+// Local mock LLM server for offline tests and load tests (POSIX). Speaks the wire formats of the
+// providers in llm_openai.cpp / llm_ollama.cpp, picked by path:
+//   /v1/chat/completions           OpenAI   (SSE chunks + include_usage when "stream":true)
+//   /api/generate                  Ollama   (NDJSON when "stream":true)
+//   /v1/messages                   Anthropic (SSE message_start / content_block_delta / message_delta)
+//   /v1beta/models/<m>:generateContent, :streamGenerateContent?alt=sse   Gemini
+// Answers are canned plan bodies (round-robin) after a latency drawn from the configured
+// distribution; streamed answers are cut in chunks spaced by chunk_ms. Errors are injected at the
+// configured rates (429 with Retry-After, 500, timeout = request never answered) or on demand.
+// One thread, poll(2) loop, HTTP/1.1 keep-alive.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct MockLLMOptions {
+    enum class Latency { Fixed, Uniform, LogNormal };
+    int port = 0;                       // 0 = a free port (see MockLLMServer::port())
+    Latency latency = Latency::Fixed;   // time to first byte
+    int latency_ms = 0;                 // Fixed: the value; Uniform: minimum; LogNormal: median
+    int latency_max_ms = 0;             // Uniform: maximum
+    double latency_sigma = 0.5;         // LogNormal: sigma of ln(latency)
+    int chunk_ms = 0;                   // streaming: delay between chunks
+    std::size_t chunk_bytes = 24;       // streaming: answer text per chunk
+    double rate_429 = 0.0, rate_500 = 0.0, rate_timeout = 0.0; // share of requests failed that way
+    int retry_after_s = 1;              // Retry-After of the 429s
+    std::vector<std::string> plans;     // canned answers (plan JSON); empty = one built-in 2-step plan
+    int prompt_tokens = 1200, completion_tokens = 60, cached_tokens = 0; // reported usage
+    std::uint64_t seed = 42;
+};
+
+// "fixed:200", "uniform:100-400", "lognormal:200,0.6" (ms) into opts; false if malformed.
+bool parse_mock_latency(const std::string& spec, MockLLMOptions& opts);
+
+class MockLLMServer {
+public:
+    struct Stats {
+        std::size_t requests = 0, connections = 0, streamed = 0;
+        std::size_t throttled = 0, server_errors = 0, timeouts = 0; // injected failures
+    };
+    explicit MockLLMServer(MockLLMOptions opts = {});
+    ~MockLLMServer();
+    MockLLMServer(const MockLLMServer&) = delete;
+    MockLLMServer& operator=(const MockLLMServer&) = delete;
+
+    bool ok() const { return m_fd >= 0; } // listening
+    int port() const { return m_port; }
+    // LLMConfig::endpoint for openai | ollama | claude | gemini.
+    std::string endpoint(const std::string& provider) const;
+    // The next n requests fail with status (429, 500, or 0 = never answered), before the random rates.
+    void fail_next(int n, int status);
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Conn { int fd; std::string in; bool continued = false; Clock::time_point free_at{}; };
+    void loop();
+    void serve(Conn& c);
+    void answer(Conn& c, const std::string& path, const std::string& body);
+    void schedule(Conn& c, Clock::time_point at, std::string data);
+    void flush_due();
+    int draw_latency_ms();
+
+    MockLLMOptions m_opts;
+    int m_fd = -1, m_port = 0;
+    std::vector<Conn> m_conns;
+    std::multimap<Clock::time_point, std::pair<int, std::string>> m_due; // fd, bytes
+    std::size_t m_next_plan = 0;
+    std::mt19937_64 m_rng;
+    mutable std::mutex m_mu; // m_stats, m_forced
+    Stats m_stats;
+    std::vector<int> m_forced;
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread;
+};
+
+} // namespace autoshell::ai
@@ -0,0 +1,129 @@
+// Session-lifetime HTTP transport shared by all LLM providers.
+// Keeps a pool of curl easy handles plus a curl share object (DNS cache, connection cache,
+// TLS sessions), so consecutive requests to the same host reuse the open keep-alive
+// connection instead of paying DNS + TCP + TLS again.
+// Transfers run on one curl_multi event loop thread: many requests can be outstanding at once,
+// and a cancelled or expired request is detached from the loop (connection closed) right away.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace autoshell::ai {
+
+// Shared cancellation flag: copies observe the same state (e.g. one token per ai command, set by SIGINT).
+class CancelToken {
+public:
+    CancelToken() : m_state(std::make_shared<State>()) {}
+    void cancel() const { m_state->flag.store(true); m_state->wake(); }
+    bool cancelled() const { return m_state->flag.load() || (m_parent && m_parent->cancelled()); }
+    // Token cancelled by its own cancel() or by this one's (e.g. one leg of a hedged request).
+    CancelToken child() const {
+        CancelToken c; c.m_parent = std::make_shared<CancelToken>(*this);
+        std::lock_guard<std::mutex> lk(m_state->mu);
+        std::erase_if(m_state->children, [](const std::weak_ptr<State>& w) { return w.expired(); });
+        m_state->children.push_back(c.m_state);
+        return c;
+    }
+    // Sleeps until t or until the token (or an ancestor) is cancelled, without polling; true = cancelled.
+    bool wait_until(std::chrono::steady_clock::time_point t) const {
+        std::unique_lock<std::mutex> lk(m_state->mu);
+        return m_state->cv.wait_until(lk, t, [this] { return cancelled(); });
+    }
+private:
+    struct State {
+        std::atomic<bool> flag{false};
+        std::mutex mu;
+        std::condition_variable cv;
+        std::vector<std::weak_ptr<State>> children; // woken too: their cancelled() follows the parent
+        void wake() {
+            std::vector<std::weak_ptr<State>> kids;
+            { std::lock_guard<std::mutex> lk(mu); cv.notify_all(); kids = children; }
+            for (auto& w : kids) if (auto k = w.lock()) k->wake();
+        }
+    };
+    std::shared_ptr<State> m_state;
+    std::shared_ptr<CancelToken> m_parent;
+};
+
+struct HttpRequest {
+    std::string url;
+    std::vector<std::string> headers; // "Name: value"
+    std::string body;                 // POST body (JSON)
+    long timeout_seconds = 20;
+    // Streaming: invoked for every received chunk (body is still accumulated); return false to abort.
+    std::function<bool(std::string_view)> on_data;
+    CancelToken cancel;
+    std::chrono::steady_clock::time_point deadline{}; // absolute limit; epoch = only timeout_seconds
+};
+
+// Where the time of one transfer went (curl timers, microseconds). Phases, not cumulative:
+// connect/tls are 0 on a reused connection, tls is 0 for plain HTTP; -1 = not measured.
+struct HttpTiming {
+    std::int64_t dns_us = -1;
+    std::int64_t connect_us = -1;
+    std::int64_t tls_us = -1;
+    std::int64_t ttfb_us = -1;   // from the start to the first response byte
+    std::int64_t total_us = -1;
+    std::int64_t bytes_down = 0;
+    std::int64_t bytes_up = 0;
+};
+
+struct HttpResponse {
+    long status = 0;        // HTTP status, 0 if the transfer failed
+    std::string body;
+    std::string error;      // curl error text, "cancelled" or "deadline exceeded"
+    long retry_after = -1;  // Retry-After of the answer in seconds (429/503), -1 = absent
+    HttpTiming timing;
+    bool ok() const { return error.empty() && status / 100 == 2; }
+    bool cancelled() const { return error == "cancelled"; }
+};
+
+struct HttpOptions {
+    std::size_t max_idle_handles = 8; // easy handles kept for reuse
+    bool http2 = true;                // negotiate HTTP/2 over TLS when the server supports it
+    long dns_cache_seconds = 300;
+    long keepalive_idle_seconds = 60; // TCP keep-alive probes on idle pooled connections
+};
+
+class HttpTransport {
+public:
+    struct Stats {
+        std::size_t requests = 0;
+        std::size_t connections = 0; // new connections opened (the rest reused one)
+        std::size_t cancelled = 0;   // cancelled or past their deadline
+    };
+    using DoneFn = std::function<void(HttpResponse)>;
+
+    explicit HttpTransport(HttpOptions opts = {});
+    ~HttpTransport();
+    HttpTransport(const HttpTransport&) = delete;
+    HttpTransport& operator=(const HttpTransport&) = delete;
+
+    // Queues a POST on the event loop; done runs on the loop thread when it ends (keep it short).
+    void submit(HttpRequest req, DoneFn done);
+    std::future<HttpResponse> post_async(HttpRequest req);
+    // Blocking POST (submit + wait); safe to call from several threads at once.
+    HttpResponse post(const HttpRequest& req);
+    Stats stats() const;
+
+    // Process-wide instance used by the provider clients (created on first use).
+    static HttpTransport& shared();
+    // Adjust the options of the shared instance; effective only before its first use.
+    static void configure_shared(const HttpOptions& opts);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m;
+};
+
+} // namespace autoshell::ai
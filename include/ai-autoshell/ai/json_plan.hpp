@@ -2,11 +2,47 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <string_view>
+#include <ai-autoshell/ai/json_pull.hpp>
 
 namespace autoshell::ai {
-struct ParsedStep { std::string id; std::string description; std::string command; bool confirm=false; };
+struct ParsedStep { std::string id; std::string description; std::string command; bool confirm=false;
+                    std::vector<std::string> depends_on; bool parallel=false;
+                    std::vector<std::string> inputs, outputs; };
 struct ParsedPlan { std::string request; std::vector<ParsedStep> steps; bool valid=false; };
 
-// Parse minimal JSON produced by LLM (assumes UTF-8, no nested objects except steps array).
+// Parse the plan JSON produced by the LLM: the first object holding a "steps" array (any text
+// or code fences around it are ignored). Strings are fully unescaped; valid once "steps" is closed.
 ParsedPlan parse_plan_json(const std::string& json);
+
+// Incremental parser for streamed responses: feed text deltas as they arrive; each step is
+// returned as soon as its object inside "steps" is closed (same field rules as parse_plan_json).
+// Each byte is examined once, however the text is split.
+class PlanStreamParser {
+public:
+    std::vector<ParsedStep> feed(std::string_view delta);
+    const std::string& text() const { return m_text; }
+    const std::string& request() const { return m_request; }
+    bool complete() const { return m_done; } // closing ']' of steps seen
+private:
+    friend ParsedPlan parse_plan_json(const std::string& json);
+    enum class Status { More, Done, Failed };
+    void reset();
+    // Drives the plan fields from the reader's tokens; Failed = not a plan object (retry at the next '{').
+    Status consume(JsonReader& r, std::vector<ParsedStep>& ready);
+    std::vector<std::string>* step_list(const std::string& key); // depends_on/inputs/outputs of m_cur
+
+    std::string m_text;
+    JsonReader m_reader;
+    bool m_reading = false;        // m_reader is on the object starting at m_start
+    bool m_stopped = false;        // plan finished, or broken after its steps began
+    std::size_t m_start = 0;
+    std::size_t m_steps_depth = 0; // reader depth inside the steps array, 0 until found
+    bool m_done = false, m_in_step = false;
+    enum class Pending { None, Steps, Request } m_pending = Pending::None;
+    std::string m_key;             // current field of the step being read
+    ParsedStep m_cur;
+    std::string m_request;
+    int m_idx = 1;                 // auto id counter ("s<N>")
+};
 }
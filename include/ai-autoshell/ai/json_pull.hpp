@@ -0,0 +1,71 @@
+// Single-pass pull JSON reader used for provider responses, stream events and plans.
+// The whole document can be read in place (zero-copy) or fed in chunks as it arrives: a token
+// split across chunks is reported as NeedMore and resumed on the next feed() without rescanning
+// the bytes already seen. Lenient where LLM output often is: trailing commas, raw control
+// characters inside strings, several top-level values in a row.
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace autoshell::ai {
+
+class JsonReader {
+public:
+    enum class Token { NeedMore, BeginObject, EndObject, BeginArray, EndArray, Key, String, Number, True, False, Null, End, Error };
+
+    JsonReader() = default;                                      // incremental: feed() + finish()
+    explicit JsonReader(std::string_view doc) : m_in(doc), m_final(true) {} // doc must outlive the reader
+
+    void feed(std::string_view chunk);
+    void finish() { m_final = true; }
+    Token next();
+    // After BeginObject/BeginArray: consumes the rest of that container (strings are not decoded).
+    // False on truncated or malformed input.
+    bool skip();
+
+    // Key/String: unescaped text (a view of the input when the string has no escapes);
+    // Number: the raw literal. Valid until the next call to next() or feed().
+    std::string_view text() const { return m_text; }
+    std::size_t depth() const { return m_stack.size(); } // open containers
+    std::size_t offset() const { return m_base + m_pos; } // bytes consumed so far
+    const std::string& error() const { return m_error; }
+
+private:
+    enum class Expect : unsigned char { Value, ValueOrEnd, KeyOrEnd, Colon, CommaOrEnd };
+    Token step();
+    Token value(char c);
+    Token string_token();
+    Token number();
+    Token literal(std::string_view word, Token t);
+    Token close(char c);
+    Token scalar(Token t) { m_expect = m_stack.empty() ? Expect::Value : Expect::CommaOrEnd; return t; }
+    Token fail(const char* what);
+
+    std::string m_buf;      // incremental mode: unconsumed input
+    std::string_view m_in;  // m_buf or the caller's document
+    std::size_t m_pos = 0, m_base = 0;
+    bool m_owned = false, m_final = false, m_failed = false, m_skipping = false;
+    std::vector<char> m_stack;
+    Expect m_expect = Expect::Value;
+    Token m_last = Token::NeedMore;
+    std::string_view m_text;
+    std::string m_scratch;  // decoded strings with escapes
+    std::string m_error;
+    // String split across chunks: where scanning stopped (absolute offsets)
+    std::size_t m_str_start = std::string::npos, m_str_scan = 0;
+    bool m_str_escaped = false;
+};
+
+// Values at several paths in one pass over json (its first top-level value). A path lists object
+// keys and array indices, e.g. {"choices","0","message","content"}. Strings come back unescaped,
+// numbers/true/false/null as written; containers and missing paths as nullopt.
+std::vector<std::optional<std::string>> json_pick(std::string_view json,
+                                                  std::initializer_list<std::initializer_list<std::string_view>> paths);
+// Non-negative integer value of a picked field, -1 otherwise.
+int json_to_int(const std::optional<std::string>& v);
+
+} // namespace autoshell::ai
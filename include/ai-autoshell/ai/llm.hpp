@@ -1,9 +1,14 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <functional>
 #include <memory>
+#include <future>
+#include <chrono>
+#include <ai-autoshell/ai/http.hpp>
+#include <ai-autoshell/ai/stream.hpp>
 
 namespace autoshell::ai {
 
@@ -16,10 +21,27 @@ struct LLMConfig {
     std::string api_key;             // direct key (less secure; prefer env)
     std::string stub_file;           // local file with canned responses (for offline)
     int max_tokens = 512;
+    std::string system_prompt;       // fixed instructions for the provider's system slot (cacheable prefix, prompt.hpp)
+    std::string keep_alive;          // ollama: how long the model (and its prompt cache) stays loaded, e.g. "30m"
     double temperature = 0.2;
     int timeout_seconds = 20;        // network timeout
     double prompt_price_per_1k = 0.0;    // USD cost per 1K prompt tokens (for cost estimation)
     double completion_price_per_1k = 0.0; // USD cost per 1K completion tokens
+    // Hedging (llm_hedge): the same request also goes to a second provider when this one is slow
+    std::string hedge_provider;      // empty = off
+    std::string hedge_model;
+    std::string hedge_endpoint;
+    std::string hedge_api_key_env;   // empty = same key settings when the provider is the same
+    int hedge_delay_ms = 1500;       // wait for the primary before hedging; 0 = both at once
+    // Resilience (llm_retries / llm_fallback): retries with backoff, circuit breaker, failover
+    int retries = 0;                 // extra attempts per provider on 429/5xx/timeout (0 and no fallback = off)
+    int backoff_base_ms = 250;       // full jitter: random(0, min(max, base * 2^attempt))
+    int backoff_max_ms = 8000;       // also the longest Retry-After waited for before failing over
+    int attempt_timeout_ms = 0;      // per-attempt limit (0 = only the request deadline)
+    double breaker_error_rate = 0.5; // open a provider's circuit at this rolling failure rate
+    int breaker_slow_ms = 0;         // calls slower than this count as failures (0 = off)
+    int breaker_cooldown_ms = 30000; // open circuit: time before one probe request
+    std::vector<std::string> fallback; // next providers, "provider[:model][@endpoint]"
 };
 
 // Response from LLM completion.
@@ -32,12 +54,57 @@ struct LLMCompletion {
     double prompt_cost = -1.0;       // estimated USD cost for prompt part
     double completion_cost = -1.0;   // estimated USD cost for completion part
     double total_cost = -1.0;        // sum
+    long http_status = -1;           // status of the remote call (0 = transport failure/timeout, -1 = no request)
+    long retry_after_ms = -1;        // Retry-After of a throttled answer (-1 = absent)
+    HttpTiming timing{};             // transfer phases of the remote call (ai stats)
+    int cached_tokens = -1;          // prompt tokens served from the provider's prompt cache (if reported)
 };
 
+// Receives each text fragment of a streamed completion, in order.
+using LLMDeltaFn = std::function<void(std::string_view)>;
+
 class LLMClient {
 public:
     virtual ~LLMClient() = default;
     virtual std::optional<LLMCompletion> complete(const std::string& prompt) = 0;
+    // Streaming variant (SSE/NDJSON for remote providers): on_delta sees the text as it is generated,
+    // the returned completion carries the full text. Default: one delta with the whole answer.
+    virtual std::optional<LLMCompletion> complete_stream(const std::string& prompt, const LLMDeltaFn& on_delta) {
+        auto r = complete(prompt);
+        if (r && r->source != "error" && on_delta) on_delta(r->text);
+        return r;
+    }
+    // Asynchronous request: the future holds nullopt as soon as cancel fires (the transfer is dropped,
+    // no further network or CPU use); a passed deadline yields an "(timeout)" error completion.
+    // Default (local clients): answered synchronously.
+    virtual std::future<std::optional<LLMCompletion>> complete_async(const std::string& prompt, LLMDeltaFn on_delta = {},
+                                                                     CancelToken cancel = {}, std::chrono::steady_clock::time_point deadline = {}) {
+        (void)deadline;
+        std::promise<std::optional<LLMCompletion>> p;
+        if (cancel.cancelled()) p.set_value(std::nullopt);
+        else p.set_value(on_delta ? complete_stream(prompt, on_delta) : complete(prompt));
+        return p.get_future();
+    }
+};
+
+// Remote providers: describe the HTTP call and how to read its answer; HttpTransport::shared() runs it
+// on its curl_multi event loop. Sync calls are complete_async(...).get().
+class HttpLLMClient : public LLMClient {
+public:
+    std::optional<LLMCompletion> complete(const std::string& prompt) override { return complete_async(prompt).get(); }
+    std::optional<LLMCompletion> complete_stream(const std::string& prompt, const LLMDeltaFn& on_delta) override { return complete_async(prompt, on_delta).get(); }
+    std::future<std::optional<LLMCompletion>> complete_async(const std::string& prompt, LLMDeltaFn on_delta = {},
+                                                             CancelToken cancel = {}, std::chrono::steady_clock::time_point deadline = {}) override;
+protected:
+    struct Call {
+        std::optional<LLMCompletion> error; // unusable config (missing key...): no request is made
+        HttpRequest req;
+        std::function<LLMCompletion(const HttpResponse&)> finish; // runs on the transport loop thread
+    };
+    // Empty on_delta = non-streaming request; otherwise on_delta is called from the loop thread.
+    virtual Call prepare(const std::string& prompt, const LLMDeltaFn& on_delta) = 0;
+    // Hooks req.on_data to an SSE/NDJSON decoder; finish must call the returned flush first.
+    static std::function<void()> stream_events(HttpRequest& req, StreamDecoder::Format format, StreamDecoder::EventFn on_event);
 };
 
 // Stub implementation: if stub_file set, returns first matching line (or whole file); otherwise echoes prompt.
@@ -50,14 +117,36 @@ private:
 };
 
 // OpenAI client (Chat Completions minimal). Richiede libcurl.
-class OpenAILLMClient : public LLMClient {
+class OpenAILLMClient : public HttpLLMClient {
 public:
     explicit OpenAILLMClient(const LLMConfig& cfg) : m_cfg(cfg) {}
-    std::optional<LLMCompletion> complete(const std::string& prompt) override;
 private:
+    Call prepare(const std::string& prompt, const LLMDeltaFn& on_delta) override;
     LLMConfig m_cfg;
 };
 
+// Races two providers (llm_hedge). The request goes to the primary; if no valid plan has arrived after
+// `delay` (or the primary already failed) it is sent to the secondary as well. The first answer that
+// parse_plan_json accepts wins and the other transfer is cancelled; if neither is valid the primary's
+// answer is returned. When streaming, the first leg to send a byte wins instead: its deltas are
+// forwarded as they arrive and the other leg is cancelled (or never started) at that point.
+class HedgedLLMClient : public LLMClient {
+public:
+    struct Stats { std::size_t requests = 0, hedged = 0, secondary_wins = 0, losers_cancelled = 0; };
+    HedgedLLMClient(std::unique_ptr<LLMClient> primary, std::unique_ptr<LLMClient> secondary, std::chrono::milliseconds delay);
+    std::optional<LLMCompletion> complete(const std::string& prompt) override { return complete_async(prompt).get(); }
+    std::optional<LLMCompletion> complete_stream(const std::string& prompt, const LLMDeltaFn& on_delta) override { return complete_async(prompt, on_delta).get(); }
+    std::future<std::optional<LLMCompletion>> complete_async(const std::string& prompt, LLMDeltaFn on_delta = {},
+                                                             CancelToken cancel = {}, std::chrono::steady_clock::time_point deadline = {}) override;
+    Stats stats() const;
+private:
+    struct Counters;
+    struct Race;
+    std::shared_ptr<LLMClient> m_primary, m_secondary;
+    std::chrono::milliseconds m_delay;
+    std::shared_ptr<Counters> m_counters;
+};
+
 // Factory helper (for future provider switch)
 // Forward for extended factory (defined in llm_ollama.cpp)
 std::unique_ptr<LLMClient> make_llm_provider_extended(const LLMConfig&);
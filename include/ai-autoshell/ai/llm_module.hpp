@@ -0,0 +1,37 @@
+// LLM module: provider clients, HttpTransport and libcurl built as a separate shared object
+// (libai-autoshell-llm) and loaded with dlopen on the first `ai` request that needs a model, so a
+// session that never plans with an LLM pays nothing for them (startup, RSS, page tables on fork).
+// Builds without AI_AUTOSHELL_LLM_MODULE (Windows, tests) link the module statically instead.
+#pragma once
+#include <ai-autoshell/ai/http.hpp>
+#include <ai-autoshell/ai/llm.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace autoshell::ai {
+
+// What the shell uses of the module. Only this interface crosses the boundary: the concrete
+// clients (ResilientLLMClient, HedgedLLMClient...) stay inside, so their stats come through here.
+class LLMModule {
+public:
+    virtual ~LLMModule() = default;
+    virtual std::unique_ptr<LLMClient> make_llm(const LLMConfig& cfg) = 0;
+    virtual void configure_http(const HttpOptions& opts) = 0; // effective before the first request
+    virtual HttpTransport::Stats http_stats() = 0;
+    // Failovers so far of a client from make_llm (0 without llm_retries / llm_fallback).
+    virtual std::size_t failovers(LLMClient& client) = 0;
+    // "[DEBUG] Resilience: ..." / "[DEBUG] Hedge ...: ..." lines for a client from make_llm ("" if none).
+    virtual std::string debug_report(LLMClient& client, const LLMConfig& cfg) = 0;
+};
+
+// Loads the module on the first call (later calls return the same instance, it is never unloaded).
+// Search order: $AI_AUTOSHELL_LLM_MODULE, the executable's directory, the install directory, the
+// dynamic linker path. nullptr if it cannot be loaded, with the reason in *error.
+LLMModule* llm_module(std::string* error = nullptr);
+bool llm_module_loaded(); // without loading it
+
+} // namespace autoshell::ai
+
+// Entry point exported by the module (the only visible symbol of libai-autoshell-llm).
+extern "C" autoshell::ai::LLMModule* ai_autoshell_llm_module();
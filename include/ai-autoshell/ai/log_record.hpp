@@ -0,0 +1,39 @@
+// Append-only log files of the AI layer (plan cache, plan journal): one record per line, fields
+// separated by TAB (TAB/newline/backslash escaped), then TAB + FNV-1a of the rest. A line cut
+// short by a crash fails the checksum and is skipped on replay.
+#pragma once
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace autoshell::ai {
+
+std::string log_record(std::initializer_list<std::string> fields);
+bool parse_log_record(std::string_view line, std::vector<std::string>& fields);
+
+// Calls fn for every valid record of the file; false if it cannot be read. torn: the file ends
+// with an incomplete line (interrupted write), worth a rewrite.
+bool replay_log(const std::string& path, const std::function<void(const std::vector<std::string>&)>& fn, bool* torn = nullptr);
+// One write per record (O_APPEND: several shells may share the file); creates the directory.
+bool append_log(const std::string& path, const std::string& record, bool sync);
+// Replaces the whole log atomically (temporary file + rename).
+bool rewrite_log(const std::string& path, const std::string& records);
+
+// Advisory lock (flock) on path + ".lock" for logs shared by several shells: shared around an
+// append, exclusive around a re-read followed by appends or a rewrite, so a shell compacting
+// the log, or numbering a new entry, sees every record the others wrote. No-op if the lock file
+// cannot be opened. append_log/rewrite_log do not take it themselves.
+class LogLock {
+public:
+    LogLock(const std::string& path, bool exclusive);
+    ~LogLock();
+    LogLock(const LogLock&) = delete;
+    LogLock& operator=(const LogLock&) = delete;
+
+private:
+    int m_fd = -1;
+};
+
+} // namespace autoshell::ai
@@ -0,0 +1,75 @@
+// Batch planning (--plan-batch): many requests planned concurrently through one LLMClient, under a
+// requests/tokens-per-minute limiter. Identical requests (PlanCache key normalization) are planned
+// once, requests already in the plan cache cost no call, and short requests can be packed several
+// per LLM call (a JSON array of plans in the same order; the ones missing from the answer are asked
+// again one by one). Results are delivered in input order.
+#pragma once
+#include <ai-autoshell/ai/llm.hpp>
+#include <ai-autoshell/ai/planner.hpp>
+#include <ai-autoshell/ai/prompt.hpp>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace autoshell::ai {
+
+// Two token buckets refilled continuously over a minute (0 = unlimited): requests and tokens.
+// reserve() debits at once and says when the caller may start, so concurrent callers are spaced
+// instead of bursting together; settle() corrects the estimate with the tokens actually used.
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+    RateLimiter(int requests_per_minute, int tokens_per_minute);
+    Clock::time_point reserve(std::size_t tokens, Clock::time_point now = Clock::now());
+    void acquire(std::size_t tokens); // reserve + sleep
+    void settle(std::size_t estimated, std::size_t actual);
+    void pause_until(Clock::time_point t); // provider throttled us (429 + Retry-After)
+private:
+    struct Bucket { double capacity = 0, level = 0; };
+    void refill(Clock::time_point now);
+    std::mutex m_mu;
+    Bucket m_requests, m_tokens;
+    Clock::time_point m_last{}, m_paused{};
+};
+
+struct BatchOptions {
+    std::size_t jobs = 4;                      // LLM calls in flight
+    int requests_per_minute = 0;               // 0 = unlimited
+    int tokens_per_minute = 0;                 // prompt + max_tokens reserved, real usage settled
+    std::size_t pack = 1;                      // requests per LLM call (1 = no packing)
+    std::size_t pack_max_chars = 160;          // only requests up to this length are packed
+    std::size_t max_tokens = 512;              // completion tokens per request (TPM reservation)
+    std::string system_prompt;                 // counted in the TPM estimate (LLMConfig::system_prompt)
+    std::vector<PromptSection> context;        // sections of every prompt (e.g. Environment)
+    std::function<std::optional<std::string>(const std::string& request)> cache_get; // plan text or nullopt
+    std::function<void(const std::string& request, const std::string& plan_text)> cache_put;
+    std::function<bool(const std::string& command)> risky; // extra confirm rule (besides the model's)
+};
+
+struct BatchResult {
+    std::size_t index = 0;  // position in the input
+    Plan plan;              // plan.request = the input request
+    std::string source;     // llm | packed | cache | duplicate | error
+    std::string error;      // non-empty when no plan was produced
+    int prompt_tokens = -1, completion_tokens = -1; // of the call (shared by packed requests)
+};
+
+struct BatchStats {
+    std::size_t requests = 0, planned = 0, failed = 0, cache_hits = 0, duplicates = 0;
+    std::size_t llm_calls = 0, packed_calls = 0;
+    long long prompt_tokens = 0, completion_tokens = 0;
+    long long wall_ms = 0;
+};
+
+// on_result runs under a lock, in input order, as soon as every earlier request is done.
+BatchStats run_plan_batch(const std::vector<std::string>& requests, LLMClient& client, const BatchOptions& opts,
+                          const std::function<void(const BatchResult&)>& on_result);
+
+// One JSON line: to_json(plan, false), with an "error" field first for failed requests.
+std::string batch_result_json(const BatchResult& r);
+
+} // namespace autoshell::ai
@@ -0,0 +1,81 @@
+// Persistent plan cache: LLM plans keyed by normalized request + provider + model + prompt version.
+// In memory it is an LRU list with a size cap and a TTL; on disk it is an append-only log
+// (one checksummed record per line) replayed at startup and compacted when it grows, so a crash
+// can at most lose the record being written. Several shells may share the log: appends take its
+// LogLock shared, compaction takes it exclusive and re-reads the log first, so no record is lost.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct PlanCacheOptions {
+    std::string path;                          // log file; empty = memory only
+    std::size_t max_entries = 256;
+    std::size_t max_bytes = 1 << 20;           // request + plan text of all entries
+    std::int64_t ttl_seconds = 7 * 24 * 3600;  // 0 = entries never expire
+    std::function<std::int64_t()> now;         // seconds since epoch; default system clock (tests inject)
+};
+
+class PlanCache {
+public:
+    struct Entry {
+        std::string key;
+        std::string request; // as typed the first time
+        std::string plan;    // raw LLM plan text
+        std::int64_t created = 0;
+        std::int64_t last_used = 0;
+        std::uint64_t hits = 0;
+    };
+    struct Stats {
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+        std::uint64_t hits = 0;      // this session
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0; // LRU (size cap) + expired
+        double hit_rate() const { return hits + misses ? double(hits) / double(hits + misses) : 0.0; }
+    };
+
+    explicit PlanCache(PlanCacheOptions opts);
+
+    // "provider|model|version|request" with the request lower-cased and blanks collapsed.
+    static std::string make_key(std::string_view request, std::string_view provider, std::string_view model,
+                                std::string_view prompt_version);
+
+    // count=false: lookup not reflected in hits/misses (callers with their own counters).
+    std::optional<std::string> get(const std::string& key, bool count = true);
+    void put(const std::string& key, const std::string& request, const std::string& plan);
+    void clear();
+    std::vector<Entry> entries() const; // most recently used first
+    Stats stats() const;
+    const PlanCacheOptions& options() const { return m_opts; }
+
+private:
+    using List = std::list<Entry>;
+    std::int64_t now() const;
+    void load();
+    void apply(const std::vector<std::string>& rec);
+    void erase(List::iterator it, bool log);
+    void enforce_limits(bool log = true);
+    void append(const std::string& record, bool sync);
+    bool reload();
+    void compact(bool merge = true);
+
+    PlanCacheOptions m_opts;
+    mutable std::mutex m_mu;
+    List m_lru; // front = most recently used
+    std::unordered_map<std::string, List::iterator> m_index;
+    std::size_t m_bytes = 0;
+    std::size_t m_log_records = 0;
+    Stats m_stats;
+};
+
+} // namespace autoshell::ai
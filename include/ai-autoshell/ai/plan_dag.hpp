@@ -0,0 +1,58 @@
+// Dependency-aware execution of plan steps.
+// A step with "depends_on" waits for exactly those steps; a step without it waits for the previous
+// step, unless it is marked "parallel". Plans with neither field are the usual sequential list.
+// Independent steps run concurrently (each in a forked child, bounded by max_parallel); their output
+// is captured and printed in plan order, one step at a time, streaming the first unfinished one.
+// A failed step (exit status != 0) skips everything that depends on it, directly or not.
+// Since every step has its own process, shell state (cd, export, VAR=x) never crosses steps:
+// a concurrent plan with a step that only changes it is rejected by build_plan_graph.
+#pragma once
+#include <ai-autoshell/ai/planner.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct PlanGraph {
+    std::vector<std::vector<std::size_t>> deps; // per step, indexes of the steps it waits for
+    bool concurrent = false;                    // some step uses depends_on or parallel
+    std::string error;                          // unknown/duplicate id, cycle or state-only step: the plan must not run
+};
+
+PlanGraph build_plan_graph(const std::vector<PlanStep>& steps);
+
+// The command only changes shell state: every part is cd, pushd, popd, export, unset, set, alias,
+// umask, source, '.' or a bare VAR=x ("cd build", "X=1; export X").
+bool shell_state_only(const std::string& command);
+
+struct StepOutcome {
+    enum class State { Ok, Failed, Skipped };
+    State state = State::Skipped;
+    int status = -1;          // exit status (Ok/Failed)
+    std::string blocked_by;   // Skipped: id of the failed step (or "interrupted")
+    std::int64_t duration_ms = -1; // Ok/Failed: wall time of the step
+    bool up_to_date = false;  // Ok without running (DagRunOptions::up_to_date)
+};
+
+struct DagRunOptions {
+    std::size_t max_parallel = 4;
+    // Runs step i in the child process (stdout/stderr already captured, stdin /dev/null); returns its
+    // exit status. The child leads its own process group: the commands it starts must stay in it.
+    std::function<int(std::size_t)> run;
+    // Polled: running steps get SIGTERM with their whole group (SIGKILL after a grace period) and
+    // reap their commands before exiting; the rest are skipped.
+    std::function<bool()> interrupted;
+    std::ostream* out = nullptr;                // where the grouped output goes (default std::cout)
+    std::vector<bool> done;                     // steps completed by an earlier run (ai resume): not run, count as Ok
+    std::function<bool(std::size_t)> up_to_date; // in the parent, once the step is ready: true = outputs up to date, not run
+    std::function<void(std::size_t)> on_start;  // in the parent, when a step is started / finished
+    std::function<void(std::size_t, const StepOutcome&)> on_finish; // also for skipped steps
+};
+
+std::vector<StepOutcome> run_plan_dag(const std::vector<PlanStep>& steps, const PlanGraph& graph, const DagRunOptions& opts);
+
+} // namespace autoshell::ai
@@ -0,0 +1,78 @@
+// Checkpoints of executed AI plans (ai resume): each 'ai auto' run is journaled with its steps and,
+// as they start and finish, every step's state, exit status and duration. A failed or interrupted
+// run can be resumed later from the stored plan: no LLM call, completed steps are not run again.
+// On disk it is an append-only log (log_record.hpp) keeping the last max_runs runs. Several shells
+// may share it: ids are numbered and the log compacted under its LogLock, after re-reading it.
+#pragma once
+#include <ai-autoshell/ai/planner.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct PlanJournalOptions {
+    std::string path;                  // log file; empty = memory only
+    std::size_t max_runs = 20;
+    std::function<std::int64_t()> now; // milliseconds since epoch; default system clock (tests inject)
+};
+
+class PlanJournal {
+public:
+    // Running = started and never finished (shell killed mid-step): resumed like Pending.
+    enum class StepState { Pending, Running, Ok, Failed, Skipped };
+    struct StepRecord {
+        StepState state = StepState::Pending;
+        int status = -1;
+        std::int64_t started_ms = 0;
+        std::int64_t duration_ms = -1;
+    };
+    struct Run {
+        std::string id;                  // "1", "2", ... increasing, unique across the shells sharing the log
+        std::string request;
+        std::string cwd;                 // working directory of the run (steps use relative paths)
+        std::int64_t created_ms = 0;
+        std::vector<PlanStep> steps;
+        std::vector<StepRecord> records; // one per step
+        bool complete() const;           // every step Ok
+        std::size_t remaining() const;   // steps not Ok
+        // Steps 'ai resume' does not run again: the Ok ones, except those that only change shell
+        // state (cd, export, ...). Those are replayed, so later steps get their directory/environment.
+        std::vector<bool> resume_done() const;
+    };
+
+    explicit PlanJournal(PlanJournalOptions opts);
+
+    // New run started in directory cwd; returns its id.
+    std::string begin(const std::string& request, const std::vector<PlanStep>& steps, const std::string& cwd = "");
+    void step_started(const std::string& id, std::size_t step);
+    void step_finished(const std::string& id, std::size_t step, StepState state, int status, std::int64_t duration_ms);
+    // id empty: the most recent run that is not complete.
+    std::optional<Run> find(const std::string& id) const;
+    std::vector<Run> runs() const; // most recent first
+    const PlanJournalOptions& options() const { return m_opts; }
+
+    static const char* state_name(StepState s);
+
+private:
+    std::int64_t now() const;
+    void apply(const std::vector<std::string>& rec);
+    Run* lookup(const std::string& id);
+    void append(const std::string& record, bool sync);
+    // Both with the exclusive LogLock held: runs as on disk (other shells included), then the
+    // log rewritten with the last max_runs of them.
+    bool reload(bool* torn);
+    void compact();
+
+    PlanJournalOptions m_opts;
+    mutable std::mutex m_mu;
+    std::vector<Run> m_runs; // oldest first
+    std::uint64_t m_next_id = 1;
+    std::size_t m_log_records = 0;
+};
+
+} // namespace autoshell::ai
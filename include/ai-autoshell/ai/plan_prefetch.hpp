@@ -0,0 +1,72 @@
+// Speculative planning while the user types (ai_prefetch). When the line editor has been idle on an
+// `ai suggest|auto <request>` line, the plan is requested in the background and, if valid, stored in
+// the plan cache, so Enter often finds it ready. A prefetch for a request the user has since edited is
+// cancelled at once, only one is in flight, and a session budget (calls and USD) bounds the spend.
+// Single-threaded: every method runs on the REPL thread; finished prefetches are collected there.
+#pragma once
+#include <ai-autoshell/ai/llm.hpp>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <optional>
+#include <set>
+#include <string>
+
+namespace autoshell::ai {
+
+struct PrefetchOptions {
+    std::size_t min_chars = 8;      // shorter requests are still being typed
+    std::size_t max_requests = 20;  // LLM calls started per session
+    double max_cost = 0.0;          // USD per session, estimates of cancelled calls included (0 = calls only)
+};
+
+class PlanPrefetcher {
+public:
+    struct Stats {
+        std::size_t started = 0, cancelled = 0, stored = 0, used = 0, over_budget = 0;
+        double spent = 0.0; // USD: reported cost of finished calls, estimate of the others
+    };
+    // Sends the plan request (the same prompt Enter would send).
+    using Start = std::function<std::future<std::optional<LLMCompletion>>(const std::string& request, CancelToken cancel)>;
+    // Estimated USD cost of planning request with the LLM, or nullopt when no call is needed or allowed
+    // (rules or cache already cover it, above llm_max_request_cost...).
+    using Estimate = std::function<std::optional<double>(const std::string& request)>;
+    // Puts a valid answer in the plan cache; false if it was not usable.
+    using Store = std::function<bool(const std::string& request, const LLMCompletion& reply)>;
+
+    PlanPrefetcher(PrefetchOptions opts, Start start, Estimate estimate, Store store);
+    ~PlanPrefetcher();
+    PlanPrefetcher(const PlanPrefetcher&) = delete;
+    PlanPrefetcher& operator=(const PlanPrefetcher&) = delete;
+
+    // The request of an "ai suggest|auto <request>" line; nullopt for other lines, --fresh and ai resume.
+    static std::optional<std::string> request_of(const std::string& line);
+
+    void on_change(const std::string& line); // line editor: every edit (cancels a stale prefetch)
+    void on_idle(const std::string& line);   // line editor: after the debounce (starts one)
+    // Enter on request: waits for its prefetch if still in flight (cancelled when interrupted() turns
+    // true) and says whether the plan now in the cache came from a prefetch. Other prefetches are cancelled.
+    bool settle(const std::string& request, const std::function<bool()>& interrupted = {});
+    void cancel(); // drops the prefetch in flight, if any (e.g. Enter on `ai ... --fresh`)
+    Stats stats() const { return m_stats; }
+
+private:
+    struct InFlight {
+        std::string request, key;
+        CancelToken cancel;
+        std::future<std::optional<LLMCompletion>> reply;
+        double estimate = 0;
+    };
+    void collect(bool wait, const std::function<bool()>& interrupted);
+
+    PrefetchOptions m_opts;
+    Start m_start;
+    Estimate m_estimate;
+    Store m_store;
+    std::optional<InFlight> m_flight;
+    std::set<std::string> m_tried;  // keys already requested this session (no second spend)
+    std::set<std::string> m_stored; // keys stored by a prefetch and not used yet
+    Stats m_stats;
+};
+
+} // namespace autoshell::ai
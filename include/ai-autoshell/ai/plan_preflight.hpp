@@ -0,0 +1,39 @@
+// Pre-flight compilation of a plan: before any step runs, every step is lexed and parsed once,
+// its executables are resolved (in parallel) and its redirections checked. A plan with problems
+// does not start; otherwise the executor runs the compiled ASTs.
+#pragma once
+#include <ai-autoshell/ai/planner.hpp>
+#include <ai-autoshell/parse/ast.hpp>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct CompiledStep {
+    AST ast;                           // parsed once, run as is (empty for native steps)
+    bool native = false;               // run without the parser (PreflightOptions::native)
+    std::vector<std::string> problems; // why the step would fail before doing anything
+};
+
+struct PreflightOptions {
+    // Commands executed natively (e.g. 'for VAR in {A..B}; do ...; done'): not parsed nor checked.
+    std::function<bool(const std::string&)> native;
+    std::size_t resolve_threads = 8; // PATH lookups run concurrently
+};
+
+struct PreflightResult {
+    std::vector<CompiledStep> steps;   // one per plan step, same order
+    std::size_t problems = 0;
+    bool ok() const { return problems == 0; }
+};
+
+// Checks, per step: syntax (parse_tokens with error), command names (builtin, function defined
+// in the plan, or resolve_executable), '<' inputs that must exist, output redirections whose
+// directory must exist and be writable. Words needing expansion ($, globs, ~, braces) are not
+// judged, and a path mentioned by an earlier step (e.g. 'mkdir out', 'touch a') counts as
+// possibly created; after a 'cd' relative paths are no longer checked.
+PreflightResult preflight_plan(const std::vector<PlanStep>& steps, const PreflightOptions& opts = {});
+
+} // namespace autoshell::ai
@@ -0,0 +1,58 @@
+// Template plan cache: requests that differ only in their arguments ("mostra il file a.txt" /
+// "mostra il file b.txt") share one cached plan. Argument-like spans (paths, numbers, quoted strings,
+// names after "file"/"cartella"/... as in Planner::rule_expand) become slots; the LLM plan is stored
+// with the slot values replaced by placeholders and re-instantiated locally for new values.
+#pragma once
+#include <ai-autoshell/ai/plan_cache.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace autoshell::ai {
+
+enum class SlotKind { Path, Number, Quoted, Name };
+
+struct RequestShape {
+    std::string shape;               // normalized request with slots: "mostra il file <path>"
+    std::vector<std::string> values; // slot values, original case
+    std::vector<SlotKind> kinds;
+    bool safe = true;                // every value is free of shell metacharacters
+};
+
+RequestShape extract_slots(std::string_view request);
+
+struct PlanTemplate {
+    std::string text;        // plan text with {{@N}} placeholders
+    double confidence = 0.0; // 0..1, lowest per-slot score
+};
+
+// Per slot: 1.0 if the value appears as a whole word in a step command (0.7 for one-digit numbers),
+// 0.5 if it only appears inside other words, 0 if no command uses it. nullopt without slots.
+std::optional<PlanTemplate> make_template(const RequestShape& shape, const std::string& plan_text);
+// Fills the placeholders; nullopt if the result is not a valid plan.
+std::optional<std::string> instantiate(const PlanTemplate& t, const std::vector<std::string>& values);
+
+// Templates live in the PlanCache (same LRU/TTL/log) under "@tpl <shape>" keys.
+class TemplateCache {
+public:
+    struct Match { std::string plan; double confidence = 0.0; };
+    struct Stats { std::uint64_t hits = 0, misses = 0, learned = 0, rejected = 0; };
+
+    explicit TemplateCache(PlanCache& store, double min_confidence = 0.8) : m_store(store), m_min(min_confidence) {}
+    // count=false: not reflected in hits/misses (speculative lookups, e.g. the prefetch).
+    std::optional<Match> lookup(const std::string& request, const std::string& provider, const std::string& model,
+                                const std::string& prompt_version, bool count = true);
+    // Stores the plan as a template when its confidence reaches the threshold.
+    bool learn(const std::string& request, const std::string& provider, const std::string& model,
+               const std::string& prompt_version, const std::string& plan_text);
+    Stats stats() const { return m_stats; }
+    double min_confidence() const { return m_min; }
+
+private:
+    PlanCache& m_store;
+    double m_min;
+    Stats m_stats;
+};
+
+} // namespace autoshell::ai
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <ai-autoshell/ai/rule_table.hpp>
 
 namespace autoshell::ai {
 
@@ -12,36 +13,70 @@ struct PlanStep {
     std::string description;     // human description
     std::string command;         // shell command (argv joined) to execute
     bool confirm = false;        // require explicit user confirmation due to risk
+    std::vector<std::string> depends_on; // ids of the steps that must succeed first
+    bool parallel = false;       // no implicit dependency on the previous step
+    std::vector<std::string> inputs;  // files the step reads (see step_state.hpp)
+    std::vector<std::string> outputs; // files it produces: skipped when up to date with the inputs
 };
 
 // Full plan produced by planner.
 struct Plan {
     std::string request;               // original natural language request
-    std::vector<PlanStep> steps;       // ordered steps
+    std::vector<PlanStep> steps;       // ordered steps (see plan_dag.hpp for depends_on/parallel)
     std::string risk_summary;          // aggregated risk notes
     bool dangerous = false;            // any step flagged confirm
 };
 
+// JSON string escaping: quotes, backslashes and control characters.
+inline std::string json_escape(const std::string& s) {
+    std::string out;
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += static_cast<char>(c); }
+        else if (c == '\n') out += "\\n";
+        else if (c == '\t') out += "\\t";
+        else if (c == '\r') out += "\\r";
+        else if (c < 0x20) { const char* hex = "0123456789abcdef"; out += "\\u00"; out += hex[c >> 4]; out += hex[c & 15]; }
+        else out += static_cast<char>(c);
+    }
+    return out;
+}
+
 // Simple serialization to JSON (hand-written, minimal, no external lib).
-inline std::string to_json(const Plan& p) {
-    std::string out = "{\n";
-    out += "  \"request\": \""; // naive escaping (TODO improve)
-    for (char c : p.request) { if (c=='"') out += "\\\""; else out += c; }
-    out += "\",\n";
-    out += "  \"dangerous\": "; out += (p.dangerous?"true":"false"); out += ",\n";
-    out += "  \"risk_summary\": \""; for (char c: p.risk_summary){ if(c=='"') out+="\\\""; else out+=c; } out += "\",\n";
-    out += "  \"steps\": [\n";
+// pretty=false: one line (JSON lines, --plan-batch).
+// Only appends on out: "literal" + std::string temporaries trip GCC 12 -Wrestrict at -O3.
+inline std::string to_json(const Plan& p, bool pretty = true) {
+    const char* nl = pretty ? "\n" : "";
+    const char* in1 = pretty ? "  " : "";
+    const char* in2 = pretty ? "    " : "";
+    std::string out;
+    auto str = [&out](const std::string& s) { out += '"'; out += json_escape(s); out += '"'; };
+    auto field = [&](const char* indent, const char* name) { out += indent; out += '"'; out += name; out += "\": "; };
+    out += '{'; out += nl;
+    field(in1, "request"); str(p.request); out += ','; out += nl;
+    field(in1, "dangerous"); out += p.dangerous?"true":"false"; out += ','; out += nl;
+    field(in1, "risk_summary"); str(p.risk_summary); out += ','; out += nl;
+    field(in1, "steps"); out += '['; out += nl;
     for (size_t i=0;i<p.steps.size();++i) {
         auto &s = p.steps[i];
-        out += "    { \"id\": \"" + s.id + "\", \"description\": \"";
-        for(char c: s.description){ if(c=='"') out+="\\\""; else out+=c; }
-        out += "\", \"command\": \"";
-        for(char c: s.command){ if(c=='"') out+="\\\""; else out+=c; }
-        out += "\", \"confirm\": "; out += (s.confirm?"true":"false"); out += " }";
+        out += in2; out += "{ \"id\": "; str(s.id); out += ", \"description\": "; str(s.description);
+        out += ", \"command\": "; str(s.command); out += ", \"confirm\": "; out += s.confirm?"true":"false";
+        if (!s.depends_on.empty()) {
+            out += ", \"depends_on\": [";
+            for (size_t d=0; d<s.depends_on.size(); ++d) { if (d) out += ", "; str(s.depends_on[d]); }
+            out += "]";
+        }
+        if (s.parallel) out += ", \"parallel\": true";
+        for (auto* files : {&s.inputs, &s.outputs}) {
+            if (files->empty()) continue;
+            out += files == &s.inputs ? ", \"inputs\": [" : ", \"outputs\": [";
+            for (size_t f=0; f<files->size(); ++f) { if (f) out += ", "; str((*files)[f]); }
+            out += "]";
+        }
+        out += " }";
         if (i+1<p.steps.size()) out += ",";
-        out += "\n";
+        out += nl;
     }
-    out += "  ]\n";
+    out += in1; out += ']'; out += nl;
     out += "}\n";
     return out;
 }
@@ -56,17 +91,28 @@ struct PlannerConfig {
     std::string api_key_env = "";      // llm_api_key_env
     int max_tokens = 0;                 // llm_max_tokens
     double temperature = 0.0;           // llm_temperature
+    bool builtin_rules = true;          // start from RuleSet::builtin()
+    std::string rules_file;             // planner_rules_file: extra rules (rule_table.hpp format)
 };
 
-// Rule-based stub planner for MVP.
+// Rule-based planner: declarative rule table (built-in + optional file), echo fallback.
 class Planner {
 public:
-    explicit Planner(const PlannerConfig& cfg) : m_cfg(cfg) {}
+    explicit Planner(const PlannerConfig& cfg);
 
     Plan plan(const std::string& request) const;
+    // Local tier for the ai command: a plan only if the rules cover the request with
+    // at least min_confidence (no echo fallback).
+    std::optional<Plan> match_rules(const std::string& request, double min_confidence) const;
+    const std::string& rules_error() const { return m_rules_error; } // rules_file load problem
+    std::size_t rule_count() const { return m_rules.size(); }
 private:
     PlannerConfig m_cfg;
+    RuleSet m_rules;
+    std::string m_rules_error;
     std::vector<PlanStep> rule_expand(const std::string& request) const;
+    std::vector<PlanStep> to_steps(const std::vector<RuleStep>& hits) const;
+    Plan make_plan(const std::string& request, std::vector<PlanStep> steps) const;
     bool is_dangerous(const std::string& cmd) const;
 };
 
@@ -0,0 +1,72 @@
+// Prompt layout of plan requests, cache-friendly: the instructions are a fixed block, identical to
+// the byte on every request, sent in the provider's system slot (LLMConfig::system_prompt) so that
+// provider-side prompt caching can reuse it as a prefix; the user message carries the optional
+// context sections (most stable first) and then the request, the only part that always changes.
+// Context is token-budgeted: estimate_tokens() is a local approximation of BPE tokenizers (no
+// vocabulary, a few ns per byte) and fit_context() shrinks the sections to the budget by priority.
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct PromptSection {
+    std::string title;
+    std::string body;       // empty = section left out
+    int priority = 0;       // fit_context: higher priority gets the budget first
+    bool keep_tail = false; // truncation keeps the last lines (history) instead of the first
+    bool stable = true;     // false: changes at every command (history), left out of context_fingerprint()
+};
+
+struct PlanPrompt {
+    std::string system;                 // plan_instructions()
+    std::vector<PromptSection> context;
+    std::string request;
+    std::string user() const;           // "Title:\nbody\n\n...Request: <request>"
+};
+
+// Plan JSON schema, rules and example; never contains per-request data.
+const std::string& plan_instructions();
+PlanPrompt make_plan_prompt(std::string request, std::vector<PromptSection> context = {});
+// Command line with its secrets replaced by "[REDACTED]": values of NAME=value words and of
+// --option value/--option=value whose name holds KEY, TOKEN, SECRET, PASSWORD, PASSWD, PASSPHRASE or
+// CREDENTIAL, what follows "Authorization:"/"Bearer" in the same word (or the next one), passwords
+// in user:password@host URLs and words shaped like well-known API keys (sk-..., ghp_..., AKIA...).
+std::string redact_secrets(std::string_view line);
+// Shell state sections in prompt order: Files in the current directory (first 500, sorted,
+// directories with '/'), Recent commands (last 40, 'ai' lines excluded), Last command (the last
+// non-'ai' line, with last_status when it is the line just before the request). Only Files is
+// stable; by priority Last command comes first, then Recent commands, then Files.
+// The history lines go through redact_secrets(): they are sent to the provider.
+// line_in_history: history already ends with the 'ai' line being planned (at Enter), which is left
+// out; false while it is still being typed (prefetch). Both give the same sections.
+std::vector<PromptSection> shell_context(const std::vector<std::string>& history, bool line_in_history, int last_status);
+// 16 hex digits identifying the context a plan was made for (plan cache keys): FNV-1a of the
+// non-empty stable sections as rendered, and of salt (e.g. the directory the file listing comes
+// from). History is left out, so a repeated request still hits after other commands.
+std::string context_fingerprint(const std::vector<PromptSection>& sections, std::string_view salt = {});
+
+// Tokens of text for GPT/Claude/Llama-style BPE vocabularies, within ~15% on English prose, shell
+// commands and file listings: words split in ~6-byte pieces, digits in
+// groups of 3, punctuation runs in pairs, a single space joins the next token, any other
+// whitespace run is one token.
+std::size_t estimate_tokens(std::string_view text);
+// Sections as rendered by PlanPrompt::user() ("Title:\nbody\n\n").
+std::size_t estimate_tokens(const PromptSection& section);
+
+struct ContextFit {
+    std::size_t tokens = 0;             // estimate of the fitted sections
+    std::vector<std::string> truncated; // titles cut line-wise ("(N more lines)" marker)
+    std::vector<std::string> dropped;   // titles that did not fit at all
+};
+// Shrinks the sections in place to at most budget tokens. By descending priority (ties in order)
+// each section is kept whole if it fits, else cut to the lines that fit, else emptied; the order
+// of the sections is unchanged (stable prefix for the provider cache).
+ContextFit fit_context(std::vector<PromptSection>& sections, std::size_t budget);
+
+// Context window (tokens) of known model families; 8192 when unknown.
+std::size_t model_context_window(std::string_view model);
+
+} // namespace autoshell::ai
@@ -0,0 +1,93 @@
+// Resilience layer for LLM providers: bounded retries with jittered exponential backoff (honouring
+// Retry-After), a per-provider circuit breaker over a rolling window of outcomes and latencies, and
+// failover to the next configured provider.
+#pragma once
+#include <ai-autoshell/ai/llm.hpp>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct RetryPolicy {
+    int retries = 2;                                  // extra attempts on the same provider
+    std::chrono::milliseconds base{250};
+    std::chrono::milliseconds max{8000};              // backoff cap and longest Retry-After waited for
+    std::chrono::milliseconds attempt_timeout{0};     // 0 = only the request deadline
+};
+
+// Full jitter: u * min(max, base * 2^attempt), u in [0,1).
+std::chrono::milliseconds backoff_delay(const RetryPolicy& p, int attempt, double u);
+// 429, 5xx and transport failures/timeouts: worth retrying. Other errors (401, missing key,
+// unparseable answer) go straight to the next provider.
+bool transient_failure(const LLMCompletion& c);
+
+struct BreakerPolicy {
+    std::size_t window = 20;
+    std::size_t min_calls = 5;
+    double error_rate = 0.5;
+    std::chrono::milliseconds slow_call{0};           // 0 = latency not counted
+    std::chrono::milliseconds cooldown{30000};
+    std::chrono::milliseconds max_age{60000};
+};
+
+// Closed: calls pass and are recorded. When the last `window` calls (younger than max_age, at least
+// min_calls) fail or exceed slow_call at error_rate or more, the circuit opens: calls are refused
+// for `cooldown`, then one probe passes (half-open) and its outcome closes or re-opens the circuit.
+class CircuitBreaker {
+public:
+    using Clock = std::chrono::steady_clock;
+    enum class State { Closed, Open, HalfOpen };
+    using Policy = BreakerPolicy;
+    explicit CircuitBreaker(Policy p = {}) : m_policy(p) {}
+    // False while open; after the cooldown lets exactly one probe through.
+    bool allow(Clock::time_point now = Clock::now());
+    void record(bool ok, std::chrono::milliseconds latency, Clock::time_point now = Clock::now());
+    // The allowed call ended without an outcome (cancelled): frees the half-open probe slot.
+    void abandon();
+    State state() const;
+    double failure_rate() const; // over the current window
+    std::size_t calls() const;
+private:
+    struct Sample { Clock::time_point at; bool bad; };
+    void trim(Clock::time_point now);
+    double rate_locked() const;
+    Policy m_policy;
+    mutable std::mutex m_mutex;
+    std::deque<Sample> m_samples;
+    State m_state = State::Closed;
+    Clock::time_point m_opened{};
+    bool m_probe = false; // half-open probe in flight
+};
+
+// Tries the providers in order. Each gets 1 + retries attempts on transient failures, spaced by
+// backoff_delay (at least the Retry-After of the answer; a longer Retry-After skips to the next
+// provider). Providers whose circuit is open are skipped; a successful answer is returned at once.
+// When every provider fails the last error is returned, "(circuit-open)" if none could be tried.
+// A stream that already delivered deltas is not retried (the text would be shown twice).
+class ResilientLLMClient : public LLMClient {
+public:
+    struct Provider { std::string name; std::unique_ptr<LLMClient> client; };
+    struct Stats { std::size_t requests = 0, retries = 0, failovers = 0, short_circuited = 0, failed = 0; };
+    struct ProviderStatus { std::string name; CircuitBreaker::State state; double failure_rate; std::size_t calls; };
+    ResilientLLMClient(std::vector<Provider> providers, RetryPolicy retry, CircuitBreaker::Policy breaker = {});
+    std::optional<LLMCompletion> complete(const std::string& prompt) override { return complete_async(prompt).get(); }
+    std::optional<LLMCompletion> complete_stream(const std::string& prompt, const LLMDeltaFn& on_delta) override { return complete_async(prompt, on_delta).get(); }
+    std::future<std::optional<LLMCompletion>> complete_async(const std::string& prompt, LLMDeltaFn on_delta = {},
+                                                             CancelToken cancel = {}, std::chrono::steady_clock::time_point deadline = {}) override;
+    Stats stats() const;
+    std::vector<ProviderStatus> status() const;
+    LLMClient& provider(std::size_t i); // e.g. to read the stats of a hedged primary
+private:
+    struct Leg { std::string name; std::shared_ptr<LLMClient> client; std::shared_ptr<CircuitBreaker> breaker; };
+    struct Shared;
+    std::shared_ptr<Shared> m_state;
+};
+
+const char* to_string(CircuitBreaker::State s);
+
+} // namespace autoshell::ai
@@ -0,0 +1,64 @@
+// Declarative planner rules compiled into an Aho-Corasick automaton.
+// One rule per line:  trigger|trigger => command :: description [:: option;option]
+//   trigger   lower-case phrase searched in the request at word boundaries; "=phrase" must equal the whole request
+//   command   may use slots: {word} first word after the trigger, {rest} remainder of the request
+//             (one word), {between} text up to the until= marker, {quoted} first "..."; values with
+//             spaces or shell metacharacters make the rule miss
+//   options   confirm | also=a+b (phrases that must also appear, anywhere) | until=marker | suffix=.txt ({word} must contain it)
+// All trigger/also phrases of all rules are found in a single pass over the request.
+#pragma once
+#include <cstddef>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct Rule {
+    std::vector<std::string> triggers; // any of them fires the rule (first listed wins for slots)
+    std::vector<bool> exact;           // per trigger: whole request only
+    std::vector<std::string> also;
+    std::string command;
+    std::string description;
+    std::string until;
+    std::string suffix;
+    bool confirm = false;
+};
+
+struct RuleStep { std::string description; std::string command; bool confirm = false; };
+
+struct RuleMatch {
+    std::vector<RuleStep> steps;  // one per fired rule, table order
+    double confidence = 0.0;      // share of the request's words covered by triggers and slots
+};
+
+class RuleSet {
+public:
+    // Built-in table (the former Planner::rule_expand rules).
+    static RuleSet builtin();
+    static std::optional<Rule> parse_rule(std::string_view line, std::string* error = nullptr);
+
+    void add(Rule r);
+    // Appends the rules of a table; false (and *error = "line N: ...") on the first bad line.
+    bool load(std::istream& in, std::string* error = nullptr);
+    bool load_file(const std::string& path, std::string* error = nullptr);
+    std::size_t size() const { return m_rules.size(); }
+
+    RuleMatch match(std::string_view request) const;
+
+private:
+    struct Node { std::vector<std::pair<unsigned char, int>> next; int fail = 0; std::vector<int> out; };
+    int pattern_id(const std::string& p);
+    void insert(Rule r);
+    void compile(); // rebuilds the automaton; match() itself never mutates (safe to share across threads)
+    int step(int state, unsigned char c) const;
+
+    std::vector<Rule> m_rules;
+    std::vector<std::string> m_patterns;
+    std::vector<std::vector<int>> m_rule_triggers, m_rule_also; // pattern ids per rule
+    std::vector<Node> m_nodes{Node{}};
+};
+
+} // namespace autoshell::ai
@@ -0,0 +1,66 @@
+// Make-like incremental plan steps: a step that declares "outputs" is skipped when they are up to
+// date with its "inputs". The state DB remembers, per set of outputs, the command that produced
+// them and a stamp (size, mtime, content hash) of every input at that time: a touched but
+// unchanged input does not trigger a rerun, a changed command does. Outputs never recorded fall
+// back to the make rule (no input newer than the oldest output). Paths are resolved against the
+// current directory. On disk it is an append-only log (log_record.hpp), LRU-capped.
+#pragma once
+#include <ai-autoshell/ai/planner.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace autoshell::ai {
+
+struct StepStateDbOptions {
+    std::string path;               // log file; empty = memory only
+    std::size_t max_entries = 1024; // recorded output sets
+};
+
+class StepStateDb {
+public:
+    struct Stamp {
+        std::string path;       // absolute
+        std::uint64_t size = 0;
+        std::int64_t mtime = 0; // nanoseconds
+        std::uint64_t hash = 0; // FNV-1a of the contents (0 for directories)
+    };
+    struct Check {
+        bool up_to_date = false;
+        std::string reason; // why the step must run (empty when up to date)
+    };
+
+    explicit StepStateDb(StepStateDbOptions opts);
+
+    // Steps without outputs always run.
+    Check check(const PlanStep& step);
+    // After a successful run; false if a declared output was not produced (nothing recorded).
+    bool record(const PlanStep& step);
+    void clear();
+    std::size_t size() const;
+    const StepStateDbOptions& options() const { return m_opts; }
+
+private:
+    struct Entry {
+        std::string key;             // absolute outputs, sorted
+        std::string command;         // hash of the command (hex)
+        std::vector<Stamp> inputs;
+    };
+    using List = std::list<Entry>;
+    void apply(const std::vector<std::string>& rec);
+    void insert(Entry e);
+    void append(const std::string& record);
+    void compact();
+
+    StepStateDbOptions m_opts;
+    mutable std::mutex m_mu;
+    List m_lru; // front = most recently recorded
+    std::unordered_map<std::string, List::iterator> m_index;
+    std::size_t m_log_records = 0;
+};
+
+} // namespace autoshell::ai
@@ -0,0 +1,35 @@
+// Streaming helpers for LLM responses: event framing (SSE / NDJSON) and small JSON field readers
+// used on each event payload (built on JsonReader, see json_pull.hpp).
+#pragma once
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace autoshell::ai {
+
+// Splits a streamed HTTP body into event payloads.
+//  - SSE (OpenAI, Claude, Gemini alt=sse): events end at a blank line, payload = joined "data:" lines.
+//  - NDJSON (Ollama): one JSON object per line.
+class StreamDecoder {
+public:
+    enum class Format { SSE, NDJSON };
+    using EventFn = std::function<void(std::string_view)>;
+
+    explicit StreamDecoder(Format f) : m_format(f) {}
+    // Chunks may split lines anywhere; on_event fires for every completed payload.
+    void feed(std::string_view chunk, const EventFn& on_event);
+    // Flushes a final event not followed by a terminator.
+    void finish(const EventFn& on_event);
+private:
+    void line(std::string_view l, const EventFn& on_event);
+    Format m_format;
+    std::string m_line;
+    std::string m_data; // SSE: data accumulated for the current event
+};
+
+// Value of the first "key" (at any depth) when it is a string, unescaped. Empty if missing or not a string.
+std::string json_string_field(std::string_view json, std::string_view key);
+// Value of the first "key" (at any depth) when it is a non-negative integer, -1 otherwise.
+int json_int_field(std::string_view json, std::string_view key);
+
+} // namespace autoshell::ai
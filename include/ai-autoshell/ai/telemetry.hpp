@@ -0,0 +1,63 @@
+// Session telemetry of the AI layer (ai stats): per provider/model latency histograms of the
+// transfer phases and of plan parsing, token throughput, and where plans came from.
+#pragma once
+#include <ai-autoshell/ai/http.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace autoshell::ai {
+
+// HDR-style log-linear histogram of microsecond values: 32 linear sub-buckets per power of two,
+// so any reported percentile is within ~3% of the recorded value; fixed memory, O(1) record.
+class LatencyHistogram {
+public:
+    void record(std::int64_t us);
+    std::uint64_t count() const { return m_count; }
+    // Highest value equivalent to the p-th percentile (p in 0..100); -1 when empty.
+    std::int64_t percentile(double p) const;
+    std::int64_t max() const { return m_count ? m_max : -1; }
+    double mean() const { return m_count ? static_cast<double>(m_sum) / static_cast<double>(m_count) : 0.0; }
+private:
+    static constexpr int kSubBits = 5;
+    static constexpr int kMaxExp = 40; // ~12 days in us: larger values are clamped
+    static constexpr std::size_t kBuckets = (kMaxExp - kSubBits + 2) << kSubBits;
+    static std::size_t index(std::int64_t v);
+    static std::int64_t highest(std::size_t idx);
+    std::array<std::uint64_t, kBuckets> m_buckets{};
+    std::uint64_t m_count = 0;
+    std::int64_t m_sum = 0, m_max = 0;
+};
+
+class Telemetry {
+public:
+    enum class PlanSource { Rules, Cache, Template, LLM };
+    struct Series {
+        LatencyHistogram dns, connect, tls, ttfb, total, parse;
+        std::uint64_t requests = 0, errors = 0;
+        std::int64_t completion_tokens = 0, token_time_us = 0; // requests that reported their tokens
+        std::int64_t prompt_tokens = 0, cached_tokens = 0;     // requests that reported their cached prompt tokens
+        double cached_share() const { return prompt_tokens > 0 ? static_cast<double>(cached_tokens) / static_cast<double>(prompt_tokens) : 0.0; }
+        std::int64_t bytes_down = 0, bytes_up = 0;
+        double tokens_per_second() const { return token_time_us > 0 ? completion_tokens * 1e6 / static_cast<double>(token_time_us) : 0.0; }
+    };
+    // One LLM request ("provider/model" series). parse_us < 0 = answer not parsed (error).
+    void record_request(const std::string& series, const HttpTiming& timing, std::int64_t parse_us, int completion_tokens, bool ok,
+                        int prompt_tokens = -1, int cached_tokens = -1);
+    void record_plan(PlanSource source);
+    // Plans served by the plan cache or a template over all plans that needed one of them or the LLM.
+    double cache_hit_rate() const;
+    std::map<std::string, Series> series() const;
+    void report(std::ostream& os) const;
+    void reset();
+private:
+    mutable std::mutex m_mutex;
+    std::map<std::string, Series> m_series;
+    std::array<std::uint64_t, 4> m_plans{};
+};
+
+} // namespace autoshell::ai
@@ -12,14 +12,42 @@
 #include <vector>
 #include <optional>
 #include <variant>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 extern std::optional<pid_t> g_foreground_pgid;
 
 namespace autoshell {
 
+// One active shell function call.
+struct CallFrame {
+    std::vector<std::string> args;   // $1..$N
+    // Variables shadowed by 'local': previous value (nullopt = was unset), restored on return.
+    std::vector<std::pair<std::string, std::optional<std::string>>> saved_vars;
+    bool returning = false;          // 'return' executed: unwind the rest of the body
+    int return_status = 0;
+};
+
 struct ExecContext {
     JobTable jobs;
     int last_status = 0;
+    // Functions defined in the session (name() { ... }); bodies are run in-process.
+    std::unordered_map<std::string, std::shared_ptr<const ListNode>> functions;
+    std::vector<CallFrame> frames;   // innermost call last
+    // <(cmd) / >(cmd) children the shell did not wait for (readers, background commands)
+    std::vector<pid_t> substs;
+    // false: children stay in the shell's process group instead of getting their own (no job
+    // control), so the whole tree can be signalled at once (concurrent plan steps).
+    bool job_control = true;
+};
+
+// Children feeding/consuming the /dev/fd/N paths of one command's <(cmd) / >(cmd) words.
+struct ProcessSubst {
+    std::vector<int> fds;     // shell side of each pipe, kept open while the command runs
+    std::vector<pid_t> pids;  // <(cmd) writers
+    std::vector<pid_t> readers; // >(cmd): may outlive the command, not waited for
 };
 
 class ExecutorPOSIX {
@@ -30,9 +58,25 @@ private:
     int run_list(const ListNode& list);
     int run_andor(const AndOrNode& node);
     int run_pipeline(const PipelineNode& pipe);
-    int run_command(const CommandNode& cmd);
+    // pipe_out: stdout is the pipe to the next stage of a pipeline
+    int run_command(const CommandNode& cmd, bool pipe_out = false);
+    int run_simple_command(const CommandNode& cmd, bool pipe_out);
+    // 'cmd &': started in its own process group, not waited for
+    int run_background_command(const CommandNode& cmd);
+    int run_background_simple(const CommandNode& cmd);
+    // Function, builtin or program for an argv that has already been expanded
+    int run_expanded(const CommandNode& cmd, const std::vector<std::string>& argv_expanded, bool pipe_out);
+    CommandNode start_process_substs(const CommandNode& cmd, ProcessSubst& ps);
+    std::string start_process_subst(const std::string& word, ProcessSubst& ps);
+    // wait: reap the <(cmd) writers now (false when the command itself runs in background)
+    void finish_process_substs(ProcessSubst& ps, bool wait = true);
+    void reap_process_substs();
     int run_subshell(const SubshellNode& node, bool background);
-    std::vector<RedirSpec> build_redirs(const CommandNode& cmd);
+    int run_function(std::shared_ptr<const ListNode> body, const std::vector<std::string>& argv);
+    bool unwinding() const { return !m_ctx.frames.empty() && m_ctx.frames.back().returning; }
+    std::vector<RedirSpec> build_redirs(const CommandNode& cmd, bool pipe_out = false);
+    // setpgid() unless job control is off
+    void set_group(pid_t pid, pid_t pgid) const;
     ExecContext& m_ctx;
 };
 
@@ -27,6 +27,7 @@ public:
     void reap(); // update statuses using waitpid(WNOHANG)
     std::vector<Job> list() const;
     void mark_finished_pgid(pid_t pgid);
+    void remove_pgid(pid_t pgid); // drop an entry whose processes the caller has reaped
 private:
     std::vector<Job> m_jobs;
     int m_next_id = 1;
@@ -7,17 +7,30 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <sys/types.h>
 
 namespace autoshell {
 
-enum class RedirType { Out, OutAppend, In, Err, ErrToOut };
+// Keep: 'source_fd' (already open) stays an output of stdout next to the redirected
+// files, e.g. the pipe in 'cmd > log | next'.
+enum class RedirType { Out, OutAppend, In, Err, ErrToOut, HereDoc, HereString, Keep };
 
 struct RedirSpec {
     RedirType type;
-    std::string target; // path
+    std::string target; // path; for HereDoc/HereString the (expanded) text fed to stdin
+    int source_fd = -1; // Keep only
 };
 
-// Open and apply redirections for child process; returns non-zero on error.
-int apply_redirections(const std::vector<RedirSpec>& specs);
+// Relay processes started for in-process commands (builtins, functions).
+struct MultiosRelays {
+    std::vector<pid_t> pids;
+};
+
+// Open and apply redirections; returns non-zero on error. Several outputs for stdout or
+// stderr ('cmd > a > b', 'cmd 2> e1 2> e2') are all written (multios) through a relay that
+// duplicates the data with tee(2)/splice(2). Without 'relays' the caller is a child about
+// to exec; with it, call wait_multios() once the original descriptors are restored.
+int apply_redirections(const std::vector<RedirSpec>& specs, MultiosRelays* relays = nullptr);
+void wait_multios(MultiosRelays& relays);
 
 } // namespace autoshell
@@ -5,7 +5,7 @@
  *
  * Description:
  *   Provides word expansion utilities for tilde (~), environment variables
- *   ($VAR and ${VAR}). No command substitution or globbing at MVP stage.
+ *   ($VAR and ${VAR}) and positional parameters ($1..$N, $#, $@, $*).
  */
 #pragma once
 #include <string>
@@ -13,9 +13,17 @@
 
 namespace autoshell {
 
+// Positional parameters of the innermost shell function call, set by the
+// executor while a function body runs; nullptr at top level.
+extern const std::vector<std::string>* g_positional_params;
+
 // Expand a single word: tilde, env vars, globbing (simple) if pattern present.
 std::string expand_word(const std::string& in);
 
+// Expand a here-document body: env vars, positional parameters and every $(...);
+// no tilde, globbing or word splitting. '\$', '\\', '\`' are literal, '\<newline>' joins lines.
+std::string expand_text(const std::string& in);
+
 // Expand a list of words (appends glob matches; if no match keep literal).
 std::vector<std::string> expand_words(const std::vector<std::string>& words);
 
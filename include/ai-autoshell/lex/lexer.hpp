@@ -5,10 +5,12 @@
  * Author: Luigi De Astis <l.deastis@idev-srl.com>
  *
  * Description:
- *   Provides lexical analysis for the AI-AutoShell. Converts an input line into a
- *   stream of Token objects handling quoting, escaping, operators (|, &&, ||, ;, >, >>,<, 2>, 2>&1),
- *   and assignment detection (NAME=VALUE). This is the first stage of the shell
- *   pipeline prior to parsing into an AST.
+ *   Provides lexical analysis for the AI-AutoShell. Converts an input line (or a
+ *   multi-line script fragment) into a stream of Token objects handling quoting,
+ *   escaping, line continuations, comments, operators (|, &&, ||, ;, newline, >,
+ *   >>, <, <<, <<-, <<<, 2>, 2>&1), here-document bodies and assignment detection
+ *   (NAME=VALUE). This is the first stage of the shell pipeline prior to parsing
+ *   into an AST.
  *
  * License (MIT):
  *   Permission is hereby granted, free of charge, to any person obtaining a copy of this
@@ -54,10 +56,16 @@ private:
     bool is_name_start(char c) const;
     bool is_name_char(char c) const;
     Token try_assign(const Token& word);
+    void read_heredoc_bodies(TokenStream& ts);
+
+    // '<<WORD' seen on the current line: the body starts after the next newline.
+    struct PendingHeredoc { std::size_t token; std::string delim; bool strip; bool quoted; };
 
     std::string m_input;
     LexerOptions m_opts;
     std::size_t m_pos = 0; // current index
+    bool m_word_quoted = false; // last lex_word() saw quotes or escapes
+    std::vector<PendingHeredoc> m_heredocs;
 };
 
 } // namespace autoshell
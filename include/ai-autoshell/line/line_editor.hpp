@@ -12,6 +12,10 @@ namespace autoshell {
 struct CompletionOptions {
     // provider riceve buffer completo corrente e prefisso token da completare
     std::function<std::vector<std::string>(const std::string& buffer,const std::string& prefix)> provider;
+    // on_change riceve il buffer a ogni modifica; on_idle dopo idle_ms senza tasti (una volta per testo)
+    std::function<void(const std::string& buffer)> on_change;
+    std::function<void(const std::string& buffer)> on_idle;
+    int idle_ms = 0;
 };
 
 class LineEditor {
@@ -26,6 +30,7 @@ private:
     void enable_raw();
     void disable_raw();
     int read_key();
+    bool wait_key(int timeout_ms); // true se un tasto e' pronto entro timeout_ms
     void write(const std::string& s);
 };
 
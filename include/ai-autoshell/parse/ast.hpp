@@ -7,8 +7,9 @@
  * Description:
  *   Defines Abstract Syntax Tree node structures representing shell command
  *   constructs: Commands with assignments and redirections, Pipelines, logical
- *   AND/OR chains, and Lists separated by semicolons. This AST is produced by
- *   the parser and later consumed by the executor module.
+ *   AND/OR chains, Lists separated by semicolons and shell function
+ *   definitions. This AST is produced by the parser and later consumed by the
+ *   executor module.
  *
  * License (MIT):
  *   Permission is hereby granted, free of charge, to any person obtaining a copy of this
@@ -38,20 +39,24 @@
 namespace autoshell {
 
 struct RedirNode {
-    enum class Type { Out, OutAppend, In, Err, ErrToOut } type; 
-    std::string target; // file path
+    enum class Type { Out, OutAppend, In, Err, ErrToOut, HereDoc, HereString } type; 
+    std::string target; // file path; text for HereDoc (body) and HereString (word)
+    bool literal = false; // HereDoc with quoted delimiter: no expansion of the body
+    bool subst = false;   // target is an unquoted <(list) / >(list), see Token::subst
 };
 
 struct CommandNode {
     std::vector<Token> assigns;
     std::vector<std::string> argv;
+    std::vector<std::size_t> substs; // argv indices lexed as unquoted <(list) / >(list)
     std::vector<RedirNode> redirs;
     bool background = false;
 };
 
 struct PipelineNode {
-    // Una pipeline ora può contenere sia comandi che subshell.
-    using Element = std::variant<std::unique_ptr<CommandNode>, std::unique_ptr<struct SubshellNode>>;
+    // Una pipeline ora può contenere comandi, subshell e definizioni di funzione.
+    using Element = std::variant<std::unique_ptr<CommandNode>, std::unique_ptr<struct SubshellNode>,
+                                 std::unique_ptr<struct FunctionDefNode>>;
     std::vector<Element> elements;
 };
 
@@ -77,6 +82,14 @@ struct SubshellNode {
     bool background = false;        // '(cmd) &' 
 };
 
+// name() { list; }
+// The body is shared so the executor can keep it in the session after the
+// AST of the defining line has been destroyed.
+struct FunctionDefNode {
+    std::string name;
+    std::shared_ptr<const ListNode> body;
+};
+
 struct AST {
     std::unique_ptr<ListNode> list;
 };
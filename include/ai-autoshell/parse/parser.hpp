@@ -30,9 +30,13 @@
 #pragma once
 #include "ai-autoshell/parse/tokens.hpp"
 #include "ai-autoshell/parse/ast.hpp"
+#include <string>
 
 namespace autoshell {
 
 AST parse_tokens(const TokenStream& ts);
+// Same AST; 'error' is set ("syntax error near 'x'") when the line is not well formed
+// (missing ')' / '}' / redirection target, dangling '|' or '&&', stray tokens).
+AST parse_tokens(const TokenStream& ts, std::string& error);
 
 } // namespace autoshell
@@ -0,0 +1,72 @@
+/*
+ * AI-AutoShell Script Stream
+ *
+ * Copyright (c) 2025 iDev srl
+ * Author: Luigi De Astis <l.deastis@idev-srl.com>
+ *
+ * Description:
+ *   Incremental front-end for scripts. Text arrives in arbitrary chunks
+ *   (mapped file windows, pipe reads); a lightweight scanner tracks quotes,
+ *   parentheses, function bodies, line continuations and trailing operators
+ *   to find where each complete top-level command ends (a here-document body
+ *   belongs to the command that opened it). Every complete command
+ *   is lexed and parsed right away and handed out as an AST, so the runner can
+ *   execute it before the rest of the script has been read. Only the command
+ *   currently being assembled is buffered, which keeps memory bounded for
+ *   arbitrarily large generated scripts.
+ *
+ * License (MIT): see lexer.hpp.
+ */
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "ai-autoshell/parse/ast.hpp"
+
+namespace autoshell {
+
+struct ScriptCommand {
+    AST ast;
+    std::size_t line = 0; // 1-based line where the command starts
+};
+
+class ScriptStream {
+public:
+    // Append raw script bytes; completed commands become available via next().
+    void feed(std::string_view chunk);
+    // End of input: the trailing command (without final newline) is completed.
+    void finish();
+    std::optional<ScriptCommand> next();
+    // After finish(): input ended inside a quote, '(' or '{', a here-doc body (or after '\', '|', '&&').
+    bool unterminated() const { return m_unterminated; }
+    std::size_t unterminated_line() const { return m_unit_line; }
+    // Bytes held for the command being assembled (for memory accounting/tests).
+    std::size_t buffered() const { return m_buf.size() - m_start; }
+private:
+    void scan();
+    bool word_boundary_before(std::size_t pos) const;
+    bool continues_on_next_line() const;
+    int scan_heredoc_operator();
+    bool scan_heredoc_body();
+    bool at_boundary() const;
+    void emit(std::size_t end);
+
+    struct Heredoc { std::string delim; bool strip; };
+
+    std::string m_buf;
+    std::size_t m_start = 0;   // first byte of the command being assembled
+    std::size_t m_pos = 0;     // next byte to scan
+    bool m_single = false, m_double = false, m_escape = false, m_comment = false;
+    int m_paren = 0, m_brace = 0;
+    char m_last_sig = 0, m_prev_sig = 0; // last two significant chars of the current command
+    bool m_cmd_pos = true; // next word starts a command: only there '{' / '}' are reserved
+    std::size_t m_line = 1, m_unit_line = 1;
+    bool m_finished = false, m_unterminated = false;
+    std::deque<Heredoc> m_heredocs; // opened on the current line, bodies still to read
+    bool m_in_body = false;
+    std::deque<ScriptCommand> m_ready;
+};
+
+} // namespace autoshell
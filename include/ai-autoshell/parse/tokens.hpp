@@ -39,11 +39,15 @@ enum class TokenKind {
     OrIf,
     Pipe,
     Semi,
+    Newline,
     LeftParen,
     RightParen,
     RedirOut,
     RedirOutAppend,
     RedirIn,
+    RedirHeredoc,      // <<
+    RedirHeredocStrip, // <<- (leading tabs removed)
+    RedirHereString,   // <<<
     RedirErr,
     RedirErrToOut,
     Assign,
@@ -56,6 +60,8 @@ struct Token {
     TokenKind kind;
     std::string lexeme;
     std::size_t pos;
+    bool quoted = false; // here-doc body with a quoted delimiter: taken literally
+    bool subst = false;  // whole word is an unquoted <(list) / >(list) process substitution
 };
 
 using TokenStream = std::vector<Token>;
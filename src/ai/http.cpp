@@ -0,0 +1,243 @@
+// HTTP transport implementation (libcurl multi event loop + share interface)
+#include <ai-autoshell/ai/http.hpp>
+#include <curl/curl.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace autoshell::ai {
+
+namespace {
+
+std::once_flag g_curl_once;
+HttpOptions g_shared_opts;
+// Upper bound for noticing a cancelled token or an expired deadline while transfers are idle.
+constexpr int kLoopPollMs = 50;
+
+struct Transfer {
+    CURL* easy = nullptr;
+    curl_slist* headers = nullptr;
+    HttpRequest req;
+    HttpResponse resp;
+    HttpTransport::DoneFn done;
+    bool aborted = false; // on_data returned false
+};
+
+size_t write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    auto* t = static_cast<Transfer*>(userdata);
+    t->resp.body.append(ptr, size * nmemb);
+    if (t->req.on_data && !t->req.on_data(std::string_view(ptr, size * nmemb))) {
+        t->aborted = true;
+        return 0; // CURLE_WRITE_ERROR: transfer stops here
+    }
+    return size * nmemb;
+}
+
+// Tempi cumulativi di curl (dall'inizio del trasferimento) trasformati in durate per fase
+void read_timing(CURL* easy, HttpTiming& out) {
+    curl_off_t dns = 0, conn = 0, app = 0, start = 0, total = 0, down = 0, up = 0;
+    curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &conn);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &app);
+    curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME_T, &start);
+    curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &down);
+    curl_easy_getinfo(easy, CURLINFO_SIZE_UPLOAD_T, &up);
+    out.dns_us = dns;
+    out.connect_us = conn > dns ? conn - dns : 0;
+    out.tls_us = app > conn ? app - conn : 0;
+    out.ttfb_us = start;
+    out.total_us = total;
+    out.bytes_down = down;
+    out.bytes_up = up;
+}
+
+} // namespace
+
+struct HttpTransport::Impl {
+    HttpOptions opts;
+    CURLSH* share = nullptr;
+    CURLM* multi = nullptr;
+    std::mutex share_locks[CURL_LOCK_DATA_LAST];
+    mutable std::mutex mutex; // pool, queue, stats
+    std::vector<CURL*> idle;
+    std::deque<std::unique_ptr<Transfer>> pending;
+    Stats stats;
+    std::once_flag loop_once;
+    std::thread loop_thread;
+    std::atomic<bool> stop{false};
+    std::unordered_map<CURL*, std::unique_ptr<Transfer>> active; // loop thread only
+
+    static void lock_cb(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+        static_cast<Impl*>(userptr)->share_locks[data].lock();
+    }
+    static void unlock_cb(CURL*, curl_lock_data data, void* userptr) {
+        static_cast<Impl*>(userptr)->share_locks[data].unlock();
+    }
+
+    CURL* acquire() {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            if (!idle.empty()) { CURL* h = idle.back(); idle.pop_back(); return h; }
+        }
+        return curl_easy_init();
+    }
+    void release(CURL* h) {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (idle.size() < opts.max_idle_handles) idle.push_back(h);
+        else curl_easy_cleanup(h);
+    }
+
+    // Options only: curl_easy_reset keeps the handle's connection and caches.
+    void setup(Transfer& t) {
+        CURL* curl = t.easy;
+        curl_easy_reset(curl);
+        for (auto &h : t.req.headers) t.headers = curl_slist_append(t.headers, h.c_str());
+        curl_easy_setopt(curl, CURLOPT_URL, t.req.url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, t.headers);
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, t.req.body.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(t.req.body.size()));
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &t);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, t.req.timeout_seconds); // the deadline is enforced by the loop
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L); // transfers run on the loop thread
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, opts.keepalive_idle_seconds);
+        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, opts.dns_cache_seconds);
+        if (opts.http2) curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        if (share) curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    }
+
+    // Detaches the transfer from the loop and delivers the response. error overrides the curl result.
+    void finish(CURL* easy, CURLcode rc, const char* error) {
+        auto it = active.find(easy);
+        if (it == active.end()) return;
+        std::unique_ptr<Transfer> t = std::move(it->second);
+        active.erase(it);
+        curl_multi_remove_handle(multi, easy); // in-flight: the connection is closed, no more I/O
+        long connects = 0;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &t->resp.status);
+        curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &connects);
+        read_timing(easy, t->resp.timing);
+#if LIBCURL_VERSION_NUM >= 0x074200
+        curl_off_t retry_after = 0; // secondi (anche dalla forma data HTTP); 0 = header assente
+        if (curl_easy_getinfo(easy, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) t->resp.retry_after = static_cast<long>(retry_after);
+#endif
+        if (error) { t->resp.error = error; t->resp.status = 0; }
+        else if (t->aborted) t->resp.error = "aborted";
+        else if (rc != CURLE_OK) t->resp.error = curl_easy_strerror(rc);
+        curl_slist_free_all(t->headers);
+        t->headers = nullptr;
+        release(easy);
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            stats.requests++;
+            stats.connections += static_cast<std::size_t>(connects);
+            if (error) stats.cancelled++;
+        }
+        if (t->done) t->done(std::move(t->resp));
+    }
+
+    void loop() {
+        while (!stop) {
+            std::deque<std::unique_ptr<Transfer>> incoming;
+            { std::lock_guard<std::mutex> lk(mutex); incoming.swap(pending); }
+            for (auto &t : incoming) {
+                CURL* easy = t->easy;
+                active.emplace(easy, std::move(t));
+                curl_multi_add_handle(multi, easy);
+            }
+            int running = 0;
+            curl_multi_perform(multi, &running);
+            int left = 0;
+            while (CURLMsg* msg = curl_multi_info_read(multi, &left))
+                if (msg->msg == CURLMSG_DONE) finish(msg->easy_handle, msg->data.result, nullptr);
+            auto now = std::chrono::steady_clock::now();
+            std::vector<std::pair<CURL*, const char*>> expired;
+            for (auto &[easy, t] : active) {
+                if (t->req.cancel.cancelled()) expired.emplace_back(easy, "cancelled");
+                else if (t->req.deadline != std::chrono::steady_clock::time_point{} && now >= t->req.deadline) expired.emplace_back(easy, "deadline exceeded");
+            }
+            for (auto &[easy, why] : expired) finish(easy, CURLE_OK, why);
+            curl_multi_poll(multi, nullptr, 0, kLoopPollMs, nullptr);
+        }
+        std::vector<CURL*> rest;
+        for (auto &kv : active) rest.push_back(kv.first);
+        for (CURL* easy : rest) finish(easy, CURLE_OK, "cancelled");
+    }
+};
+
+HttpTransport::HttpTransport(HttpOptions opts) : m(std::make_unique<Impl>()) {
+    std::call_once(g_curl_once, []{ curl_global_init(CURL_GLOBAL_DEFAULT); });
+    m->opts = opts;
+    m->multi = curl_multi_init();
+    m->share = curl_share_init();
+    if (m->share) {
+        curl_share_setopt(m->share, CURLSHOPT_LOCKFUNC, &Impl::lock_cb);
+        curl_share_setopt(m->share, CURLSHOPT_UNLOCKFUNC, &Impl::unlock_cb);
+        curl_share_setopt(m->share, CURLSHOPT_USERDATA, m.get());
+        curl_share_setopt(m->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(m->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(m->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+}
+
+HttpTransport::~HttpTransport() {
+    if (m->loop_thread.joinable()) {
+        m->stop = true;
+        curl_multi_wakeup(m->multi);
+        m->loop_thread.join();
+    }
+    for (auto &t : m->pending) {
+        curl_slist_free_all(t->headers);
+        curl_easy_cleanup(t->easy);
+        t->resp.error = "cancelled";
+        if (t->done) t->done(std::move(t->resp));
+    }
+    for (CURL* h : m->idle) curl_easy_cleanup(h);
+    if (m->multi) curl_multi_cleanup(m->multi);
+    if (m->share) curl_share_cleanup(m->share);
+}
+
+void HttpTransport::submit(HttpRequest req, DoneFn done) {
+    auto t = std::make_unique<Transfer>();
+    t->req = std::move(req);
+    t->done = std::move(done);
+    t->easy = m->acquire();
+    if (!t->easy || !m->multi) {
+        if (t->easy) m->release(t->easy);
+        t->resp.error = "curl-init-fail";
+        if (t->done) t->done(std::move(t->resp));
+        return;
+    }
+    m->setup(*t);
+    std::call_once(m->loop_once, [this]{ m->loop_thread = std::thread([this]{ m->loop(); }); });
+    { std::lock_guard<std::mutex> lk(m->mutex); m->pending.push_back(std::move(t)); }
+    curl_multi_wakeup(m->multi);
+}
+
+std::future<HttpResponse> HttpTransport::post_async(HttpRequest req) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    auto fut = promise->get_future();
+    submit(std::move(req), [promise](HttpResponse r){ promise->set_value(std::move(r)); });
+    return fut;
+}
+
+HttpResponse HttpTransport::post(const HttpRequest& req) { return post_async(req).get(); }
+
+HttpTransport::Stats HttpTransport::stats() const {
+    std::lock_guard<std::mutex> lk(m->mutex);
+    return m->stats;
+}
+
+void HttpTransport::configure_shared(const HttpOptions& opts) { g_shared_opts = opts; }
+
+HttpTransport& HttpTransport::shared() {
+    // Intentionally leaked: providers may still be used from static destructors.
+    static HttpTransport* instance = new HttpTransport(g_shared_opts);
+    return *instance;
+}
+
+} // namespace autoshell::ai
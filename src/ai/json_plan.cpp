@@ -1,47 +1,115 @@
 #include <ai-autoshell/ai/json_plan.hpp>
-#include <algorithm>
-#include <cctype>
+#include <charconv>
 
 namespace autoshell::ai {
 
-static std::string trim(const std::string& s){ size_t a=0; while(a<s.size() && std::isspace((unsigned char)s[a])) ++a; size_t b=s.size(); while(b>a && std::isspace((unsigned char)s[b-1])) --b; return s.substr(a,b-a); }
+void PlanStreamParser::reset() {
+    m_reader = JsonReader();
+    m_steps_depth = 0; m_in_step = false; m_pending = Pending::None;
+    m_key.clear(); m_request.clear(); m_idx = 1;
+}
 
-ParsedPlan parse_plan_json(const std::string& input) {
-    ParsedPlan out; std::string json = input;
-    // crude isolate outer braces
-    size_t a=json.find('{'); size_t b=json.find_last_of('}'); if(a==std::string::npos||b==std::string::npos||b<=a) return out; json = json.substr(a,b-a+1);
-    auto extract_string=[&](const std::string& key){ std::string k = '"'+key+'"'; size_t p=json.find(k); if(p==std::string::npos) return std::string(); size_t colon=json.find(':',p); if(colon==std::string::npos) return std::string(); size_t q1=json.find('"',colon+1); if(q1==std::string::npos) return std::string(); size_t q2=json.find('"',q1+1); if(q2==std::string::npos) return std::string(); return json.substr(q1+1,q2-q1-1); };
-    out.request = extract_string("request");
-    // steps array parsing robusto contro braces dentro stringhe (es: {1..100})
-    size_t sp = json.find("\"steps\""); if(sp==std::string::npos) return out; size_t arr = json.find('[',sp); if(arr==std::string::npos) return out;
-    // Trova la chiusura corretta dell'array tenendo conto di [] annidati improbabili
-    int bracket_depth=0; size_t arr_end=std::string::npos; bool in_str=false; bool escape=false;
-    for(size_t i=arr; i<json.size(); ++i){ char c=json[i]; if(!in_str){ if(c=='[') bracket_depth++; else if(c==']'){ bracket_depth--; if(bracket_depth==0){ arr_end=i; break; } } else if(c=='"'){ in_str=true; } }
-        else { if(escape){ escape=false; } else if(c=='\\'){ escape=true; } else if(c=='"'){ in_str=false; } }
-    }
-    if (arr_end == std::string::npos) {
-        return out;
+std::vector<std::string>* PlanStreamParser::step_list(const std::string& key) {
+    if (key == "depends_on") return &m_cur.depends_on;
+    if (key == "inputs") return &m_cur.inputs;
+    if (key == "outputs") return &m_cur.outputs;
+    return nullptr;
+}
+
+PlanStreamParser::Status PlanStreamParser::consume(JsonReader& r, std::vector<ParsedStep>& ready) {
+    using T = JsonReader::Token;
+    for (;;) {
+        T t = r.next();
+        std::size_t d = r.depth();
+        Pending pending = m_pending; m_pending = Pending::None;
+        bool field = m_in_step && d == m_steps_depth + 1; // valore diretto dello step corrente
+        switch (t) {
+            case T::NeedMore: m_pending = pending; return Status::More;
+            case T::Error: case T::End: return m_done ? Status::Done : Status::Failed;
+            case T::Key:
+                if (m_in_step) { if (field) m_key.assign(r.text()); }
+                else if (r.text() == "steps" && !m_steps_depth && !m_done) m_pending = Pending::Steps;
+                else if (r.text() == "request" && d == 1) m_pending = Pending::Request;
+                break;
+            case T::BeginArray:
+                if (pending == Pending::Steps) m_steps_depth = d;
+                break;
+            case T::BeginObject:
+                if (m_steps_depth && !m_in_step && d == m_steps_depth + 1) { m_in_step = true; m_cur = ParsedStep{}; m_key.clear(); }
+                break;
+            case T::EndObject:
+                if (m_in_step && d == m_steps_depth) {
+                    m_in_step = false;
+                    if (m_cur.id.empty()) { char id[16] = "s"; m_cur.id.assign(id, std::to_chars(id + 1, id + sizeof(id), m_idx).ptr); }
+                    ++m_idx;
+                    if (!m_cur.command.empty()) ready.push_back(std::move(m_cur));
+                }
+                if (d == 0) return m_done ? Status::Done : Status::Failed;
+                break;
+            case T::EndArray:
+                if (m_steps_depth && !m_in_step && d + 1 == m_steps_depth) { m_done = true; m_steps_depth = 0; }
+                break;
+            case T::String:
+                if (pending == Pending::Request) m_request.assign(r.text());
+                else if (field) {
+                    if (m_key == "id") m_cur.id.assign(r.text());
+                    else if (m_key == "description") m_cur.description.assign(r.text());
+                    else if (m_key == "command") m_cur.command.assign(r.text());
+                    else if (auto* list = step_list(m_key)) list->emplace_back(r.text()); // anche stringa singola
+                }
+                else if (m_in_step && d == m_steps_depth + 2) { if (auto* list = step_list(m_key)) list->emplace_back(r.text()); }
+                break;
+            case T::True: case T::False:
+                if (field && m_key == "confirm") m_cur.confirm = t == T::True;
+                else if (field && m_key == "parallel") m_cur.parallel = t == T::True;
+                break;
+            default: break;
+        }
     }
-    std::string arr_content = json.substr(arr + 1, arr_end - arr - 1);
-    size_t pos=0; int idx=1; while(pos < arr_content.size()){
-        // trova inizio object
-        size_t obj_start=std::string::npos; bool in_s=false; bool esc=false; for(size_t i=pos;i<arr_content.size();++i){ char c=arr_content[i]; if(!in_s){ if(c=='"') in_s=true; else if(c=='{'){ obj_start=i; break; } else if(c==']') { pos=arr_content.size(); break; } }
-            else { if(esc) esc=false; else if(c=='\\') esc=true; else if(c=='"') in_s=false; } }
-        if(obj_start==std::string::npos) break;
-        // trova fine object bilanciando
-        int depth=0; size_t obj_end=std::string::npos; in_s=false; esc=false; for(size_t i=obj_start;i<arr_content.size();++i){ char c=arr_content[i]; if(!in_s){ if(c=='"') in_s=true; else if(c=='{'){ depth++; } else if(c=='}'){ depth--; if(depth==0){ obj_end=i; break; } } }
-            else { if(esc) esc=false; else if(c=='\\') esc=true; else if(c=='"') in_s=false; } }
-        if(obj_end==std::string::npos) break;
-        std::string obj = arr_content.substr(obj_start, obj_end-obj_start+1);
-        auto field=[&](const std::string& k){ std::string key='"'+k+'"'; size_t p=obj.find(key); if(p==std::string::npos) return std::string(); size_t c=obj.find(':',p); if(c==std::string::npos) return std::string(); // trova primo '"' dopo : ignorando spazi
-            size_t scan=c+1; while(scan<obj.size() && std::isspace((unsigned char)obj[scan])) ++scan; if(scan>=obj.size()||obj[scan]!='"') return std::string(); size_t q1=scan; size_t q2=obj.find('"',q1+1); if(q2==std::string::npos) return std::string(); return obj.substr(q1+1,q2-q1-1); };
-        ParsedStep ps; ps.id = field("id"); if(ps.id.empty()) ps.id = "s"+std::to_string(idx++); else idx++; ps.description = field("description"); ps.command = field("command");
-        if(obj.find("\"confirm\"")!=std::string::npos){ size_t kp=obj.find("\"confirm\""); size_t colon=obj.find(':',kp); if(colon!=std::string::npos){ std::string tail=obj.substr(colon+1); tail=trim(tail); ps.confirm = (tail.rfind("true",0)==0); } }
-        if(!ps.command.empty()) out.steps.push_back(ps);
-        pos = obj_end + 1;
+}
+
+ParsedPlan parse_plan_json(const std::string& input) {
+    ParsedPlan out;
+    PlanStreamParser p;
+    std::string_view text(input);
+    // Testo o code fence attorno al JSON: si prova da ogni '{' finche' uno contiene "steps"
+    for (auto b = text.find('{'); b != std::string_view::npos;) {
+        p.reset();
+        JsonReader r(text.substr(b)); // documento intero: nessuna copia
+        auto st = p.consume(r, out.steps);
+        if (st == PlanStreamParser::Status::Failed && !p.m_steps_depth && p.m_idx == 1) {
+            // Oggetto valido senza "steps": si salta per intero; JSON rotto: si riprova dal '{' successivo
+            b = text.find('{', r.error().empty() ? b + r.offset() : b + 1);
+            continue;
+        }
+        out.valid = p.m_done; // array steps chiuso, anche se vuoto
+        out.request = p.m_request;
+        break;
     }
-    out.valid = true; // consider syntactically parsed even if zero steps
     return out;
 }
 
+std::vector<ParsedStep> PlanStreamParser::feed(std::string_view delta) {
+    std::vector<ParsedStep> ready;
+    m_text.append(delta);
+    if (m_reading) m_reader.feed(delta);
+    while (!m_stopped) {
+        if (!m_reading) {
+            auto b = m_text.find('{', m_start);
+            if (b == std::string::npos) { m_start = m_text.size(); break; }
+            m_start = b;
+            reset();
+            m_reader.feed(std::string_view(m_text).substr(b));
+            m_reading = true;
+        }
+        Status st = consume(m_reader, ready);
+        if (st == Status::More) break;
+        m_reading = false;
+        if (st == Status::Done || m_steps_depth || m_idx > 1) { m_stopped = true; break; }
+        // Non era l'oggetto del piano: si salta se ben formato, altrimenti si riprova dal '{' successivo
+        m_start += m_reader.error().empty() ? m_reader.offset() : 1;
+    }
+    return ready;
+}
+
 } // namespace autoshell::ai
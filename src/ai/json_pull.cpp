@@ -0,0 +1,282 @@
+// Single-pass pull JSON reader
+#include <ai-autoshell/ai/json_pull.hpp>
+#include <climits>
+#include <cstring>
+
+namespace autoshell::ai {
+
+namespace {
+
+void append_utf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) out.push_back(static_cast<char>(cp));
+    else if (cp < 0x800) { out.push_back(static_cast<char>(0xC0 | (cp >> 6))); out.push_back(static_cast<char>(0x80 | (cp & 0x3F))); }
+    else if (cp < 0x10000) { out.push_back(static_cast<char>(0xE0 | (cp >> 12))); out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F))); out.push_back(static_cast<char>(0x80 | (cp & 0x3F))); }
+    else { out.push_back(static_cast<char>(0xF0 | (cp >> 18))); out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F))); out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F))); out.push_back(static_cast<char>(0x80 | (cp & 0x3F))); }
+}
+
+bool hex4(std::string_view s, std::size_t i, unsigned& v) {
+    if (i + 4 > s.size()) return false;
+    v = 0;
+    for (std::size_t k = i; k < i + 4; ++k) {
+        char c = s[k]; v <<= 4;
+        if (c >= '0' && c <= '9') v |= static_cast<unsigned>(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= static_cast<unsigned>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= static_cast<unsigned>(c - 'A' + 10);
+        else return false;
+    }
+    return true;
+}
+
+// Body of a string literal (without quotes) into out; false on a malformed \u escape.
+bool unescape(std::string_view s, std::string& out) {
+    out.clear();
+    out.reserve(s.size());
+    std::size_t i = 0;
+    while (i < s.size()) {
+        const void* b = std::memchr(s.data() + i, '\\', s.size() - i);
+        std::size_t bi = b ? static_cast<std::size_t>(static_cast<const char*>(b) - s.data()) : s.size();
+        out.append(s.data() + i, bi - i); // tratti senza escape copiati in blocco
+        if (bi + 1 >= s.size()) return bi == s.size();
+        i = bi + 2;
+        switch (s[bi + 1]) {
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'u': {
+                unsigned cp = 0;
+                if (!hex4(s, i, cp)) return false;
+                i += 4;
+                if (cp >= 0xD800 && cp < 0xDC00) { // coppia surrogata (\uD83D\uDE00)
+                    unsigned lo = 0;
+                    if (i + 6 <= s.size() && s[i] == '\\' && s[i + 1] == 'u' && hex4(s, i + 2, lo) && lo >= 0xDC00 && lo < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        i += 6;
+                    } else cp = 0xFFFD;
+                } else if (cp >= 0xDC00 && cp < 0xE000) cp = 0xFFFD; // surrogata isolata
+                append_utf8(out, cp);
+                break;
+            }
+            default: out.push_back(s[bi + 1]); // \" \\ \/ (e qualsiasi altro carattere, come scritto)
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void JsonReader::feed(std::string_view chunk) {
+    if (!m_owned) { // primo chunk, o documento intero seguito da altro input
+        m_buf.assign(m_in.substr(m_pos));
+        m_base += m_pos; m_pos = 0;
+        m_owned = true;
+    } else if (m_pos > 4096 && m_pos * 2 > m_buf.size()) { // scarta l'input gia' consumato
+        m_buf.erase(0, m_pos);
+        m_base += m_pos; m_pos = 0;
+    }
+    m_buf.append(chunk);
+    m_in = m_buf;
+}
+
+JsonReader::Token JsonReader::next() {
+    if (m_owned) m_in = m_buf; // il reader puo' essere stato copiato o spostato
+    m_last = step();
+    return m_last;
+}
+
+JsonReader::Token JsonReader::step() {
+    if (m_failed) return Token::Error;
+    for (;;) {
+        while (m_pos < m_in.size() && (m_in[m_pos] == ' ' || m_in[m_pos] == '\n' || m_in[m_pos] == '\r' || m_in[m_pos] == '\t')) ++m_pos;
+        if (m_pos >= m_in.size()) {
+            if (!m_final) return Token::NeedMore;
+            if (!m_stack.empty()) return fail("unexpected end of input");
+            return Token::End;
+        }
+        char c = m_in[m_pos];
+        switch (m_expect) {
+            case Expect::Colon:
+                if (c != ':') return fail("expected ':'");
+                ++m_pos; m_expect = Expect::Value;
+                continue;
+            case Expect::CommaOrEnd:
+                if (c == ',') { // dopo la virgola accetta anche la chiusura (virgola finale)
+                    ++m_pos; m_expect = m_stack.back() == '{' ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+                    continue;
+                }
+                return close(c);
+            case Expect::KeyOrEnd: {
+                if (c == '}') return close(c);
+                if (c != '"') return fail("expected a key");
+                Token t = string_token();
+                if (t != Token::String) return t;
+                m_expect = Expect::Colon;
+                return Token::Key;
+            }
+            case Expect::ValueOrEnd:
+                if (c == ']') return close(c);
+                return value(c);
+            case Expect::Value:
+                return value(c);
+        }
+    }
+}
+
+JsonReader::Token JsonReader::value(char c) {
+    switch (c) {
+        case '{': m_stack.push_back('{'); ++m_pos; m_expect = Expect::KeyOrEnd; return Token::BeginObject;
+        case '[': m_stack.push_back('['); ++m_pos; m_expect = Expect::ValueOrEnd; return Token::BeginArray;
+        case '"': { Token t = string_token(); return t == Token::String ? scalar(t) : t; }
+        case 't': return literal("true", Token::True);
+        case 'f': return literal("false", Token::False);
+        case 'n': return literal("null", Token::Null);
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) return number();
+            return fail("unexpected character");
+    }
+}
+
+JsonReader::Token JsonReader::string_token() {
+    const char* d = m_in.data();
+    std::size_t n = m_in.size(), start = m_pos + 1, i = start;
+    bool escaped = false;
+    if (m_str_start == m_base + m_pos) { i = m_str_scan - m_base; escaped = m_str_escaped; } // ripresa dopo feed()
+    std::size_t qi = 0; bool have_q = false;
+    for (;;) {
+        if (!have_q || qi < i) { // prossimo '"' candidato, ricercato solo quando superato
+            const void* q = i < n ? std::memchr(d + i, '"', n - i) : nullptr;
+            if (!q) break;
+            qi = static_cast<std::size_t>(static_cast<const char*>(q) - d); have_q = true;
+        }
+        const void* b = std::memchr(d + i, '\\', qi - i);
+        if (!b) {
+            std::string_view raw = m_in.substr(start, qi - start);
+            m_pos = qi + 1;
+            m_str_start = std::string::npos;
+            if (!escaped || m_skipping) m_text = raw; // zero-copy
+            else if (unescape(raw, m_scratch)) m_text = m_scratch;
+            else return fail("bad \\u escape");
+            return Token::String;
+        }
+        escaped = true;
+        i = static_cast<std::size_t>(static_cast<const char*>(b) - d) + 2; // salta il carattere escapato
+    }
+    if (m_final) return fail("unterminated string");
+    // Nessuna '"' fino alla fine del buffer: si registrano gli escape del tratto e la prossima
+    // feed() riprende da qui senza riesaminare
+    while (i < n) {
+        const void* b = std::memchr(d + i, '\\', n - i);
+        if (!b) { i = n; break; }
+        escaped = true;
+        std::size_t bi = static_cast<std::size_t>(static_cast<const char*>(b) - d);
+        if (bi + 1 >= n) { i = bi; break; } // il carattere escapato arriva col chunk successivo
+        i = bi + 2;
+    }
+    m_str_start = m_base + m_pos; m_str_scan = m_base + i; m_str_escaped = escaped;
+    return Token::NeedMore;
+}
+
+JsonReader::Token JsonReader::number() {
+    std::size_t i = m_pos;
+    bool digit = false;
+    for (; i < m_in.size(); ++i) {
+        char c = m_in[i];
+        if (c >= '0' && c <= '9') digit = true;
+        else if (c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E') break;
+    }
+    if (i == m_in.size() && !m_final) return Token::NeedMore; // il numero puo' continuare nel prossimo chunk
+    if (!digit) return fail("bad number");
+    m_text = m_in.substr(m_pos, i - m_pos);
+    m_pos = i;
+    return scalar(Token::Number);
+}
+
+JsonReader::Token JsonReader::literal(std::string_view word, Token t) {
+    std::string_view have = m_in.substr(m_pos, word.size());
+    if (have.size() < word.size() && !m_final && word.compare(0, have.size(), have) == 0) return Token::NeedMore;
+    if (have != word) return fail("unexpected literal");
+    m_text = have;
+    m_pos += word.size();
+    return scalar(t);
+}
+
+JsonReader::Token JsonReader::close(char c) {
+    char open = c == '}' ? '{' : c == ']' ? '[' : 0;
+    if (!open) return fail("expected ',' or a closing bracket");
+    if (m_stack.empty() || m_stack.back() != open) return fail("mismatched closing bracket");
+    m_stack.pop_back();
+    ++m_pos;
+    return scalar(c == '}' ? Token::EndObject : Token::EndArray);
+}
+
+JsonReader::Token JsonReader::fail(const char* what) {
+    m_failed = true;
+    m_error = std::string(what) + " at offset " + std::to_string(offset());
+    return Token::Error;
+}
+
+bool JsonReader::skip() {
+    if (m_last != Token::BeginObject && m_last != Token::BeginArray) return m_last != Token::Error && m_last != Token::NeedMore;
+    std::size_t target = m_stack.size() - 1;
+    m_skipping = true;
+    Token t;
+    do t = next();
+    while (t != Token::NeedMore && t != Token::Error && t != Token::End &&
+           !((t == Token::EndObject || t == Token::EndArray) && m_stack.size() == target));
+    m_skipping = false;
+    return t == Token::EndObject || t == Token::EndArray;
+}
+
+std::vector<std::optional<std::string>> json_pick(std::string_view json,
+                                                  std::initializer_list<std::initializer_list<std::string_view>> paths) {
+    std::vector<std::optional<std::string>> out(paths.size());
+    struct Frame { bool array; long index; std::string seg; }; // seg: chiave corrente o indice come testo
+    std::vector<Frame> stack;
+    // Qualche percorso ancora da trovare passa per il contenitore corrente (i primi `depth` segmenti)?
+    auto wanted = [&](bool exact) {
+        std::size_t i = 0;
+        for (auto& p : paths) {
+            bool fit = !out[i++] && (exact ? p.size() == stack.size() : p.size() > stack.size());
+            for (std::size_t d = 0; fit && d < stack.size(); ++d) fit = p.begin()[d] == stack[d].seg;
+            if (fit) return static_cast<long>(i - 1);
+        }
+        return -1L;
+    };
+    std::size_t found = 0;
+    JsonReader r(json);
+    for (;;) {
+        auto t = r.next();
+        if (t == JsonReader::Token::NeedMore || t == JsonReader::Token::Error || t == JsonReader::Token::End) break;
+        if (t == JsonReader::Token::Key) { stack.back().seg.assign(r.text()); continue; }
+        if (t == JsonReader::Token::EndObject || t == JsonReader::Token::EndArray) {
+            stack.pop_back();
+            if (stack.empty()) break;
+            continue;
+        }
+        if (!stack.empty() && stack.back().array) stack.back().seg = std::to_string(++stack.back().index);
+        if (t == JsonReader::Token::BeginObject || t == JsonReader::Token::BeginArray) {
+            // Sottoalberi che nessun percorso attraversa: saltati senza decodificare le stringhe
+            if (!stack.empty() && wanted(false) < 0) { if (!r.skip()) break; continue; }
+            stack.push_back(Frame{t == JsonReader::Token::BeginArray, -1, {}});
+            continue;
+        }
+        // Possono corrispondere piu' percorsi uguali: si assegnano tutti
+        for (long k; (k = wanted(true)) >= 0;) { out[static_cast<std::size_t>(k)] = std::string(r.text()); ++found; }
+        if (found == out.size() || stack.empty()) break;
+    }
+    return out;
+}
+
+int json_to_int(const std::optional<std::string>& v) {
+    if (!v || v->empty() || (*v)[0] < '0' || (*v)[0] > '9') return -1;
+    long long n = 0;
+    for (char c : *v) {
+        if (c < '0' || c > '9') break;
+        n = n * 10 + (c - '0');
+        if (n > INT_MAX) return INT_MAX;
+    }
+    return static_cast<int>(n);
+}
+
+} // namespace autoshell::ai
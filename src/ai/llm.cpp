@@ -36,4 +36,35 @@ std::optional<LLMCompletion> StubLLMClient::complete(const std::string& prompt)
     return LLMCompletion{prompt, "stub_plain", -1, -1, -1, -1.0, -1.0, -1.0};
 }
 
+std::future<std::optional<LLMCompletion>> HttpLLMClient::complete_async(const std::string& prompt, LLMDeltaFn on_delta,
+                                                                        CancelToken cancel, std::chrono::steady_clock::time_point deadline) {
+    auto promise = std::make_shared<std::promise<std::optional<LLMCompletion>>>();
+    auto fut = promise->get_future();
+    Call call = prepare(prompt, on_delta);
+    if (call.error) { promise->set_value(call.error); return fut; }
+    call.req.cancel = cancel;
+    call.req.deadline = deadline;
+    HttpTransport::shared().submit(std::move(call.req), [promise, finish = std::move(call.finish)](HttpResponse r) {
+        if (r.cancelled()) { promise->set_value(std::nullopt); return; }
+        LLMCompletion c{"(timeout)", "error"};
+        if (r.error != "deadline exceeded") {
+            try { c = finish(r); }
+            catch (...) { c = LLMCompletion{"(parse-empty)", "error"}; } // mai eccezioni sul thread del loop
+        }
+        // Esito HTTP per il livello di resilienza (retry su 429/5xx/timeout, Retry-After)
+        c.http_status = r.status;
+        if (r.retry_after >= 0) c.retry_after_ms = r.retry_after * 1000;
+        c.timing = r.timing;
+        promise->set_value(std::move(c));
+    });
+    return fut;
+}
+
+std::function<void()> HttpLLMClient::stream_events(HttpRequest& req, StreamDecoder::Format format, StreamDecoder::EventFn on_event) {
+    auto dec = std::make_shared<StreamDecoder>(format);
+    auto fn = std::make_shared<StreamDecoder::EventFn>(std::move(on_event));
+    req.on_data = [dec, fn](std::string_view chunk) { dec->feed(chunk, *fn); return true; };
+    return [dec, fn] { dec->finish(*fn); };
+}
+
 } // namespace autoshell::ai
@@ -0,0 +1,139 @@
+// Hedged requests across two providers (llm_hedge)
+#include <ai-autoshell/ai/llm.hpp>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace autoshell::ai {
+
+struct HedgedLLMClient::Counters { std::atomic<std::size_t> requests{0}, hedged{0}, secondary_wins{0}, losers_cancelled{0}; };
+
+// Una gara: condivisa fra i thread che attendono le gambe e i callback di streaming del loop HTTP.
+// Niente polling: ogni gamba ha un thread bloccato sul proprio future; quello del primario attende
+// anche l'istante dell'hedge. Il primo esito decisivo risolve la promise restituita a chi chiama.
+struct HedgedLLMClient::Race : std::enable_shared_from_this<Race> {
+    using Result = std::optional<LLMCompletion>;
+    std::array<std::shared_ptr<LLMClient>, 2> clients;
+    std::shared_ptr<Counters> c;
+    std::string prompt;
+    LLMDeltaFn on_delta;
+    CancelToken cancel;
+    CancelToken legs[2]; // un token per gamba: il perdente si cancella da solo, Ctrl-C (cancel) ferma entrambe
+    std::chrono::steady_clock::time_point deadline;
+    std::mutex mu;
+    bool started[2] = {false, false}, done[2] = {false, false}, settled = false;
+    int streaming = -1; // gamba che ha mandato il primo byte: solo le sue delta arrivano a chi chiama
+    Result results[2];
+    std::promise<Result> promise;
+
+    static bool valid(const Result& r) {
+        if (!r || r->source == "error") return false;
+        auto p = parse_plan_json(r->text);
+        return p.valid && !p.steps.empty();
+    }
+
+    void cancel_leg(int i) {
+        if (!started[i] || done[i] || legs[i].cancelled()) return; // una volta sola
+        legs[i].cancel();
+        c->losers_cancelled++;
+    }
+
+    // Chiamato senza mu: un client locale risponde (e manda le delta) dentro complete_async
+    void start(int i, std::chrono::steady_clock::time_point hedge_at) {
+        auto self = shared_from_this();
+        LLMDeltaFn delta;
+        if (on_delta) delta = [self, i](std::string_view d) { if (self->first_delta(i)) self->on_delta(d); };
+        auto fut = clients[i]->complete_async(prompt, std::move(delta), legs[i], deadline);
+        std::thread([self, i, hedge_at, fut = std::move(fut)]() mutable {
+            if (i == 0 && hedge_at != std::chrono::steady_clock::time_point{} && fut.wait_until(hedge_at) == std::future_status::timeout) self->hedge();
+            self->finished(i, fut.get());
+        }).detach(); // tiene vivi la gara e i client fino alla fine della gamba, anche dopo il vincitore
+    }
+
+    // Le delta vanno a chi chiama da una sola gamba: la prima che trasmette vince e l'altra si ferma
+    bool first_delta(int i) {
+        std::lock_guard<std::mutex> lk(mu);
+        if (streaming < 0 && !settled) {
+            streaming = i;
+            cancel_leg(1 - i);
+        }
+        return streaming == i;
+    }
+
+    void hedge() {
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            if (started[1] || settled || streaming >= 0 || cancel.cancelled()) return;
+            started[1] = true;
+            c->hedged++;
+        }
+        start(1, {});
+    }
+
+    // Il vincitore si decide sotto mu; la promise si risolve fuori, dopo l'ultima delta: chi attende
+    // il future puo' contare sul fatto che on_delta non verra' piu' chiamato
+    void finished(int i, Result r) {
+        bool start_secondary = false;
+        std::optional<Result> outcome;
+        std::string whole; // vincitore che non ha trasmesso: il testo arriva come una sola delta
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            done[i] = true;
+            results[i] = std::move(r);
+            if (settled || streaming == 1 - i) return; // gara gia' decisa, o perdente cancellato
+            if (cancel.cancelled()) {
+                outcome = Result{};
+            } else if (streaming == i || valid(results[i])) {
+                // Una gamba che ha gia' trasmesso resta quella scelta, valida o no: le sue delta sono state consegnate
+                cancel_leg(1 - i);
+                if (i == 1) c->secondary_wins++;
+                if (streaming < 0 && on_delta) whole = results[i]->text;
+                outcome = results[i];
+            } else if (i == 0 && !started[1]) {
+                // Il primario ha risposto male prima dell'hedge: il secondario parte subito
+                started[1] = true; c->hedged++;
+                start_secondary = true;
+            } else if (done[0] && done[1]) {
+                outcome = results[0] ? results[0] : results[1];
+            }
+            if (outcome) settled = true;
+        }
+        if (!whole.empty()) on_delta(whole);
+        if (outcome) promise.set_value(std::move(*outcome));
+        if (start_secondary) start(1, {});
+    }
+};
+
+HedgedLLMClient::HedgedLLMClient(std::unique_ptr<LLMClient> primary, std::unique_ptr<LLMClient> secondary, std::chrono::milliseconds delay)
+    : m_primary(std::move(primary)), m_secondary(std::move(secondary)), m_delay(std::max(delay, std::chrono::milliseconds(0))),
+      m_counters(std::make_shared<Counters>()) {}
+
+HedgedLLMClient::Stats HedgedLLMClient::stats() const {
+    return Stats{m_counters->requests.load(), m_counters->hedged.load(), m_counters->secondary_wins.load(), m_counters->losers_cancelled.load()};
+}
+
+std::future<std::optional<LLMCompletion>> HedgedLLMClient::complete_async(const std::string& prompt, LLMDeltaFn on_delta,
+                                                                          CancelToken cancel, std::chrono::steady_clock::time_point deadline) {
+    auto race = std::make_shared<Race>();
+    race->clients = {m_primary, m_secondary};
+    race->c = m_counters;
+    race->prompt = prompt;
+    race->on_delta = std::move(on_delta);
+    race->cancel = cancel;
+    race->legs[0] = cancel.child();
+    race->legs[1] = cancel.child();
+    race->deadline = deadline;
+    auto fut = race->promise.get_future();
+    m_counters->requests++;
+    bool both = m_delay.count() == 0;
+    race->started[0] = true;
+    if (both) { race->started[1] = true; m_counters->hedged++; }
+    race->start(0, both ? std::chrono::steady_clock::time_point{} : std::chrono::steady_clock::now() + m_delay);
+    if (both) race->start(1, {});
+    return fut;
+}
+
+} // namespace autoshell::ai
@@ -0,0 +1,75 @@
+// Loader of the LLM module (llm_module.hpp): dlopen on first use, or the statically linked entry
+#include <ai-autoshell/ai/llm_module.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#ifdef AI_AUTOSHELL_LLM_MODULE
+#include <dlfcn.h>
+#include <climits>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+#endif
+
+namespace autoshell::ai {
+
+namespace {
+
+std::once_flag g_once;
+std::atomic<LLMModule*> g_module{nullptr};
+std::string g_error;
+
+#ifdef AI_AUTOSHELL_LLM_MODULE
+std::string executable_dir() {
+    char buf[PATH_MAX] = {0};
+#ifdef __APPLE__
+    uint32_t size = sizeof(buf);
+    if (_NSGetExecutablePath(buf, &size) != 0) return {};
+#else
+    ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    if (n <= 0) return {};
+    buf[n] = 0;
+#endif
+    std::string path(buf);
+    auto slash = path.rfind('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash);
+}
+
+void load() {
+    std::vector<std::string> candidates;
+    if (const char* env = std::getenv("AI_AUTOSHELL_LLM_MODULE"); env && *env) candidates.push_back(env);
+    if (auto dir = executable_dir(); !dir.empty()) candidates.push_back(dir + "/" AI_AUTOSHELL_LLM_MODULE);
+#ifdef AI_AUTOSHELL_LLM_MODULE_DIR
+    candidates.push_back(AI_AUTOSHELL_LLM_MODULE_DIR "/" AI_AUTOSHELL_LLM_MODULE);
+#endif
+    candidates.push_back(AI_AUTOSHELL_LLM_MODULE);
+    for (auto& path : candidates) {
+        // RTLD_LOCAL: curl e i client restano nel modulo; mai chiuso (client e thread del transport vivono fino all'uscita)
+        void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) { if (g_error.empty()) g_error = dlerror(); continue; }
+        auto entry = reinterpret_cast<LLMModule* (*)()>(dlsym(handle, "ai_autoshell_llm_module"));
+        if (!entry) { g_error = path + ": ai_autoshell_llm_module not found"; dlclose(handle); continue; }
+        g_module = entry();
+        return;
+    }
+}
+#else
+void load() { g_module = ai_autoshell_llm_module(); }
+#endif
+
+} // namespace
+
+LLMModule* llm_module(std::string* error) {
+    std::call_once(g_once, load);
+    LLMModule* m = g_module;
+    if (!m && error) *error = g_error.empty() ? "LLM module not found" : g_error;
+    return m;
+}
+
+bool llm_module_loaded() {
+    return g_module != nullptr;
+}
+
+} // namespace autoshell::ai
@@ -0,0 +1,52 @@
+// Entry point of the LLM module (libai-autoshell-llm): the LLMModule the shell loads with dlopen
+#include <ai-autoshell/ai/llm_module.hpp>
+#include <ai-autoshell/ai/resilience.hpp>
+#include <iomanip>
+#include <sstream>
+
+namespace autoshell::ai {
+namespace {
+
+class LLMModuleImpl : public LLMModule {
+public:
+    std::unique_ptr<LLMClient> make_llm(const LLMConfig& cfg) override { return autoshell::ai::make_llm(cfg); }
+    void configure_http(const HttpOptions& opts) override { HttpTransport::configure_shared(opts); }
+    HttpTransport::Stats http_stats() override { return HttpTransport::shared().stats(); }
+    std::size_t failovers(LLMClient& client) override {
+        auto* rc = dynamic_cast<ResilientLLMClient*>(&client);
+        return rc ? rc->stats().failovers : 0;
+    }
+    std::string debug_report(LLMClient& client, const LLMConfig& cfg) override {
+        std::ostringstream out;
+        // Catena di failover (llm_retries/llm_fallback): il client hedged, se c'e', e' il primo provider
+        auto* rc = dynamic_cast<ResilientLLMClient*>(&client);
+        if (rc) {
+            auto st = rc->stats();
+            out << "[DEBUG] Resilience: requests=" << st.requests << " retries=" << st.retries << " failovers=" << st.failovers
+                << " short_circuited=" << st.short_circuited << " failed=" << st.failed;
+            for (auto& ps : rc->status())
+                out << " | " << ps.name << " " << to_string(ps.state) << " fail=" << std::fixed << std::setprecision(2) << ps.failure_rate << "/" << ps.calls;
+            out << "\n";
+        }
+        if (auto* hc = dynamic_cast<HedgedLLMClient*>(rc ? &rc->provider(0) : &client)) {
+            auto st = hc->stats();
+            out << "[DEBUG] Hedge (" << cfg.provider << " vs " << cfg.hedge_provider << ", " << cfg.hedge_delay_ms << " ms): requests=" << st.requests
+                << " hedged=" << st.hedged << " secondary_wins=" << st.secondary_wins << " losers_cancelled=" << st.losers_cancelled << "\n";
+        }
+        return out.str();
+    }
+};
+
+} // namespace
+} // namespace autoshell::ai
+
+#if defined(_WIN32)
+#define AI_AUTOSHELL_LLM_EXPORT
+#else
+#define AI_AUTOSHELL_LLM_EXPORT __attribute__((visibility("default")))
+#endif
+
+extern "C" AI_AUTOSHELL_LLM_EXPORT autoshell::ai::LLMModule* ai_autoshell_llm_module() {
+    static autoshell::ai::LLMModuleImpl module;
+    return &module;
+}
@@ -1,91 +1,163 @@
 #include <ai-autoshell/ai/llm.hpp>
-#include <curl/curl.h>
+#include <ai-autoshell/ai/http.hpp>
+#include <ai-autoshell/ai/stream.hpp>
+#include <ai-autoshell/ai/json_pull.hpp>
+#include <ai-autoshell/ai/resilience.hpp>
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <optional>
 #include <memory>
 
 namespace autoshell::ai {
-// Callback comune per tutti i client basati su curl in questo file
-static size_t curl_write_cb_ollama(char* ptr, size_t size, size_t nmemb, void* userdata){
-    auto* out = static_cast<std::string*>(userdata); out->append(ptr, size*nmemb); return size*nmemb;
+// Tutti i client di questo file descrivono la richiesta (prepare) e il parsing della risposta (finish):
+// l'esecuzione e' del trasporto condiviso, sul suo event loop (connessioni keep-alive riusate).
+static HttpRequest json_request(const std::string& url, std::vector<std::string> headers, std::string body, int timeout){
+    HttpRequest req; req.url=url; req.headers=std::move(headers); req.headers.insert(req.headers.begin(),"Content-Type: application/json"); req.body=std::move(body); req.timeout_seconds=timeout;
+    return req;
 }
 
 // Implementazioni aggiuntive (Claude, Gemini) incluse qui per evitare problemi di tipo incompleto.
 // Claude client minimale
-class ClaudeLLMClient : public LLMClient {
+class ClaudeLLMClient : public HttpLLMClient {
 public:
     explicit ClaudeLLMClient(const LLMConfig& cfg):m_cfg(cfg){}
-    std::optional<LLMCompletion> complete(const std::string& prompt) override {
-        const char* env_key=nullptr; if(!m_cfg.api_key_env.empty()) env_key=std::getenv(m_cfg.api_key_env.c_str()); std::string key=(env_key && *env_key)?env_key:m_cfg.api_key; if(key.empty()) return LLMCompletion{"(no-key-direct)","error"};
+private:
+    Call prepare(const std::string& prompt, const LLMDeltaFn& on_delta) override {
+        Call call;
+        const char* env_key=nullptr; if(!m_cfg.api_key_env.empty()) env_key=std::getenv(m_cfg.api_key_env.c_str()); std::string key=(env_key && *env_key)?env_key:m_cfg.api_key; if(key.empty()){ call.error=LLMCompletion{"(no-key-direct)","error"}; return call; }
         std::string endpoint=m_cfg.endpoint.empty()?"https://api.anthropic.com/v1/messages":m_cfg.endpoint;
-        CURL* curl=curl_easy_init(); if(!curl) return LLMCompletion{"(curl-init-fail)","error"}; std::string response; curl_easy_setopt(curl,CURLOPT_URL,endpoint.c_str()); curl_easy_setopt(curl,CURLOPT_WRITEFUNCTION,curl_write_cb_ollama); curl_easy_setopt(curl,CURLOPT_WRITEDATA,&response); curl_easy_setopt(curl,CURLOPT_TIMEOUT,m_cfg.timeout_seconds);
         auto esc=[&](const std::string& in){ std::string out; out.reserve(in.size()+16); for(char c: in){ switch(c){ case '"': out+="\\\""; break; case '\\': out+="\\\\"; break; case '\n': out+="\\n"; break; case '\r': out+="\\r"; break; case '\t': out+="\\t"; break; default: out.push_back(c);} } return out; };
-        std::ostringstream body; body<<"{\"model\":\""<<(m_cfg.model.empty()?"claude-3-haiku-20240307":m_cfg.model)<<"\",\"max_tokens\":256,\"messages\":[{\"role\":\"user\",\"content\":[{\"type\":\"text\",\"text\":\""<<esc(prompt)<<"\"}]}]}";
-        struct curl_slist* headers=nullptr; headers=curl_slist_append(headers,"Content-Type: application/json"); headers=curl_slist_append(headers,(std::string("x-api-key: ")+key).c_str()); headers=curl_slist_append(headers,"anthropic-version: 2023-06-01"); curl_easy_setopt(curl,CURLOPT_HTTPHEADER,headers); curl_easy_setopt(curl,CURLOPT_POST,1L); std::string b=body.str(); curl_easy_setopt(curl,CURLOPT_POSTFIELDS,b.c_str());
-        auto res=curl_easy_perform(curl); long code=0; curl_easy_getinfo(curl,CURLINFO_RESPONSE_CODE,&code); curl_slist_free_all(headers); curl_easy_cleanup(curl);
-        if(res!=CURLE_OK || code/100!=2) return LLMCompletion{"(claude error code="+std::to_string(code)+")","error"};
-        std::string text; size_t pos=response.find("\"text\""); if(pos!=std::string::npos){ pos=response.find(':',pos); if(pos!=std::string::npos){ ++pos; while(pos<response.size() && response[pos]==' ') ++pos; if(pos<response.size() && response[pos]=='"'){ ++pos; bool esc2=false; for(size_t i=pos;i<response.size();++i){ char c=response[i]; if(esc2){ if(c=='n') text+="\n"; else if(c=='r') text+="\r"; else if(c=='t') text+="\t"; else text.push_back(c); esc2=false; continue;} if(c=='\\'){ esc2=true; continue;} if(c=='"') break; text.push_back(c);} } } }
-        if(text.empty()) text="(parse-empty)";
-        auto extract_int=[&](const std::string& key){ size_t p=response.find(key); if(p==std::string::npos) return -1; p=response.find(':',p); if(p==std::string::npos) return -1; ++p; while(p<response.size() && response[p]==' ') ++p; size_t e=p; while(e<response.size() && isdigit((unsigned char)response[e])) ++e; if(e==p) return -1; return std::stoi(response.substr(p,e-p)); };
-        int prompt_tokens=extract_int("\"input_tokens\""); int completion_tokens=extract_int("\"output_tokens\""); int total_tokens=(prompt_tokens>=0 && completion_tokens>=0)?(prompt_tokens+completion_tokens):-1;
-        double p_cost=-1.0,c_cost=-1.0,t_cost=-1.0; if(prompt_tokens>=0 && m_cfg.prompt_price_per_1k>0) p_cost=(prompt_tokens/1000.0)*m_cfg.prompt_price_per_1k; if(completion_tokens>=0 && m_cfg.completion_price_per_1k>0) c_cost=(completion_tokens/1000.0)*m_cfg.completion_price_per_1k; if(p_cost>=0||c_cost>=0) t_cost=(p_cost<0?0:p_cost)+(c_cost<0?0:c_cost);
-        return LLMCompletion{text,"claude",prompt_tokens,completion_tokens,total_tokens,p_cost,c_cost,t_cost};
+        // Istruzioni nel blocco system con cache_control: Anthropic le riusa dalla cache (oltre la soglia minima di token del modello)
+        std::ostringstream body; body<<"{\"model\":\""<<(m_cfg.model.empty()?"claude-3-haiku-20240307":m_cfg.model)<<"\",\"max_tokens\":"<<m_cfg.max_tokens;
+        if(!m_cfg.system_prompt.empty()) body<<",\"system\":[{\"type\":\"text\",\"text\":\""<<esc(m_cfg.system_prompt)<<"\",\"cache_control\":{\"type\":\"ephemeral\"}}]";
+        body<<",\"messages\":[{\"role\":\"user\",\"content\":[{\"type\":\"text\",\"text\":\""<<esc(prompt)<<"\"}]}]"<<(on_delta?",\"stream\":true}":"}");
+        call.req=json_request(endpoint,{"x-api-key: "+key,"anthropic-version: 2023-06-01"},body.str(),m_cfg.timeout_seconds);
+        // Streaming SSE: input_tokens (e token in cache) in message_start, testo in content_block_delta, output_tokens aggiornati in message_delta.
+        // input_tokens esclude i token letti o scritti in cache: prompt_tokens e' la somma
+        struct State { std::string text; int in=-1, out=-1, cache_read=-1, cache_write=-1; }; auto st=std::make_shared<State>(); std::function<void()> flush; bool stream=static_cast<bool>(on_delta);
+        if(stream) flush=stream_events(call.req,StreamDecoder::Format::SSE,[st,on_delta](std::string_view ev){ auto f=json_pick(ev,{{"type"},{"delta","text"},{"usage","output_tokens"},{"message","usage","input_tokens"},{"message","usage","cache_read_input_tokens"},{"message","usage","cache_creation_input_tokens"}}); if(f[0]=="content_block_delta"){ std::string t=f[1].value_or(""); st->text+=t; if(!t.empty()) on_delta(t); } else if(f[0]=="message_delta") st->out=json_to_int(f[2]); else if(f[0]=="message_start"){ st->in=json_to_int(f[3]); st->cache_read=json_to_int(f[4]); st->cache_write=json_to_int(f[5]); } });
+        call.finish=[m_cfg=m_cfg,st,flush,stream](const HttpResponse& http)->LLMCompletion{
+            if(flush) flush();
+            const std::string& response=http.body; long code=http.status;
+            if(!http.ok()) return LLMCompletion{"(claude error code="+std::to_string(code)+")","error"};
+            // Un solo passaggio: content[0].text e usage
+            auto f=json_pick(response,{{"content","0","text"},{"usage","input_tokens"},{"usage","output_tokens"},{"usage","cache_read_input_tokens"},{"usage","cache_creation_input_tokens"}});
+            std::string text=stream?st->text:f[0].value_or(""); if(text.empty()) text="(parse-empty)";
+            int prompt_tokens=stream?st->in:json_to_int(f[1]); int completion_tokens=stream?st->out:json_to_int(f[2]);
+            int cache_read=stream?st->cache_read:json_to_int(f[3]), cache_write=stream?st->cache_write:json_to_int(f[4]);
+            if(prompt_tokens>=0) prompt_tokens+=std::max(cache_read,0)+std::max(cache_write,0);
+            int total_tokens=(prompt_tokens>=0 && completion_tokens>=0)?(prompt_tokens+completion_tokens):-1;
+            double p_cost=-1.0,c_cost=-1.0,t_cost=-1.0; if(prompt_tokens>=0 && m_cfg.prompt_price_per_1k>0) p_cost=(prompt_tokens/1000.0)*m_cfg.prompt_price_per_1k; if(completion_tokens>=0 && m_cfg.completion_price_per_1k>0) c_cost=(completion_tokens/1000.0)*m_cfg.completion_price_per_1k; if(p_cost>=0||c_cost>=0) t_cost=(p_cost<0?0:p_cost)+(c_cost<0?0:c_cost);
+            LLMCompletion comp{text,"claude",prompt_tokens,completion_tokens,total_tokens,p_cost,c_cost,t_cost}; comp.cached_tokens=cache_read; return comp;
+        };
+        return call;
     }
-private: LLMConfig m_cfg; };
+    LLMConfig m_cfg; };
 
-class GeminiLLMClient : public LLMClient {
+class GeminiLLMClient : public HttpLLMClient {
 public:
     explicit GeminiLLMClient(const LLMConfig& cfg):m_cfg(cfg){}
-    std::optional<LLMCompletion> complete(const std::string& prompt) override {
-        const char* env_key=nullptr; if(!m_cfg.api_key_env.empty()) env_key=std::getenv(m_cfg.api_key_env.c_str()); std::string key=(env_key && *env_key)?env_key:m_cfg.api_key; if(key.empty()) return LLMCompletion{"(no-key-direct)","error"};
-        std::string model=m_cfg.model.empty()?"gemini-1.5-flash":m_cfg.model; std::string base=m_cfg.endpoint.empty()?"https://generativelanguage.googleapis.com/v1/models/":m_cfg.endpoint; std::string endpoint=base+model+":generateContent?key="+key;
-        CURL* curl=curl_easy_init(); if(!curl) return LLMCompletion{"(curl-init-fail)","error"}; std::string response; curl_easy_setopt(curl,CURLOPT_URL,endpoint.c_str()); curl_easy_setopt(curl,CURLOPT_WRITEFUNCTION,curl_write_cb_ollama); curl_easy_setopt(curl,CURLOPT_WRITEDATA,&response); curl_easy_setopt(curl,CURLOPT_TIMEOUT,m_cfg.timeout_seconds);
-        struct curl_slist* headers=nullptr; headers=curl_slist_append(headers,"Content-Type: application/json"); curl_easy_setopt(curl,CURLOPT_HTTPHEADER,headers);
+private:
+    Call prepare(const std::string& prompt, const LLMDeltaFn& on_delta) override {
+        Call call;
+        const char* env_key=nullptr; if(!m_cfg.api_key_env.empty()) env_key=std::getenv(m_cfg.api_key_env.c_str()); std::string key=(env_key && *env_key)?env_key:m_cfg.api_key; if(key.empty()){ call.error=LLMCompletion{"(no-key-direct)","error"}; return call; }
+        std::string model=m_cfg.model.empty()?"gemini-1.5-flash":m_cfg.model; std::string base=m_cfg.endpoint.empty()?"https://generativelanguage.googleapis.com/v1/models/":m_cfg.endpoint; std::string endpoint=base+model+(on_delta?":streamGenerateContent?alt=sse&key=":":generateContent?key=")+key;
         auto esc=[&](const std::string& in){ std::string out; out.reserve(in.size()+16); for(char c: in){ switch(c){ case '"': out+="\\\""; break; case '\\': out+="\\\\"; break; case '\n': out+="\\n"; break; case '\r': out+="\\r"; break; case '\t': out+="\\t"; break; default: out.push_back(c);} } return out; };
-        std::ostringstream body; body<<"{\"contents\":[{\"parts\":[{\"text\":\""<<esc(prompt)<<"\"}]}]}"; std::string b=body.str(); curl_easy_setopt(curl,CURLOPT_POST,1L); curl_easy_setopt(curl,CURLOPT_POSTFIELDS,b.c_str());
-        auto res=curl_easy_perform(curl); long code=0; curl_easy_getinfo(curl,CURLINFO_RESPONSE_CODE,&code); curl_slist_free_all(headers); curl_easy_cleanup(curl);
-        if(res!=CURLE_OK || code/100!=2) return LLMCompletion{"(gemini error code="+std::to_string(code)+")","error"};
-        std::string text; size_t pos=response.find("\"text\""); if(pos!=std::string::npos){ pos=response.find(':',pos); if(pos!=std::string::npos){ ++pos; while(pos<response.size() && response[pos]==' ') ++pos; if(pos<response.size() && response[pos]=='"'){ ++pos; bool esc2=false; for(size_t i=pos;i<response.size();++i){ char c=response[i]; if(esc2){ if(c=='n') text+="\n"; else if(c=='r') text+="\r"; else if(c=='t') text+="\t"; else text.push_back(c); esc2=false; continue;} if(c=='\\'){ esc2=true; continue;} if(c=='"') break; text.push_back(c);} } } }
-        if(text.empty()) text="(parse-empty)";
-        auto extract_int=[&](const std::string& key){ size_t p=response.find(key); if(p==std::string::npos) return -1; p=response.find(':',p); if(p==std::string::npos) return -1; ++p; while(p<response.size() && response[p]==' ') ++p; size_t e=p; while(e<response.size() && isdigit((unsigned char)response[e])) ++e; if(e==p) return -1; return std::stoi(response.substr(p,e-p)); };
-        int prompt_tokens=extract_int("\"promptTokenCount\""); int completion_tokens=extract_int("\"candidatesTokenCount\""); int total_tokens=extract_int("\"totalTokenCount\"");
-        double p_cost=-1.0,c_cost=-1.0,t_cost=-1.0; if(prompt_tokens>=0 && m_cfg.prompt_price_per_1k>0) p_cost=(prompt_tokens/1000.0)*m_cfg.prompt_price_per_1k; if(completion_tokens>=0 && m_cfg.completion_price_per_1k>0) c_cost=(completion_tokens/1000.0)*m_cfg.completion_price_per_1k; if(p_cost>=0||c_cost>=0) t_cost=(p_cost<0?0:p_cost)+(c_cost<0?0:c_cost);
-        return LLMCompletion{text,"gemini",prompt_tokens,completion_tokens,total_tokens,p_cost,c_cost,t_cost};
+        // Istruzioni in testa allo stesso testo: il caching implicito di Gemini lavora sul prefisso comune
+        std::string text=m_cfg.system_prompt.empty()?prompt:m_cfg.system_prompt+"\n\n"+prompt;
+        std::ostringstream body; body<<"{\"contents\":[{\"parts\":[{\"text\":\""<<esc(text)<<"\"}]}]}";
+        call.req=json_request(endpoint,{},body.str(),m_cfg.timeout_seconds);
+        // Streaming SSE: ogni evento porta un frammento di candidates[0].content.parts[0].text e l'usage cumulativo
+        struct State { std::string text; int prompt=-1, out=-1, total=-1, cached=-1; }; auto st=std::make_shared<State>(); std::function<void()> flush; bool stream=static_cast<bool>(on_delta);
+        if(stream) flush=stream_events(call.req,StreamDecoder::Format::SSE,[st,on_delta](std::string_view ev){ auto f=json_pick(ev,{{"candidates","0","content","parts","0","text"},{"usageMetadata","promptTokenCount"},{"usageMetadata","candidatesTokenCount"},{"usageMetadata","totalTokenCount"},{"usageMetadata","cachedContentTokenCount"}}); std::string t=f[0].value_or(""); st->text+=t; if(!t.empty()) on_delta(t); int v; if((v=json_to_int(f[1]))>=0) st->prompt=v; if((v=json_to_int(f[2]))>=0) st->out=v; if((v=json_to_int(f[3]))>=0) st->total=v; if((v=json_to_int(f[4]))>=0) st->cached=v; });
+        call.finish=[m_cfg=m_cfg,st,flush,stream](const HttpResponse& http)->LLMCompletion{
+            if(flush) flush();
+            const std::string& response=http.body; long code=http.status;
+            if(!http.ok()) return LLMCompletion{"(gemini error code="+std::to_string(code)+")","error"};
+            auto f=json_pick(response,{{"candidates","0","content","parts","0","text"},{"usageMetadata","promptTokenCount"},{"usageMetadata","candidatesTokenCount"},{"usageMetadata","totalTokenCount"},{"usageMetadata","cachedContentTokenCount"}});
+            std::string text=stream?st->text:f[0].value_or(""); if(text.empty()) text="(parse-empty)";
+            int prompt_tokens=stream?st->prompt:json_to_int(f[1]); int completion_tokens=stream?st->out:json_to_int(f[2]); int total_tokens=stream?st->total:json_to_int(f[3]);
+            double p_cost=-1.0,c_cost=-1.0,t_cost=-1.0; if(prompt_tokens>=0 && m_cfg.prompt_price_per_1k>0) p_cost=(prompt_tokens/1000.0)*m_cfg.prompt_price_per_1k; if(completion_tokens>=0 && m_cfg.completion_price_per_1k>0) c_cost=(completion_tokens/1000.0)*m_cfg.completion_price_per_1k; if(p_cost>=0||c_cost>=0) t_cost=(p_cost<0?0:p_cost)+(c_cost<0?0:c_cost);
+            LLMCompletion comp{text,"gemini",prompt_tokens,completion_tokens,total_tokens,p_cost,c_cost,t_cost}; comp.cached_tokens=stream?st->cached:json_to_int(f[4]); return comp;
+        };
+        return call;
     }
-private: LLMConfig m_cfg; };
+    LLMConfig m_cfg; };
 // Ollama client
 
-class OllamaLLMClient : public LLMClient {
+class OllamaLLMClient : public HttpLLMClient {
 public:
     explicit OllamaLLMClient(const LLMConfig& cfg) : m_cfg(cfg) {}
-    std::optional<LLMCompletion> complete(const std::string& prompt) override {
+private:
+    Call prepare(const std::string& prompt, const LLMDeltaFn& on_delta) override {
+        Call call;
         std::string endpoint = m_cfg.endpoint.empty() ? "http://localhost:11434/api/generate" : m_cfg.endpoint;
-        CURL* curl = curl_easy_init(); if(!curl) return LLMCompletion{"(curl-init-fail)", "error"};
-        std::string response; curl_easy_setopt(curl, CURLOPT_URL, endpoint.c_str()); curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_cb_ollama); curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response); curl_easy_setopt(curl, CURLOPT_TIMEOUT, m_cfg.timeout_seconds);
-        struct curl_slist* headers=nullptr; headers=curl_slist_append(headers, "Content-Type: application/json"); curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        // Body conforme API generate: {"model":"<model>","prompt":"...","stream":false}
-        auto escape_json=[&](const std::string& in){ std::string out; out.reserve(in.size()+16); for(char c: in){ switch(c){ case '"': out+="\\\""; break; case '\\': out+="\\\\"; break; case '\n': out+="\\n"; break; case '\r': out+="\\r"; break; case '\t': out+="\\t"; break; default: out.push_back(c); } } return out; };        
-        std::ostringstream body; body << "{\"model\":\"" << (m_cfg.model.empty()?"llama2":m_cfg.model) << "\",\"prompt\":\"" << escape_json(prompt) << "\",\"stream\":false}"; std::string b=body.str(); curl_easy_setopt(curl, CURLOPT_POST, 1L); curl_easy_setopt(curl, CURLOPT_POSTFIELDS, b.c_str());
-        auto res = curl_easy_perform(curl); long code=0; curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE,&code); curl_slist_free_all(headers); curl_easy_cleanup(curl);
-        if(res!=CURLE_OK || code/100!=2){ return LLMCompletion{"(ollama error code="+std::to_string(code)+")","error"}; }
-        // Estrarre campo "response":"..." (semplice parser)
-        std::string text; std::string key="\"response\""; size_t pos=response.find(key); if(pos!=std::string::npos){ pos=response.find(':',pos); if(pos!=std::string::npos){ ++pos; while(pos<response.size() && (response[pos]==' ')) ++pos; if(pos<response.size() && response[pos]=='"'){ ++pos; bool esc=false; for(size_t i=pos;i<response.size();++i){ char c=response[i]; if(esc){ if(c=='n') text+="\n"; else if(c=='r') text+="\r"; else if(c=='t') text+="\t"; else text.push_back(c); esc=false; continue;} if(c=='\\'){ esc=true; continue;} if(c=='"') break; text.push_back(c); } } } }
-        if(text.empty()) text="(parse-empty)";
-        // Ollama non fornisce token usage diretto qui -> lasciamo -1
-        LLMCompletion comp{text, "ollama", -1,-1,-1,-1.0,-1.0,-1.0}; return comp;
+        // Body conforme API generate: {"model":"<model>","system":"...","prompt":"...","stream":false|true,"keep_alive":"30m"}.
+        // Il system fisso resta in testa al prompt effettivo: finche' il modello e' caricato (keep_alive) Ollama riusa la KV cache del prefisso
+        // (il "context" della risposta non si ripassa: porterebbe nel piano anche la richiesta precedente)
+        auto escape_json=[&](const std::string& in){ std::string out; out.reserve(in.size()+16); for(char c: in){ switch(c){ case '"': out+="\\\""; break; case '\\': out+="\\\\"; break; case '\n': out+="\\n"; break; case '\r': out+="\\r"; break; case '\t': out+="\\t"; break; default: out.push_back(c); } } return out; };
+        std::ostringstream body; body << "{\"model\":\"" << (m_cfg.model.empty()?"llama2":m_cfg.model) << "\",";
+        if(!m_cfg.system_prompt.empty()) body << "\"system\":\"" << escape_json(m_cfg.system_prompt) << "\",";
+        body << "\"prompt\":\"" << escape_json(prompt) << "\",\"stream\":" << (on_delta?"true":"false");
+        if(!m_cfg.keep_alive.empty()) body << ",\"keep_alive\":\"" << escape_json(m_cfg.keep_alive) << "\"";
+        body << "}";
+        call.req = json_request(endpoint, {}, body.str(), m_cfg.timeout_seconds);
+        // Streaming NDJSON: una riga {"response":"<frammento>","done":false} per token, l'ultima con done=true e i conteggi
+        auto streamed = std::make_shared<std::string>(); auto counts = std::make_shared<std::pair<int,int>>(-1,-1); std::function<void()> flush; bool stream = static_cast<bool>(on_delta);
+        if(stream) flush = stream_events(call.req, StreamDecoder::Format::NDJSON, [streamed,counts,on_delta](std::string_view ev){ auto f=json_pick(ev,{{"response"},{"prompt_eval_count"},{"eval_count"}}); std::string t=f[0].value_or(""); *streamed+=t; if(!t.empty()) on_delta(t); if(f[2]){ counts->first=json_to_int(f[1]); counts->second=json_to_int(f[2]); } });
+        call.finish = [m_cfg=m_cfg, streamed, counts, flush, stream](const HttpResponse& http)->LLMCompletion{
+            if(flush) flush();
+            const std::string& response = http.body; long code = http.status;
+            if(!http.ok()){ return LLMCompletion{"(ollama error code="+std::to_string(code)+")","error"}; }
+            // Risposta e usage nell'oggetto finale (in streaming l'ultima riga, done=true): prompt_eval_count / eval_count
+            // (assenti se il prompt era gia' in cache)
+            auto f=stream?std::vector<std::optional<std::string>>(3):json_pick(response,{{"response"},{"prompt_eval_count"},{"eval_count"}});
+            std::string text=stream?*streamed:f[0].value_or(""); if(text.empty()) text="(parse-empty)";
+            int prompt_tokens=stream?counts->first:json_to_int(f[1]), completion_tokens=stream?counts->second:json_to_int(f[2]); int total_tokens=(prompt_tokens>=0 && completion_tokens>=0)?prompt_tokens+completion_tokens:-1;
+            double p_cost=-1.0,c_cost=-1.0,t_cost=-1.0; if(prompt_tokens>=0 && m_cfg.prompt_price_per_1k>0) p_cost=(prompt_tokens/1000.0)*m_cfg.prompt_price_per_1k; if(completion_tokens>=0 && m_cfg.completion_price_per_1k>0) c_cost=(completion_tokens/1000.0)*m_cfg.completion_price_per_1k; if(p_cost>=0||c_cost>=0) t_cost=(p_cost<0?0:p_cost)+(c_cost<0?0:c_cost);
+            LLMCompletion comp{text, "ollama", prompt_tokens,completion_tokens,total_tokens,p_cost,c_cost,t_cost}; return comp;
+        };
+        return call;
     }
-private:
     LLMConfig m_cfg;
 };
 
 // Extend factory (wrapped in anonymous helper to avoid ODR issues)
 std::unique_ptr<LLMClient> make_llm_provider_extended(const LLMConfig& cfg){
+    if(cfg.enabled && (cfg.retries>0 || !cfg.fallback.empty())){
+        // Catena di failover: il provider configurato (eventualmente con hedge) e poi llm_fallback in ordine.
+        // Fallback "provider[:model][@endpoint]": chiave del primario se il provider e' lo stesso,
+        // altrimenti la variabile convenzionale del provider (OPENAI_API_KEY, ANTHROPIC_API_KEY, GEMINI_API_KEY)
+        LLMConfig primary=cfg; primary.retries=0; primary.fallback.clear();
+        std::vector<ResilientLLMClient::Provider> providers;
+        providers.push_back({primary.provider+(primary.model.empty()?"":":"+primary.model), make_llm_provider_extended(primary)});
+        for(const auto& spec: cfg.fallback){
+            LLMConfig fb=primary; fb.hedge_provider.clear();
+            std::string head=spec; auto at=spec.find('@'); fb.endpoint.clear(); if(at!=std::string::npos){ head=spec.substr(0,at); fb.endpoint=spec.substr(at+1); }
+            auto colon=head.find(':'); fb.provider=head.substr(0,colon); fb.model=colon==std::string::npos?std::string():head.substr(colon+1);
+            if(fb.provider.empty()) continue;
+            if(fb.provider!=primary.provider){ fb.api_key.clear(); fb.api_key_env=fb.provider=="openai"?"OPENAI_API_KEY":fb.provider=="claude"?"ANTHROPIC_API_KEY":fb.provider=="gemini"?"GEMINI_API_KEY":""; }
+            providers.push_back({head, make_llm_provider_extended(fb)});
+        }
+        RetryPolicy rp; rp.retries=cfg.retries; rp.base=std::chrono::milliseconds(cfg.backoff_base_ms); rp.max=std::chrono::milliseconds(cfg.backoff_max_ms); rp.attempt_timeout=std::chrono::milliseconds(cfg.attempt_timeout_ms);
+        CircuitBreaker::Policy bp; bp.error_rate=cfg.breaker_error_rate; bp.slow_call=std::chrono::milliseconds(cfg.breaker_slow_ms); bp.cooldown=std::chrono::milliseconds(cfg.breaker_cooldown_ms);
+        return std::make_unique<ResilientLLMClient>(std::move(providers), rp, bp);
+    }
+    if(cfg.enabled && !cfg.hedge_provider.empty()){
+        // Secondario: stessi parametri (timeout, prezzi, max_tokens) con provider/modello/endpoint propri;
+        // la chiave del primario vale solo se il provider e' lo stesso
+        LLMConfig primary=cfg; primary.hedge_provider.clear();
+        LLMConfig secondary=primary; secondary.provider=cfg.hedge_provider; secondary.model=cfg.hedge_model; secondary.endpoint=cfg.hedge_endpoint;
+        if(!cfg.hedge_api_key_env.empty()){ secondary.api_key_env=cfg.hedge_api_key_env; secondary.api_key.clear(); }
+        else if(secondary.provider!=primary.provider){ secondary.api_key_env.clear(); secondary.api_key.clear(); }
+        return std::make_unique<HedgedLLMClient>(make_llm_provider_extended(primary), make_llm_provider_extended(secondary), std::chrono::milliseconds(cfg.hedge_delay_ms));
+    }
     if(cfg.enabled){
         if(cfg.provider=="openai") return std::make_unique<OpenAILLMClient>(cfg);
         if(cfg.provider=="ollama") return std::make_unique<OllamaLLMClient>(cfg);
-        if(cfg.provider=="claude") return std::make_unique<ClaudeLLMClient>(cfg); // definita in llm_claude.cpp
-        if(cfg.provider=="gemini") return std::make_unique<GeminiLLMClient>(cfg); // definita in llm_gemini.cpp
+        if(cfg.provider=="claude") return std::make_unique<ClaudeLLMClient>(cfg); // definita sopra, in questo file
+        if(cfg.provider=="gemini") return std::make_unique<GeminiLLMClient>(cfg); // definita sopra, in questo file
     }
     return std::make_unique<StubLLMClient>(cfg);
 }
@@ -0,0 +1,126 @@
+// Checksummed append-only log records (plan cache, plan journal)
+#include <ai-autoshell/ai/log_record.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace autoshell::ai {
+
+namespace {
+
+std::uint32_t fnv1a(std::string_view s) {
+    std::uint32_t h = 2166136261u;
+    for (unsigned char c : s) { h ^= c; h *= 16777619u; }
+    return h;
+}
+
+std::string escape(std::string_view s) {
+    std::string out; out.reserve(s.size());
+    for (char c : s) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '\t') out += "\\t";
+        else if (c == '\n') out += "\\n";
+        else if (c == '\r') out += "\\r";
+        else out.push_back(c);
+    }
+    return out;
+}
+
+std::string unescape(std::string_view s) {
+    std::string out; out.reserve(s.size());
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 == s.size()) { out.push_back(s[i]); continue; }
+        char c = s[++i];
+        out.push_back(c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c);
+    }
+    return out;
+}
+
+} // namespace
+
+std::string log_record(std::initializer_list<std::string> fields) {
+    std::string body;
+    for (auto& f : fields) { if (!body.empty()) body.push_back('\t'); body += escape(f); }
+    char crc[16]; std::snprintf(crc, sizeof(crc), "%08x", fnv1a(body));
+    return body + "\t" + crc + "\n";
+}
+
+bool parse_log_record(std::string_view line, std::vector<std::string>& fields) {
+    auto tab = line.rfind('\t');
+    if (tab == std::string_view::npos || line.size() - tab - 1 != 8) return false;
+    std::string_view body = line.substr(0, tab);
+    char crc[16]; std::snprintf(crc, sizeof(crc), "%08x", fnv1a(body));
+    if (line.substr(tab + 1) != crc) return false;
+    fields.clear();
+    std::size_t start = 0;
+    for (;;) {
+        auto t = body.find('\t', start);
+        fields.push_back(unescape(body.substr(start, t == std::string_view::npos ? std::string_view::npos : t - start)));
+        if (t == std::string_view::npos) break;
+        start = t + 1;
+    }
+    return true;
+}
+
+bool replay_log(const std::string& path, const std::function<void(const std::vector<std::string>&)>& fn, bool* torn) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::stringstream ss; ss << in.rdbuf();
+    std::string data = ss.str();
+    std::vector<std::string> fields;
+    std::size_t pos = 0;
+    for (;;) {
+        auto nl = data.find('\n', pos);
+        if (nl == std::string::npos) break; // record without newline: interrupted write
+        if (parse_log_record(std::string_view(data).substr(pos, nl - pos), fields)) fn(fields);
+        pos = nl + 1;
+    }
+    if (torn) *torn = pos != data.size();
+    return true;
+}
+
+bool append_log(const std::string& path, const std::string& record, bool sync) {
+    std::error_code ec;
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+    int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    // Un solo write per record: con O_APPEND piu' shell possono condividere il file
+    bool ok = ::write(fd, record.data(), record.size()) == static_cast<ssize_t>(record.size());
+    if (sync) ::fdatasync(fd);
+    ::close(fd);
+    return ok;
+}
+
+bool rewrite_log(const std::string& path, const std::string& records) {
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, records.data(), records.size()) == static_cast<ssize_t>(records.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (ok && std::rename(tmp.c_str(), path.c_str()) == 0) return true;
+    std::remove(tmp.c_str());
+    return false;
+}
+
+LogLock::LogLock(const std::string& path, bool exclusive) {
+    std::error_code ec;
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+    // File a parte: il log viene sostituito da rewrite_log (rename), il lock deve restare sullo stesso inode
+    m_fd = ::open((path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_fd < 0) return;
+    while (::flock(m_fd, exclusive ? LOCK_EX : LOCK_SH) != 0 && errno == EINTR) {}
+}
+
+LogLock::~LogLock() {
+    if (m_fd >= 0) ::close(m_fd);
+}
+
+} // namespace autoshell::ai
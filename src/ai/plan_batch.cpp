@@ -0,0 +1,264 @@
+// Batch planning with rate-limited concurrency (--plan-batch)
+#include <ai-autoshell/ai/plan_batch.hpp>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include <ai-autoshell/ai/plan_cache.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+
+namespace autoshell::ai {
+
+RateLimiter::RateLimiter(int requests_per_minute, int tokens_per_minute) {
+    m_requests.capacity = m_requests.level = std::max(0, requests_per_minute);
+    m_tokens.capacity = m_tokens.level = std::max(0, tokens_per_minute);
+}
+
+void RateLimiter::refill(Clock::time_point now) {
+    if (m_last == Clock::time_point{}) { m_last = now; return; }
+    if (now <= m_last) return;
+    double minutes = std::chrono::duration<double>(now - m_last).count() / 60.0;
+    for (auto* b : {&m_requests, &m_tokens}) b->level = std::min(b->capacity, b->level + b->capacity * minutes);
+    m_last = now;
+}
+
+RateLimiter::Clock::time_point RateLimiter::reserve(std::size_t tokens, Clock::time_point now) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    refill(now);
+    double wait_minutes = 0;
+    // Debito subito anche in negativo: chi arriva dopo aspetta il proprio turno (niente raffiche)
+    auto take = [&](Bucket& b, double cost) {
+        if (b.capacity <= 0) return;
+        b.level -= std::min(cost, b.capacity); // una richiesta piu' grande del minuto intero aspetta al massimo un minuto
+        if (b.level < 0) wait_minutes = std::max(wait_minutes, -b.level / b.capacity);
+    };
+    take(m_requests, 1);
+    take(m_tokens, static_cast<double>(tokens));
+    auto at = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(wait_minutes * 60.0));
+    return std::max(at, m_paused);
+}
+
+void RateLimiter::acquire(std::size_t tokens) {
+    std::this_thread::sleep_until(reserve(tokens));
+}
+
+void RateLimiter::settle(std::size_t estimated, std::size_t actual) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    if (m_tokens.capacity <= 0) return;
+    m_tokens.level = std::min(m_tokens.capacity, m_tokens.level + static_cast<double>(estimated) - static_cast<double>(actual));
+}
+
+void RateLimiter::pause_until(Clock::time_point t) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    m_paused = std::max(m_paused, t);
+}
+
+namespace {
+
+Plan to_plan(const std::string& request, const ParsedPlan& parsed, const BatchOptions& o) {
+    Plan p;
+    p.request = request;
+    int auto_id = 1;
+    for (auto& st : parsed.steps) {
+        PlanStep s;
+        s.id = st.id;
+        if (s.id.empty()) { char id[16]; std::snprintf(id, sizeof(id), "s%d", auto_id++); s.id = id; } // "s"+to_string: -Wrestrict di GCC 12 a -O3
+        s.description = st.description.empty() ? "LLM step" : st.description;
+        s.command = st.command;
+        s.depends_on = st.depends_on; s.parallel = st.parallel;
+        s.inputs = st.inputs; s.outputs = st.outputs;
+        s.confirm = st.confirm || (o.risky && o.risky(s.command));
+        if (s.confirm) p.dangerous = true;
+        p.steps.push_back(std::move(s));
+    }
+    return p;
+}
+
+// Oggetti JSON di primo livello nel testo (array di piani, o piani uno dopo l'altro)
+std::vector<std::string> split_objects(const std::string& text) {
+    std::vector<std::string> out;
+    int depth = 0;
+    bool in_str = false, esc = false;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (in_str) {
+            if (esc) esc = false;
+            else if (c == '\\') esc = true;
+            else if (c == '"') in_str = false;
+            continue;
+        }
+        if (c == '"') in_str = depth > 0;
+        else if (c == '{') { if (depth++ == 0) start = i; }
+        else if (c == '}' && depth > 0 && --depth == 0) out.push_back(text.substr(start, i - start + 1));
+    }
+    return out;
+}
+
+std::string packed_request(const std::vector<std::string>& requests) {
+    auto n = std::to_string(requests.size());
+    std::string r = "Plan each of these ";
+    r += n;
+    r += " requests separately. Reply ONLY with a JSON array of ";
+    r += n;
+    r += " plans in the same order, each in the schema above:";
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        r += '\n';
+        r += std::to_string(i + 1);
+        r += ". ";
+        r += requests[i];
+    }
+    return r;
+}
+
+std::string error_text(const std::optional<LLMCompletion>& r) {
+    if (!r) return "cancelled";
+    std::string t = r->text.empty() ? "(empty response)" : r->text;
+    return t.size() > 200 ? t.substr(0, 200) + "..." : t;
+}
+
+} // namespace
+
+BatchStats run_plan_batch(const std::vector<std::string>& requests, LLMClient& client, const BatchOptions& opts,
+                          const std::function<void(const BatchResult&)>& on_result) {
+    auto t0 = std::chrono::steady_clock::now();
+    const std::size_t n = requests.size();
+    constexpr std::size_t none = static_cast<std::size_t>(-1);
+    std::vector<std::optional<BatchResult>> results(n);
+    std::vector<std::size_t> dup_of(n, none);
+    std::deque<std::vector<std::size_t>> queue; // unita' di lavoro: indici di una chiamata LLM
+    BatchStats stats;
+    stats.requests = n;
+
+    // Duplicati e cache prima di ogni chiamata; i corti restano da impacchettare
+    std::unordered_map<std::string, std::size_t> first;
+    std::vector<std::size_t> packable;
+    for (std::size_t i = 0; i < n; ++i) {
+        auto [it, fresh] = first.emplace(PlanCache::make_key(requests[i], "", "", ""), i);
+        if (!fresh) { dup_of[i] = it->second; continue; }
+        if (opts.cache_get) {
+            if (auto hit = opts.cache_get(requests[i])) {
+                auto parsed = parse_plan_json(*hit);
+                if (parsed.valid && !parsed.steps.empty()) {
+                    results[i] = BatchResult{i, to_plan(requests[i], parsed, opts), "cache", {}, -1, -1};
+                    continue;
+                }
+            }
+        }
+        if (opts.pack > 1 && requests[i].size() <= opts.pack_max_chars) packable.push_back(i);
+        else queue.push_back({i});
+    }
+    for (std::size_t k = 0; k < packable.size(); k += opts.pack)
+        queue.push_back(std::vector<std::size_t>(packable.begin() + k, packable.begin() + std::min(packable.size(), k + opts.pack)));
+
+    std::mutex mu;
+    std::condition_variable cv;
+    std::size_t in_flight = 0, next_emit = 0;
+    auto emit_ready = [&] { // con mu preso
+        for (; next_emit < n; ++next_emit) {
+            std::size_t i = next_emit;
+            if (!results[i] && dup_of[i] != none && results[dup_of[i]]) {
+                BatchResult d = *results[dup_of[i]];
+                d.index = i; d.plan.request = requests[i]; d.prompt_tokens = d.completion_tokens = -1;
+                if (d.error.empty()) d.source = "duplicate";
+                results[i] = std::move(d);
+            }
+            if (!results[i]) break;
+            if (on_result) on_result(*results[i]);
+        }
+    };
+
+    RateLimiter limiter(opts.requests_per_minute, opts.tokens_per_minute);
+    const std::size_t system_tokens = estimate_tokens(opts.system_prompt);
+    auto process = [&](const std::vector<std::size_t>& unit) {
+        std::vector<std::size_t> retry; // mancanti da una risposta impacchettata: di nuovo uno per uno
+        std::vector<std::string> reqs;
+        for (auto i : unit) reqs.push_back(requests[i]);
+        bool packed = unit.size() > 1;
+        std::string prompt = make_plan_prompt(packed ? packed_request(reqs) : reqs[0], opts.context).user();
+        std::size_t estimated = system_tokens + estimate_tokens(prompt) + opts.max_tokens * unit.size();
+        limiter.acquire(estimated);
+        auto r = client.complete(prompt);
+        if (r && r->http_status == 429 && r->retry_after_ms > 0)
+            limiter.pause_until(std::chrono::steady_clock::now() + std::chrono::milliseconds(r->retry_after_ms));
+        limiter.settle(estimated, r && r->total_tokens >= 0 ? static_cast<std::size_t>(r->total_tokens) : estimated);
+        std::vector<BatchResult> done;
+        bool cacheable = r && r->source != "stub" && r->source != "echo";
+        if (!r || r->source == "error") {
+            for (auto i : unit) done.push_back(BatchResult{i, Plan{requests[i], {}, {}, false}, "error", error_text(r), -1, -1});
+        } else {
+            auto objects = packed ? split_objects(r->text) : std::vector<std::string>{r->text};
+            std::vector<ParsedPlan> plans;
+            for (auto& o : objects) plans.push_back(parse_plan_json(o));
+            // Tutti presenti: per posizione (il modello puo' riformulare "request"); altrimenti per "request"
+            auto pick = [&](std::size_t k) -> std::size_t {
+                if (plans.size() == unit.size()) return k;
+                auto key = PlanCache::make_key(requests[unit[k]], "", "", "");
+                for (std::size_t p = 0; p < plans.size(); ++p)
+                    if (PlanCache::make_key(plans[p].request, "", "", "") == key) return p;
+                return none;
+            };
+            for (std::size_t k = 0; k < unit.size(); ++k) {
+                auto i = unit[k];
+                auto p = pick(k);
+                ParsedPlan parsed = p == none ? ParsedPlan{} : plans[p];
+                if (parsed.valid && !parsed.steps.empty()) {
+                    if (cacheable && opts.cache_put) opts.cache_put(requests[i], objects[p]);
+                    done.push_back(BatchResult{i, to_plan(requests[i], parsed, opts), packed ? "packed" : "llm", {}, r->prompt_tokens, r->completion_tokens});
+                } else if (packed) retry.push_back(i);
+                else done.push_back(BatchResult{i, Plan{requests[i], {}, {}, false}, "error", "unparseable response: " + error_text(r), r->prompt_tokens, r->completion_tokens});
+            }
+        }
+        std::lock_guard<std::mutex> lk(mu);
+        ++stats.llm_calls;
+        if (packed) ++stats.packed_calls;
+        if (r && r->prompt_tokens > 0) stats.prompt_tokens += r->prompt_tokens;
+        if (r && r->completion_tokens > 0) stats.completion_tokens += r->completion_tokens;
+        for (auto& d : done) results[d.index] = std::move(d);
+        for (auto i : retry) queue.push_back({i});
+    };
+
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        emit_ready(); // cache e duplicati in testa al file
+    }
+    std::size_t workers = std::min(std::max<std::size_t>(1, opts.jobs), queue.size());
+    std::vector<std::thread> pool;
+    for (std::size_t w = 0; w < workers; ++w) pool.emplace_back([&] {
+        std::unique_lock<std::mutex> lk(mu);
+        while (true) {
+            cv.wait(lk, [&] { return !queue.empty() || in_flight == 0; });
+            if (queue.empty()) return; // niente in coda ne' in volo: finito
+            auto unit = std::move(queue.front());
+            queue.pop_front();
+            ++in_flight;
+            lk.unlock();
+            process(unit);
+            lk.lock();
+            --in_flight;
+            emit_ready();
+            cv.notify_all();
+        }
+    });
+    for (auto& t : pool) t.join();
+
+    for (auto& r : results) {
+        if (!r) continue;
+        if (!r->error.empty()) ++stats.failed;
+        else ++stats.planned;
+        if (r->source == "cache") ++stats.cache_hits;
+        if (r->source == "duplicate") ++stats.duplicates;
+    }
+    stats.wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+std::string batch_result_json(const BatchResult& r) {
+    std::string line = to_json(r.plan, false);
+    if (!r.error.empty()) line = "{\"error\": \"" + json_escape(r.error) + "\", " + line.substr(1);
+    return line;
+}
+
+} // namespace autoshell::ai
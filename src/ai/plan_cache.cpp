@@ -0,0 +1,177 @@
+// Persistent plan cache (append-only log + in-memory LRU)
+#include <ai-autoshell/ai/plan_cache.hpp>
+#include <ai-autoshell/ai/log_record.hpp>
+#include <cctype>
+#include <ctime>
+
+namespace autoshell::ai {
+
+namespace {
+
+// Log records (log_record.hpp), one per line:
+//   P created last_used hits key request plan   (insert / replace)
+//   H time key                                  (hit: move to front)
+//   D key                                       (evicted or expired)
+std::int64_t to_i64(const std::string& s) { try { return std::stoll(s); } catch (...) { return 0; } }
+
+} // namespace
+
+PlanCache::PlanCache(PlanCacheOptions opts) : m_opts(std::move(opts)) {
+    load();
+}
+
+std::string PlanCache::make_key(std::string_view request, std::string_view provider, std::string_view model,
+                                std::string_view prompt_version) {
+    std::string norm;
+    for (unsigned char c : request) {
+        if (std::isspace(c)) { if (!norm.empty() && norm.back() != ' ') norm.push_back(' '); continue; }
+        norm.push_back(static_cast<char>(std::tolower(c)));
+    }
+    if (!norm.empty() && norm.back() == ' ') norm.pop_back();
+    std::string key;
+    key.append(provider).append("|").append(model).append("|").append(prompt_version).append("|").append(norm);
+    return key;
+}
+
+std::int64_t PlanCache::now() const {
+    return m_opts.now ? m_opts.now() : static_cast<std::int64_t>(std::time(nullptr));
+}
+
+void PlanCache::load() {
+    if (m_opts.path.empty()) return;
+    bool torn = false;
+    if (!replay_log(m_opts.path, [&](const std::vector<std::string>& rec) { apply(rec); ++m_log_records; }, &torn)) return;
+    std::lock_guard<std::mutex> lk(m_mu);
+    enforce_limits();
+    if (m_log_records > 2 * m_lru.size() + 64 || torn) compact();
+}
+
+void PlanCache::apply(const std::vector<std::string>& rec) {
+    const std::string& op = rec[0];
+    if (op == "P" && rec.size() == 7) {
+        auto it = m_index.find(rec[4]);
+        if (it != m_index.end()) erase(it->second, false);
+        Entry e{rec[4], rec[5], rec[6], to_i64(rec[1]), to_i64(rec[2]), static_cast<std::uint64_t>(to_i64(rec[3]))};
+        m_bytes += e.request.size() + e.plan.size();
+        m_lru.push_front(std::move(e));
+        m_index[m_lru.front().key] = m_lru.begin();
+    } else if (op == "H" && rec.size() == 3) {
+        auto it = m_index.find(rec[2]);
+        if (it == m_index.end()) return;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        it->second->last_used = to_i64(rec[1]);
+        it->second->hits++;
+    } else if (op == "D" && rec.size() == 2) {
+        auto it = m_index.find(rec[1]);
+        if (it != m_index.end()) erase(it->second, false);
+    }
+}
+
+void PlanCache::erase(List::iterator it, bool log) {
+    if (log) append(log_record({"D", it->key}), false);
+    m_bytes -= it->request.size() + it->plan.size();
+    m_index.erase(it->key);
+    m_lru.erase(it);
+}
+
+void PlanCache::enforce_limits(bool log) {
+    if (m_opts.ttl_seconds > 0) {
+        std::int64_t limit = now() - m_opts.ttl_seconds;
+        for (auto it = m_lru.begin(); it != m_lru.end();) {
+            auto cur = it++;
+            if (cur->created < limit) { erase(cur, log); m_stats.evictions++; }
+        }
+    }
+    while (!m_lru.empty() && (m_lru.size() > m_opts.max_entries || m_bytes > m_opts.max_bytes)) {
+        erase(std::prev(m_lru.end()), log);
+        m_stats.evictions++;
+    }
+}
+
+std::optional<std::string> PlanCache::get(const std::string& key, bool count) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    auto it = m_index.find(key);
+    if (it == m_index.end()) { if (count) m_stats.misses++; return std::nullopt; }
+    std::int64_t t = now();
+    if (m_opts.ttl_seconds > 0 && it->second->created < t - m_opts.ttl_seconds) {
+        erase(it->second, true);
+        m_stats.evictions++;
+        if (count) m_stats.misses++;
+        return std::nullopt;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    it->second->last_used = t;
+    it->second->hits++;
+    if (count) m_stats.hits++;
+    append(log_record({"H", std::to_string(t), key}), false); // l'ordine LRU perso in un crash non e' grave
+    return it->second->plan;
+}
+
+void PlanCache::put(const std::string& key, const std::string& request, const std::string& plan) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) erase(it->second, false);
+    std::int64_t t = now();
+    m_lru.push_front(Entry{key, request, plan, t, t, 0});
+    m_index[key] = m_lru.begin();
+    m_bytes += request.size() + plan.size();
+    append(log_record({"P", std::to_string(t), std::to_string(t), "0", key, request, plan}), true);
+    enforce_limits();
+    if (m_log_records > 2 * m_lru.size() + 64) compact();
+}
+
+void PlanCache::clear() {
+    std::lock_guard<std::mutex> lk(m_mu);
+    m_lru.clear(); m_index.clear(); m_bytes = 0; m_stats = Stats{};
+    compact(false); // niente da rileggere: si svuota anche quanto scritto dalle altre shell
+}
+
+std::vector<PlanCache::Entry> PlanCache::entries() const {
+    std::lock_guard<std::mutex> lk(m_mu);
+    return {m_lru.begin(), m_lru.end()};
+}
+
+PlanCache::Stats PlanCache::stats() const {
+    std::lock_guard<std::mutex> lk(m_mu);
+    Stats s = m_stats;
+    s.entries = m_lru.size();
+    s.bytes = m_bytes;
+    return s;
+}
+
+void PlanCache::append(const std::string& rec, bool sync) {
+    if (m_opts.path.empty()) return;
+    LogLock lock(m_opts.path, false); // non durante una compattazione, che finirebbe per perderlo
+    if (append_log(m_opts.path, rec, sync)) ++m_log_records;
+}
+
+// Rilegge il log sotto lock esclusivo: le entry scritte da altre shell dopo il nostro load entrano in memoria
+// e sopravvivono alla compattazione. I nostri record sono gia' nel log, quindi il replay li contiene.
+bool PlanCache::reload() {
+    List lru; std::unordered_map<std::string, List::iterator> index;
+    lru.swap(m_lru); index.swap(m_index);
+    std::size_t bytes = m_bytes, records = 0;
+    m_bytes = 0;
+    if (!replay_log(m_opts.path, [&](const std::vector<std::string>& rec) { apply(rec); ++records; })) {
+        m_lru.swap(lru); m_index.swap(index); // log non leggibile: resta lo stato in memoria
+        m_bytes = bytes;
+        return false;
+    }
+    m_log_records = records;
+    return true;
+}
+
+// Riscrive il log con le sole entry vive (dalla meno recente, cosi' il replay ricostruisce l'ordine LRU)
+// in un file temporaneo, poi rename atomico. Tutto sotto il LogLock esclusivo, come PlanJournal.
+void PlanCache::compact(bool merge) {
+    if (m_opts.path.empty()) return;
+    LogLock lock(m_opts.path, true);
+    if (merge && reload()) enforce_limits(false); // gli scarti spariscono con la riscrittura: nessun record D
+    std::string out;
+    for (auto it = m_lru.rbegin(); it != m_lru.rend(); ++it)
+        out += log_record({"P", std::to_string(it->created), std::to_string(it->last_used), std::to_string(it->hits),
+                       it->key, it->request, it->plan});
+    if (rewrite_log(m_opts.path, out)) m_log_records = m_lru.size();
+}
+
+} // namespace autoshell::ai
@@ -0,0 +1,285 @@
+// Dependency-aware execution of plan steps (depends_on / parallel)
+#include <ai-autoshell/ai/plan_dag.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace autoshell::ai {
+
+// Comando che cambia solo lo stato della shell ("cd build", "export CC=clang", "X=1; cd src"):
+// eseguito in un processo a parte, nessun altro step ne vede l'effetto
+bool shell_state_only(const std::string& cmd) {
+    static const char* builtins[] = {"cd", "pushd", "popd", "export", "unset", "set", "alias", "umask", "source", "."};
+    bool any = false;
+    for (std::size_t i = 0; i < cmd.size();) {
+        std::size_t e = cmd.find_first_of(";&|", i);
+        std::istringstream words(cmd.substr(i, e == std::string::npos ? std::string::npos : e - i));
+        std::string first, next;
+        if (words >> first) {
+            auto eq = first.find('=');
+            bool assign = eq != std::string::npos && eq > 0 && (std::isalpha(static_cast<unsigned char>(first[0])) || first[0] == '_') && !(words >> next);
+            if (!assign && std::find(std::begin(builtins), std::end(builtins), first) == std::end(builtins)) return false;
+            any = true;
+        }
+        if (e == std::string::npos) break;
+        i = cmd.find_first_not_of(";&|", e);
+        if (i == std::string::npos) break;
+    }
+    return any;
+}
+
+PlanGraph build_plan_graph(const std::vector<PlanStep>& steps) {
+    PlanGraph g;
+    g.deps.resize(steps.size());
+    std::unordered_map<std::string, std::size_t> index;
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        if (!steps[i].depends_on.empty() || steps[i].parallel) g.concurrent = true;
+        if (!index.emplace(steps[i].id, i).second && g.error.empty()) g.error = "duplicate step id '" + steps[i].id + "'";
+    }
+    if (!g.concurrent) g.error.clear(); // piano sequenziale classico: gli id non servono
+    // Ogni step del grafo gira in un figlio: un 'cd' o un 'export' da solo non arriverebbe agli step successivi
+    for (std::size_t i = 0; i < steps.size() && g.concurrent && g.error.empty(); ++i)
+        if (shell_state_only(steps[i].command))
+            g.error = "step '" + steps[i].id + "' only changes shell state ('" + steps[i].command + "'), but with depends_on/parallel every step runs in its own process: "
+                      "join it to the commands that need it (e.g. 'cd build && make')";
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        if (steps[i].depends_on.empty()) {
+            if (!steps[i].parallel && i > 0) g.deps[i].push_back(i - 1);
+            continue;
+        }
+        for (auto& id : steps[i].depends_on) {
+            auto it = index.find(id);
+            if (it == index.end()) { if (g.error.empty()) g.error = "step '" + steps[i].id + "' depends on unknown step '" + id + "'"; continue; }
+            if (it->second == i) { if (g.error.empty()) g.error = "step '" + id + "' depends on itself"; continue; }
+            if (std::find(g.deps[i].begin(), g.deps[i].end(), it->second) == g.deps[i].end()) g.deps[i].push_back(it->second);
+        }
+    }
+    if (!g.error.empty()) return g;
+    // Kahn: cio' che resta con dipendenze non risolte sta su un ciclo
+    std::vector<std::size_t> missing(steps.size());
+    std::vector<std::vector<std::size_t>> users(steps.size());
+    for (std::size_t i = 0; i < steps.size(); ++i) { missing[i] = g.deps[i].size(); for (auto d : g.deps[i]) users[d].push_back(i); }
+    std::vector<std::size_t> ready;
+    for (std::size_t i = 0; i < steps.size(); ++i) if (!missing[i]) ready.push_back(i);
+    std::size_t seen = 0;
+    while (!ready.empty()) {
+        auto i = ready.back(); ready.pop_back(); ++seen;
+        for (auto u : users[i]) if (--missing[u] == 0) ready.push_back(u);
+    }
+    if (seen != steps.size()) {
+        g.error = "dependency cycle among steps:";
+        for (std::size_t i = 0; i < steps.size(); ++i) if (missing[i]) g.error += " " + steps[i].id;
+    }
+    return g;
+}
+
+#ifndef _WIN32
+
+namespace {
+
+struct Slot {
+    enum class Phase { Pending, Running, Done } phase = Phase::Pending;
+    pid_t pid = -1;
+    int fd = -1;
+    std::string buf;      // output not yet printed
+    bool header = false;  // "Executing" line printed
+    std::chrono::steady_clock::time_point started;
+};
+
+// Nel figlio di uno step (capogruppo): il SIGTERM dell'interruzione arriva a tutto il gruppo;
+// prima di uscire si raccolgono i comandi lanciati, cosi' nessuno resta orfano
+void on_step_term(int) {
+    while (waitpid(-1, nullptr, 0) > 0 || errno == EINTR) {}
+    _exit(128 + SIGTERM);
+}
+
+// Gruppo di uno step interrotto: un comando che ignora SIGTERM viene ucciso dopo questo margine
+constexpr std::chrono::milliseconds kTermGrace{2000};
+
+void drain(Slot& s) {
+    char tmp[4096];
+    for (;;) {
+        ssize_t n = read(s.fd, tmp, sizeof(tmp));
+        if (n > 0) { s.buf.append(tmp, static_cast<std::size_t>(n)); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0) { close(s.fd); s.fd = -1; }
+        return; // EAGAIN: per ora niente altro
+    }
+}
+
+} // namespace
+
+std::vector<StepOutcome> run_plan_dag(const std::vector<PlanStep>& steps, const PlanGraph& graph, const DagRunOptions& opts) {
+    std::ostream& out = opts.out ? *opts.out : std::cout;
+    const std::size_t n = steps.size();
+    const std::size_t limit = std::max<std::size_t>(1, opts.max_parallel);
+    std::vector<StepOutcome> result(n);
+    std::vector<Slot> slots(n);
+    std::size_t running = 0, head = 0; // head: primo step la cui uscita non e' ancora stata stampata
+    bool stopping = false, killed = false;
+    std::chrono::steady_clock::time_point stop_time;
+    for (std::size_t i = 0; i < n && i < opts.done.size(); ++i)
+        if (opts.done[i]) { slots[i].phase = Slot::Phase::Done; result[i] = {StepOutcome::State::Ok, 0, {}, -1}; }
+
+    auto spawn = [&](std::size_t i) {
+        int p[2];
+        if (pipe(p) != 0) { slots[i].phase = Slot::Phase::Done; result[i] = {StepOutcome::State::Failed, 127, {}, -1}; slots[i].buf = "pipe: failed\n"; if (opts.on_finish) opts.on_finish(i, result[i]); return; }
+        out.flush(); std::fflush(nullptr); // niente buffer duplicati nel figlio
+        pid_t pid = fork();
+        if (pid == 0) {
+            setpgid(0, 0); // i comandi dello step restano nel suo gruppo (ExecContext::job_control=false)
+            std::signal(SIGTERM, on_step_term);
+            close(p[0]);
+            dup2(p[1], 1); dup2(p[1], 2); close(p[1]);
+            // Il terminale resta alla shell: da un gruppo in background una lettura fermerebbe lo step (SIGTTIN)
+            int null_fd = open("/dev/null", O_RDONLY);
+            if (null_fd >= 0) { dup2(null_fd, 0); close(null_fd); }
+            int st = 1;
+            try { st = opts.run ? opts.run(i) : 0; } catch (...) {}
+            std::cout.flush(); std::cerr.flush(); std::fflush(nullptr);
+            _exit(st & 0xff);
+        }
+        close(p[1]);
+        if (pid > 0) setpgid(pid, pid); // anche nel padre: kill(-pid) non deve precedere il figlio
+        if (pid < 0) { close(p[0]); slots[i].phase = Slot::Phase::Done; result[i] = {StepOutcome::State::Failed, 127, {}, -1}; slots[i].buf = "fork: failed\n"; if (opts.on_finish) opts.on_finish(i, result[i]); return; }
+        fcntl(p[0], F_SETFL, fcntl(p[0], F_GETFL) | O_NONBLOCK);
+        fcntl(p[0], F_SETFD, FD_CLOEXEC); // i comandi lanciati dai passi successivi non la ereditano
+        slots[i].pid = pid; slots[i].fd = p[0]; slots[i].phase = Slot::Phase::Running;
+        slots[i].started = std::chrono::steady_clock::now();
+        ++running;
+        if (opts.on_start) opts.on_start(i);
+    };
+
+    for (;;) {
+        if (!stopping && opts.interrupted && opts.interrupted()) {
+            stopping = true; stop_time = std::chrono::steady_clock::now();
+            for (auto& s : slots) if (s.phase == Slot::Phase::Running) kill(-s.pid, SIGTERM); // lo step e i suoi comandi
+        }
+        if (stopping && !killed && running && std::chrono::steady_clock::now() - stop_time > kTermGrace) {
+            killed = true;
+            for (auto& s : slots) if (s.phase == Slot::Phase::Running) kill(-s.pid, SIGKILL);
+        }
+        // Dipendenze fallite o saltate: si salta anche chi ne dipende (a catena, in ordine di piano)
+        for (std::size_t i = 0; i < n; ++i) {
+            if (slots[i].phase != Slot::Phase::Pending) continue;
+            std::string blocked = stopping ? "interrupted" : "";
+            for (auto d : graph.deps[i]) {
+                if (slots[d].phase != Slot::Phase::Done || result[d].state == StepOutcome::State::Ok) continue;
+                blocked = result[d].state == StepOutcome::State::Failed ? steps[d].id : result[d].blocked_by;
+                break;
+            }
+            if (!blocked.empty()) { slots[i].phase = Slot::Phase::Done; result[i] = {StepOutcome::State::Skipped, -1, blocked, -1}; if (opts.on_finish) opts.on_finish(i, result[i]); }
+        }
+        for (std::size_t i = 0; i < n && running < limit && !stopping; ++i) {
+            if (slots[i].phase != Slot::Phase::Pending) continue;
+            bool ready = std::all_of(graph.deps[i].begin(), graph.deps[i].end(), [&](std::size_t d) { return slots[d].phase == Slot::Phase::Done; });
+            if (!ready) continue;
+            // Controllato solo ora: le dipendenze appena finite possono aver cambiato gli input
+            if (opts.up_to_date && opts.up_to_date(i)) {
+                slots[i].phase = Slot::Phase::Done; result[i] = {StepOutcome::State::Ok, 0, {}, 0, true};
+                if (opts.on_finish) opts.on_finish(i, result[i]);
+            } else spawn(i);
+        }
+        // Uscita in ordine di piano: lo step in testa scorre dal vivo, gli altri restano in buffer
+        while (head < n) {
+            auto& s = slots[head];
+            if (s.phase == Slot::Phase::Pending) break;
+            if (head < opts.done.size() && opts.done[head]) { out << "Done [" << steps[head].id << "]: " << steps[head].command << " (earlier run)\n"; ++head; continue; }
+            if (result[head].up_to_date) { out << "Up to date [" << steps[head].id << "]: " << steps[head].command << "\n"; ++head; continue; }
+            if (result[head].state == StepOutcome::State::Skipped && s.phase == Slot::Phase::Done && !s.header) {
+                out << "Skipped [" << steps[head].id << "]: " << (result[head].blocked_by == "interrupted" ? std::string("interrupted") : "depends on failed step " + result[head].blocked_by) << "\n";
+                ++head;
+                continue;
+            }
+            if (!s.header) { out << "Executing [" << steps[head].id << "]: " << steps[head].command << "\n"; s.header = true; }
+            out << s.buf; s.buf.clear();
+            if (s.phase != Slot::Phase::Done || s.fd >= 0) break;
+            if (result[head].state == StepOutcome::State::Failed) out << "Step " << steps[head].id << " failed status=" << result[head].status << "\n";
+            ++head;
+        }
+        out.flush();
+        if (head == n) break;
+
+        std::vector<pollfd> fds;
+        std::vector<std::size_t> owner;
+        for (std::size_t i = 0; i < n; ++i) if (slots[i].fd >= 0) { fds.push_back({slots[i].fd, POLLIN, 0}); owner.push_back(i); }
+        if (!fds.empty()) poll(fds.data(), fds.size(), 50);
+        for (std::size_t k = 0; k < fds.size(); ++k) if (fds[k].revents) drain(slots[owner[k]]);
+        // Fine step = processo raccolto; la pipe si svuota e si chiude anche se un nipote in background la tiene aperta
+        for (std::size_t i = 0; i < n; ++i) {
+            auto& s = slots[i];
+            if (s.phase != Slot::Phase::Running) continue;
+            int wst = 0;
+            pid_t r = waitpid(s.pid, &wst, WNOHANG);
+            if (r == 0 || (r < 0 && errno == EINTR)) continue;
+            int code = r < 0 ? 127 : WIFEXITED(wst) ? WEXITSTATUS(wst) : 128 + (WIFSIGNALED(wst) ? WTERMSIG(wst) : 0);
+            if (s.fd >= 0) { drain(s); if (s.fd >= 0) { close(s.fd); s.fd = -1; } }
+            if (stopping) kill(-s.pid, SIGKILL); // nipoti rimasti nel gruppo dello step interrotto
+            s.phase = Slot::Phase::Done;
+            --running;
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - s.started).count();
+            result[i] = {code == 0 ? StepOutcome::State::Ok : StepOutcome::State::Failed, code, {}, ms};
+            if (opts.on_finish) opts.on_finish(i, result[i]);
+        }
+        if (fds.empty() && running) {
+            struct timespec ts{0, 10 * 1000 * 1000};
+            nanosleep(&ts, nullptr);
+        }
+    }
+    return result;
+}
+
+#else
+
+// Windows: nessun fork; stesso ordine di dipendenze, un passo alla volta e senza cattura dell'uscita
+std::vector<StepOutcome> run_plan_dag(const std::vector<PlanStep>& steps, const PlanGraph& graph, const DagRunOptions& opts) {
+    std::ostream& out = opts.out ? *opts.out : std::cout;
+    std::vector<StepOutcome> result(steps.size());
+    std::vector<bool> done(steps.size(), false);
+    for (std::size_t left = steps.size(); left;) {
+        for (std::size_t i = 0; i < steps.size(); ++i) {
+            if (done[i] || !std::all_of(graph.deps[i].begin(), graph.deps[i].end(), [&](std::size_t d) { return done[d]; })) continue;
+            done[i] = true; --left;
+            if (i < opts.done.size() && opts.done[i]) { result[i] = {StepOutcome::State::Ok, 0, {}, -1}; out << "Done [" << steps[i].id << "]: " << steps[i].command << " (earlier run)\n"; continue; }
+            std::string blocked = opts.interrupted && opts.interrupted() ? "interrupted" : "";
+            for (auto d : graph.deps[i]) if (result[d].state != StepOutcome::State::Ok) { blocked = result[d].state == StepOutcome::State::Failed ? steps[d].id : result[d].blocked_by; break; }
+            if (!blocked.empty()) {
+                result[i] = {StepOutcome::State::Skipped, -1, blocked, -1};
+                out << "Skipped [" << steps[i].id << "]: " << (blocked == "interrupted" ? blocked : "depends on failed step " + blocked) << "\n";
+                if (opts.on_finish) opts.on_finish(i, result[i]);
+                continue;
+            }
+            if (opts.up_to_date && opts.up_to_date(i)) {
+                result[i] = {StepOutcome::State::Ok, 0, {}, 0, true};
+                out << "Up to date [" << steps[i].id << "]: " << steps[i].command << "\n";
+                if (opts.on_finish) opts.on_finish(i, result[i]);
+                continue;
+            }
+            out << "Executing [" << steps[i].id << "]: " << steps[i].command << "\n";
+            if (opts.on_start) opts.on_start(i);
+            auto t0 = std::chrono::steady_clock::now();
+            int st = opts.run ? opts.run(i) : 0;
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+            result[i] = {st == 0 ? StepOutcome::State::Ok : StepOutcome::State::Failed, st, {}, ms};
+            if (st != 0) out << "Step " << steps[i].id << " failed status=" << st << "\n";
+            if (opts.on_finish) opts.on_finish(i, result[i]);
+        }
+    }
+    return result;
+}
+
+#endif
+
+} // namespace autoshell::ai
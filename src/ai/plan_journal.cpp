@@ -0,0 +1,218 @@
+// Checkpoints of executed AI plans (ai resume)
+#include <ai-autoshell/ai/plan_journal.hpp>
+#include <ai-autoshell/ai/log_record.hpp>
+#include <ai-autoshell/ai/plan_dag.hpp>
+#include <algorithm>
+#include <chrono>
+
+namespace autoshell::ai {
+
+namespace {
+
+// Log records (log_record.hpp), one per line:
+//   B id created request steps cwd                               (run started)
+//   S id index step_id confirm parallel depends_on command description inputs outputs  (one per step, after B)
+//   R id index started                                           (step started)
+//   E id index state status duration                             (step finished)
+std::int64_t to_i64(const std::string& s) { try { return std::stoll(s); } catch (...) { return 0; } }
+
+// Liste: depends_on separati da ',', percorsi (inputs/outputs) da newline
+std::string join(const std::vector<std::string>& v, char sep = ',') {
+    std::string out;
+    for (auto& s : v) { if (!out.empty()) out.push_back(sep); out += s; }
+    return out;
+}
+
+std::vector<std::string> split(const std::string& s, char sep = ',') {
+    std::vector<std::string> out;
+    std::size_t start = 0;
+    while (start < s.size()) {
+        auto c = s.find(sep, start);
+        out.push_back(s.substr(start, c == std::string::npos ? std::string::npos : c - start));
+        if (c == std::string::npos) break;
+        start = c + 1;
+    }
+    return out;
+}
+
+std::string step_record(const std::string& run, std::size_t i, const PlanStep& s) {
+    return log_record({"S", run, std::to_string(i), s.id, s.confirm ? "1" : "0", s.parallel ? "1" : "0", join(s.depends_on), s.command, s.description, join(s.inputs, '\n'), join(s.outputs, '\n')});
+}
+
+} // namespace
+
+bool PlanJournal::Run::complete() const {
+    return std::all_of(records.begin(), records.end(), [](const StepRecord& r) { return r.state == StepState::Ok; });
+}
+
+std::size_t PlanJournal::Run::remaining() const {
+    return static_cast<std::size_t>(std::count_if(records.begin(), records.end(), [](const StepRecord& r) { return r.state != StepState::Ok; }));
+}
+
+std::vector<bool> PlanJournal::Run::resume_done() const {
+    std::vector<bool> done(records.size(), false);
+    for (std::size_t i = 0; i < records.size() && i < steps.size(); ++i)
+        done[i] = records[i].state == StepState::Ok && !shell_state_only(steps[i].command); // 'cd sub' costa nulla: si rifa'
+    return done;
+}
+
+const char* PlanJournal::state_name(StepState s) {
+    switch (s) {
+    case StepState::Pending: return "pending";
+    case StepState::Running: return "interrupted";
+    case StepState::Ok: return "ok";
+    case StepState::Failed: return "failed";
+    case StepState::Skipped: return "skipped";
+    }
+    return "?";
+}
+
+PlanJournal::PlanJournal(PlanJournalOptions opts) : m_opts(std::move(opts)) {
+    if (m_opts.path.empty()) return;
+    std::lock_guard<std::mutex> lk(m_mu);
+    LogLock lock(m_opts.path, true);
+    bool torn = false;
+    if (!reload(&torn)) return;
+    std::size_t live = 0; // record minimi delle run tenute: B, S ed E/R per step
+    for (std::size_t i = m_runs.size() > m_opts.max_runs ? m_runs.size() - m_opts.max_runs : 0; i < m_runs.size(); ++i) live += 1 + 2 * m_runs[i].steps.size();
+    if (m_runs.size() > m_opts.max_runs || torn || m_log_records > 2 * live + 64) compact();
+}
+
+std::int64_t PlanJournal::now() const {
+    if (m_opts.now) return m_opts.now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+PlanJournal::Run* PlanJournal::lookup(const std::string& id) {
+    for (auto& r : m_runs) if (r.id == id) return &r;
+    return nullptr;
+}
+
+void PlanJournal::apply(const std::vector<std::string>& rec) {
+    const std::string& op = rec[0];
+    if (op == "B" && rec.size() == 6) {
+        Run r;
+        r.id = rec[1]; r.created_ms = to_i64(rec[2]); r.request = rec[3]; r.cwd = rec[5];
+        auto n = static_cast<std::size_t>(std::max<std::int64_t>(0, to_i64(rec[4])));
+        r.steps.resize(n); r.records.resize(n);
+        m_next_id = std::max<std::uint64_t>(m_next_id, static_cast<std::uint64_t>(to_i64(r.id)) + 1);
+        m_runs.push_back(std::move(r));
+        return;
+    }
+    if (rec.size() < 3) return;
+    Run* r = lookup(rec[1]);
+    auto i = static_cast<std::size_t>(to_i64(rec[2]));
+    if (!r || i >= r->steps.size()) return;
+    if (op == "S" && rec.size() == 11) {
+        auto& s = r->steps[i];
+        s.id = rec[3]; s.confirm = rec[4] == "1"; s.parallel = rec[5] == "1"; s.depends_on = split(rec[6]);
+        s.command = rec[7]; s.description = rec[8];
+        s.inputs = split(rec[9], '\n'); s.outputs = split(rec[10], '\n');
+    } else if (op == "R" && rec.size() == 4) {
+        r->records[i] = {StepState::Running, -1, to_i64(rec[3]), -1};
+    } else if (op == "E" && rec.size() == 6) {
+        auto st = to_i64(rec[3]);
+        if (st < 0 || st > static_cast<std::int64_t>(StepState::Skipped)) return;
+        auto& sr = r->records[i];
+        sr.state = static_cast<StepState>(st); sr.status = static_cast<int>(to_i64(rec[4])); sr.duration_ms = to_i64(rec[5]);
+    }
+}
+
+std::string PlanJournal::begin(const std::string& request, const std::vector<PlanStep>& steps, const std::string& cwd) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    // Id e record sotto lock esclusivo, dopo aver riletto il log: un'altra shell puo' aver appena numerato una run
+    std::optional<LogLock> lock;
+    if (!m_opts.path.empty()) {
+        lock.emplace(m_opts.path, true);
+        bool torn = false;
+        if (reload(&torn) && torn) compact(); // un record troncato in coda si mangerebbe il prossimo
+    }
+    Run r;
+    r.id = std::to_string(m_next_id++);
+    r.request = request;
+    r.cwd = cwd;
+    r.created_ms = now();
+    r.steps = steps;
+    r.records.resize(steps.size());
+    std::string out = log_record({"B", r.id, std::to_string(r.created_ms), request, std::to_string(steps.size()), cwd});
+    for (std::size_t i = 0; i < steps.size(); ++i) out += step_record(r.id, i, steps[i]);
+    std::string id = r.id;
+    m_runs.push_back(std::move(r));
+    // Il piano deve esserci prima che parta il primo step
+    if (!m_opts.path.empty() && append_log(m_opts.path, out, true)) m_log_records += 1 + steps.size();
+    if (m_runs.size() > m_opts.max_runs) compact();
+    return id;
+}
+
+void PlanJournal::step_started(const std::string& id, std::size_t step) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    Run* r = lookup(id);
+    if (!r || step >= r->records.size()) return;
+    auto t = now();
+    r->records[step] = {StepState::Running, -1, t, -1};
+    append(log_record({"R", id, std::to_string(step), std::to_string(t)}), false);
+}
+
+void PlanJournal::step_finished(const std::string& id, std::size_t step, StepState state, int status, std::int64_t duration_ms) {
+    std::lock_guard<std::mutex> lk(m_mu);
+    Run* r = lookup(id);
+    if (!r || step >= r->records.size()) return;
+    auto& sr = r->records[step];
+    sr.state = state; sr.status = status; sr.duration_ms = duration_ms;
+    // Il checkpoint di uno step riuscito e' cio' che evita di rieseguirlo: su disco subito
+    append(log_record({"E", id, std::to_string(step), std::to_string(static_cast<int>(state)), std::to_string(status), std::to_string(duration_ms)}), state == StepState::Ok);
+}
+
+std::optional<PlanJournal::Run> PlanJournal::find(const std::string& id) const {
+    std::lock_guard<std::mutex> lk(m_mu);
+    for (auto it = m_runs.rbegin(); it != m_runs.rend(); ++it)
+        if (id.empty() ? !it->complete() : it->id == id) return *it;
+    return std::nullopt;
+}
+
+std::vector<PlanJournal::Run> PlanJournal::runs() const {
+    std::lock_guard<std::mutex> lk(m_mu);
+    return {m_runs.rbegin(), m_runs.rend()};
+}
+
+void PlanJournal::append(const std::string& record, bool sync) {
+    if (m_opts.path.empty()) return;
+    LogLock lock(m_opts.path, false); // non durante una compattazione, che finirebbe per perderlo
+    if (append_log(m_opts.path, record, sync)) ++m_log_records;
+}
+
+bool PlanJournal::reload(bool* torn) {
+    std::vector<Run> kept;
+    kept.swap(m_runs);
+    std::uint64_t next = m_next_id;
+    std::size_t records = 0;
+    m_next_id = 1;
+    if (!replay_log(m_opts.path, [&](const std::vector<std::string>& rec) { apply(rec); ++records; }, torn)) {
+        m_runs.swap(kept); // log non leggibile: resta lo stato in memoria
+        m_next_id = next;
+        return false;
+    }
+    m_next_id = std::max(m_next_id, next); // mai riusare un id gia' dato, anche se un'altra shell l'ha compattato via
+    m_log_records = records;
+    return true;
+}
+
+// Riscrive il log con le sole run tenute: piano e stato attuale di ogni step
+void PlanJournal::compact() {
+    if (m_runs.size() > m_opts.max_runs) m_runs.erase(m_runs.begin(), m_runs.end() - static_cast<std::ptrdiff_t>(m_opts.max_runs));
+    if (m_opts.path.empty()) return;
+    std::string out;
+    std::size_t n = 0;
+    for (auto& r : m_runs) {
+        out += log_record({"B", r.id, std::to_string(r.created_ms), r.request, std::to_string(r.steps.size()), r.cwd}); ++n;
+        for (std::size_t i = 0; i < r.steps.size(); ++i) {
+            out += step_record(r.id, i, r.steps[i]); ++n;
+            auto& sr = r.records[i];
+            if (sr.state == StepState::Running) { out += log_record({"R", r.id, std::to_string(i), std::to_string(sr.started_ms)}); ++n; }
+            else if (sr.state != StepState::Pending) { out += log_record({"E", r.id, std::to_string(i), std::to_string(static_cast<int>(sr.state)), std::to_string(sr.status), std::to_string(sr.duration_ms)}); ++n; }
+        }
+    }
+    if (rewrite_log(m_opts.path, out)) m_log_records = n;
+}
+
+} // namespace autoshell::ai
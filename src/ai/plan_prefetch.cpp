@@ -0,0 +1,88 @@
+// Speculative plan prefetch while typing an ai request (ai_prefetch)
+#include <ai-autoshell/ai/plan_prefetch.hpp>
+#include <ai-autoshell/ai/plan_cache.hpp>
+#include <chrono>
+#include <sstream>
+
+namespace autoshell::ai {
+
+namespace {
+std::string key_of(const std::string& request) { return PlanCache::make_key(request, "", "", ""); }
+}
+
+PlanPrefetcher::PlanPrefetcher(PrefetchOptions opts, Start start, Estimate estimate, Store store)
+    : m_opts(opts), m_start(std::move(start)), m_estimate(std::move(estimate)), m_store(std::move(store)) {}
+
+PlanPrefetcher::~PlanPrefetcher() { cancel(); }
+
+std::optional<std::string> PlanPrefetcher::request_of(const std::string& line) {
+    std::istringstream in(line);
+    std::string ai, mode, request;
+    in >> ai >> mode;
+    if (ai != "ai" || (mode != "suggest" && mode != "auto")) return std::nullopt;
+    std::getline(in, request);
+    auto b = request.find_first_not_of(" \t");
+    if (b == std::string::npos) return std::nullopt;
+    request = request.substr(b, request.find_last_not_of(" \t") - b + 1);
+    if (request.rfind("--fresh", 0) == 0) return std::nullopt; // vuole comunque una chiamata nuova all'Invio
+    return request;
+}
+
+void PlanPrefetcher::cancel() {
+    if (!m_flight) return;
+    m_flight->cancel.cancel(); // il trasferimento si stacca subito; il future non va atteso
+    ++m_stats.cancelled;
+    m_stats.spent += m_flight->estimate; // il prompt puo' essere gia' stato fatturato: si conta il preventivo
+    m_flight.reset();
+}
+
+void PlanPrefetcher::collect(bool wait, const std::function<bool()>& interrupted) {
+    if (!m_flight) return;
+    while (m_flight->reply.wait_for(std::chrono::milliseconds(wait ? 50 : 0)) != std::future_status::ready) {
+        if (!wait) return;
+        if (interrupted && interrupted()) { cancel(); return; }
+    }
+    auto r = m_flight->reply.get();
+    m_stats.spent += r && r->total_cost >= 0 ? r->total_cost : m_flight->estimate;
+    if (r && r->source != "error" && m_store(m_flight->request, *r)) {
+        ++m_stats.stored;
+        m_stored.insert(m_flight->key);
+    }
+    m_flight.reset();
+}
+
+void PlanPrefetcher::on_change(const std::string& line) {
+    collect(false, {});
+    if (!m_flight) return;
+    auto request = request_of(line);
+    if (!request || key_of(*request) != m_flight->key) cancel();
+}
+
+void PlanPrefetcher::on_idle(const std::string& line) {
+    collect(false, {});
+    auto request = request_of(line);
+    if (!request || request->size() < m_opts.min_chars || m_flight) return;
+    auto key = key_of(*request);
+    if (m_tried.count(key)) return;
+    auto estimate = m_estimate(*request);
+    if (!estimate) return;
+    if (m_stats.started >= m_opts.max_requests || (m_opts.max_cost > 0 && m_stats.spent + *estimate > m_opts.max_cost)) {
+        ++m_stats.over_budget;
+        return;
+    }
+    m_tried.insert(key);
+    ++m_stats.started;
+    CancelToken token;
+    m_flight = InFlight{*request, key, token, m_start(*request, token), *estimate};
+}
+
+bool PlanPrefetcher::settle(const std::string& request, const std::function<bool()>& interrupted) {
+    auto key = key_of(request);
+    if (m_flight && m_flight->key != key) cancel();
+    collect(true, interrupted);
+    if (!m_stored.erase(key)) return false;
+    ++m_stats.used;
+    return true;
+}
+
+} // namespace autoshell::ai
@@ -0,0 +1,184 @@
+// Pre-flight compilation of plan steps (parse, resolve, redirection checks)
+#include <ai-autoshell/ai/plan_preflight.hpp>
+#include <ai-autoshell/exec/builtins.hpp>
+#include <ai-autoshell/exec/path.hpp>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace autoshell::ai {
+
+namespace {
+
+bool is_keyword(const std::string& w) {
+    static const std::unordered_set<std::string> kw{"for", "in", "do", "done", "if", "then", "else", "elif", "fi",
+                                                    "while", "until", "case", "esac", "{", "}", "!", "[[", "]]"};
+    return kw.count(w) > 0;
+}
+
+// Il valore si conosce solo a runtime (variabili, glob, tilde, brace expansion)
+bool needs_expansion(const std::string& w) {
+    return w.find_first_of("$`*?[~{") != std::string::npos;
+}
+
+std::string normalize(std::string p) {
+    while (p.size() > 2 && p.compare(0, 2, "./") == 0) p.erase(0, 2);
+    while (p.size() > 1 && p.back() == '/') p.pop_back();
+    return p;
+}
+
+bool exists(const std::string& p, bool* is_dir = nullptr) {
+    struct stat st{};
+    if (stat(p.c_str(), &st) != 0) return false;
+    if (is_dir) *is_dir = (st.st_mode & S_IFMT) == S_IFDIR;
+    return true;
+}
+
+bool writable(const std::string& p) {
+#ifdef _WIN32
+    (void)p; return true; // permessi verificati solo su POSIX
+#else
+    return access(p.c_str(), W_OK) == 0;
+#endif
+}
+
+bool is_absolute(const std::string& p) { return !p.empty() && (p[0] == '/' || (p.size() > 2 && p[1] == ':')); }
+
+struct Walker {
+    const std::unordered_set<std::string>& functions;
+    std::set<std::string>& mentioned;  // parole (percorsi) dei comandi precedenti
+    bool& cwd_known;
+    std::vector<std::string>& problems;
+    std::vector<std::string> commands; // nomi da risolvere
+
+    bool maybe_created(const std::string& path) const {
+        auto p = normalize(path);
+        if (mentioned.count(p)) return true;
+        auto it = mentioned.lower_bound(p + "/"); // 'mkdir -p out/logs' crea anche 'out'
+        return it != mentioned.end() && it->compare(0, p.size() + 1, p + "/") == 0;
+    }
+    bool checkable(const std::string& path) const { return !path.empty() && !needs_expansion(path) && (cwd_known || is_absolute(path)); }
+
+    void list(const ListNode* l) {
+        if (!l) return;
+        for (auto& seg : l->segments) {
+            if (!seg.and_or) continue;
+            for (auto& ao : seg.and_or->segments) {
+                if (!ao.pipeline) continue;
+                for (auto& el : ao.pipeline->elements) {
+                    if (auto* c = std::get_if<std::unique_ptr<CommandNode>>(&el)) command(**c);
+                    else if (auto* s = std::get_if<std::unique_ptr<SubshellNode>>(&el)) { bool saved = cwd_known; list((*s)->list.get()); cwd_known = saved; }
+                    else if (auto* f = std::get_if<std::unique_ptr<FunctionDefNode>>(&el)) list((*f)->body.get());
+                }
+            }
+        }
+    }
+
+    void command(const CommandNode& cmd) {
+        for (auto& r : cmd.redirs) {
+            if (r.subst || !checkable(r.target)) continue; // '< <(ls)': diventa /dev/fd/N a runtime
+            switch (r.type) {
+            case RedirNode::Type::In:
+                if (!exists(r.target) && !maybe_created(r.target)) problems.push_back("input file not found: " + r.target);
+                break;
+            case RedirNode::Type::Out: case RedirNode::Type::OutAppend: case RedirNode::Type::Err: {
+                bool dir = false;
+                if (exists(r.target, &dir)) {
+                    if (dir) problems.push_back("redirection target is a directory: " + r.target);
+                    else if (!writable(r.target)) problems.push_back("cannot write to " + r.target);
+                    break;
+                }
+                auto slash = r.target.find_last_of('/');
+                std::string parent = slash == std::string::npos ? "." : slash == 0 ? "/" : r.target.substr(0, slash);
+                if (!exists(parent, &dir) || !dir) { if (!maybe_created(parent)) problems.push_back("directory not found for redirection: " + r.target); }
+                else if (!writable(parent)) problems.push_back("cannot create " + r.target + " (directory not writable)");
+                break;
+            }
+            default: break; // here-doc, here-string, 2>&1
+            }
+        }
+        if (!cmd.argv.empty()) {
+            auto& name = cmd.argv[0];
+            if (!needs_expansion(name) && !is_keyword(name) && !is_builtin(name) && !functions.count(name)) {
+                bool path = name.find('/') != std::string::npos; // './build.sh' scritto da un passo precedente
+                if (!path || (checkable(name) && !maybe_created(name))) commands.push_back(name);
+            }
+            if (name == "cd" || name == "pushd" || name == "popd") cwd_known = false;
+        }
+        // Cio' che il comando nomina puo' esistere per i comandi successivi ('mkdir out && ls > out/x')
+        for (std::size_t i = 1; i < cmd.argv.size(); ++i) mentioned.insert(normalize(cmd.argv[i]));
+        for (auto& r : cmd.redirs) if (!r.subst) mentioned.insert(normalize(r.target));
+    }
+};
+
+void collect_functions(const ListNode* l, std::unordered_set<std::string>& out) {
+    if (!l) return;
+    for (auto& seg : l->segments) {
+        if (!seg.and_or) continue;
+        for (auto& ao : seg.and_or->segments) {
+            if (!ao.pipeline) continue;
+            for (auto& el : ao.pipeline->elements) {
+                if (auto* f = std::get_if<std::unique_ptr<FunctionDefNode>>(&el)) { out.insert((*f)->name); collect_functions((*f)->body.get(), out); }
+                else if (auto* s = std::get_if<std::unique_ptr<SubshellNode>>(&el)) collect_functions((*s)->list.get(), out);
+            }
+        }
+    }
+}
+
+} // namespace
+
+PreflightResult preflight_plan(const std::vector<PlanStep>& steps, const PreflightOptions& opts) {
+    PreflightResult res;
+    res.steps.resize(steps.size());
+    std::unordered_set<std::string> functions;
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        auto& cs = res.steps[i];
+        if (opts.native && opts.native(steps[i].command)) { cs.native = true; continue; }
+        Lexer lx(steps[i].command);
+        auto ts = lx.run();
+        std::string err;
+        cs.ast = parse_tokens(ts, err);
+        if (!err.empty()) cs.problems.push_back(err);
+        collect_functions(cs.ast.list.get(), functions);
+    }
+    // Redirezioni in ordine di piano; i nomi dei comandi si raccolgono per risolverli insieme
+    std::set<std::string> mentioned;
+    bool cwd_known = true;
+    std::vector<std::vector<std::string>> names(steps.size());
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        auto& cs = res.steps[i];
+        if (cs.native) { cwd_known = cwd_known && steps[i].command.find("cd ") == std::string::npos; continue; }
+        Walker w{functions, mentioned, cwd_known, cs.problems, {}};
+        w.list(cs.ast.list.get());
+        names[i] = std::move(w.commands);
+    }
+    std::vector<std::string> unique;
+    std::unordered_map<std::string, std::size_t> slot;
+    for (auto& v : names) for (auto& n : v) if (slot.emplace(n, unique.size()).second) unique.push_back(n);
+    std::vector<std::optional<std::string>> resolved(unique.size());
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] { for (std::size_t k; (k = next.fetch_add(1)) < unique.size();) resolved[k] = resolve_executable(unique[k]); };
+    std::vector<std::thread> pool;
+    for (std::size_t t = 1; t < std::min(std::max<std::size_t>(opts.resolve_threads, 1), unique.size()); ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        std::unordered_set<std::string> reported;
+        for (auto& n : names[i])
+            if (!resolved[slot[n]] && reported.insert(n).second) res.steps[i].problems.push_back("command not found: " + n);
+        res.problems += res.steps[i].problems.size();
+    }
+    return res;
+}
+
+} // namespace autoshell::ai
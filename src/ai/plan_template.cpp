@@ -0,0 +1,207 @@
+// Template plan cache (slot extraction + plan parametrization)
+#include <ai-autoshell/ai/plan_template.hpp>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+namespace autoshell::ai {
+
+namespace {
+
+// Parole dopo cui segue un nome (stesse frasi di Planner::rule_expand: "mostra il file X",
+// "crea una cartella X", "contenuto della directory X", ...)
+const char* kAnchors[] = {"file", "cartella", "directory", "dir", "folder", "named", "called", "chiamata", "chiamato", "nome", "name"};
+const char* kStopwords[] = {"il", "lo", "la", "i", "gli", "le", "un", "una", "uno", "di", "del", "della", "the", "a", "an", "of", "in", "to", "con", "with"};
+
+bool in_list(const std::string& w, const char* const* list, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) if (w == list[i]) return true;
+    return false;
+}
+bool is_anchor(const std::string& w) { return in_list(w, kAnchors, std::size(kAnchors)); }
+bool is_stopword(const std::string& w) { return in_list(w, kStopwords, std::size(kStopwords)); }
+
+bool is_number(const std::string& t) {
+    std::size_t i = (t.size() > 1 && t[0] == '-') ? 1 : 0, digits = 0;
+    bool dot = false;
+    for (; i < t.size(); ++i) {
+        if (std::isdigit(static_cast<unsigned char>(t[i]))) ++digits;
+        else if (t[i] == '.' && !dot && digits) dot = true;
+        else return false;
+    }
+    return digits > 0 && t.back() != '.';
+}
+
+bool is_path(const std::string& t) {
+    if (t.find('/') != std::string::npos || t[0] == '~' || (t[0] == '.' && t.size() > 1)) return true;
+    auto dot = t.find('.');
+    return dot != std::string::npos && dot > 0 && dot + 1 < t.size() &&
+           std::isalnum(static_cast<unsigned char>(t[dot - 1])) && std::isalnum(static_cast<unsigned char>(t[dot + 1]));
+}
+
+// Valori sostituibili in un comando senza cambiarne la struttura: i valori finiscono nei comandi
+// senza quoting, quindi anche le stringhe tra virgolette passano la stessa whitelist (niente spazi, ; | & ...)
+bool safe_value(const std::string& v, SlotKind k) {
+    if (v.empty()) return false;
+    if (v[0] == '-' && k != SlotKind::Number) return false; // sarebbe un'opzione
+    for (unsigned char c : v)
+        if (!(std::isalnum(c) || std::strchr("_./~+@%,:=-", c) || c >= 0x80)) return false;
+    return true;
+}
+
+// Caratteri che continuano una parola: un valore conta solo se non e' parte di una parola piu' lunga
+bool word_char(unsigned char c) { return std::isalnum(c) || c == '_' || c == '-' || c == '.' || c >= 0x80; }
+
+bool bounded_at(std::string_view text, std::size_t pos, std::string_view v) {
+    if (text.compare(pos, v.size(), v) != 0) return false;
+    bool left = pos == 0 || !word_char(static_cast<unsigned char>(text[pos - 1]));
+    bool right = pos + v.size() == text.size() || !word_char(static_cast<unsigned char>(text[pos + v.size()]));
+    return left && right;
+}
+
+std::size_t count_bounded(std::string_view text, std::string_view v) {
+    std::size_t n = 0;
+    for (auto p = text.find(v); p != std::string_view::npos; p = text.find(v, p + 1)) n += bounded_at(text, p, v);
+    return n;
+}
+std::size_t count_any(std::string_view text, std::string_view v) {
+    std::size_t n = 0;
+    for (auto p = text.find(v); p != std::string_view::npos; p = text.find(v, p + 1)) ++n;
+    return n;
+}
+
+std::string placeholder(std::size_t i) { return "{{@" + std::to_string(i) + "}}"; }
+
+} // namespace
+
+RequestShape extract_slots(std::string_view request) {
+    RequestShape out;
+    std::string prev; // ultima parola (minuscola) non slot
+    auto add_shape = [&](const std::string& s) { if (!out.shape.empty()) out.shape.push_back(' '); out.shape += s; };
+    auto add_slot = [&](std::string v, SlotKind k, const char* tag) {
+        out.safe = out.safe && safe_value(v, k);
+        out.values.push_back(std::move(v)); out.kinds.push_back(k);
+        add_shape(tag);
+    };
+    std::size_t i = 0;
+    while (i < request.size()) {
+        if (std::isspace(static_cast<unsigned char>(request[i]))) { ++i; continue; }
+        char q = request[i];
+        if (q == '"' || q == '\'') {
+            auto close = request.find(q, i + 1);
+            if (close != std::string_view::npos) {
+                add_slot(std::string(request.substr(i + 1, close - i - 1)), SlotKind::Quoted, "<str>");
+                i = close + 1; prev.clear();
+                continue;
+            }
+        }
+        std::size_t j = i;
+        while (j < request.size() && !std::isspace(static_cast<unsigned char>(request[j]))) ++j;
+        std::string tok(request.substr(i, j - i));
+        i = j;
+        while (!tok.empty() && std::strchr(",;:!?.", tok.back())) tok.pop_back(); // punteggiatura della frase
+        if (tok.empty()) continue;
+        std::string low = tok;
+        std::transform(low.begin(), low.end(), low.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (is_number(tok)) add_slot(tok, SlotKind::Number, "<num>");
+        else if (is_path(tok)) add_slot(tok, SlotKind::Path, "<path>");
+        else if (is_anchor(prev) && !is_anchor(low) && !is_stopword(low)) add_slot(tok, SlotKind::Name, "<name>");
+        else { add_shape(low); prev = low; continue; }
+        prev.clear();
+    }
+    return out;
+}
+
+std::optional<PlanTemplate> make_template(const RequestShape& shape, const std::string& plan_text) {
+    const auto& vals = shape.values;
+    if (vals.empty()) return std::nullopt;
+    for (std::size_t a = 0; a < vals.size(); ++a)
+        for (std::size_t b = a + 1; b < vals.size(); ++b)
+            if (vals[a] == vals[b]) return std::nullopt; // quale slot e' quale? ambiguo
+    auto parsed = parse_plan_json(plan_text);
+    if (!parsed.valid || parsed.steps.empty()) return std::nullopt;
+    std::string commands;
+    for (auto& s : parsed.steps) { commands += s.command; commands.push_back('\n'); }
+
+    PlanTemplate t; t.confidence = 1.0;
+    for (std::size_t k = 0; k < vals.size(); ++k) {
+        const std::string& v = vals[k];
+        double score = 0.0;
+        if (count_bounded(commands, v)) score = (shape.kinds[k] == SlotKind::Number && v.size() == 1) ? 0.7 : 1.0;
+        else if (commands.find(v) != std::string::npos) score = 0.5;
+        // Occorrenze dentro altre parole resterebbero col vecchio valore nel piano istanziato
+        if (count_bounded(plan_text, v) != count_any(plan_text, v)) score = std::min(score, 0.5);
+        t.confidence = std::min(t.confidence, score);
+    }
+
+    // Sostituzione in un solo passaggio, valori piu' lunghi prima (nessun match dentro i placeholder)
+    std::vector<std::size_t> order(vals.size());
+    for (std::size_t k = 0; k < order.size(); ++k) order[k] = k;
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return vals[a].size() > vals[b].size(); });
+    for (std::size_t p = 0; p < plan_text.size();) {
+        bool hit = false;
+        for (std::size_t k : order) {
+            if (bounded_at(plan_text, p, vals[k])) { t.text += placeholder(k); p += vals[k].size(); hit = true; break; }
+        }
+        if (!hit) t.text.push_back(plan_text[p++]);
+    }
+    return t;
+}
+
+std::optional<std::string> instantiate(const PlanTemplate& t, const std::vector<std::string>& values) {
+    std::string out;
+    for (std::size_t p = 0; p < t.text.size();) {
+        if (t.text.compare(p, 3, "{{@") == 0) {
+            auto end = t.text.find("}}", p + 3);
+            if (end == std::string::npos) return std::nullopt;
+            std::size_t idx = 0;
+            try { idx = std::stoul(t.text.substr(p + 3, end - p - 3)); } catch (...) { return std::nullopt; }
+            if (idx >= values.size()) return std::nullopt;
+            out += values[idx];
+            p = end + 2;
+            continue;
+        }
+        out.push_back(t.text[p++]);
+    }
+    auto parsed = parse_plan_json(out);
+    if (!parsed.valid || parsed.steps.empty()) return std::nullopt;
+    return out;
+}
+
+// Entry nella PlanCache: "tpl <confidence>\n<testo con placeholder>"
+std::optional<TemplateCache::Match> TemplateCache::lookup(const std::string& request, const std::string& provider,
+                                                          const std::string& model, const std::string& prompt_version, bool count) {
+    auto miss = [&] { if (count) m_stats.misses++; };
+    auto shape = extract_slots(request);
+    if (shape.values.empty() || !shape.safe) { miss(); return std::nullopt; }
+    auto stored = m_store.get(PlanCache::make_key("@tpl " + shape.shape, provider, model, prompt_version), false);
+    PlanTemplate t;
+    if (stored && stored->rfind("tpl ", 0) == 0) {
+        auto nl = stored->find('\n');
+        if (nl != std::string::npos) {
+            try { t.confidence = std::stod(stored->substr(4, nl - 4)); } catch (...) {}
+            t.text = stored->substr(nl + 1);
+        }
+    }
+    if (t.text.empty() || t.confidence < m_min) { miss(); return std::nullopt; }
+    auto plan = instantiate(t, shape.values);
+    if (!plan) { miss(); return std::nullopt; }
+    if (count) m_stats.hits++;
+    return Match{*plan, t.confidence};
+}
+
+bool TemplateCache::learn(const std::string& request, const std::string& provider, const std::string& model,
+                          const std::string& prompt_version, const std::string& plan_text) {
+    auto shape = extract_slots(request);
+    if (shape.values.empty() || !shape.safe) return false;
+    auto t = make_template(shape, plan_text);
+    if (!t || t->confidence < m_min) { m_stats.rejected++; return false; }
+    char conf[16]; std::snprintf(conf, sizeof(conf), "%.2f", t->confidence);
+    m_store.put(PlanCache::make_key("@tpl " + shape.shape, provider, model, prompt_version), shape.shape,
+                std::string("tpl ") + conf + "\n" + t->text);
+    m_stats.learned++;
+    return true;
+}
+
+} // namespace autoshell::ai
@@ -0,0 +1,304 @@
+// Cache-friendly plan prompt layout
+#include <ai-autoshell/ai/prompt.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <numeric>
+
+namespace autoshell::ai {
+
+const std::string& plan_instructions() {
+    static const std::string text =
+        "You are a shell assistant that turns a request into an execution plan. Reply ONLY with valid JSON (no text before or after). "
+        "Schema: {request:string, steps:[{id:string, description:string, command:string, confirm:boolean, depends_on?:[string], parallel?:boolean, inputs?:[string], outputs?:[string]}]}. "
+        "'confirm' must be true only for dangerous commands (rm, sudo, chmod 777). "
+        "Steps run in order; give independent steps depends_on (the ids they need) or parallel:true so they can run concurrently. "
+        "With depends_on or parallel every step runs in its own process, so cd, export or VAR=value in one step does not reach the others: write 'cd dir && cmd' in the step that needs it. "
+        "A step that only turns input files into output files should list them in inputs/outputs (it is skipped while up to date). "
+        "Example:\n{\n  \"request\": \"create listing file\",\n  \"steps\":[\n    {\n      \"id\": \"s1\", \"description\": \"List files by size\", \"command\": \"ls -laS > listing.txt\", \"confirm\": false\n    }\n  ]\n}\nEnd example.";
+    return text;
+}
+
+std::string PlanPrompt::user() const {
+    std::string out;
+    for (auto& s : context) {
+        if (s.body.empty()) continue;
+        out += s.title + ":\n" + s.body;
+        if (out.back() != '\n') out.push_back('\n');
+        out.push_back('\n');
+    }
+    return out + "Request: " + request;
+}
+
+PlanPrompt make_plan_prompt(std::string request, std::vector<PromptSection> context) {
+    return {plan_instructions(), std::move(context), std::move(request)};
+}
+
+namespace {
+
+constexpr std::string_view kRedacted = "[REDACTED]";
+
+bool is_quote(char c) { return c == '"' || c == '\''; }
+
+bool is_separator(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) || c == ';' || c == '|' || c == '&';
+}
+
+// Fine della parola di shell che inizia in i: le virgolette tengono insieme spazi e separatori
+std::size_t word_end(std::string_view s, std::size_t i) {
+    char quote = 0;
+    for (; i < s.size(); ++i) {
+        char c = s[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+            else if (c == '\\' && quote == '"' && i + 1 < s.size()) ++i;
+        } else if (c == '\'' || c == '"') quote = c;
+        else if (c == '\\' && i + 1 < s.size()) ++i;
+        else if (is_separator(c)) break;
+    }
+    return i;
+}
+
+std::string upper(std::string_view s) {
+    std::string u(s);
+    std::transform(u.begin(), u.end(), u.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return u;
+}
+
+bool secret_name(std::string_view name) {
+    auto u = upper(name);
+    for (const char* k : {"KEY", "TOKEN", "SECRET", "PASSWORD", "PASSWD", "PASSPHRASE", "CREDENTIAL"})
+        if (u.find(k) != std::string::npos) return true;
+    return false;
+}
+
+bool looks_like_key(std::string_view w) {
+    while (!w.empty() && is_quote(w.front())) w.remove_prefix(1);
+    while (!w.empty() && is_quote(w.back())) w.remove_suffix(1);
+    if (w.size() < 20) return false;
+    for (const char* p : {"sk-", "ghp_", "gho_", "ghs_", "github_pat_", "glpat-", "xoxb-", "xoxp-", "AKIA", "AIza"})
+        if (w.rfind(p, 0) == 0) return true;
+    return false;
+}
+
+// Parola con il valore segreto da w[from] in poi redatto; le virgolette che lo racchiudono restano
+void append_redacted(std::string& out, std::string_view w, std::size_t from) {
+    char quote = from < w.size() && is_quote(w[from]) ? w[from] : 0;
+    if (quote) ++from;
+    out.append(w.substr(0, from));
+    out.append(kRedacted);
+    if (!quote && !w.empty() && is_quote(w.front())) quote = w.front(); // "Authorization: Bearer x"
+    if (quote && w.size() > from && w.back() == quote) out.push_back(quote);
+}
+
+// Inizio di marker in u (maiuscolo) come parola a se', npos se assente
+std::size_t find_marker(const std::string& u, std::string_view marker) {
+    for (auto at = u.find(marker); at != std::string::npos; at = u.find(marker, at + 1))
+        if (at == 0 || !std::isalnum(static_cast<unsigned char>(u[at - 1]))) return at;
+    return std::string::npos;
+}
+
+} // namespace
+
+std::string redact_secrets(std::string_view line) {
+    std::string out;
+    out.reserve(line.size());
+    bool redact_next = false;
+    for (std::size_t i = 0; i < line.size();) {
+        if (is_separator(line[i])) { out.push_back(line[i++]); continue; }
+        std::size_t end = word_end(line, i);
+        std::string_view w = line.substr(i, end - i);
+        i = end;
+        auto u = upper(w);
+        std::size_t eq = w.find('=');
+        std::size_t auth = find_marker(u, "AUTHORIZATION:"), bearer = find_marker(u, "BEARER");
+        if (redact_next && (u == "BEARER" || u == "BASIC")) {
+            out.append(w); // Authorization: Bearer <token>
+        } else if (redact_next) {
+            append_redacted(out, w, 0);
+            redact_next = false;
+        } else if (auth != std::string::npos || bearer != std::string::npos) {
+            std::size_t at = bearer != std::string::npos ? bearer + 6 : auth + 14;
+            while (at < w.size() && w[at] == ' ') ++at;
+            if (at >= w.size() || (at + 1 == w.size() && is_quote(w[at]))) { out.append(w); redact_next = true; }
+            else append_redacted(out, w, at);
+        } else if (eq != std::string_view::npos && eq > 0 && secret_name(w.substr(0, eq))) {
+            append_redacted(out, w, eq + 1);
+        } else if (w.size() > 1 && w[0] == '-' && secret_name(w)) {
+            out.append(w);
+            redact_next = true;
+        } else if (looks_like_key(w)) {
+            append_redacted(out, w, 0);
+        } else if (auto scheme = w.find("://"); scheme != std::string_view::npos && w.find('@', scheme) != std::string_view::npos &&
+                   w.find(':', scheme + 3) < w.find('@', scheme)) {
+            std::size_t colon = w.find(':', scheme + 3), at = w.find('@', scheme);
+            out.append(w.substr(0, colon + 1));
+            out.append(kRedacted);
+            out.append(w.substr(at));
+        } else {
+            out.append(w);
+        }
+    }
+    return out;
+}
+
+std::vector<PromptSection> shell_context(const std::vector<std::string>& history, bool line_in_history, int last_status) {
+    std::size_t n = history.size() - (line_in_history && !history.empty() ? 1 : 0); // righe prima della richiesta
+    std::string recent, last, files;
+    for (std::size_t i = n > 40 ? n - 40 : 0; i < n; ++i) if (history[i].rfind("ai ", 0) != 0) { recent += redact_secrets(history[i]); recent += '\n'; }
+    for (std::size_t i = n; i > 0; --i) {
+        if (history[i - 1].rfind("ai ", 0) == 0) continue; // lo stato di uscita e' quello della riga appena prima
+        last = redact_secrets(history[i - 1]);
+        if (i == n) { last += " (exit status "; last += std::to_string(last_status); last += ')'; }
+        break;
+    }
+    std::vector<std::string> names;
+    std::error_code ec;
+    std::size_t seen = 0;
+    for (std::filesystem::directory_iterator it(".", ec), end; !ec && it != end && seen < 500; it.increment(ec), ++seen) {
+        std::string name = it->path().filename().string();
+        if (name.empty() || name[0] == '.') continue;
+        std::error_code dec;
+        if (it->is_directory(dec)) name += '/';
+        names.push_back(std::move(name));
+    }
+    std::sort(names.begin(), names.end());
+    for (auto& name : names) files += name + "\n";
+    if (seen == 500) files += "(more entries not listed)\n";
+    // Dal piu' stabile al piu' variabile: la history cambia a ogni comando e chiude il prefisso
+    return {{"Files in the current directory", files, 0, false, true}, {"Recent commands", recent, 1, true, false}, {"Last command", last, 2, false, false}};
+}
+
+std::string context_fingerprint(const std::vector<PromptSection>& sections, std::string_view salt) {
+    std::uint64_t h = 14695981039346656037ull;
+    auto mix = [&](std::string_view s) { for (unsigned char c : s) { h ^= c; h *= 1099511628211ull; } h ^= 0xff; h *= 1099511628211ull; };
+    mix(salt);
+    for (auto& s : sections) {
+        if (s.body.empty() || !s.stable) continue;
+        mix(s.title); mix(s.body);
+    }
+    char hex[17]; std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(h));
+    return hex;
+}
+
+namespace {
+
+enum class CharClass { Word, Digit, Space, Newline, Punct };
+
+CharClass classify(unsigned char c) {
+    if (c >= 0x80 || std::isalpha(c)) return CharClass::Word; // UTF-8: conta come lettere (stima per eccesso sui non latini)
+    if (std::isdigit(c)) return CharClass::Digit;
+    if (c == '\n' || c == '\r') return CharClass::Newline;
+    if (std::isspace(c)) return CharClass::Space;
+    return CharClass::Punct;
+}
+
+std::size_t render_cost(const std::string& title, std::size_t body_tokens) {
+    return estimate_tokens(title) + 2 + body_tokens; // ":\n" e riga vuota di separazione
+}
+
+// "(N more lines)" con append: la concatenazione di temporanei fa scattare -Wrestrict di GCC 12 a -O3
+std::string more_lines_marker(std::size_t n) {
+    std::string marker;
+    marker.reserve(24);
+    marker.push_back('(');
+    marker.append(std::to_string(n));
+    marker.append(" more lines)");
+    return marker;
+}
+
+std::vector<std::string_view> split_lines(const std::string& body) {
+    std::vector<std::string_view> lines;
+    std::size_t pos = 0;
+    while (pos < body.size()) {
+        auto nl = body.find('\n', pos);
+        if (nl == std::string::npos) nl = body.size();
+        lines.emplace_back(body.data() + pos, nl - pos);
+        pos = nl + 1;
+    }
+    return lines;
+}
+
+} // namespace
+
+std::size_t estimate_tokens(std::string_view text) {
+    std::size_t tokens = 0, i = 0;
+    while (i < text.size()) {
+        auto cls = classify(static_cast<unsigned char>(text[i]));
+        std::size_t j = i + 1;
+        while (j < text.size() && classify(static_cast<unsigned char>(text[j])) == cls) ++j;
+        std::size_t len = j - i;
+        switch (cls) {
+        case CharClass::Word: tokens += (len + 5) / 6; break;
+        case CharClass::Digit: tokens += (len + 2) / 3; break;
+        case CharClass::Punct: tokens += (len + 1) / 2; break;
+        case CharClass::Newline: tokens += 1; break;
+        case CharClass::Space: // uno spazio singolo fa parte del token che segue (" sort", " |")
+            if (len > 1 || j == text.size() || classify(static_cast<unsigned char>(text[j])) == CharClass::Newline) tokens += 1;
+            break;
+        }
+        i = j;
+    }
+    return tokens;
+}
+
+std::size_t estimate_tokens(const PromptSection& section) {
+    return section.body.empty() ? 0 : render_cost(section.title, estimate_tokens(section.body));
+}
+
+ContextFit fit_context(std::vector<PromptSection>& sections, std::size_t budget) {
+    std::vector<std::size_t> order(sections.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return sections[a].priority > sections[b].priority; });
+    ContextFit fit;
+    for (auto idx : order) {
+        auto& s = sections[idx];
+        if (s.body.empty()) continue;
+        std::size_t cost = estimate_tokens(s), left = budget - fit.tokens;
+        if (cost <= left) { fit.tokens += cost; continue; }
+        // Taglio per righe: prime righe (o ultime con keep_tail) finche' stanno con il marcatore
+        auto lines = split_lines(s.body);
+        std::size_t used = 0, kept = 0;
+        for (; kept < lines.size(); ++kept) {
+            auto& line = s.keep_tail ? lines[lines.size() - 1 - kept] : lines[kept];
+            std::size_t more = estimate_tokens(line) + 1;
+            std::string marker = more_lines_marker(lines.size() - kept - 1);
+            if (render_cost(s.title, used + more + estimate_tokens(marker) + 1) > left) break;
+            used += more;
+        }
+        if (kept == 0) { s.body.clear(); fit.dropped.push_back(s.title); continue; }
+        std::string marker = more_lines_marker(lines.size() - kept);
+        std::string body;
+        if (s.keep_tail) {
+            body = marker + "\n";
+            for (std::size_t k = lines.size() - kept; k < lines.size(); ++k) { body.append(lines[k]); body.push_back('\n'); }
+        } else {
+            for (std::size_t k = 0; k < kept; ++k) { body.append(lines[k]); body.push_back('\n'); }
+            body += marker + "\n";
+        }
+        s.body = std::move(body);
+        fit.tokens += estimate_tokens(s);
+        fit.truncated.push_back(s.title);
+    }
+    return fit;
+}
+
+std::size_t model_context_window(std::string_view model) {
+    std::string m(model);
+    std::transform(m.begin(), m.end(), m.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    auto has = [&](const char* s) { return m.find(s) != std::string::npos; };
+    // Dal piu' specifico: "gpt-4o" prima di "gpt-4", "llama3.1" prima di "llama3"
+    if (has("gemini")) return 1048576;
+    if (has("claude")) return 200000;
+    if (has("gpt-4o") || has("gpt-4-turbo") || has("gpt-4.1") || has("gpt-5") || m.rfind("o1", 0) == 0 || m.rfind("o3", 0) == 0 || m.rfind("o4", 0) == 0) return 128000;
+    if (has("gpt-3.5")) return 16385;
+    if (has("gpt-4")) return 8192;
+    if (has("llama3.1") || has("llama3.2") || has("llama3.3") || has("llama-3.1")) return 131072;
+    if (has("mistral") || has("mixtral") || has("qwen")) return 32768;
+    if (has("llama2") || has("llama-2")) return 4096;
+    return 8192;
+}
+
+} // namespace autoshell::ai
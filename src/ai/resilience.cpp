@@ -0,0 +1,160 @@
+// Retries, circuit breaking and failover across LLM providers (llm_retries / llm_fallback)
+#include <ai-autoshell/ai/resilience.hpp>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+
+namespace autoshell::ai {
+
+std::chrono::milliseconds backoff_delay(const RetryPolicy& p, int attempt, double u) {
+    double cap = static_cast<double>(p.max.count());
+    double exp = static_cast<double>(p.base.count()) * static_cast<double>(1ull << std::clamp(attempt, 0, 30));
+    return std::chrono::milliseconds(static_cast<long long>(std::clamp(u, 0.0, 1.0) * std::min(cap, exp)));
+}
+
+bool transient_failure(const LLMCompletion& c) {
+    if (c.source != "error") return false;
+    return c.http_status == 0 || c.http_status == 408 || c.http_status == 429 || c.http_status >= 500;
+}
+
+const char* to_string(CircuitBreaker::State s) {
+    switch (s) {
+        case CircuitBreaker::State::Closed: return "closed";
+        case CircuitBreaker::State::Open: return "open";
+        case CircuitBreaker::State::HalfOpen: return "half-open";
+    }
+    return "?";
+}
+
+void CircuitBreaker::trim(Clock::time_point now) {
+    while (!m_samples.empty() && (m_samples.size() > m_policy.window || now - m_samples.front().at > m_policy.max_age)) m_samples.pop_front();
+}
+
+double CircuitBreaker::rate_locked() const {
+    if (m_samples.empty()) return 0.0;
+    auto bad = std::count_if(m_samples.begin(), m_samples.end(), [](const Sample& s) { return s.bad; });
+    return static_cast<double>(bad) / static_cast<double>(m_samples.size());
+}
+
+bool CircuitBreaker::allow(Clock::time_point now) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_state == State::Closed) return true;
+    if (m_state == State::Open) {
+        if (now - m_opened < m_policy.cooldown) return false;
+        m_state = State::HalfOpen;
+        m_probe = false;
+    }
+    if (m_probe) return false; // una sola sonda alla volta
+    m_probe = true;
+    return true;
+}
+
+void CircuitBreaker::record(bool ok, std::chrono::milliseconds latency, Clock::time_point now) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    bool bad = !ok || (m_policy.slow_call.count() > 0 && latency > m_policy.slow_call);
+    if (m_state == State::HalfOpen) {
+        // Esito della sonda: chiude con finestra pulita o riapre per un altro cooldown
+        m_probe = false;
+        m_samples.clear();
+        if (bad) { m_state = State::Open; m_opened = now; }
+        else m_state = State::Closed;
+        return;
+    }
+    if (m_state == State::Open) return; // risposta tardiva di una chiamata partita prima dell'apertura
+    m_samples.push_back({now, bad});
+    trim(now);
+    if (m_samples.size() >= m_policy.min_calls && rate_locked() >= m_policy.error_rate) { m_state = State::Open; m_opened = now; }
+}
+
+void CircuitBreaker::abandon() { std::lock_guard<std::mutex> lk(m_mutex); m_probe = false; }
+
+CircuitBreaker::State CircuitBreaker::state() const { std::lock_guard<std::mutex> lk(m_mutex); return m_state; }
+double CircuitBreaker::failure_rate() const { std::lock_guard<std::mutex> lk(m_mutex); return rate_locked(); }
+std::size_t CircuitBreaker::calls() const { std::lock_guard<std::mutex> lk(m_mutex); return m_samples.size(); }
+
+struct ResilientLLMClient::Shared {
+    std::vector<Leg> legs;
+    RetryPolicy retry;
+    std::atomic<std::size_t> requests{0}, retries{0}, failovers{0}, short_circuited{0}, failed{0};
+};
+
+ResilientLLMClient::ResilientLLMClient(std::vector<Provider> providers, RetryPolicy retry, CircuitBreaker::Policy breaker)
+    : m_state(std::make_shared<Shared>()) {
+    m_state->retry = retry;
+    m_state->retry.retries = std::max(0, retry.retries);
+    for (auto& p : providers) m_state->legs.push_back({p.name, std::shared_ptr<LLMClient>(std::move(p.client)), std::make_shared<CircuitBreaker>(breaker)});
+}
+
+ResilientLLMClient::Stats ResilientLLMClient::stats() const {
+    auto& s = *m_state;
+    return Stats{s.requests.load(), s.retries.load(), s.failovers.load(), s.short_circuited.load(), s.failed.load()};
+}
+
+LLMClient& ResilientLLMClient::provider(std::size_t i) { return *m_state->legs.at(i).client; }
+
+std::vector<ResilientLLMClient::ProviderStatus> ResilientLLMClient::status() const {
+    std::vector<ProviderStatus> out;
+    for (auto& l : m_state->legs) out.push_back({l.name, l.breaker->state(), l.breaker->failure_rate(), l.breaker->calls()});
+    return out;
+}
+
+std::future<std::optional<LLMCompletion>> ResilientLLMClient::complete_async(const std::string& prompt, LLMDeltaFn on_delta,
+                                                                             CancelToken cancel, std::chrono::steady_clock::time_point deadline) {
+    using Clock = std::chrono::steady_clock;
+    using std::chrono::milliseconds;
+    // Attese di backoff su un thread staccato, come le gambe di HedgedLLMClient: chi chiama attende il
+    // future come per un singolo provider, ma puo' anche abbandonarlo (cancel) senza restare bloccato
+    auto promise = std::make_shared<std::promise<std::optional<LLMCompletion>>>();
+    auto fut = promise->get_future();
+    auto run = [s = m_state, prompt, on_delta, cancel, deadline]() -> std::optional<LLMCompletion> {
+        thread_local std::mt19937_64 rng{std::random_device{}()};
+        std::uniform_real_distribution<double> jitter(0.0, 1.0);
+        bool has_deadline = deadline != Clock::time_point{};
+        auto past = [&](Clock::time_point t) { return has_deadline && t >= deadline; };
+        s->requests++;
+        std::optional<LLMCompletion> last;
+        bool tried = false;
+        for (std::size_t i = 0; i < s->legs.size(); ++i) {
+            auto& leg = s->legs[i];
+            if (!leg.breaker->allow()) { s->short_circuited++; continue; }
+            if (tried) s->failovers++;
+            tried = true;
+            for (int attempt = 0;; ++attempt) {
+                if (cancel.cancelled()) return std::nullopt;
+                auto start = Clock::now();
+                auto limit = deadline;
+                if (s->retry.attempt_timeout.count() > 0 && (!has_deadline || start + s->retry.attempt_timeout < deadline)) limit = start + s->retry.attempt_timeout;
+                auto delivered = std::make_shared<std::atomic<bool>>(false);
+                LLMDeltaFn fwd;
+                if (on_delta) fwd = [on_delta, delivered](std::string_view d) { delivered->store(true); on_delta(d); };
+                auto r = leg.client->complete_async(prompt, fwd, cancel, limit).get();
+                if (!r) { leg.breaker->abandon(); return std::nullopt; } // cancellato: nessun esito da registrare
+                bool ok = r->source != "error";
+                leg.breaker->record(ok, std::chrono::duration_cast<milliseconds>(Clock::now() - start));
+                if (ok || *delivered) return r;
+                last = std::move(r);
+                if (past(Clock::now())) { s->failed++; return last; }
+                if (attempt >= s->retry.retries || !transient_failure(*last)) break;
+                auto wait = backoff_delay(s->retry, attempt, jitter(rng));
+                if (last->retry_after_ms >= 0) {
+                    if (milliseconds(last->retry_after_ms) > s->retry.max) break; // throttling lungo: meglio il prossimo provider
+                    wait = std::max(wait, milliseconds(last->retry_after_ms));
+                }
+                if (past(Clock::now() + wait) || !leg.breaker->allow()) break;
+                s->retries++;
+                if (cancel.wait_until(Clock::now() + wait)) return std::nullopt; // Ctrl-C interrompe subito l'attesa
+            }
+        }
+        s->failed++;
+        if (!last) return LLMCompletion{"(circuit-open)", "error"};
+        return last;
+    };
+    std::thread([promise, run = std::move(run)] {
+        try { promise->set_value(run()); }
+        catch (...) { promise->set_exception(std::current_exception()); }
+    }).detach();
+    return fut;
+}
+
+} // namespace autoshell::ai
@@ -0,0 +1,308 @@
+// Declarative planner rules (table parser + Aho-Corasick matcher)
+#include <ai-autoshell/ai/rule_table.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <sstream>
+
+namespace autoshell::ai {
+
+namespace {
+
+// Le regole storiche di Planner::rule_expand, ora come tabella
+const char* kBuiltinRules = R"(
+list files|show files => ls -la :: List files in current directory
+show current directory|current directory|print working directory|show pwd|where am i|=pwd => pwd :: Show current directory path
+find text => grep -R 'TODO' . :: Search for pattern in *.txt
+remove build|clean build => rm -rf build :: Remove build directory
+elenco.txt => ls -laS > elenco.txt :: List files by size into elenco.txt :: also=dimensione
+crea un elenco dei file => ls -laS > elenco.txt :: Crea elenco file in elenco.txt
+mostra la data|visualizza la data => date :: Mostra data corrente
+crea un file => echo "{quoted}" > {between} :: Crea file {between} con contenuto :: until=con scritto
+mostrami il file|mostra il file => cat {word} :: Mostra contenuto file {word}
+mostrami il contenuto della directory|mostra il contenuto della directory => ls -la {rest} :: Lista contenuto directory {rest}
+rimuovi la cartella|elimina la cartella|cancella la cartella => rm -rf {word} :: Rimuovi cartella {word} :: confirm
+crea una cartella|crea cartella => mkdir -p {word} :: Crea cartella {word}
+create => ls -la > {word} :: List files into {word} :: also=list of file;suffix=.txt
+)";
+
+// Parole che non contano per la confidenza (cortesia, articoli, congiunzioni)
+const char* kFillers[] = {"please", "per", "favore", "mi", "me", "and", "e", "poi", "then", "also", "anche", "the", "a", "an",
+                          "il", "lo", "la", "i", "le", "un", "una", "of", "di", "to", "for", "my", "mio", "mia"};
+
+std::string trim(std::string_view s) {
+    std::size_t a = 0, b = s.size();
+    while (a < b && std::isspace(static_cast<unsigned char>(s[a]))) ++a;
+    while (b > a && std::isspace(static_cast<unsigned char>(s[b - 1]))) --b;
+    return std::string(s.substr(a, b - a));
+}
+
+std::string lower(std::string_view s) {
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return std::tolower(c); });
+    return out;
+}
+
+std::vector<std::string> split(std::string_view s, std::string_view sep) {
+    std::vector<std::string> out;
+    std::size_t start = 0;
+    for (;;) {
+        auto p = s.find(sep, start);
+        out.push_back(trim(s.substr(start, p == std::string_view::npos ? std::string_view::npos : p - start)));
+        if (p == std::string_view::npos) return out;
+        start = p + sep.size();
+    }
+}
+
+// Valori inseriti in un comando eseguibile: niente metacaratteri di shell, niente opzioni
+bool safe_word(const std::string& v) {
+    if (v.empty() || v[0] == '-') return false;
+    for (unsigned char c : v)
+        if (!(std::isalnum(c) || std::strchr("_./~+@%,:=-", c) || c >= 0x80)) return false;
+    return true;
+}
+bool safe_quoted(const std::string& v) {
+    for (unsigned char c : v) if (c == '"' || c == '$' || c == '`' || c == '\\' || c < 0x20) return false;
+    return !v.empty();
+}
+
+void replace_all(std::string& s, const std::string& from, const std::string& to) {
+    for (std::size_t p = 0; (p = s.find(from, p)) != std::string::npos; p += to.size()) s.replace(p, from.size(), to);
+}
+
+} // namespace
+
+std::optional<Rule> RuleSet::parse_rule(std::string_view line, std::string* error) {
+    auto fail = [&](const char* msg) -> std::optional<Rule> { if (error) *error = msg; return std::nullopt; };
+    auto arrow = line.find("=>");
+    if (arrow == std::string_view::npos) return fail("missing '=>'");
+    Rule r;
+    for (auto& t : split(line.substr(0, arrow), "|")) {
+        if (t.empty()) continue;
+        bool exact = t[0] == '=';
+        r.triggers.push_back(lower(exact ? trim(std::string_view(t).substr(1)) : t));
+        r.exact.push_back(exact);
+    }
+    if (r.triggers.empty()) return fail("no trigger phrase");
+    auto parts = split(line.substr(arrow + 2), " :: ");
+    r.command = parts[0];
+    if (r.command.empty()) return fail("empty command");
+    r.description = parts.size() > 1 && !parts[1].empty() ? parts[1] : r.command;
+    if (parts.size() > 2) {
+        for (auto& opt : split(parts[2], ";")) {
+            if (opt.empty()) continue;
+            if (opt == "confirm") r.confirm = true;
+            else if (opt.rfind("also=", 0) == 0) { for (auto& a : split(std::string_view(opt).substr(5), "+")) if (!a.empty()) r.also.push_back(lower(a)); }
+            else if (opt.rfind("until=", 0) == 0) r.until = lower(trim(std::string_view(opt).substr(6)));
+            else if (opt.rfind("suffix=", 0) == 0) r.suffix = lower(trim(std::string_view(opt).substr(7)));
+            else return fail("unknown option");
+        }
+    }
+    if (parts.size() > 3) return fail("too many '::' fields");
+    bool uses_between = r.command.find("{between}") != std::string::npos;
+    if (uses_between != !r.until.empty()) return fail("{between} needs until= (and vice versa)");
+    return r;
+}
+
+int RuleSet::pattern_id(const std::string& p) {
+    auto it = std::find(m_patterns.begin(), m_patterns.end(), p);
+    if (it != m_patterns.end()) return static_cast<int>(it - m_patterns.begin());
+    m_patterns.push_back(p);
+    return static_cast<int>(m_patterns.size() - 1);
+}
+
+void RuleSet::insert(Rule r) {
+    std::vector<int> trig, also;
+    for (std::size_t i = 0; i < r.triggers.size(); ++i) trig.push_back(r.exact[i] ? -1 : pattern_id(r.triggers[i]));
+    for (auto& a : r.also) also.push_back(pattern_id(a));
+    if (!r.until.empty()) also.push_back(pattern_id(r.until));
+    m_rule_triggers.push_back(std::move(trig));
+    m_rule_also.push_back(std::move(also));
+    m_rules.push_back(std::move(r));
+}
+
+void RuleSet::add(Rule r) { insert(std::move(r)); compile(); }
+
+bool RuleSet::load(std::istream& in, std::string* error) {
+    std::vector<Rule> parsed;
+    std::string line; int n = 0;
+    while (std::getline(in, line)) {
+        ++n;
+        std::string t = trim(line);
+        if (t.empty() || t[0] == '#') continue;
+        std::string why;
+        auto r = parse_rule(t, &why);
+        if (!r) { if (error) *error = "line " + std::to_string(n) + ": " + why; return false; }
+        parsed.push_back(std::move(*r));
+    }
+    for (auto& r : parsed) insert(std::move(r));
+    compile();
+    return true;
+}
+
+bool RuleSet::load_file(const std::string& path, std::string* error) {
+    std::ifstream in(path);
+    if (!in) { if (error) *error = "cannot open " + path; return false; }
+    return load(in, error);
+}
+
+RuleSet RuleSet::builtin() {
+    RuleSet rs;
+    std::istringstream in(kBuiltinRules);
+    rs.load(in);
+    return rs;
+}
+
+// Trie dei pattern + link di fallimento (BFS); le uscite dei suffissi vengono fuse in ogni nodo.
+void RuleSet::compile() {
+    m_nodes.assign(1, Node{});
+    for (std::size_t p = 0; p < m_patterns.size(); ++p) {
+        int cur = 0;
+        for (unsigned char c : m_patterns[p]) {
+            auto& nx = m_nodes[cur].next;
+            auto it = std::find_if(nx.begin(), nx.end(), [c](auto& e) { return e.first == c; });
+            if (it != nx.end()) { cur = it->second; continue; }
+            m_nodes[cur].next.emplace_back(c, static_cast<int>(m_nodes.size()));
+            cur = static_cast<int>(m_nodes.size());
+            m_nodes.emplace_back();
+        }
+        m_nodes[cur].out.push_back(static_cast<int>(p));
+    }
+    std::queue<int> q;
+    for (auto& [c, child] : m_nodes[0].next) { m_nodes[child].fail = 0; q.push(child); }
+    while (!q.empty()) {
+        int u = q.front(); q.pop();
+        for (auto [c, v] : m_nodes[u].next) {
+            int f = m_nodes[u].fail;
+            int target = 0;
+            for (;;) {
+                auto& nx = m_nodes[f].next;
+                auto it = std::find_if(nx.begin(), nx.end(), [c = c](auto& e) { return e.first == c; });
+                if (it != nx.end() && it->second != v) { target = it->second; break; }
+                if (f == 0) break;
+                f = m_nodes[f].fail;
+            }
+            m_nodes[v].fail = target;
+            auto& fo = m_nodes[target].out;
+            m_nodes[v].out.insert(m_nodes[v].out.end(), fo.begin(), fo.end());
+            q.push(v);
+        }
+    }
+}
+
+int RuleSet::step(int state, unsigned char c) const {
+    for (;;) {
+        for (auto& [ch, nx] : m_nodes[state].next) if (ch == c) return nx;
+        if (state == 0) return 0;
+        state = m_nodes[state].fail;
+    }
+}
+
+RuleMatch RuleSet::match(std::string_view request) const {
+    RuleMatch m;
+    std::string low = lower(request);
+    const std::size_t npos = std::string::npos;
+    // Inizio della prima occorrenza: ovunque (also) e a confini di parola (trigger: "current directory" non scatta in "currentdirectory")
+    std::vector<std::size_t> first(m_patterns.size(), npos), first_word(m_patterns.size(), npos);
+    auto word_char = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || static_cast<unsigned char>(c) >= 0x80; };
+    for (std::size_t i = 0, state = 0; i < low.size(); ++i) {
+        state = static_cast<std::size_t>(step(static_cast<int>(state), static_cast<unsigned char>(low[i])));
+        for (int p : m_nodes[state].out) {
+            const std::string& pat = m_patterns[p];
+            std::size_t a = i + 1 - pat.size(), b = i + 1;
+            if (first[p] == npos) first[p] = a;
+            bool left = a == 0 || !word_char(low[a - 1]) || !word_char(pat.front());
+            bool right = b == low.size() || !word_char(low[b]) || !word_char(pat.back());
+            if (first_word[p] == npos && left && right) first_word[p] = a;
+        }
+    }
+    std::string whole = trim(low);
+    std::size_t whole_at = low.find_first_not_of(" \t\r\n");
+    std::vector<bool> covered(low.size(), false);
+    auto cover = [&](std::size_t a, std::size_t len) { for (std::size_t k = a; k < a + len && k < covered.size(); ++k) covered[k] = true; };
+
+    for (std::size_t ri = 0; ri < m_rules.size(); ++ri) {
+        const Rule& r = m_rules[ri];
+        std::size_t at = npos, tlen = 0;
+        for (std::size_t t = 0; t < r.triggers.size() && at == npos; ++t) {
+            int id = m_rule_triggers[ri][t];
+            if (id < 0) { if (whole == r.triggers[t]) { at = whole_at; tlen = whole.size(); } }
+            else if (first_word[id] != npos) { at = first_word[id]; tlen = r.triggers[t].size(); }
+        }
+        if (at == npos) continue;
+        bool all = true;
+        for (int id : m_rule_also[ri]) all = all && first[id] != npos;
+        if (!all) continue;
+
+        // Slot: posizioni sul testo minuscolo, valori dal testo originale (stessa lunghezza)
+        std::size_t tend = at + tlen;
+        std::vector<std::pair<std::size_t, std::size_t>> spans{{at, tlen}};
+        auto need = [&](const char* slot) { return r.command.find(slot) != npos || r.description.find(slot) != npos; };
+        std::string word, rest, between, quoted;
+        bool ok = true;
+        if (need("{word}")) {
+            std::size_t a = tend;
+            while (a < low.size() && std::isspace(static_cast<unsigned char>(low[a]))) ++a;
+            std::size_t b = a;
+            while (b < low.size() && !std::isspace(static_cast<unsigned char>(low[b]))) ++b;
+            word = std::string(request.substr(a, b - a));
+            while (word.size() > 1 && std::strchr(",;:!?.", word.back())) word.pop_back();
+            ok = ok && safe_word(word) && (r.suffix.empty() || lower(word).find(r.suffix) != npos);
+            spans.emplace_back(a, b - a);
+        }
+        if (need("{rest}")) {
+            // Tutto il resto come un solo valore: spazi o metacaratteri fanno mancare la regola, niente filtro
+            rest = trim(request.substr(std::min(tend, request.size())));
+            while (rest.size() > 1 && std::strchr(",;:!?.", rest.back())) rest.pop_back();
+            ok = ok && safe_word(rest);
+            spans.emplace_back(tend, low.size() - std::min(tend, low.size()));
+        }
+        std::size_t qfrom = tend;
+        if (!r.until.empty()) {
+            std::size_t u = low.find(r.until, tend);
+            if (u == npos) ok = false;
+            else {
+                between = trim(request.substr(tend, u - tend));
+                ok = ok && safe_word(between);
+                spans.emplace_back(tend, u + r.until.size() - tend);
+                qfrom = u + r.until.size();
+            }
+        }
+        if (ok && need("{quoted}")) {
+            std::size_t q1 = request.find('"', qfrom), q2 = q1 == npos ? npos : request.find('"', q1 + 1);
+            if (q2 == npos) ok = false;
+            else { quoted = std::string(request.substr(q1 + 1, q2 - q1 - 1)); ok = safe_quoted(quoted); spans.emplace_back(q1, q2 - q1 + 1); }
+        }
+        if (!ok) continue;
+        for (int id : m_rule_also[ri]) spans.emplace_back(first[id], m_patterns[id].size());
+        for (auto& [a, len] : spans) cover(a, len);
+
+        RuleStep st{r.description, r.command, r.confirm};
+        for (std::string* s : {&st.description, &st.command}) {
+            replace_all(*s, "{word}", word); replace_all(*s, "{rest}", rest);
+            replace_all(*s, "{between}", between); replace_all(*s, "{quoted}", quoted);
+        }
+        m.steps.push_back(std::move(st));
+    }
+    if (m.steps.empty()) return m;
+
+    std::size_t words = 0, hit = 0;
+    for (std::size_t i = 0; i < low.size();) {
+        while (i < low.size() && std::isspace(static_cast<unsigned char>(low[i]))) ++i;
+        std::size_t j = i;
+        while (j < low.size() && !std::isspace(static_cast<unsigned char>(low[j]))) ++j;
+        std::string w = low.substr(i, j - i);
+        while (!w.empty() && std::strchr(",;:!?.", w.back())) w.pop_back();
+        if (!w.empty() && std::find_if(std::begin(kFillers), std::end(kFillers), [&](const char* f) { return w == f; }) == std::end(kFillers)) {
+            ++words;
+            if (std::any_of(covered.begin() + static_cast<std::ptrdiff_t>(i), covered.begin() + static_cast<std::ptrdiff_t>(j), [](bool b) { return b; })) ++hit;
+        }
+        i = j;
+    }
+    m.confidence = words ? static_cast<double>(hit) / static_cast<double>(words) : 1.0;
+    return m;
+}
+
+} // namespace autoshell::ai
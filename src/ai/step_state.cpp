@@ -0,0 +1,191 @@
+// State DB of incremental plan steps (inputs/outputs)
+#include <ai-autoshell/ai/step_state.hpp>
+#include <ai-autoshell/ai/log_record.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+namespace autoshell::ai {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Log records (log_record.hpp), one per line:
+//   U key command inputs   (outputs recorded; inputs = "size mtime hash path" lines)
+std::uint64_t fnv1a64(std::string_view s, std::uint64_t h = 14695981039346656037ull) {
+    for (unsigned char c : s) { h ^= c; h *= 1099511628211ull; }
+    return h;
+}
+
+std::string hex(std::uint64_t v) { char b[24]; std::snprintf(b, sizeof(b), "%016llx", static_cast<unsigned long long>(v)); return b; }
+
+std::string absolute(const std::string& p) {
+    std::error_code ec;
+    auto a = fs::absolute(p, ec);
+    return (ec ? fs::path(p) : a).lexically_normal().string();
+}
+
+std::string output_key(const PlanStep& step) {
+    std::vector<std::string> outs;
+    for (auto& o : step.outputs) outs.push_back(absolute(o));
+    std::sort(outs.begin(), outs.end());
+    outs.erase(std::unique(outs.begin(), outs.end()), outs.end());
+    std::string key;
+    for (auto& o : outs) { if (!key.empty()) key.push_back('\n'); key += o; }
+    return key;
+}
+
+// Stat senza hash: il contenuto si legge solo se dimensione o mtime non bastano a decidere
+std::optional<StepStateDb::Stamp> stamp_of(const std::string& abs) {
+    std::error_code ec;
+    auto st = fs::status(abs, ec);
+    if (ec || !fs::exists(st)) return std::nullopt;
+    StepStateDb::Stamp s;
+    s.path = abs;
+    auto t = fs::last_write_time(abs, ec);
+    if (!ec) s.mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    if (fs::is_regular_file(st)) { auto n = fs::file_size(abs, ec); if (!ec) s.size = n; }
+    return s;
+}
+
+std::uint64_t content_hash(const std::string& abs) {
+    std::ifstream in(abs, std::ios::binary);
+    if (!in) return 0;
+    std::uint64_t h = 14695981039346656037ull;
+    char buf[65536];
+    while (in.read(buf, sizeof(buf)) || in.gcount() > 0) h = fnv1a64(std::string_view(buf, static_cast<std::size_t>(in.gcount())), h);
+    return h;
+}
+
+std::string encode(const std::vector<StepStateDb::Stamp>& v) {
+    std::string out;
+    for (auto& s : v) out += std::to_string(s.size) + " " + std::to_string(s.mtime) + " " + hex(s.hash) + " " + s.path + "\n";
+    return out;
+}
+
+std::vector<StepStateDb::Stamp> decode(const std::string& text) {
+    std::vector<StepStateDb::Stamp> out;
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        auto nl = text.find('\n', pos);
+        std::string line = text.substr(pos, nl == std::string::npos ? std::string::npos : nl - pos);
+        pos = nl == std::string::npos ? text.size() : nl + 1;
+        auto a = line.find(' '), b = line.find(' ', a + 1), c = line.find(' ', b + 1);
+        if (c == std::string::npos) continue;
+        StepStateDb::Stamp s;
+        try {
+            s.size = std::stoull(line.substr(0, a)); s.mtime = std::stoll(line.substr(a + 1, b - a - 1));
+            s.hash = std::stoull(line.substr(b + 1, c - b - 1), nullptr, 16);
+        } catch (...) { continue; }
+        s.path = line.substr(c + 1);
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+} // namespace
+
+StepStateDb::StepStateDb(StepStateDbOptions opts) : m_opts(std::move(opts)) {
+    if (m_opts.path.empty()) return;
+    bool torn = false;
+    if (!replay_log(m_opts.path, [&](const std::vector<std::string>& rec) { apply(rec); ++m_log_records; }, &torn)) return;
+    std::lock_guard<std::mutex> lk(m_mu);
+    bool trim = m_lru.size() > m_opts.max_entries;
+    while (m_lru.size() > m_opts.max_entries) { m_index.erase(m_lru.back().key); m_lru.pop_back(); }
+    if (trim || torn || m_log_records > 2 * m_lru.size() + 64) compact();
+}
+
+void StepStateDb::apply(const std::vector<std::string>& rec) {
+    if (rec[0] == "U" && rec.size() == 4) insert({rec[1], rec[2], decode(rec[3])});
+}
+
+void StepStateDb::insert(Entry e) {
+    auto it = m_index.find(e.key);
+    if (it != m_index.end()) m_lru.erase(it->second);
+    m_lru.push_front(std::move(e));
+    m_index[m_lru.front().key] = m_lru.begin();
+}
+
+StepStateDb::Check StepStateDb::check(const PlanStep& step) {
+    if (step.outputs.empty()) return {false, "no outputs declared"};
+    std::optional<std::int64_t> oldest_output;
+    for (auto& o : step.outputs) {
+        auto s = stamp_of(absolute(o));
+        if (!s) return {false, "output missing: " + o};
+        if (!oldest_output || s->mtime < *oldest_output) oldest_output = s->mtime;
+    }
+    std::vector<std::pair<const std::string*, Stamp>> inputs;
+    for (auto& i : step.inputs) {
+        auto s = stamp_of(absolute(i));
+        if (!s) return {false, "input missing: " + i};
+        inputs.emplace_back(&i, std::move(*s));
+    }
+    std::lock_guard<std::mutex> lk(m_mu);
+    auto it = m_index.find(output_key(step));
+    if (it == m_index.end()) {
+        // Mai registrati: regola di make (senza input non si sa da cosa dipendono, si eseguono)
+        if (inputs.empty()) return {false, "not run before"};
+        for (auto& [name, s] : inputs)
+            if (s.mtime > *oldest_output) return {false, "input newer than outputs: " + *name};
+        return {true, {}};
+    }
+    const Entry& e = *it->second;
+    if (e.command != hex(fnv1a64(step.command))) return {false, "command changed"};
+    for (auto& [name, s] : inputs) {
+        auto prev = std::find_if(e.inputs.begin(), e.inputs.end(), [&](const Stamp& p) { return p.path == s.path; });
+        if (prev == e.inputs.end()) return {false, "new input: " + *name};
+        if (prev->size == s.size && prev->mtime == s.mtime) continue;
+        // Toccato ma forse identico: decide l'hash del contenuto
+        if (prev->size != s.size || !prev->hash || content_hash(s.path) != prev->hash) return {false, "input changed: " + *name};
+    }
+    return {true, {}};
+}
+
+bool StepStateDb::record(const PlanStep& step) {
+    if (step.outputs.empty()) return false;
+    for (auto& o : step.outputs) if (!stamp_of(absolute(o))) return false;
+    Entry e{output_key(step), hex(fnv1a64(step.command)), {}};
+    for (auto& i : step.inputs) {
+        auto s = stamp_of(absolute(i));
+        if (!s) return false;
+        if (fs::is_regular_file(s->path)) s->hash = content_hash(s->path);
+        e.inputs.push_back(std::move(*s));
+    }
+    std::lock_guard<std::mutex> lk(m_mu);
+    std::string rec = log_record({"U", e.key, e.command, encode(e.inputs)});
+    insert(std::move(e));
+    if (m_lru.size() > m_opts.max_entries) {
+        while (m_lru.size() > m_opts.max_entries) { m_index.erase(m_lru.back().key); m_lru.pop_back(); }
+        compact();
+    } else append(rec);
+    return true;
+}
+
+void StepStateDb::clear() {
+    std::lock_guard<std::mutex> lk(m_mu);
+    m_lru.clear(); m_index.clear();
+    compact();
+}
+
+std::size_t StepStateDb::size() const {
+    std::lock_guard<std::mutex> lk(m_mu);
+    return m_lru.size();
+}
+
+void StepStateDb::append(const std::string& record) {
+    if (m_opts.path.empty()) return;
+    if (append_log(m_opts.path, record, false)) ++m_log_records;
+}
+
+void StepStateDb::compact() {
+    if (m_opts.path.empty()) return;
+    std::string out;
+    for (auto it = m_lru.rbegin(); it != m_lru.rend(); ++it) out += log_record({"U", it->key, it->command, encode(it->inputs)});
+    if (rewrite_log(m_opts.path, out)) m_log_records = m_lru.size();
+}
+
+} // namespace autoshell::ai
@@ -0,0 +1,55 @@
+#include <ai-autoshell/ai/stream.hpp>
+#include <ai-autoshell/ai/json_pull.hpp>
+
+namespace autoshell::ai {
+
+void StreamDecoder::feed(std::string_view chunk, const EventFn& on_event) {
+    for (char c : chunk) {
+        if (c != '\n') { m_line.push_back(c); continue; }
+        if (!m_line.empty() && m_line.back() == '\r') m_line.pop_back();
+        line(m_line, on_event);
+        m_line.clear();
+    }
+}
+
+void StreamDecoder::finish(const EventFn& on_event) {
+    if (!m_line.empty()) { line(m_line, on_event); m_line.clear(); }
+    if (m_format == Format::SSE) line("", on_event);
+}
+
+void StreamDecoder::line(std::string_view l, const EventFn& on_event) {
+    if (m_format == Format::NDJSON) {
+        if (!l.empty()) on_event(l);
+        return;
+    }
+    if (l.empty()) { // fine evento SSE
+        if (!m_data.empty()) { on_event(m_data); m_data.clear(); }
+        return;
+    }
+    if (l.rfind("data:", 0) != 0) return; // event:, id:, retry:, commenti ':'
+    l.remove_prefix(5);
+    if (!l.empty() && l.front() == ' ') l.remove_prefix(1);
+    if (!m_data.empty()) m_data.push_back('\n');
+    m_data.append(l);
+}
+
+// Prima chiave uguale a key a qualsiasi profondita': il reader si ferma sul suo valore.
+static JsonReader::Token value_of(JsonReader& r, std::string_view key) {
+    for (auto t = r.next();; t = r.next()) {
+        if (t == JsonReader::Token::Key && r.text() == key) return r.next();
+        if (t == JsonReader::Token::End || t == JsonReader::Token::Error || t == JsonReader::Token::NeedMore) return t;
+    }
+}
+
+std::string json_string_field(std::string_view json, std::string_view key) {
+    JsonReader r(json);
+    return value_of(r, key) == JsonReader::Token::String ? std::string(r.text()) : std::string();
+}
+
+int json_int_field(std::string_view json, std::string_view key) {
+    JsonReader r(json);
+    if (value_of(r, key) != JsonReader::Token::Number) return -1;
+    return json_to_int(std::string(r.text()));
+}
+
+} // namespace autoshell::ai
@@ -0,0 +1,128 @@
+// Session telemetry of the AI layer (ai stats)
+#include <ai-autoshell/ai/telemetry.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace autoshell::ai {
+
+std::size_t LatencyHistogram::index(std::int64_t v) {
+    if (v < 0) v = 0;
+    auto u = std::min<std::uint64_t>(static_cast<std::uint64_t>(v), (std::uint64_t{1} << (kMaxExp + 1)) - 1);
+    if (u < (1u << kSubBits)) return static_cast<std::size_t>(u);
+    int e = std::bit_width(u) - 1; // e >= kSubBits
+    auto sub = (u >> (e - kSubBits)) & ((1u << kSubBits) - 1);
+    return (static_cast<std::size_t>(e - kSubBits + 1) << kSubBits) + static_cast<std::size_t>(sub);
+}
+
+std::int64_t LatencyHistogram::highest(std::size_t idx) {
+    if (idx < (1u << kSubBits)) return static_cast<std::int64_t>(idx);
+    int e = static_cast<int>(idx >> kSubBits) + kSubBits - 1;
+    std::int64_t sub = static_cast<std::int64_t>(idx & ((1u << kSubBits) - 1));
+    std::int64_t width = std::int64_t{1} << (e - kSubBits);
+    return (((std::int64_t{1} << kSubBits) + sub) << (e - kSubBits)) + width - 1;
+}
+
+void LatencyHistogram::record(std::int64_t us) {
+    if (us < 0) return;
+    m_buckets[index(us)]++;
+    m_count++;
+    m_sum += us;
+    m_max = std::max(m_max, us);
+}
+
+std::int64_t LatencyHistogram::percentile(double p) const {
+    if (!m_count) return -1;
+    auto target = static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(m_count)));
+    target = std::max<std::uint64_t>(target, 1);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += m_buckets[i];
+        if (seen >= target) return i + 1 == kBuckets ? m_max : std::min(highest(i), m_max); // l'ultimo bucket raccoglie i valori fuori range
+    }
+    return m_max;
+}
+
+void Telemetry::record_request(const std::string& series, const HttpTiming& timing, std::int64_t parse_us, int completion_tokens, bool ok,
+                               int prompt_tokens, int cached_tokens) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto& s = m_series[series];
+    s.requests++;
+    if (!ok) s.errors++;
+    s.dns.record(timing.dns_us);
+    s.connect.record(timing.connect_us);
+    s.tls.record(timing.tls_us);
+    s.ttfb.record(timing.ttfb_us);
+    s.total.record(timing.total_us);
+    s.parse.record(parse_us);
+    s.bytes_down += timing.bytes_down;
+    s.bytes_up += timing.bytes_up;
+    if (ok && completion_tokens > 0 && timing.total_us > 0) { s.completion_tokens += completion_tokens; s.token_time_us += timing.total_us; }
+    if (ok && prompt_tokens > 0 && cached_tokens >= 0) { s.prompt_tokens += prompt_tokens; s.cached_tokens += std::min(cached_tokens, prompt_tokens); }
+}
+
+void Telemetry::record_plan(PlanSource source) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_plans[static_cast<std::size_t>(source)]++;
+}
+
+double Telemetry::cache_hit_rate() const {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto hits = m_plans[1] + m_plans[2];
+    return hits + m_plans[3] ? static_cast<double>(hits) / static_cast<double>(hits + m_plans[3]) : 0.0;
+}
+
+std::map<std::string, Telemetry::Series> Telemetry::series() const {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_series;
+}
+
+void Telemetry::reset() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_series.clear();
+    m_plans = {};
+}
+
+void Telemetry::report(std::ostream& os) const {
+    auto series_copy = series();
+    std::array<std::uint64_t, 4> plans;
+    { std::lock_guard<std::mutex> lk(m_mutex); plans = m_plans; }
+    auto flags = os.flags();
+    auto prec = os.precision();
+    os << std::fixed << std::setprecision(1);
+    os << "[AI] Plans: " << plans[0] + plans[1] + plans[2] + plans[3] << " (rules " << plans[0] << ", cache " << plans[1]
+       << ", template " << plans[2] << ", llm " << plans[3] << "), cache hit rate " << cache_hit_rate() * 100.0 << "%\n";
+    if (series_copy.empty()) os << "[AI] No LLM requests in this session.\n";
+    auto ms = [](std::int64_t us) {
+        std::ostringstream o;
+        if (us < 0) o << "-";
+        else o << std::fixed << std::setprecision(us < 10000 ? 2 : 1) << us / 1000.0;
+        return o.str();
+    };
+    for (auto& [name, s] : series_copy) {
+        os << "[AI] " << name << ": " << s.requests << " request" << (s.requests == 1 ? "" : "s") << ", " << s.errors << " failed, "
+           << s.completion_tokens << " tokens out";
+        if (s.token_time_us > 0) os << " (" << s.tokens_per_second() << " tokens/s)";
+        if (s.prompt_tokens > 0) os << ", " << s.prompt_tokens << " tokens in (" << s.cached_share() * 100.0 << "% cached)";
+        os << ", " << s.bytes_up / 1024.0 << " KB up / " << s.bytes_down / 1024.0 << " KB down\n";
+        os << "     phase (ms)       p50       p95       p99       max\n";
+        auto row = [&](const char* label, const LatencyHistogram& h) {
+            if (!h.count()) return;
+            os << "     " << std::left << std::setw(12) << label << std::right;
+            for (double p : {50.0, 95.0, 99.0}) os << std::setw(10) << ms(h.percentile(p));
+            os << std::setw(10) << ms(h.max()) << "\n";
+        };
+        row("dns", s.dns);
+        row("connect", s.connect);
+        row("tls", s.tls);
+        row("ttfb", s.ttfb);
+        row("total", s.total);
+        row("parse", s.parse);
+    }
+    os.flags(flags);
+    os.precision(prec);
+}
+
+} // namespace autoshell::ai
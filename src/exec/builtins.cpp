@@ -13,6 +13,7 @@
 #include <sys/wait.h>
 #include <signal.h>
 #include <cerrno>
+#include <algorithm>
 
 namespace autoshell {
 namespace fs = std::filesystem;
@@ -58,18 +59,55 @@ static int do_export(const std::vector<std::string>& argv) {
     return rc;
 }
 
-static int do_unset(const std::vector<std::string>& argv) {
+static int do_unset(const std::vector<std::string>& argv, ExecContext* ctx) {
+    int rc=0; size_t i=1;
+    if (argv.size()>1 && argv[1]=="-f") { // unset -f NAME: remove shell functions
+        for (i=2;i<argv.size();++i) if (!ctx || ctx->functions.erase(argv[i])==0) rc=1;
+        return rc;
+    }
+    for (;i<argv.size();++i) {
+        if (unsetenv(argv[i].c_str())!=0) { perror("unset"); rc=1; }
+    }
+    return rc;
+}
+
+// local NAME[=VALUE]...: shadow a variable until the current function returns.
+static int do_local(const std::vector<std::string>& argv, ExecContext* ctx) {
+    if (!ctx || ctx->frames.empty()) { std::cerr << "local: can only be used in a function" << '\n'; return 1; }
+    auto &frame = ctx->frames.back();
     int rc=0;
     for (size_t i=1;i<argv.size();++i) {
-        if (unsetenv(argv[i].c_str())!=0) { perror("unset"); rc=1; }
+        auto &a = argv[i];
+        auto eq = a.find('=');
+        std::string key = a.substr(0, eq);
+        if (key.empty()) { std::cerr << "local: invalid: " << a << '\n'; rc=1; continue; }
+        bool saved = std::any_of(frame.saved_vars.begin(), frame.saved_vars.end(), [&](auto &v){ return v.first==key; });
+        if (!saved) {
+            const char* old = std::getenv(key.c_str());
+            frame.saved_vars.emplace_back(key, old ? std::optional<std::string>(old) : std::nullopt);
+        }
+        if (eq==std::string::npos) unsetenv(key.c_str());
+        else setenv(key.c_str(), a.substr(eq+1).c_str(), 1);
     }
     return rc;
 }
 
+static int do_return(const std::vector<std::string>& argv, ExecContext* ctx) {
+    if (!ctx || ctx->frames.empty()) { std::cerr << "return: can only `return' from a function" << '\n'; return 1; }
+    int code = ctx->last_status;
+    if (argv.size()>1) {
+        try { code = std::stoi(argv[1]) & 0xff; } catch(...) { std::cerr << "return: numeric argument required" << '\n'; code = 2; }
+    }
+    ctx->frames.back().returning = true;
+    ctx->frames.back().return_status = code;
+    return code;
+}
+
 static bool is_jobs_builtin(const std::string& s){ return s=="jobs"||s=="fg"||s=="bg"; }
 
 bool is_builtin(const std::string& name) {
-    return name=="cd"||name=="pwd"||name=="exit"||name=="echo"||name=="export"||name=="unset"||is_jobs_builtin(name);
+    return name=="cd"||name=="pwd"||name=="exit"||name=="echo"||name=="export"||name=="unset"||
+           name=="local"||name=="return"||is_jobs_builtin(name);
 }
 
 struct ExecContext; // forward
@@ -81,7 +119,9 @@ std::optional<BuiltinResult> run_builtin(const std::vector<std::string>& argv, E
     else if (argv[0]=="pwd") res.exit_code = do_pwd();
     else if (argv[0]=="echo") res.exit_code = do_echo(argv);
     else if (argv[0]=="export") res.exit_code = do_export(argv);
-    else if (argv[0]=="unset") res.exit_code = do_unset(argv);
+    else if (argv[0]=="unset") res.exit_code = do_unset(argv, ctx);
+    else if (argv[0]=="local") res.exit_code = do_local(argv, ctx);
+    else if (argv[0]=="return") res.exit_code = do_return(argv, ctx);
     else if (argv[0]=="exit") { res.exit_code = 0; res.should_exit = true; }
     else if (is_jobs_builtin(argv[0])) {
         if (!ctx) { std::cerr << argv[0] << ": no context" << '\n'; res.exit_code=1; }
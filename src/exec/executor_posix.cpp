@@ -7,10 +7,15 @@
 #include <ai-autoshell/expand/expand.hpp>
 #include <ai-autoshell/exec/builtins.hpp>
 #include <ai-autoshell/exec/path.hpp>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <algorithm>
 #include <csignal>
 #include <cerrno>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <optional>
 #include <variant>
@@ -19,7 +24,59 @@ std::optional<pid_t> g_foreground_pgid; // definizione globale
 
 namespace autoshell {
 
+namespace {
+// Saves stdin/stdout/stderr while redirections are applied to an in-process
+// command (builtin or shell function) and restores them on destruction; multios
+// relays see EOF once the originals are back and are waited for.
+struct SavedStdio {
+    int fds[3] = {-1, -1, -1};
+    MultiosRelays relays;
+    void save() { flush(); for (int i=0;i<3;++i) fds[i] = dup(i); }
+    ~SavedStdio() {
+        if (fds[0]==-1) return;
+        flush();
+        for (int i=0;i<3;++i) if (fds[i]!=-1) { dup2(fds[i], i); close(fds[i]); }
+        wait_multios(relays);
+    }
+    static void flush() { std::cout.flush(); std::cerr.flush(); std::fflush(stdout); }
+};
+// Prefix assignments of an in-process command (VAR=x f, VAR=x builtin): set for
+// the duration of the call, previous values (or their absence) restored after.
+// Special builtins (export, unset, return, exit) keep them, as POSIX requires.
+struct ScopedEnv {
+    std::vector<std::pair<std::string, std::optional<std::string>>> saved;
+    bool keep = false;
+    void set(const std::string& name, const std::string& value) {
+        const char* old = std::getenv(name.c_str());
+        if (!keep) saved.emplace_back(name, old ? std::optional<std::string>(old) : std::nullopt);
+        setenv(name.c_str(), value.c_str(), 1);
+    }
+    ~ScopedEnv() {
+        for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+            if (it->second) setenv(it->first.c_str(), it->second->c_str(), 1);
+            else unsetenv(it->first.c_str());
+        }
+    }
+};
+bool is_special_builtin(const std::string& name) {
+    return name=="export"||name=="unset"||name=="return"||name=="exit";
+}
+constexpr size_t kMaxFunctionDepth = 1000;
+
+// Only words the lexer saw unquoted: echo '<(cmd)' prints the text and runs nothing.
+bool has_process_subst(const CommandNode& cmd) {
+    if (!cmd.substs.empty()) return true;
+    for (auto &r : cmd.redirs) if (r.subst) return true;
+    return false;
+}
+} // namespace
+
+void ExecutorPOSIX::set_group(pid_t pid, pid_t pgid) const {
+    if (m_ctx.job_control) setpgid(pid, pgid);
+}
+
 int ExecutorPOSIX::run(const AST& ast) {
+    reap_process_substs();
     if (!ast.list) return 0;
     return run_list(*ast.list);
 }
@@ -28,6 +85,8 @@ int ExecutorPOSIX::run_list(const ListNode& list) {
     int status = 0;
     for (size_t i=0;i<list.segments.size();++i) {
         status = run_andor(*list.segments[i].and_or);
+        m_ctx.last_status = status;
+        if (unwinding()) break;
     }
     m_ctx.last_status = status;
     return status;
@@ -42,6 +101,7 @@ int ExecutorPOSIX::run_andor(const AndOrNode& node) {
             if (seg.op == "||" && status == 0) return status;
         }
         status = run_pipeline(*seg.pipeline);
+        if (unwinding()) break;
     }
     return status;
 }
@@ -54,39 +114,14 @@ int ExecutorPOSIX::run_pipeline(const PipelineNode& pipeline) {
         return std::visit([&](auto &ptr)->int {
             using T = std::decay_t<decltype(ptr)>;
             if constexpr (std::is_same_v<T, std::unique_ptr<CommandNode>>) {
-                if (ptr->background) {
-                    // Background single command (come prima)
-                    auto &cmd = *ptr;
-                    auto argv_expanded = expand_words(cmd.argv);
-                    if (argv_expanded.empty()) return 0;
-                    if (is_builtin(argv_expanded[0])) {
-                        auto r = run_builtin(argv_expanded);
-                        return r ? r->exit_code : 0;
-                    }
-                    auto exe = resolve_executable(argv_expanded[0]);
-                    if (!exe) { std::cerr << argv_expanded[0] << ": command not found" << '\n'; return 127; }
-                    pid_t pid = fork();
-                    if (pid < 0) { perror("fork"); return 1; }
-                    if (pid == 0) {
-                        std::signal(SIGINT, SIG_IGN);
-                        auto specs = build_redirs(cmd);
-                        if (apply_redirections(specs)!=0) _exit(1);
-                        std::vector<char*> cargv; cargv.reserve(argv_expanded.size()+1);
-                        for (auto &s : argv_expanded) cargv.push_back(const_cast<char*>(s.c_str()));
-                        cargv.push_back(nullptr);
-                        setpgid(0,0);
-                        execvp(cargv[0], cargv.data());
-                        perror("execvp"); _exit(127);
-                    }
-                    setpgid(pid,pid);
-                    m_ctx.jobs.add(pid, argv_expanded[0], true);
-                    std::cout << "[" << pid << "] running in background" << '\n';
-                    return 0;
-                }
+                if (ptr->background) return run_background_command(*ptr);
                 return run_command(*ptr);
             } else if constexpr (std::is_same_v<T, std::unique_ptr<SubshellNode>>) {
                 // Esegui sempre la subshell in un processo separato per coerenza POSIX
                 return run_subshell(*ptr, ptr->background);
+            } else if constexpr (std::is_same_v<T, std::unique_ptr<FunctionDefNode>>) {
+                m_ctx.functions[ptr->name] = ptr->body;
+                return 0;
             }
             return 0;
         }, pipeline.elements[0]);
@@ -119,11 +154,14 @@ int ExecutorPOSIX::run_pipeline(const PipelineNode& pipeline) {
             int rc = std::visit([&](auto &ptr)->int {
                 using T = std::decay_t<decltype(ptr)>;
                 if constexpr (std::is_same_v<T, std::unique_ptr<CommandNode>>) {
-                    return run_command(*ptr);
+                    return run_command(*ptr, i < n-1); // 'cmd > f | next': next still gets the output
                 } else if constexpr (std::is_same_v<T, std::unique_ptr<SubshellNode>>) {
                     // Esecuzione subshell inline: niente fork aggiuntivo, esegue lista e ritorna status
                     if (ptr->list) return run_list(*ptr->list);
                     return 0;
+                } else if constexpr (std::is_same_v<T, std::unique_ptr<FunctionDefNode>>) {
+                    m_ctx.functions[ptr->name] = ptr->body; // visibile solo in questo processo
+                    return 0;
                 }
                 return 0;
             }, pipeline.elements[i]);
@@ -150,14 +188,14 @@ int ExecutorPOSIX::run_pipeline(const PipelineNode& pipeline) {
     int status = 0;
     if (background) {
         // Put all into same process group
-        for (size_t i=0;i<pids.size();++i) setpgid(pids[i], pids[0]);
+        for (size_t i=0;i<pids.size();++i) set_group(pids[i], pids[0]);
         m_ctx.jobs.add(pids[0], "pipeline", true);
         std::cout << "[" << pids[0] << "] pipeline running in background" << '\n';
         // Do not wait
         return 0;
     }
     // Imposta pgid comune
-    for (size_t i=0;i<pids.size();++i) setpgid(pids[i], pids[0]);
+    for (size_t i=0;i<pids.size();++i) set_group(pids[i], pids[0]);
     if (!background) g_foreground_pgid = pids[0];
     for (pid_t pid : pids) {
         int st=0; while (waitpid(pid, &st, 0)<0 && errno==EINTR) {}
@@ -167,16 +205,82 @@ int ExecutorPOSIX::run_pipeline(const PipelineNode& pipeline) {
     return status;
 }
 
+// Background single command; its <(cmd)/>(cmd) children are started in the shell like
+// for run_command, but nothing is waited for: reap_process_substs collects them later.
+int ExecutorPOSIX::run_background_command(const CommandNode& cmd) {
+    if (!has_process_subst(cmd)) return run_background_simple(cmd);
+    ProcessSubst ps;
+    CommandNode resolved = start_process_substs(cmd, ps);
+    int status = run_background_simple(resolved);
+    finish_process_substs(ps, false);
+    return status;
+}
+
+int ExecutorPOSIX::run_background_simple(const CommandNode& cmd) {
+    auto argv_expanded = expand_words(cmd.argv);
+    if (argv_expanded.empty()) return 0;
+    if (m_ctx.functions.count(argv_expanded[0])) {
+        // The only case where a function call forks: 'f &'
+        pid_t pid = fork();
+        if (pid < 0) { perror("fork"); return 1; }
+        if (pid == 0) {
+            std::signal(SIGINT, SIG_IGN);
+            set_group(0,0);
+            int st = run_expanded(cmd, argv_expanded, false); // argv already expanded once
+            std::cout.flush();
+            _exit(st);
+        }
+        set_group(pid,pid);
+        m_ctx.jobs.add(pid, argv_expanded[0], true);
+        std::cout << "[" << pid << "] running in background" << '\n';
+        return 0;
+    }
+    if (is_builtin(argv_expanded[0])) {
+        ScopedEnv prefix;
+        prefix.keep = is_special_builtin(argv_expanded[0]);
+        for (auto &a : cmd.assigns) {
+            auto eq = a.lexeme.find('=');
+            prefix.set(a.lexeme.substr(0, eq), expand_word(a.lexeme.substr(eq+1)));
+        }
+        auto r = run_builtin(argv_expanded);
+        return r ? r->exit_code : 0;
+    }
+    auto exe = resolve_executable(argv_expanded[0]);
+    if (!exe) { std::cerr << argv_expanded[0] << ": command not found" << '\n'; return 127; }
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); return 1; }
+    if (pid == 0) {
+        std::signal(SIGINT, SIG_IGN);
+        set_group(0,0); // before redirections: a multios relay shares the job's group
+        for (auto &a : cmd.assigns) { // VAR=x cmd &: only for the child
+            auto eq = a.lexeme.find('=');
+            std::string value = expand_word(a.lexeme.substr(eq+1));
+            setenv(a.lexeme.substr(0, eq).c_str(), value.c_str(), 1);
+        }
+        auto specs = build_redirs(cmd);
+        if (apply_redirections(specs)!=0) _exit(1);
+        std::vector<char*> cargv; cargv.reserve(argv_expanded.size()+1);
+        for (auto &s : argv_expanded) cargv.push_back(const_cast<char*>(s.c_str()));
+        cargv.push_back(nullptr);
+        execvp(cargv[0], cargv.data());
+        perror("execvp"); _exit(127);
+    }
+    set_group(pid,pid);
+    m_ctx.jobs.add(pid, argv_expanded[0], true);
+    std::cout << "[" << pid << "] running in background" << '\n';
+    return 0;
+}
+
 int ExecutorPOSIX::run_subshell(const SubshellNode& node, bool background) {
     pid_t pid = fork();
     if (pid < 0) { perror("fork"); return 1; }
     if (pid == 0) {
         if (!background) std::signal(SIGINT, SIG_DFL); else std::signal(SIGINT, SIG_IGN);
-        setpgid(0,0);
+        set_group(0,0);
         int st = node.list ? run_list(*node.list) : 0;
         _exit(st);
     }
-    setpgid(pid,pid);
+    set_group(pid,pid);
     if (background) {
         m_ctx.jobs.add(pid, "subshell", true);
         std::cout << "[" << pid << "] subshell running in background" << '\n';
@@ -188,8 +292,9 @@ int ExecutorPOSIX::run_subshell(const SubshellNode& node, bool background) {
     return status;
 }
 
-std::vector<RedirSpec> ExecutorPOSIX::build_redirs(const CommandNode& cmd) {
+std::vector<RedirSpec> ExecutorPOSIX::build_redirs(const CommandNode& cmd, bool pipe_out) {
     std::vector<RedirSpec> specs;
+    bool stdout_redirected = false;
     for (auto &r : cmd.redirs) {
         RedirSpec s; s.target = r.target;
         switch (r.type) {
@@ -198,36 +303,172 @@ std::vector<RedirSpec> ExecutorPOSIX::build_redirs(const CommandNode& cmd) {
             case RedirNode::Type::In: s.type = RedirType::In; break;
             case RedirNode::Type::Err: s.type = RedirType::Err; break;
             case RedirNode::Type::ErrToOut: s.type = RedirType::ErrToOut; break;
+            case RedirNode::Type::HereDoc:
+                s.type = RedirType::HereDoc;
+                if (!r.literal) s.target = expand_text(r.target);
+                break;
+            case RedirNode::Type::HereString: s.type = RedirType::HereString; s.target = expand_word(r.target); break;
         }
+        if (s.type == RedirType::Out || s.type == RedirType::OutAppend) stdout_redirected = true;
         specs.push_back(s);
     }
+    // Multios: the pipe to the next pipeline stage stays one of the stdout targets.
+    if (pipe_out && stdout_redirected) {
+        RedirSpec keep; keep.type = RedirType::Keep; keep.source_fd = STDOUT_FILENO;
+        specs.push_back(keep);
+    }
     return specs;
 }
 
-int ExecutorPOSIX::run_command(const CommandNode& cmd) {
+int ExecutorPOSIX::run_function(std::shared_ptr<const ListNode> body, const std::vector<std::string>& argv) {
+    if (m_ctx.frames.size() >= kMaxFunctionDepth) {
+        std::cerr << argv[0] << ": maximum function nesting level exceeded" << '\n';
+        return 1;
+    }
+    CallFrame frame; frame.args.assign(argv.begin()+1, argv.end());
+    m_ctx.frames.push_back(std::move(frame));
+    g_positional_params = &m_ctx.frames.back().args;
+    // 'body' is held by value: the function may redefine or unset itself while running.
+    int status = body ? run_list(*body) : 0;
+    CallFrame& done = m_ctx.frames.back();
+    if (done.returning) status = done.return_status;
+    for (auto it = done.saved_vars.rbegin(); it != done.saved_vars.rend(); ++it) {
+        if (it->second) setenv(it->first.c_str(), it->second->c_str(), 1);
+        else unsetenv(it->first.c_str());
+    }
+    m_ctx.frames.pop_back();
+    g_positional_params = m_ctx.frames.empty() ? nullptr : &m_ctx.frames.back().args;
+    return status;
+}
+
+int ExecutorPOSIX::run_command(const CommandNode& cmd, bool pipe_out) {
+    if (!has_process_subst(cmd)) return run_simple_command(cmd, pipe_out);
+    ProcessSubst ps;
+    CommandNode resolved = start_process_substs(cmd, ps);
+    int status = run_simple_command(resolved, pipe_out);
+    finish_process_substs(ps);
+    return status;
+}
+
+CommandNode ExecutorPOSIX::start_process_substs(const CommandNode& cmd, ProcessSubst& ps) {
+    CommandNode out = cmd;
+    for (std::size_t i : out.substs) out.argv[i] = start_process_subst(out.argv[i], ps);
+    out.substs.clear();
+    for (auto &r : out.redirs) {
+        if (r.type != RedirNode::Type::HereDoc && r.type != RedirNode::Type::HereString && r.subst) {
+            r.target = start_process_subst(r.target, ps);
+            r.subst = false;
+        }
+    }
+    return out;
+}
+
+// Runs the list between the parentheses in a child connected by a pipe; the shell keeps
+// its end open (no CLOEXEC) so the command inherits it and can open it as /dev/fd/N.
+std::string ExecutorPOSIX::start_process_subst(const std::string& word, ProcessSubst& ps) {
+    bool input = word[0] == '<'; // <(cmd): the command reads what the child writes
+    int p[2];
+    if (pipe(p) != 0) { perror("pipe"); return word; }
+    std::cout.flush(); std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); close(p[0]); close(p[1]); return word; }
+    if (pid == 0) {
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGPIPE, SIG_DFL);
+        set_group(0,0);
+        dup2(input ? p[1] : p[0], input ? STDOUT_FILENO : STDIN_FILENO);
+        close(p[0]); close(p[1]);
+        for (int fd : ps.fds) close(fd); // ends of sibling substitutions
+        Lexer lx(word.substr(2, word.size()-3));
+        auto ts = lx.run();
+        AST ast = parse_tokens(ts);
+        int st = ast.list ? run_list(*ast.list) : 0;
+        std::cout.flush(); std::fflush(stdout);
+        _exit(st);
+    }
+    set_group(pid,pid);
+    int keep = input ? p[0] : p[1];
+    close(input ? p[1] : p[0]);
+    ps.fds.push_back(keep);
+    (input ? ps.pids : ps.readers).push_back(pid);
+    m_ctx.jobs.add(pid, word, false);
+    return "/dev/fd/" + std::to_string(keep);
+}
+
+// The consumer has exited: closing the shell ends delivers EOF to >(cmd) readers and
+// SIGPIPE to <(cmd) writers nobody read. Writers are reaped here; readers may still be
+// draining (echo x > >(sleep 3; cat)) and, as in bash, the next command does not wait.
+void ExecutorPOSIX::finish_process_substs(ProcessSubst& ps, bool wait) {
+    for (int fd : ps.fds) close(fd);
+    for (pid_t pid : ps.pids) {
+        if (!wait) { m_ctx.substs.push_back(pid); continue; }
+        int st=0; while (waitpid(pid,&st,0)<0 && errno==EINTR) {}
+        m_ctx.jobs.remove_pgid(pid);
+    }
+    m_ctx.substs.insert(m_ctx.substs.end(), ps.readers.begin(), ps.readers.end());
+    ps.fds.clear(); ps.pids.clear(); ps.readers.clear();
+    reap_process_substs();
+}
+
+// Non-blocking: children still running stay listed (and in the job table) until a later command.
+void ExecutorPOSIX::reap_process_substs() {
+    auto &v = m_ctx.substs;
+    v.erase(std::remove_if(v.begin(), v.end(), [&](pid_t pid){
+        int st=0; pid_t r = waitpid(pid, &st, WNOHANG);
+        if (r == 0 || (r < 0 && errno == EINTR)) return false;
+        m_ctx.jobs.remove_pgid(pid); // r < 0: already collected by 'jobs'
+        return true;
+    }), v.end());
+}
+
+int ExecutorPOSIX::run_simple_command(const CommandNode& cmd, bool pipe_out) {
     // Expand argv words
     auto argv_expanded = expand_words(cmd.argv);
-    if (argv_expanded.empty()) return 0;
+    if (argv_expanded.empty()) {
+        // Bare assignments (X=1): set the variable in the shell itself
+        for (auto &a : cmd.assigns) {
+            auto eq = a.lexeme.find('=');
+            std::string value = expand_word(a.lexeme.substr(eq+1));
+            setenv(a.lexeme.substr(0, eq).c_str(), value.c_str(), 1);
+        }
+        return 0;
+    }
+    return run_expanded(cmd, argv_expanded, pipe_out);
+}
+
+int ExecutorPOSIX::run_expanded(const CommandNode& cmd, const std::vector<std::string>& argv_expanded, bool pipe_out) {
+    auto fn = m_ctx.functions.find(argv_expanded[0]);
+    ScopedEnv prefix;
+    prefix.keep = fn == m_ctx.functions.end() && is_special_builtin(argv_expanded[0]);
+    if (fn != m_ctx.functions.end() || is_builtin(argv_expanded[0])) {
+        for (auto &a : cmd.assigns) {
+            auto eq = a.lexeme.find('=');
+            prefix.set(a.lexeme.substr(0, eq), expand_word(a.lexeme.substr(eq+1)));
+        }
+    }
+    // Shell function? Runs in-process; only its redirections touch the fds.
+    if (fn != m_ctx.functions.end()) {
+        SavedStdio saved;
+        auto specs = build_redirs(cmd, pipe_out);
+        if (!specs.empty()) {
+            saved.save();
+            if (apply_redirections(specs, &saved.relays)!=0) return 1;
+        }
+        return run_function(fn->second, argv_expanded);
+    }
     // Built-in?
     if (is_builtin(argv_expanded[0])) {
         // Apply redirections in subscope (dup fds) then restore
-        int saved_stdin=-1, saved_stdout=-1, saved_stderr=-1;
-        auto specs = build_redirs(cmd);
-        if (!specs.empty()) {
-            saved_stdin = dup(STDIN_FILENO);
-            saved_stdout = dup(STDOUT_FILENO);
-            saved_stderr = dup(STDERR_FILENO);
-            if (apply_redirections(specs)!=0) {
-                if (saved_stdin!=-1) { dup2(saved_stdin, STDIN_FILENO); close(saved_stdin);} 
-                if (saved_stdout!=-1) { dup2(saved_stdout, STDOUT_FILENO); close(saved_stdout);} 
-                if (saved_stderr!=-1) { dup2(saved_stderr, STDERR_FILENO); close(saved_stderr);} 
-                return 1;
+        std::optional<BuiltinResult> r;
+        {
+            SavedStdio saved;
+            auto specs = build_redirs(cmd, pipe_out);
+            if (!specs.empty()) {
+                saved.save();
+                if (apply_redirections(specs, &saved.relays)!=0) return 1;
             }
+            r = run_builtin(argv_expanded, &m_ctx);
         }
-    auto r = run_builtin(argv_expanded, &m_ctx);
-        if (saved_stdin!=-1) { dup2(saved_stdin, STDIN_FILENO); close(saved_stdin);} 
-        if (saved_stdout!=-1) { dup2(saved_stdout, STDOUT_FILENO); close(saved_stdout);} 
-        if (saved_stderr!=-1) { dup2(saved_stderr, STDERR_FILENO); close(saved_stderr);} 
         if (r && r->should_exit) std::exit(r->exit_code);
         return r ? r->exit_code : 0;
     }
@@ -238,7 +479,12 @@ int ExecutorPOSIX::run_command(const CommandNode& cmd) {
     if (pid < 0) { perror("fork"); return 1; }
     if (pid == 0) {
         std::signal(SIGINT, SIG_DFL);
-        auto specs = build_redirs(cmd);
+        for (auto &a : cmd.assigns) { // VAR=x cmd: only for the child
+            auto eq = a.lexeme.find('=');
+            std::string value = expand_word(a.lexeme.substr(eq+1));
+            setenv(a.lexeme.substr(0, eq).c_str(), value.c_str(), 1);
+        }
+        auto specs = build_redirs(cmd, pipe_out);
         if (apply_redirections(specs)!=0) _exit(1);
         // Build cargv
         std::vector<char*> cargv; cargv.reserve(argv_expanded.size()+1);
@@ -6,6 +6,7 @@
 #include <ai-autoshell/exec/job.hpp>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
 
 namespace autoshell {
 
@@ -59,4 +60,8 @@ void JobTable::mark_finished_pgid(pid_t pgid) {
     for (auto &j : m_jobs) if (j.pgid == pgid) { j.running = false; break; }
 }
 
+void JobTable::remove_pgid(pid_t pgid) {
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), [&](const Job& j){ return j.pgid == pgid; }), m_jobs.end());
+}
+
 } // namespace autoshell
@@ -7,7 +7,16 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <climits>
+#include <string_view>
 #include <cstdio>
+#include <cerrno>
+#include <csignal>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 namespace autoshell {
 
@@ -16,32 +25,212 @@ static int dup_to(int fd, int target) {
     return 0;
 }
 
-int apply_redirections(const std::vector<RedirSpec>& specs) {
+static int write_all(int fd, std::string_view text) {
+    size_t off = 0;
+    while (off < text.size()) {
+        ssize_t n = ::write(fd, text.data()+off, text.size()-off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        off += static_cast<size_t>(n);
+    }
+    return 0;
+}
+
+// Pipe fallback: small texts fit in the pipe buffer and are written directly, larger ones
+// are fed by a detached grandchild (double fork, nothing left to reap) so the reader can
+// consume while it is being written.
+static int open_text_pipe(const std::string& text) {
+    int p[2];
+    if (pipe(p) != 0) { perror("pipe"); return -1; }
+    if (text.size() <= PIPE_BUF) {
+        int rc = write_all(p[1], text);
+        ::close(p[1]);
+        if (rc != 0) { perror("write"); ::close(p[0]); return -1; }
+        return p[0];
+    }
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); ::close(p[0]); ::close(p[1]); return -1; }
+    if (pid == 0) {
+        ::close(p[0]);
+        if (fork() == 0) { signal(SIGPIPE, SIG_DFL); write_all(p[1], text); _exit(0); }
+        _exit(0);
+    }
+    ::close(p[1]);
+    int st = 0; while (waitpid(pid, &st, 0) < 0 && errno == EINTR) {}
+    return p[0];
+}
+
+// Here-doc / here-string content as a read-only descriptor, no disk I/O: an anonymous
+// sealed memfd (seekable like a file, nothing to clean up) where available, else a pipe.
+static int open_text_fd(const std::string& text) {
+#ifdef __linux__
+    int fd = memfd_create("ai-autoshell-heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd >= 0) {
+        if (write_all(fd, text) != 0 || lseek(fd, 0, SEEK_SET) != 0) { perror("memfd"); ::close(fd); return -1; }
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+        return fd;
+    }
+#endif
+    return open_text_pipe(text);
+}
+
+namespace {
+
+constexpr size_t kRelayChunk = 1 << 16; // one pipe buffer per round
+
+struct RelayOut {
+    int fd;
+    int scratch[2] = {-1, -1}; // private pipe receiving the tee'd copy
+    bool use_splice = true;
+    bool dead = false;         // write failed (e.g. EPIPE): keep draining, stop writing
+};
+
+// Moves exactly 'len' bytes already sitting in pipe 'from' to the target: splice() when the
+// target accepts it (files opened O_APPEND may not), otherwise read/write.
+bool move_bytes(int from, RelayOut& out, size_t len) {
+    static char buf[kRelayChunk];
+    while (len > 0) {
+#ifdef __linux__
+        if (!out.dead && out.use_splice) {
+            ssize_t n = splice(from, nullptr, out.fd, nullptr, len, SPLICE_F_MOVE);
+            if (n > 0) { len -= static_cast<size_t>(n); continue; }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS)) { out.use_splice = false; continue; }
+            if (n == 0) return false;
+            out.dead = true; // EPIPE, ENOSPC...: drain below
+        }
+#endif
+        ssize_t n = ::read(from, buf, std::min(len, sizeof(buf)));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        if (!out.dead && write_all(out.fd, std::string_view(buf, static_cast<size_t>(n))) != 0) out.dead = true;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Copies everything arriving on 'in' to every target until EOF (or until no target is
+// left). On Linux each round tee()s the pipe content into one scratch pipe per extra target
+// and splices it out, and splices the original to the last target: no user-space copy.
+void run_relay(int in, const std::vector<int>& targets) {
+    std::signal(SIGPIPE, SIG_IGN); // a closed reader only drops that target
+    std::signal(SIGINT, SIG_IGN);  // the command decides; the relay flushes what it wrote
+    std::vector<RelayOut> outs;
+    for (int fd : targets) outs.push_back(RelayOut{fd});
+    bool zero_copy = false;
+#ifdef __linux__
+    zero_copy = true;
+    for (size_t k = 0; k + 1 < outs.size(); ++k) if (pipe(outs[k].scratch) != 0) zero_copy = false;
+#endif
+    auto all_dead = [&]{ return std::all_of(outs.begin(), outs.end(), [](const RelayOut& o){ return o.dead; }); };
+    while (!all_dead()) {
+#ifdef __linux__
+        if (zero_copy) {
+            ssize_t len = tee(in, outs[0].scratch[1], kRelayChunk, 0);
+            if (len < 0 && errno == EINTR) continue;
+            if (len < 0) { zero_copy = false; continue; }
+            if (len == 0) break; // EOF
+            size_t n = static_cast<size_t>(len);
+            for (size_t k = 1; k + 1 < outs.size(); ++k) {
+                ssize_t t;
+                do { t = tee(in, outs[k].scratch[1], n, 0); } while (t < 0 && errno == EINTR);
+                // scratch pipes are empty and as large as the chunk: a short tee means a broken relay
+                if (t != len) { if (t > 0) move_bytes(outs[k].scratch[0], outs[k], static_cast<size_t>(t)); outs[k].dead = true; }
+                else if (!move_bytes(outs[k].scratch[0], outs[k], n)) outs[k].dead = true;
+            }
+            if (!move_bytes(outs[0].scratch[0], outs[0], n)) outs[0].dead = true;
+            if (!move_bytes(in, outs.back(), n)) break;
+            continue;
+        }
+#endif
+        static char buf[kRelayChunk];
+        ssize_t n = ::read(in, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (auto &o : outs) {
+            if (!o.dead && write_all(o.fd, std::string_view(buf, static_cast<size_t>(n))) != 0) o.dead = true;
+        }
+    }
+    ::close(in);
+    for (auto &o : outs) { ::close(o.fd); if (o.scratch[0] != -1) { ::close(o.scratch[0]); ::close(o.scratch[1]); } }
+}
+
+// Several outputs for one descriptor (zsh multios): 'target' becomes a pipe drained by a
+// relay. For a command about to exec (relays == nullptr) the current process becomes the
+// relay and the command continues in a child, so whoever waits for this pid also waits for
+// the last byte to reach every target. In-process commands get a relay child instead.
+int start_relay(int target, std::vector<int>& outs, MultiosRelays* relays) {
+    int p[2];
+    if (pipe(p) != 0) { perror("pipe"); return -1; }
+    std::fflush(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); ::close(p[0]); ::close(p[1]); return -1; }
+    bool relay_side = relays ? pid == 0 : pid > 0;
+    if (relay_side) {
+        ::close(p[1]);
+        run_relay(p[0], outs);
+        int code = 0;
+        if (!relays) {
+            int st = 0; while (waitpid(pid, &st, 0) < 0 && errno == EINTR) {}
+            code = WIFEXITED(st) ? WEXITSTATUS(st) : WIFSIGNALED(st) ? 128 + WTERMSIG(st) : 1;
+        }
+        _exit(code);
+    }
+    if (relays) relays->pids.push_back(pid);
+    ::close(p[0]);
+    for (int fd : outs) ::close(fd);
+    outs.clear();
+    int rc = dup_to(p[1], target);
+    ::close(p[1]);
+    return rc;
+}
+
+} // namespace
+
+int apply_redirections(const std::vector<RedirSpec>& specs, MultiosRelays* relays) {
+    // Open every target first, grouped by the descriptor it replaces (0, 1, 2).
+    std::vector<int> targets[3];
+    auto fail = [&]{ for (auto &t : targets) for (int fd : t) ::close(fd); return -1; };
     for (auto &r : specs) {
-        int fd = -1;
+        int fd = -1, to = STDOUT_FILENO;
         switch (r.type) {
             case RedirType::Out:
                 fd = ::open(r.target.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0644); break;
             case RedirType::OutAppend:
                 fd = ::open(r.target.c_str(), O_CREAT|O_WRONLY|O_APPEND, 0644); break;
             case RedirType::In:
-                fd = ::open(r.target.c_str(), O_RDONLY); break;
+                fd = ::open(r.target.c_str(), O_RDONLY); to = STDIN_FILENO; break;
             case RedirType::Err:
-                fd = ::open(r.target.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0644); break;
+                fd = ::open(r.target.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0644); to = STDERR_FILENO; break;
+            case RedirType::HereDoc:
+                fd = open_text_fd(r.target); to = STDIN_FILENO; break;
+            case RedirType::HereString:
+                fd = open_text_fd(r.target + "\n"); to = STDIN_FILENO; break;
+            case RedirType::Keep:
+                fd = dup(r.source_fd); break;
             case RedirType::ErrToOut:
-                // handle after loop? Simplify: create a pipe by duplicating stdout later.
-                // We'll implement by marking special; continue.
-                continue;
+                continue; // after the others, see below
         }
-        if (fd < 0) { perror("open"); return -1; }
-        if (r.type == RedirType::In) {
-            if (dup_to(fd, STDIN_FILENO) != 0) { ::close(fd); return -1; }
-        } else if (r.type == RedirType::Err) {
-            if (dup_to(fd, STDERR_FILENO) != 0) { ::close(fd); return -1; }
-        } else { // Out / OutAppend
-            if (dup_to(fd, STDOUT_FILENO) != 0) { ::close(fd); return -1; }
+        if (fd < 0) {
+            if (r.type != RedirType::HereDoc && r.type != RedirType::HereString) perror("open"); // text fds report their own error
+            return fail();
         }
-        ::close(fd);
+        targets[to].push_back(fd);
+    }
+    // stdin: the last source wins
+    if (!targets[0].empty()) {
+        int rc = dup_to(targets[0].back(), STDIN_FILENO);
+        for (int fd : targets[0]) ::close(fd);
+        targets[0].clear();
+        if (rc != 0) return fail();
+    }
+    for (int to : {STDOUT_FILENO, STDERR_FILENO}) {
+        auto &t = targets[to];
+        if (t.size() > 1) { if (start_relay(to, t, relays) != 0) return fail(); continue; }
+        if (t.empty()) continue;
+        int rc = dup_to(t[0], to);
+        ::close(t[0]); t.clear();
+        if (rc != 0) return fail();
     }
     // Second pass for ErrToOut
     for (auto &r : specs) {
@@ -52,4 +241,9 @@ int apply_redirections(const std::vector<RedirSpec>& specs) {
     return 0;
 }
 
+void wait_multios(MultiosRelays& relays) {
+    for (pid_t pid : relays.pids) { int st = 0; while (waitpid(pid, &st, 0) < 0 && errno == EINTR) {} }
+    relays.pids.clear();
+}
+
 } // namespace autoshell
@@ -20,6 +20,21 @@
 
 namespace autoshell {
 
+const std::vector<std::string>* g_positional_params = nullptr;
+
+static std::string positional_param(size_t n) {
+    if (n == 0) return "ai-autoshell";
+    if (!g_positional_params || n > g_positional_params->size()) return std::string();
+    return (*g_positional_params)[n-1];
+}
+
+static std::string positional_joined() {
+    std::string out;
+    if (!g_positional_params) return out;
+    for (size_t i=0;i<g_positional_params->size();++i) { if (i) out.push_back(' '); out += (*g_positional_params)[i]; }
+    return out;
+}
+
 static std::string getenv_or(const std::string& key) {
     const char* v = std::getenv(key.c_str());
     return v ? std::string(v) : std::string();
@@ -44,11 +59,25 @@ static std::string expand_env_vars(const std::string& in) {
                 size_t end = in.find('}', i+2);
                 if (end != std::string::npos) {
                     std::string key = in.substr(i+2, end-(i+2));
-                    out += getenv_or(key);
+                    if (!key.empty() && std::all_of(key.begin(), key.end(), [](unsigned char c){ return std::isdigit(c); }))
+                        out += positional_param(std::stoul(key));
+                    else out += getenv_or(key);
                     i = end+1; continue;
                 }
             }
             size_t j=i+1;
+            if (j < in.size() && std::isdigit(static_cast<unsigned char>(in[j]))) { // $0..$9
+                out += positional_param(static_cast<size_t>(in[j]-'0'));
+                i=j+1; continue;
+            }
+            if (j < in.size() && in[j]=='#') {
+                out += std::to_string(g_positional_params ? g_positional_params->size() : 0);
+                i=j+1; continue;
+            }
+            if (j < in.size() && (in[j]=='@' || in[j]=='*')) {
+                out += positional_joined();
+                i=j+1; continue;
+            }
             if (j < in.size() && (std::isalpha(static_cast<unsigned char>(in[j])) || in[j]=='_')) {
                 ++j; while (j<in.size() && (std::isalnum(static_cast<unsigned char>(in[j])) || in[j]=='_')) ++j;
                 std::string key = in.substr(i+1, j-(i+1));
@@ -145,9 +174,47 @@ std::string expand_word(const std::string& in) {
     return tmp;
 }
 
+// Replaces every $(...) (parentheses balanced) with the command output.
+static std::string substitute_all(const std::string& in) {
+    std::string out;
+    size_t i = 0;
+    while (i < in.size()) {
+        size_t pos = in.find("$(", i);
+        if (pos == std::string::npos) break;
+        size_t j = pos+2; int depth = 1;
+        while (j < in.size() && depth > 0) { if (in[j]=='(') ++depth; else if (in[j]==')') --depth; ++j; }
+        if (depth > 0) break; // unbalanced: keep the rest literally
+        out.append(in, i, pos-i);
+        out += command_substitute(in.substr(pos+2, j-1-(pos+2)));
+        i = j;
+    }
+    out.append(in, i, std::string::npos);
+    return out;
+}
+
+std::string expand_text(const std::string& in) {
+    std::string out, run;
+    auto flush = [&]{ if (!run.empty()) { out += substitute_all(expand_env_vars(run)); run.clear(); } };
+    for (size_t i=0;i<in.size();++i) {
+        if (in[i]=='\\' && i+1 < in.size() && (in[i+1]=='$' || in[i+1]=='\\' || in[i+1]=='`' || in[i+1]=='\n')) {
+            flush();
+            if (in[i+1] != '\n') out.push_back(in[i+1]);
+            ++i; continue;
+        }
+        run.push_back(in[i]);
+    }
+    flush();
+    return out;
+}
+
 std::vector<std::string> expand_words(const std::vector<std::string>& words) {
     std::vector<std::string> out; out.reserve(words.size());
     for (auto &w : words) {
+        // "$@" on its own keeps one word per positional parameter
+        if (w == "$@") {
+            if (g_positional_params) out.insert(out.end(), g_positional_params->begin(), g_positional_params->end());
+            continue;
+        }
         std::string base = expand_word(w);
     // Simple brace expansion {1..5} and {a,b,c}
         auto brace_pos = base.find('{');
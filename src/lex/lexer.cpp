@@ -12,6 +12,7 @@
  *              assignments, redirections). See header for details.
  */
 #include <cctype>
+#include <string_view>
 #include <ai-autoshell/lex/lexer.hpp>
 
 namespace autoshell {
@@ -22,7 +23,15 @@ char Lexer::peek() const { return eof() ? '\0' : m_input[m_pos]; }
 char Lexer::get() { return eof() ? '\0' : m_input[m_pos++]; }
 bool Lexer::eof() const { return m_pos >= m_input.size(); }
 
-void Lexer::skip_space() { while (!eof() && std::isspace(static_cast<unsigned char>(peek()))) get(); }
+// Newlines are tokens (command separators); backslash + newline is a line continuation.
+void Lexer::skip_space() {
+    while (!eof()) {
+        char c = peek();
+        if (c=='\\' && m_pos+1 < m_input.size() && m_input[m_pos+1]=='\n') { m_pos+=2; continue; }
+        if (c=='\n' || !std::isspace(static_cast<unsigned char>(c))) break;
+        get();
+    }
+}
 
 bool Lexer::is_name_start(char c) const { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; }
 bool Lexer::is_name_char(char c) const { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
@@ -37,7 +46,14 @@ Token Lexer::lex_operator() {
     case '(': return {TokenKind::LeftParen, "(", start};
     case ')': return {TokenKind::RightParen, ")", start};
         case '>': if (peek() == '>') { get(); return {TokenKind::RedirOutAppend, ">>", start}; } return {TokenKind::RedirOut, ">", start};
-        case '<': return {TokenKind::RedirIn, "<", start};
+        case '<':
+            if (peek() == '<') {
+                get();
+                if (peek() == '<') { get(); return {TokenKind::RedirHereString, "<<<", start}; }
+                if (peek() == '-') { get(); return {TokenKind::RedirHeredocStrip, "<<-", start}; }
+                return {TokenKind::RedirHeredoc, "<<", start};
+            }
+            return {TokenKind::RedirIn, "<", start};
         case '2':
             if (peek() == '>') {
                 get();
@@ -55,14 +71,30 @@ Token Lexer::lex_operator() {
 
 Token Lexer::lex_word() {
     std::size_t start = m_pos; std::string out; bool in_single=false, in_double=false;
+    std::size_t subst_len = 0; // length of a leading unquoted <(...) / >(...)
+    m_word_quoted = false;
     while (!eof()) {
         char c = peek();
         if (!in_single && !in_double) {
             if (std::isspace(static_cast<unsigned char>(c))) break;
-            if (c=='|'||c=='&'||c==';'||c=='>'||c=='<'|| (c=='2' && m_pos+1 < m_input.size() && m_input[m_pos+1]=='>')) break;
-            if (c=='\'') { in_single=true; get(); continue; }
-            if (c=='"') { in_double=true; get(); continue; }
-            if (c=='\\') { get(); if(!eof()) out.push_back(get()); continue; }
+            // Process substitution <( ... ) / >( ... ) at word start: kept verbatim, parentheses balanced
+            if ((c=='<'||c=='>') && m_pos==start && m_pos+1 < m_input.size() && m_input[m_pos+1]=='(') {
+                out.push_back(c); out.push_back('('); m_pos+=2;
+                int depth=1; char q=0;
+                while (!eof() && depth>0) {
+                    char d = get(); out.push_back(d);
+                    if (q) { if (d==q) q=0; continue; }
+                    if (d=='\''||d=='"') q=d;
+                    else if (d=='(') depth++;
+                    else if (d==')') depth--;
+                }
+                if (depth==0) subst_len = out.size();
+                continue;
+            }
+            if (c=='|'||c=='&'||c==';'||c=='>'||c=='<'||c=='('||c==')'|| (c=='2' && m_pos+1 < m_input.size() && m_input[m_pos+1]=='>')) break;
+            if (c=='\'') { in_single=true; m_word_quoted=true; get(); continue; }
+            if (c=='"') { in_double=true; m_word_quoted=true; get(); continue; }
+            if (c=='\\') { m_word_quoted=true; get(); if(!eof()) { char n=get(); if (n!='\n') out.push_back(n); } continue; }
                 // Handle command substitution $( ... ) as single token (no nesting)
                 if (c=='$' && m_pos+1 < m_input.size() && m_input[m_pos+1]=='(') {
                     out.push_back('$'); out.push_back('('); m_pos+=2; // consume '$('
@@ -79,11 +111,12 @@ Token Lexer::lex_word() {
             get(); if (c=='\'') { in_single=false; continue; } out.push_back(c);
         } else if (in_double) {
             get(); if (c=='"') { in_double=false; continue; }
-            if (c=='\\' && !eof()) { char n=peek(); if (n=='"'||n=='\\'||n=='$') { out.push_back(n); get(); continue; }}
+            if (c=='\\' && !eof()) { char n=peek(); if (n=='"'||n=='\\'||n=='$') { out.push_back(n); get(); continue; } if (n=='\n') { get(); continue; } }
             out.push_back(c);
         }
     }
     Token t{TokenKind::Word, out, start};
+    t.subst = subst_len > 0 && subst_len == out.size(); // '<(a)b' and '"<(a)"' stay plain words
     if (m_opts.enable_assign_detection) t = try_assign(t);
     return t;
 }
@@ -97,14 +130,51 @@ Token Lexer::try_assign(const Token& word) {
 
 Token Lexer::next() {
     skip_space(); if (eof()) return {TokenKind::Eof, "", m_pos};
-    char c = peek(); if (c=='|'||c=='&'||c==';'||c=='>'||c=='<'||c=='('||c==')'||c=='2') return lex_operator();
+    char c = peek();
+    if (c=='#') { // comment up to end of line (the newline stays a separator)
+        while (!eof() && peek()!='\n') get();
+        if (eof()) return {TokenKind::Eof, "", m_pos};
+        c = peek();
+    }
+    if ((c=='<'||c=='>') && m_pos+1 < m_input.size() && m_input[m_pos+1]=='(') return lex_word(); // <(cmd) >(cmd)
+    if (c=='\n') { get(); return {TokenKind::Newline, "\n", m_pos-1}; } if (c=='|'||c=='&'||c==';'||c=='>'||c=='<'||c=='('||c==')'||c=='2') return lex_operator();
     return lex_word();
 }
 
 TokenStream Lexer::run() {
-    TokenStream ts; while (true) { Token t = next(); ts.push_back(t); if (t.kind==TokenKind::Eof) break; }
+    TokenStream ts;
+    while (true) {
+        Token t = next();
+        if (t.kind==TokenKind::Word && !ts.empty() &&
+            (ts.back().kind==TokenKind::RedirHeredoc || ts.back().kind==TokenKind::RedirHeredocStrip)) {
+            m_heredocs.push_back({ts.size(), t.lexeme, ts.back().kind==TokenKind::RedirHeredocStrip, m_word_quoted});
+        }
+        ts.push_back(t);
+        if ((t.kind==TokenKind::Newline || t.kind==TokenKind::Eof) && !m_heredocs.empty()) read_heredoc_bodies(ts);
+        if (t.kind==TokenKind::Eof) break;
+    }
     return ts;
 }
 
+// Reads the bodies of the here-docs opened on the line just ended, in order. The delimiter
+// token is replaced by the body text; a missing delimiter ends the body at end of input.
+void Lexer::read_heredoc_bodies(TokenStream& ts) {
+    for (auto &h : m_heredocs) {
+        std::string body;
+        while (!eof()) {
+            std::size_t eol = m_input.find('\n', m_pos);
+            std::size_t end = eol==std::string::npos ? m_input.size() : eol;
+            std::string_view line(m_input.data()+m_pos, end-m_pos);
+            m_pos = eol==std::string::npos ? end : eol+1;
+            if (h.strip) while (!line.empty() && line.front()=='\t') line.remove_prefix(1);
+            if (line == h.delim) break;
+            body.append(line); body.push_back('\n');
+        }
+        ts[h.token].lexeme = std::move(body);
+        ts[h.token].quoted = h.quoted;
+    }
+    m_heredocs.clear();
+}
+
 } // namespace autoshell
 
@@ -8,6 +8,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <cstdio>
 #include <iostream>
 #include <algorithm>
@@ -37,6 +38,11 @@ int LineEditor::read_key() {
     unsigned char c; if (read(STDIN_FILENO, &c, 1) != 1) return -1; return c;
 }
 
+bool LineEditor::wait_key(int timeout_ms) {
+    struct pollfd p{STDIN_FILENO, POLLIN, 0};
+    return poll(&p, 1, timeout_ms) != 0; // anche errore/EINTR: lo gestisce read_key
+}
+
 void LineEditor::write(const std::string& s) { ::write(STDOUT_FILENO, s.c_str(), s.size()); }
 
 std::string LineEditor::read_line(const std::string& prompt,
@@ -46,7 +52,13 @@ std::string LineEditor::read_line(const std::string& prompt,
     write(prompt);
     std::string buf; size_t hist_index = history.size(); // one past last
     bool last_was_tab = false;
+    std::string seen; bool idle_due = false; // testo gia' notificato; on_idle ancora da chiamare per esso
     while (true) {
+        if (buf != seen) { seen = buf; idle_due = true; if (comp.on_change) comp.on_change(buf); }
+        if (idle_due && comp.on_idle && comp.idle_ms > 0 && !wait_key(comp.idle_ms)) {
+            idle_due = false; comp.on_idle(buf);
+            continue;
+        }
         int k = read_key();
         if (k == -1) { disable_raw(); return ""; }
         if (k == '\n') { write("\n"); disable_raw(); return buf; }
@@ -7,8 +7,22 @@
 #include <ai-autoshell/exec/executor_posix.hpp>
 #include <ai-autoshell/line/line_editor.hpp>
 #include <ai-autoshell/ai/llm.hpp>
-#include <ai-autoshell/ai/planner.hpp> // only for Plan/PlanStep structs and to_json; no rule usage
+#include <ai-autoshell/ai/http.hpp>
+#include <ai-autoshell/ai/planner.hpp> // Plan/PlanStep, to_json and the local rule tier
 #include <ai-autoshell/ai/json_plan.hpp>
+#include <ai-autoshell/ai/plan_cache.hpp>
+#include <ai-autoshell/ai/plan_template.hpp>
+#include <ai-autoshell/ai/llm_module.hpp>
+#include <ai-autoshell/ai/telemetry.hpp>
+#include <ai-autoshell/ai/plan_dag.hpp>
+#include <ai-autoshell/ai/plan_preflight.hpp>
+#include <ai-autoshell/ai/plan_journal.hpp>
+#include <ai-autoshell/ai/step_state.hpp>
+#include <ai-autoshell/ai/prompt.hpp>
+#include <ai-autoshell/ai/plan_batch.hpp>
+#include <ai-autoshell/ai/plan_prefetch.hpp>
+#include <ai-autoshell/exec/builtins.hpp>
+#include <ai-autoshell/exec/path.hpp>
 
 #include <algorithm>
 #include <csignal>
@@ -23,6 +37,7 @@
 #include <vector>
 #include <cctype>
 #include <cstdio>
+#include <ctime>
 #include <iomanip>
 #ifndef _WIN32
 #include <sys/utsname.h>
@@ -31,8 +46,10 @@
 #include <windows.h>
 #endif
 #include <thread>
+#include <future>
 #include <atomic>
 #include <chrono>
+#include <mutex>
 #include <regex>
 namespace fs = std::filesystem;
 
@@ -49,6 +66,14 @@ struct ShellConfig {
     bool ai_enabled = false;
     bool ai_debug = false; // show full JSON and details only if true
     std::string planner_mode = "suggest"; // suggest|auto
+    int ai_max_parallel = 4; // plan steps running at once (depends_on/parallel plans)
+    bool ai_preflight = true; // parse/resolve/check every step before running any
+    bool ai_context = true; // files in cwd, recent commands and last exit status in the plan prompt
+    int ai_context_tokens = 1000; // budget of the context sections (estimated tokens)
+    bool ai_prefetch = false; // plan `ai suggest|auto` requests in the background while they are typed
+    int ai_prefetch_idle_ms = 600; // typing pause before a prefetch
+    int ai_prefetch_max_requests = 20; // speculative LLM calls per session
+    double ai_prefetch_max_cost = 0.05; // USD per session spent on prefetches (with pricing set; 0 = calls cap only)
     std::string llm_provider = "none";
     std::string llm_model;
     std::string llm_endpoint;
@@ -59,6 +84,42 @@ struct ShellConfig {
     bool llm_spinner = true; // show LLM progress spinner
     double llm_prompt_price_per_1k = 0.0; // USD per 1K prompt tokens
     double llm_completion_price_per_1k = 0.0; // USD per 1K completion tokens
+    bool llm_stream = true; // stream the completion and show steps as they arrive
+    bool llm_http2 = true; // negotiate HTTP/2 on TLS endpoints
+    int llm_pool_size = 8; // idle HTTP handles kept across ai commands
+    std::string llm_keep_alive = "30m"; // ollama: keep the model (and its prompt cache) loaded between requests
+    int llm_context_window = 0; // tokens; 0 = from the model name (ollama: its 4096 default num_ctx)
+    int llm_rpm = 0; // --plan-batch: requests per minute (0 = unlimited)
+    int llm_tpm = 0; // --plan-batch: tokens per minute (0 = unlimited)
+    double llm_max_request_cost = 0.0; // USD; requests estimated above it are not sent (0 = no limit)
+    std::string llm_hedge; // second provider raced against llm_provider (empty = off)
+    std::string llm_hedge_model;
+    std::string llm_hedge_endpoint;
+    std::string llm_hedge_api_key_env;
+    int llm_hedge_delay_ms = 1500; // hedge only if the primary has not answered by then
+    int llm_retries = 2; // extra attempts on 429/5xx/timeout (backoff with jitter, Retry-After)
+    int llm_backoff_ms = 250;
+    int llm_backoff_max_ms = 8000;
+    int llm_attempt_timeout_ms = 0; // 0 = the whole request timeout
+    std::vector<std::string> llm_fallback; // providers tried next, "provider[:model][@endpoint]"
+    double llm_breaker_error_rate = 0.5;
+    int llm_breaker_slow_ms = 0;
+    int llm_breaker_cooldown_ms = 30000;
+    bool plan_cache = true; // persistent plan cache (~/.ai-autoshell_plan_cache)
+    std::string plan_cache_file; // empty = $HOME/.ai-autoshell_plan_cache
+    bool plan_journal = true; // checkpoints of executed plans for 'ai resume'
+    std::string plan_journal_file; // empty = $HOME/.ai-autoshell_plans
+    int plan_journal_max_runs = 20;
+    bool plan_incremental = true; // skip steps whose declared outputs are up to date
+    std::string plan_state_file; // empty = $HOME/.ai-autoshell_state
+    int plan_cache_max_entries = 256;
+    int plan_cache_max_kb = 1024;
+    int plan_cache_ttl_hours = 168; // 0 = no expiry
+    bool plan_template = true; // reuse cached plans for requests differing only in arguments
+    double plan_template_min_confidence = 0.8;
+    bool planner_rules = true; // local rule table consulted before the LLM
+    std::string planner_rules_file; // extra rules (see ai/rule_table.hpp)
+    double planner_rules_min_confidence = 1.0; // share of the request's words the rules must cover (1.0: all)
 };
 static ShellConfig g_cfg;
 
@@ -84,6 +145,14 @@ static void load_config(){
         else if (key == "color") g_cfg.color = (val == "1" || val == "true" || val == "on");
         else if (key == "ai_enabled") g_cfg.ai_enabled = (val == "1" || val == "true" || val == "on");
         else if (key == "planner_mode") g_cfg.planner_mode = val;
+        else if (key == "ai_preflight") g_cfg.ai_preflight = (val == "1" || val == "true" || val == "on");
+        else if (key == "ai_context") g_cfg.ai_context = (val == "1" || val == "true" || val == "on");
+        else if (key == "ai_context_tokens") { try { g_cfg.ai_context_tokens = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "ai_prefetch") g_cfg.ai_prefetch = (val == "1" || val == "true" || val == "on");
+        else if (key == "ai_prefetch_idle_ms") { try { g_cfg.ai_prefetch_idle_ms = std::clamp(std::stoi(val), 50, 10000); } catch(...) {} }
+        else if (key == "ai_prefetch_max_requests") { try { g_cfg.ai_prefetch_max_requests = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "ai_prefetch_max_cost") { try { g_cfg.ai_prefetch_max_cost = std::max(0.0, std::stod(val)); } catch(...) {} }
+        else if (key == "ai_max_parallel") { try { g_cfg.ai_max_parallel = std::clamp(std::stoi(val), 1, 64); } catch(...) {} }
         else if (key == "llm_provider") g_cfg.llm_provider = val;
         else if (key == "llm_model") g_cfg.llm_model = val;
         else if (key == "llm_endpoint") g_cfg.llm_endpoint = val;
@@ -94,8 +163,199 @@ static void load_config(){
         else if (key == "llm_spinner") g_cfg.llm_spinner = (val == "1" || val == "true" || val == "on");
         else if (key == "llm_prompt_price_per_1k") { try { g_cfg.llm_prompt_price_per_1k = std::stod(val); } catch(...) {} }
         else if (key == "llm_completion_price_per_1k") { try { g_cfg.llm_completion_price_per_1k = std::stod(val); } catch(...) {} }
+        else if (key == "llm_stream") g_cfg.llm_stream = (val == "1" || val == "true" || val == "on");
+        else if (key == "llm_http2") g_cfg.llm_http2 = (val == "1" || val == "true" || val == "on");
+        else if (key == "llm_pool_size") { try { g_cfg.llm_pool_size = std::max(1, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_keep_alive") g_cfg.llm_keep_alive = val;
+        else if (key == "llm_rpm") { try { g_cfg.llm_rpm = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_tpm") { try { g_cfg.llm_tpm = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_context_window") { try { g_cfg.llm_context_window = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_max_request_cost") { try { g_cfg.llm_max_request_cost = std::max(0.0, std::stod(val)); } catch(...) {} }
+        else if (key == "llm_hedge") g_cfg.llm_hedge = (val == "none" || val == "off") ? "" : val;
+        else if (key == "llm_hedge_model") g_cfg.llm_hedge_model = val;
+        else if (key == "llm_hedge_endpoint") g_cfg.llm_hedge_endpoint = val;
+        else if (key == "llm_hedge_api_key_env") g_cfg.llm_hedge_api_key_env = val;
+        else if (key == "llm_hedge_delay_ms") { try { g_cfg.llm_hedge_delay_ms = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_retries") { try { g_cfg.llm_retries = std::clamp(std::stoi(val), 0, 10); } catch(...) {} }
+        else if (key == "llm_backoff_ms") { try { g_cfg.llm_backoff_ms = std::max(1, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_backoff_max_ms") { try { g_cfg.llm_backoff_max_ms = std::max(1, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_attempt_timeout_ms") { try { g_cfg.llm_attempt_timeout_ms = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_fallback") { g_cfg.llm_fallback.clear(); std::istringstream ls(val); std::string item; while (std::getline(ls, item, ',')) { item.erase(0, item.find_first_not_of(" \t")); item.erase(item.find_last_not_of(" \t") + 1); if (!item.empty() && item != "none") g_cfg.llm_fallback.push_back(item); } }
+        else if (key == "llm_breaker_error_rate") { try { g_cfg.llm_breaker_error_rate = std::clamp(std::stod(val), 0.01, 1.0); } catch(...) {} }
+        else if (key == "llm_breaker_slow_ms") { try { g_cfg.llm_breaker_slow_ms = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "llm_breaker_cooldown_ms") { try { g_cfg.llm_breaker_cooldown_ms = std::max(0, std::stoi(val)); } catch(...) {} }
+        else if (key == "plan_cache") g_cfg.plan_cache = (val == "1" || val == "true" || val == "on");
+        else if (key == "plan_cache_file") g_cfg.plan_cache_file = val;
+        else if (key == "plan_journal") g_cfg.plan_journal = (val == "1" || val == "true" || val == "on");
+        else if (key == "plan_journal_file") g_cfg.plan_journal_file = val;
+        else if (key == "plan_journal_max_runs") { try { g_cfg.plan_journal_max_runs = std::max(1, std::stoi(val)); } catch(...) {} }
+        else if (key == "plan_incremental") g_cfg.plan_incremental = (val == "1" || val == "true" || val == "on");
+        else if (key == "plan_state_file") g_cfg.plan_state_file = val;
+        else if (key == "plan_cache_max_entries") { try { g_cfg.plan_cache_max_entries = std::max(1, std::stoi(val)); } catch(...) {} }
+        else if (key == "plan_cache_max_kb") { try { g_cfg.plan_cache_max_kb = std::max(1, std::stoi(val)); } catch(...) {} }
+        else if (key == "plan_template") g_cfg.plan_template = (val == "1" || val == "true" || val == "on");
+        else if (key == "plan_template_min_confidence") { try { g_cfg.plan_template_min_confidence = std::stod(val); } catch(...) {} }
+        else if (key == "planner_rules") g_cfg.planner_rules = (val == "1" || val == "true" || val == "on");
+        else if (key == "planner_rules_file") g_cfg.planner_rules_file = val;
+        else if (key == "planner_rules_min_confidence") { try { g_cfg.planner_rules_min_confidence = std::stod(val); } catch(...) {} }
+        else if (key == "plan_cache_ttl_hours") { try { g_cfg.plan_cache_ttl_hours = std::max(0, std::stoi(val)); } catch(...) {} }
     }
 }
+// Comandi che richiedono conferma anche se il modello non li marca confirm=true
+static bool risky_command(std::string low){
+    std::transform(low.begin(),low.end(),low.begin(),::tolower);
+    return low.find("rm ")!=std::string::npos||low.find("sudo")!=std::string::npos||low.find("chmod 777")!=std::string::npos||low.find("chown")!=std::string::npos||low.find("dd ")!=std::string::npos||low.find("mkfs")!=std::string::npos|| (low.find("curl")!=std::string::npos && low.find("| sh")!=std::string::npos);
+}
+// Validazione anticipata degli step in streaming (ai auto): il primo comando deve essere eseguibile
+static std::string early_check(const std::string& cmd){
+    autoshell::Lexer lx(cmd); auto ts=lx.run();
+    if(ts.empty() || ts[0].kind!=autoshell::TokenKind::Word) return "";
+    const std::string& w=ts[0].lexeme;
+    if(w=="for"||w=="if"||w=="while"||w=="{"||autoshell::is_builtin(w)||autoshell::resolve_executable(w)) return "";
+    return "not found: "+w;
+}
+// Loop eseguiti nativamente negli step AI. Base regex: for i in {1..10}; do echo $i; done
+static const std::regex& native_for_re(){
+    static const std::regex re(R"(^for\s+([A-Za-z_][A-Za-z0-9_]*)\s+in\s+\{(-?\d+)\.\.(-?\d+)\}\s*;\s*do\s*(.*)\s*;\s*done\s*$)");
+    return re;
+}
+// Versione del prompt di pianificazione: fa parte della chiave della plan cache (cambiarla invalida i piani salvati)
+static const char* kPlanPromptVersion = "v5";
+static autoshell::ai::PlanCache& plan_cache(){
+    static autoshell::ai::PlanCache cache([]{
+        autoshell::ai::PlanCacheOptions o;
+        if(g_cfg.plan_cache) o.path = !g_cfg.plan_cache_file.empty() ? g_cfg.plan_cache_file : (getenv_or("HOME").empty() ? std::string() : getenv_or("HOME")+"/.ai-autoshell_plan_cache");
+        o.max_entries = static_cast<std::size_t>(g_cfg.plan_cache_max_entries);
+        o.max_bytes = static_cast<std::size_t>(g_cfg.plan_cache_max_kb)*1024;
+        o.ttl_seconds = static_cast<std::int64_t>(g_cfg.plan_cache_ttl_hours)*3600;
+        return o; }());
+    return cache;
+}
+// Checkpoint dei piani eseguiti (ai resume)
+static autoshell::ai::PlanJournal& plan_journal(){
+    static autoshell::ai::PlanJournal journal([]{
+        autoshell::ai::PlanJournalOptions o;
+        if(g_cfg.plan_journal) o.path = !g_cfg.plan_journal_file.empty() ? g_cfg.plan_journal_file : (getenv_or("HOME").empty() ? std::string() : getenv_or("HOME")+"/.ai-autoshell_plans");
+        o.max_runs = static_cast<std::size_t>(g_cfg.plan_journal_max_runs);
+        return o; }());
+    return journal;
+}
+// Sezione di contesto del prompt: fissa per la macchina, quindi dopo le istruzioni resta parte del prefisso in cache
+static const std::string& plan_environment(){
+    static const std::string env=[]{
+        std::string os;
+#ifndef _WIN32
+        struct utsname u; if(uname(&u)==0) os=std::string(u.sysname)+" "+u.machine;
+#else
+        os="Windows";
+#endif
+        return "OS: "+os+"\nShell: POSIX sh syntax (pipes, && ||, redirections, $(...), for loops); builtins cd export unset jobs fg bg";
+    }();
+    return env;
+}
+// Contesto della shell per il prompt, dal piu' stabile al piu' variabile; fit_context lo riduce al budget
+// (priorita': ambiente, ultimo comando, comandi recenti, file della directory corrente)
+static std::vector<autoshell::ai::PromptSection> plan_context(const std::vector<std::string>& history, bool line_in_history, int last_status){
+    std::vector<autoshell::ai::PromptSection> ctx{{"Environment", plan_environment(), 3, false}};
+    if(!g_cfg.ai_context) return ctx;
+    auto shell=autoshell::ai::shell_context(history, line_in_history, last_status);
+    ctx.insert(ctx.end(), shell.begin(), shell.end());
+    return ctx;
+}
+// Configurazione LLM dei piani (comandi ai e --plan-batch)
+static autoshell::ai::LLMConfig plan_llm_config(){
+    autoshell::ai::LLMConfig lc; lc.enabled=true; lc.provider=g_cfg.llm_provider; lc.model=g_cfg.llm_model; lc.endpoint=g_cfg.llm_endpoint; lc.api_key_env=g_cfg.llm_api_key_env; lc.api_key=g_cfg.llm_api_key; lc.stub_file=g_cfg.llm_stub_file; lc.max_tokens=512; lc.temperature=0.2; lc.system_prompt=autoshell::ai::plan_instructions(); lc.keep_alive=g_cfg.llm_keep_alive; lc.timeout_seconds=25; lc.prompt_price_per_1k=g_cfg.llm_prompt_price_per_1k; lc.completion_price_per_1k=g_cfg.llm_completion_price_per_1k;
+    lc.hedge_provider=g_cfg.llm_hedge; lc.hedge_model=g_cfg.llm_hedge_model; lc.hedge_endpoint=g_cfg.llm_hedge_endpoint; lc.hedge_api_key_env=g_cfg.llm_hedge_api_key_env; lc.hedge_delay_ms=g_cfg.llm_hedge_delay_ms;
+    lc.retries=g_cfg.llm_retries; lc.backoff_base_ms=g_cfg.llm_backoff_ms; lc.backoff_max_ms=g_cfg.llm_backoff_max_ms; lc.attempt_timeout_ms=g_cfg.llm_attempt_timeout_ms; lc.fallback=g_cfg.llm_fallback; lc.breaker_error_rate=g_cfg.llm_breaker_error_rate; lc.breaker_slow_ms=g_cfg.llm_breaker_slow_ms; lc.breaker_cooldown_ms=g_cfg.llm_breaker_cooldown_ms;
+    return lc;
+}
+// Stato degli step incrementali (inputs/outputs)
+static autoshell::ai::StepStateDb& step_state(){
+    static autoshell::ai::StepStateDb db([]{
+        autoshell::ai::StepStateDbOptions o;
+        o.path = !g_cfg.plan_state_file.empty() ? g_cfg.plan_state_file : (getenv_or("HOME").empty() ? std::string() : getenv_or("HOME")+"/.ai-autoshell_state");
+        return o; }());
+    return db;
+}
+static autoshell::ai::TemplateCache& plan_templates(){
+    static autoshell::ai::TemplateCache tc(plan_cache(), g_cfg.plan_template_min_confidence);
+    return tc;
+}
+static autoshell::ai::Telemetry& telemetry(){
+    static autoshell::ai::Telemetry t;
+    return t;
+}
+static const autoshell::ai::Planner& local_planner(){
+    static autoshell::ai::Planner planner([]{ autoshell::ai::PlannerConfig pc; pc.enabled=g_cfg.ai_enabled; pc.rules_file=g_cfg.planner_rules_file; return pc; }());
+    static bool reported=[]{ if(!planner.rules_error().empty()) std::cerr << "[AI] planner_rules_file: "<<planner.rules_error()<<" (using the built-in rules)\n"; return true; }();
+    (void)reported;
+    return planner;
+}
+// Modulo LLM (provider, HttpTransport, libcurl): caricato alla prima richiesta che deve chiamare un modello
+static autoshell::ai::LLMModule* llm(){
+    std::string err; auto* m=autoshell::ai::llm_module(&err);
+    static bool ready=[&]{ if(!m){ std::cerr << "[AI] LLM module unavailable: "<<err<<"\n"; return false; }
+        autoshell::ai::HttpOptions ho; ho.http2=g_cfg.llm_http2; ho.max_idle_handles=static_cast<std::size_t>(g_cfg.llm_pool_size); m->configure_http(ho); return true; }();
+    return ready?m:nullptr;
+}
+// Client riusato tra comandi ai (e dal prefetch): ricostruito solo se cambia la configurazione (es. ai pricing)
+static autoshell::ai::LLMClient* plan_client(autoshell::ai::LLMModule* mod, const autoshell::ai::LLMConfig& lc){
+    static std::unique_ptr<autoshell::ai::LLMClient> client; static std::string client_key;
+    std::ostringstream k; k<<lc.provider<<'\x1f'<<lc.model<<'\x1f'<<lc.endpoint<<'\x1f'<<lc.api_key_env<<'\x1f'<<lc.api_key<<'\x1f'<<lc.stub_file<<'\x1f'<<lc.prompt_price_per_1k<<'\x1f'<<lc.completion_price_per_1k<<'\x1f'<<lc.hedge_provider<<'\x1f'<<lc.hedge_model<<'\x1f'<<lc.hedge_endpoint<<'\x1f'<<lc.hedge_api_key_env<<'\x1f'<<lc.hedge_delay_ms<<'\x1f'<<lc.retries<<'\x1f'<<lc.backoff_base_ms<<'\x1f'<<lc.backoff_max_ms<<'\x1f'<<lc.attempt_timeout_ms<<'\x1f'<<lc.breaker_error_rate<<'\x1f'<<lc.breaker_slow_ms<<'\x1f'<<lc.breaker_cooldown_ms<<'\x1f'<<lc.keep_alive; for(auto &f: lc.fallback) k<<'\x1f'<<f;
+    if(mod && (!client || k.str()!=client_key)){ client=mod->make_llm(lc); client_key=k.str(); }
+    return client.get();
+}
+// Prompt utente di pianificazione e versione della chiave di plan cache che gli corrisponde
+struct PlanRequestPrompt {
+    std::string user;
+    std::string cache_version; // kPlanPromptVersion; con ai_context anche l'impronta dei file e della directory corrente
+    autoshell::ai::ContextFit fit;
+    std::size_t ctx_budget=0, window=0;
+};
+// Contesto a budget: ai_context_tokens, e comunque la finestra del modello meno istruzioni, richiesta e risposta.
+// line_in_history: la riga 'ai ...' e' gia' in history (Invio) o no (prefetch): stesso prompt, quindi stessa chiave di cache
+static PlanRequestPrompt plan_prompt(const std::string& request, const std::vector<std::string>& history, bool line_in_history, int last_status, const autoshell::ai::LLMConfig& lc){
+    auto ctx=plan_context(history, line_in_history, last_status);
+    PlanRequestPrompt p;
+    p.window=g_cfg.llm_context_window>0?static_cast<std::size_t>(g_cfg.llm_context_window):(lc.provider=="ollama"?4096:autoshell::ai::model_context_window(lc.model));
+    std::size_t fixed=autoshell::ai::estimate_tokens(lc.system_prompt)+autoshell::ai::estimate_tokens("Request: "+request)+static_cast<std::size_t>(lc.max_tokens);
+    p.ctx_budget=std::min(static_cast<std::size_t>(g_cfg.ai_context_tokens), p.window>fixed?p.window-fixed:0);
+    // Un piano fatto col listing della directory A non va servito in B: la chiave include listing completo e cwd, non la history
+    p.cache_version=kPlanPromptVersion;
+    if(g_cfg.ai_context){ std::error_code ec; p.cache_version+="+ctx:"+autoshell::ai::context_fingerprint(ctx, fs::current_path(ec).string()); }
+    p.fit=autoshell::ai::fit_context(ctx, p.ctx_budget);
+    p.user=autoshell::ai::make_plan_prompt(request, std::move(ctx)).user();
+    return p;
+}
+// --plan-batch: una richiesta per riga (vuote e '#' ignorate), piani in JSON lines nello stesso ordine
+static int plan_batch_main(const std::string& in_path, const std::string& out_path, autoshell::ai::BatchOptions bo){
+    std::ifstream in(in_path); if(!in){ std::cerr << "[AI] Cannot read "<<in_path<<"\n"; return 2; }
+    std::vector<std::string> requests; std::string line;
+    while(std::getline(in,line)){ auto b=line.find_first_not_of(" \t\r"); if(b==std::string::npos || line[b]=='#') continue; auto e=line.find_last_not_of(" \t\r"); requests.push_back(line.substr(b,e-b+1)); }
+    std::ofstream file; if(out_path!="-"){ file.open(out_path, std::ios::trunc); if(!file){ std::cerr << "[AI] Cannot write "<<out_path<<"\n"; return 2; } }
+    std::ostream& out = out_path=="-" ? std::cout : file;
+    if(!g_cfg.llm_enabled){ std::cerr << "[AI] LLM disabled: cannot generate plans.\n"; return 1; }
+    auto lc=plan_llm_config(); lc.max_tokens=static_cast<int>(512*std::max<std::size_t>(1,bo.pack)); // un piano per richiesta impacchettata
+    auto* mod=llm(); if(!mod) return 1;
+    auto client=mod->make_llm(lc);
+    if(!client){ std::cerr << "[AI] LLM unavailable (missing provider/key).\n"; return 1; }
+    bo.max_tokens=512; bo.system_prompt=lc.system_prompt; bo.context={{"Environment", plan_environment(), 0, false}};
+    bo.risky=[](const std::string& c){ return risky_command(c); };
+    std::mutex cache_mu; // TemplateCache non e' thread-safe
+    // Solo Environment nel prompt: piani senza contesto, stessa chiave dei comandi ai con ai_context=false
+    if(g_cfg.plan_cache){
+        bo.cache_get=[&](const std::string& r)->std::optional<std::string>{ std::lock_guard<std::mutex> lk(cache_mu); if(auto hit=plan_cache().get(autoshell::ai::PlanCache::make_key(r, lc.provider, lc.model, kPlanPromptVersion))) return hit; if(g_cfg.plan_template){ if(auto tm=plan_templates().lookup(r, lc.provider, lc.model, kPlanPromptVersion)) return tm->plan; } return std::nullopt; };
+        bo.cache_put=[&](const std::string& r, const std::string& text){ std::lock_guard<std::mutex> lk(cache_mu); plan_cache().put(autoshell::ai::PlanCache::make_key(r, lc.provider, lc.model, kPlanPromptVersion), r, text); if(g_cfg.plan_template) plan_templates().learn(r, lc.provider, lc.model, kPlanPromptVersion, text); };
+    }
+    std::cerr << "[AI] Planning "<<requests.size()<<" requests (jobs "<<bo.jobs; if(bo.requests_per_minute>0) std::cerr << ", "<<bo.requests_per_minute<<" rpm"; if(bo.tokens_per_minute>0) std::cerr << ", "<<bo.tokens_per_minute<<" tpm"; if(bo.pack>1) std::cerr << ", pack "<<bo.pack; std::cerr << ")\n";
+    auto st=autoshell::ai::run_plan_batch(requests, *client, bo, [&](const autoshell::ai::BatchResult& r){
+        out << autoshell::ai::batch_result_json(r) << std::flush;
+        if(!r.error.empty()) std::cerr << "[AI] #"<<r.index+1<<" failed: "<<r.error<<"\n"; });
+    std::cerr << "[AI] Batch: "<<st.planned<<"/"<<st.requests<<" planned, "<<st.failed<<" failed | "<<st.llm_calls<<" LLM calls ("<<st.packed_calls<<" packed), "<<st.cache_hits<<" from cache, "<<st.duplicates<<" duplicates | "<<st.prompt_tokens<<" prompt + "<<st.completion_tokens<<" completion tokens";
+    if(lc.prompt_price_per_1k>0 || lc.completion_price_per_1k>0) std::cerr << ", $"<<std::fixed<<std::setprecision(4)<<(st.prompt_tokens/1000.0*lc.prompt_price_per_1k+st.completion_tokens/1000.0*lc.completion_price_per_1k);
+    std::cerr << " | "<<st.wall_ms<<" ms\n";
+    return st.failed?1:0;
+}
 static void sigint_handler(int){ g_interrupted=1; }
 static void sigtstp_handler(int){ g_tstp=1; /* foreground pgid non gestito */ }
 static std::string make_prompt(){
@@ -115,6 +375,13 @@ int main(int argc,char* argv[]){
     std::signal(SIGTSTP,sigtstp_handler);
     load_config();
     for(int i=1;i<argc;++i){ std::string a=argv[i]; if(a=="--ai-debug"||a=="-d") g_cfg.ai_debug=true; }
+    // ai-autoshell --plan-batch requests.txt [--out plans.jsonl] [-j N] [--rpm N] [--tpm N] [--pack N]
+    { std::string batch_in, batch_out="-"; autoshell::ai::BatchOptions bo; bo.requests_per_minute=g_cfg.llm_rpm; bo.tokens_per_minute=g_cfg.llm_tpm;
+      for(int i=1;i+1<argc;++i){ std::string a=argv[i], v=argv[i+1]; bool used=true;
+          try { if(a=="--plan-batch") batch_in=v; else if(a=="--out"||a=="-o") batch_out=v; else if(a=="-j"||a=="--jobs") bo.jobs=static_cast<std::size_t>(std::max(1,std::stoi(v))); else if(a=="--rpm") bo.requests_per_minute=std::stoi(v); else if(a=="--tpm") bo.tokens_per_minute=std::stoi(v); else if(a=="--pack") bo.pack=static_cast<std::size_t>(std::max(1,std::stoi(v))); else used=false; }
+          catch(...) { std::cerr << "Invalid value for "<<a<<": "<<v<<"\n"; return 2; }
+          if(used) ++i; }
+      if(!batch_in.empty()) return plan_batch_main(batch_in, batch_out, bo); }
     std::cout << "\n" << apply_color("AI-AutoShell","1;36") << " (MVP)\n";
 #ifndef _WIN32
     struct utsname u; uname(&u);
@@ -123,7 +390,7 @@ int main(int argc,char* argv[]){
     OSVERSIONINFOEX info{}; info.dwOSVersionInfoSize=sizeof(info); GetVersionEx((OSVERSIONINFO*)&info);
     std::cout << "System: Windows " << info.dwMajorVersion << "." << info.dwMinorVersion << " (build " << info.dwBuildNumber << ")\n";
 #endif
-    std::cout << "Built-ins: cd pwd exit echo export unset jobs fg bg ai\n";
+    std::cout << "Built-ins: cd pwd exit echo export unset local return jobs fg bg ai\n";
     // AI / LLM status banner
     if (g_cfg.ai_enabled) {
         std::cout << "AI LLM mode active (model-generated steps only)";
@@ -132,15 +399,44 @@ int main(int argc,char* argv[]){
         if (g_cfg.llm_prompt_price_per_1k>0 || g_cfg.llm_completion_price_per_1k>0) {
             std::cout << " | pricing=$" << std::fixed << std::setprecision(4) << g_cfg.llm_prompt_price_per_1k << "/1K(prompt),$" << g_cfg.llm_completion_price_per_1k << "/1K(completion)";
         }
-        std::cout << "\nUsage: ai suggest <request> | ai auto <request>";
+        std::cout << "\nUsage: ai suggest <request> | ai auto <request> | ai resume [id|list]";
         if(g_cfg.ai_debug) std::cout << " (debug JSON ON)";
         std::cout << "\n";
     } else {
         std::cout << "AI disabled. Enable by adding 'ai_enabled=true' to ~/.ai-autoshellrc\n";
     }
+    // Un planner_rules_file illeggibile si segnala all'avvio, non alla prima 'ai' (o mai)
+    if (g_cfg.ai_enabled && g_cfg.planner_rules && !g_cfg.planner_rules_file.empty()) local_planner();
     std::cout << "Type 'exit' to quit.\n\n";
     int last_status = 0;
     std::vector<std::string> history;
+    // ai_prefetch: il piano si chiede in background durante la pausa di digitazione e finisce nella plan cache
+    std::unique_ptr<autoshell::ai::PlanPrefetcher> prefetch;
+    if (g_cfg.ai_enabled && g_cfg.llm_enabled && g_cfg.ai_prefetch && g_cfg.plan_cache) {
+        autoshell::ai::PrefetchOptions po; po.max_requests=static_cast<std::size_t>(g_cfg.ai_prefetch_max_requests); po.max_cost=g_cfg.ai_prefetch_max_cost;
+        prefetch = std::make_unique<autoshell::ai::PlanPrefetcher>(po,
+            [&](const std::string& r, autoshell::ai::CancelToken cancel){
+                auto lc=plan_llm_config(); auto* mod=llm(); auto* client=mod?plan_client(mod, lc):nullptr;
+                if(!client){ std::promise<std::optional<autoshell::ai::LLMCompletion>> none; none.set_value(std::nullopt); return none.get_future(); }
+                return client->complete_async(plan_prompt(r, history, false, last_status, lc).user, {}, cancel, std::chrono::steady_clock::now()+std::chrono::seconds(lc.timeout_seconds)); },
+            [&](const std::string& r)->std::optional<double>{ // niente chiamata se regole, cache o template coprono gia' la richiesta
+                auto lc=plan_llm_config();
+                if(g_cfg.planner_rules && local_planner().match_rules(r, g_cfg.planner_rules_min_confidence)) return std::nullopt;
+                auto pp=plan_prompt(r, history, false, last_status, lc);
+                if(plan_cache().get(autoshell::ai::PlanCache::make_key(r, lc.provider, lc.model, pp.cache_version), false)) return std::nullopt;
+                if(g_cfg.plan_template && plan_templates().lookup(r, lc.provider, lc.model, pp.cache_version, false)) return std::nullopt;
+                std::size_t est_prompt=autoshell::ai::estimate_tokens(lc.system_prompt)+autoshell::ai::estimate_tokens(pp.user);
+                double est=est_prompt/1000.0*lc.prompt_price_per_1k+lc.max_tokens/1000.0*lc.completion_price_per_1k;
+                if(g_cfg.llm_max_request_cost>0 && est>g_cfg.llm_max_request_cost) return std::nullopt;
+                return est; },
+            [&](const std::string& r, const autoshell::ai::LLMCompletion& reply){
+                if(reply.source=="stub" || reply.source=="echo") return false;
+                auto parsed=autoshell::ai::parse_plan_json(reply.text); if(!parsed.valid || parsed.steps.empty()) return false;
+                auto lc=plan_llm_config(); auto pp=plan_prompt(r, history, false, last_status, lc);
+                plan_cache().put(autoshell::ai::PlanCache::make_key(r, lc.provider, lc.model, pp.cache_version), r, reply.text);
+                if(g_cfg.plan_template) plan_templates().learn(r, lc.provider, lc.model, pp.cache_version, reply.text);
+                return true; });
+    }
     while (true) {
         g_interrupted = 0;
         autoshell::LineEditor editor;
@@ -209,7 +505,7 @@ int main(int argc,char* argv[]){
                 }
             } else {
                 refresh_path_cache();
-                static const char* builtins[] = {"cd","pwd","exit","echo","export","unset","jobs","fg","bg"};
+                static const char* builtins[] = {"cd","pwd","exit","echo","export","unset","jobs","fg","bg","local","return"};
                 size_t first_space = buffer.find(' '); bool first_token = (first_space==std::string::npos || buffer.size()==first_space+1);
                 if (first_token) {
                     for (auto b: builtins) if (std::string(b).rfind(prefix,0)==0) { matches.push_back(b); autoshell::g_completion_colors[b] = "\033[36m"; }
@@ -232,7 +528,8 @@ int main(int argc,char* argv[]){
             std::sort(matches.begin(), matches.end());
             matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
             return matches;
-        } };
+        }, .on_change = {}, .on_idle = {} };
+        if (prefetch) { comp.on_change = [&](const std::string& b){ prefetch->on_change(b); }; comp.on_idle = [&](const std::string& b){ prefetch->on_idle(b); }; comp.idle_ms = g_cfg.ai_prefetch_idle_ms; }
         std::string line = editor.read_line(make_prompt(), comp, history);
         if (line.empty()) {
             if (std::cin.eof()) break;
@@ -252,27 +549,84 @@ int main(int argc,char* argv[]){
             if (tmp.rfind("ai ",0)==0) {
                 // Format: ai suggest <request> | ai auto <request>
                 std::istringstream iss(tmp); std::string ai_kw, mode_kw; iss>>ai_kw>>mode_kw; std::string request; std::getline(iss, request); if(!request.empty() && request.front()==' ') request.erase(request.begin());
-                if(mode_kw=="suggest"||mode_kw=="auto") {
-                    // Flusso puro LLM (nessun planner locale)
+                if(mode_kw=="suggest"||mode_kw=="auto"||mode_kw=="resume") {
+                    // --fresh: ignora cache e template, chiede sempre all'LLM (e aggiorna la cache)
+                    bool fresh=false; if(request.rfind("--fresh ",0)==0){ fresh=true; request.erase(0,8); }
                     autoshell::ai::Plan plan; plan.request = request;
+                    // Tier locale: tabella di regole (un solo passaggio Aho-Corasick); se copre la richiesta niente rete
+                    size_t early_shown=0; bool from_rules=false; // early_shown: step gia' mostrati durante lo streaming
+                    // ai resume [id|list]: il piano salvato nel journal, senza LLM; gli step gia' riusciti non si rieseguono
+                    std::string journal_id; std::vector<bool> done_steps;
+                    if(mode_kw=="resume"){
+                        std::string rid=request; while(!rid.empty() && std::isspace((unsigned char)rid.back())) rid.pop_back();
+                        if(rid=="list"){ auto runs=plan_journal().runs(); if(runs.empty()) std::cout << "[AI] No plans in the journal.\n"; for(auto &r: runs){ size_t ok=r.steps.size()-r.remaining(); std::time_t t=static_cast<std::time_t>(r.created_ms/1000); char when[32]; std::strftime(when,sizeof(when),"%Y-%m-%d %H:%M",std::localtime(&t)); std::cout << " - "<<r.id<<"  "<<when<<"  "<<ok<<"/"<<r.steps.size()<<" ok"<<(r.complete()?"":"  [resumable]")<<"  "<<r.request<<"\n"; } last_status=0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                        auto run=plan_journal().find(rid);
+                        if(!run){ std::cout << (rid.empty()?std::string("[AI] No failed or interrupted plan to resume.\n"):"[AI] No plan with id "+rid+" ('ai resume list' shows them).\n"); last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                        if(run->complete()){ std::cout << "[AI] Plan "<<run->id<<" already completed.\n"; last_status=0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                        // Gli step usano percorsi relativi: si riprende solo dalla directory in cui il piano e' partito
+                        std::error_code cwd_ec; if(!run->cwd.empty() && !fs::equivalent(run->cwd, fs::current_path(), cwd_ec)){ std::cout << "[AI] Plan "<<run->id<<" ran in "<<run->cwd<<": cd there and run 'ai resume "<<run->id<<"' again.\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                        plan.request=run->request; plan.steps=run->steps; journal_id=run->id; plan.dangerous=false;
+                        // Gli step riusciti che cambiano solo lo stato della shell (cd, export) si rieseguono: i successivi ne dipendono
+                        done_steps=run->resume_done(); size_t replayed=0;
+                        for(size_t i=0;i<run->steps.size();++i){ if(done_steps[i]) continue; if(run->records[i].state==autoshell::ai::PlanJournal::StepState::Ok) ++replayed; if(run->steps[i].confirm) plan.dangerous=true; }
+                        std::cout << "[AI] Resuming plan "<<run->id<<" ("<<run->request<<"): "<<run->remaining()<<" of "<<run->steps.size()<<" steps left"; if(replayed) std::cout << ", "<<replayed<<" cd/export step"<<(replayed==1?"":"s")<<" replayed"; std::cout << ", 0 API calls\n";
+                        mode_kw="auto"; from_rules=true; // niente regole, cache ne' LLM
+                    }
+                    if(g_cfg.planner_rules && !fresh && journal_id.empty()){ auto t0=std::chrono::steady_clock::now(); if(auto rp=local_planner().match_rules(request, g_cfg.planner_rules_min_confidence)){ plan=*rp; from_rules=true; telemetry().record_plan(autoshell::ai::Telemetry::PlanSource::Rules); auto us=std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-t0).count(); std::cout << "[AI] Plan from local rules ("<<us<<" us, 0 API calls; 'ai "<<mode_kw<<" --fresh ...' asks the LLM)\n"; } }
+                    if(!from_rules){
                     if(!g_cfg.llm_enabled){ std::cout << "LLM disabled: cannot generate the plan.\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
-                    static std::unordered_map<std::string,std::string> g_plan_cache; auto normalize_req=[&](std::string r){ std::transform(r.begin(),r.end(),r.begin(),[](unsigned char c){ return std::tolower(c); }); return r; };
-                    autoshell::ai::LLMConfig lc; lc.enabled=true; lc.provider=g_cfg.llm_provider; lc.model=g_cfg.llm_model; lc.endpoint=g_cfg.llm_endpoint; lc.api_key_env=g_cfg.llm_api_key_env; lc.api_key=g_cfg.llm_api_key; lc.stub_file=g_cfg.llm_stub_file; lc.max_tokens=512; lc.temperature=0.2; lc.timeout_seconds=25; lc.prompt_price_per_1k=g_cfg.llm_prompt_price_per_1k; lc.completion_price_per_1k=g_cfg.llm_completion_price_per_1k;
-                    auto client_full = autoshell::ai::make_llm(lc);
-                    if(!client_full){ std::cout << "[AI] LLM unavailable (missing provider/key).\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
-                    std::string norm=normalize_req(request); std::string llm_text; bool from_cache=false;
-                    auto cit=g_plan_cache.find(norm); if(cit!=g_plan_cache.end()){ llm_text=cit->second; from_cache=true; if(g_cfg.ai_debug) std::cout << "[DEBUG] Cache hit\n"; }
+                    autoshell::ai::LLMConfig lc=plan_llm_config();
+                    // Istruzioni fisse nel system (lc.system_prompt), contesto e richiesta nel messaggio utente
+                    auto pp=plan_prompt(request, history, true, last_status, lc);
+                    // Prefetch della stessa richiesta ancora in volo: si aspetta quello invece di rifare la chiamata
+                    bool prefetched=false; if(prefetch){ if(fresh) prefetch->cancel(); else prefetched=prefetch->settle(request, []{ return g_interrupted!=0; }); }
+                    std::string cache_key=autoshell::ai::PlanCache::make_key(request, lc.provider, lc.model, pp.cache_version); std::string llm_text; bool from_cache=false;
+                    if(g_cfg.plan_cache && !fresh){ if(auto hit=plan_cache().get(cache_key)){ llm_text=*hit; from_cache=true; if(prefetched){ telemetry().record_plan(autoshell::ai::Telemetry::PlanSource::LLM); std::cout << "[AI] Plan prefetched while typing (1 API call)\n"; } else { telemetry().record_plan(autoshell::ai::Telemetry::PlanSource::Cache); std::cout << "[AI] Plan from cache (0 API calls)\n"; } }
+                        else if(g_cfg.plan_template){ if(auto tm=plan_templates().lookup(request, lc.provider, lc.model, pp.cache_version)){ llm_text=tm->plan; from_cache=true; telemetry().record_plan(autoshell::ai::Telemetry::PlanSource::Template); std::cout << "[AI] Plan from template (confidence "<<std::fixed<<std::setprecision(2)<<tm->confidence<<", 0 API calls; 'ai "<<mode_kw<<" --fresh ...' asks the LLM)\n"; } } }
                     static std::string llm_source; // mantiene ultimo source
-                    if(llm_text.empty()){ std::atomic<bool> done{false}; bool aborted=false; llm_source.clear(); static int usage_prompt=-1, usage_completion=-1, usage_total=-1; static double cost_prompt=-1.0, cost_completion=-1.0, cost_total=-1.0; if(g_cfg.ai_debug){ std::cout << "[DEBUG] LLM config provider="<<lc.provider<<" model="<<lc.model<<" endpoint="<<(lc.endpoint.empty()?"<default>":lc.endpoint)<<" key_present="<<(!lc.api_key.empty()||!lc.api_key_env.empty())<<"\n"; }
-                        std::thread worker([&]{ std::string prompt_full="You are a shell assistant. Output ONLY pure JSON with {request, steps:[{id,description,command,confirm}]} and no extra text. Request: "+request; auto r=client_full->complete(prompt_full); if(r){ llm_text=r->text; llm_source=r->source; usage_prompt=r->prompt_tokens; usage_completion=r->completion_tokens; usage_total=r->total_tokens; cost_prompt=r->prompt_cost; cost_completion=r->completion_cost; cost_total=r->total_cost; } done=true; }); std::cout << "LLM planning"; if(g_cfg.llm_spinner) std::cout << "..."; std::cout.flush(); auto start=std::chrono::steady_clock::now(); int max_frames=lc.timeout_seconds*(1000/120); for(int f=0; f<max_frames && !done; ++f){ if(g_interrupted){ std::cout << "\n[AI] Interrupted by user.\n"; aborted=true; break; } auto el=std::chrono::steady_clock::now()-start; if(std::chrono::duration_cast<std::chrono::seconds>(el).count()>=lc.timeout_seconds){ std::cout << "\n[AI] LLM timeout after "<<lc.timeout_seconds<<"s.\n"; aborted=true; break; } if(g_cfg.llm_spinner && f % (1000/120)==0) std::cout << "." << std::flush; std::this_thread::sleep_for(std::chrono::milliseconds(120)); } worker.join(); std::cout << "\n"; if(!aborted && !llm_text.empty() && llm_source=="openai" && llm_text.rfind("(parse-empty)",0)!=0 && llm_text.rfind("(openai error",0)!=0) { g_plan_cache[norm]=llm_text; }
+                    // Telemetria della richiesta LLM (ai stats): fasi del trasferimento qui, parsing piu' sotto
+                    std::optional<autoshell::ai::LLMCompletion> llm_reply; std::string llm_series;
+                    if(llm_text.empty()){ bool aborted=false; std::mutex early_mu; autoshell::ai::PlanStreamParser early_parser; std::vector<autoshell::ai::ParsedStep> early_steps; bool line_open=true;
+                        // Solo qui serve il modello (e quindi il modulo LLM)
+                        auto* mod=llm();
+                        autoshell::ai::LLMClient* client_full=mod?plan_client(mod, lc):nullptr;
+                        if(!client_full){ if(mod) std::cout << "[AI] LLM unavailable (missing provider/key).\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                        // Step completi appena arrivano: tempo percepito = primo step, non risposta intera
+                        auto show_early=[&]{ std::lock_guard<std::mutex> lk(early_mu); for(; early_shown<early_steps.size(); ++early_shown){ auto &st=early_steps[early_shown]; if(line_open){ std::cout << "\n"; line_open=false; } std::cout << " - "<<st.id<<": "<<st.command; if(!st.depends_on.empty()){ std::cout << "  (after"; for(size_t d=0; d<st.depends_on.size(); ++d) std::cout << (d?", ":" ")<<st.depends_on[d]; std::cout << ")"; } else if(st.parallel) std::cout << "  (parallel)"; if(st.confirm || risky_command(st.command)) std::cout << "  [confirm]"; if(mode_kw=="auto"){ std::string w=early_check(st.command); if(!w.empty()) std::cout << "  ["<<w<<"]"; } std::cout << "\n" << std::flush; } }; llm_source.clear(); static int usage_prompt=-1, usage_completion=-1, usage_total=-1, usage_cached=-1; static double cost_prompt=-1.0, cost_completion=-1.0, cost_total=-1.0; if(g_cfg.ai_debug){ std::cout << "[DEBUG] LLM config provider="<<lc.provider<<" model="<<lc.model<<" endpoint="<<(lc.endpoint.empty()?"<default>":lc.endpoint)<<" key_present="<<(!lc.api_key.empty()||!lc.api_key_env.empty())<<"\n"; }
+                        std::size_t est_prompt=autoshell::ai::estimate_tokens(lc.system_prompt)+autoshell::ai::estimate_tokens(pp.user);
+                        if(g_cfg.ai_debug){ std::cout << "[DEBUG] Context: ~"<<pp.fit.tokens<<"/"<<pp.ctx_budget<<" tokens (window "<<pp.window<<")"; for(auto &t: pp.fit.truncated) std::cout << " | truncated: "<<t; for(auto &t: pp.fit.dropped) std::cout << " | dropped: "<<t; std::cout << "\n"; }
+                        // Preventivo prima dell'invio: prompt stimato localmente, completion al massimo lc.max_tokens
+                        if(lc.prompt_price_per_1k>0 || lc.completion_price_per_1k>0 || g_cfg.ai_debug){
+                            double est_cost=est_prompt/1000.0*lc.prompt_price_per_1k+lc.max_tokens/1000.0*lc.completion_price_per_1k;
+                            std::cout << "[AI] Estimate: ~"<<est_prompt<<" prompt tokens"; if(lc.prompt_price_per_1k>0 || lc.completion_price_per_1k>0) std::cout << ", up to $"<<std::fixed<<std::setprecision(6)<<est_cost<<" (completion <= "<<lc.max_tokens<<" tokens)"; std::cout << "\n";
+                            if(g_cfg.llm_max_request_cost>0 && est_cost>g_cfg.llm_max_request_cost){ std::cout << "[AI] Request not sent: estimated cost above llm_max_request_cost ($"<<g_cfg.llm_max_request_cost<<").\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                        }
+                        // on_delta gira sul thread dell'event loop HTTP: il future viene sempre atteso prima di uscire dal blocco
+                        auto on_delta=[&](std::string_view d){ auto ready=early_parser.feed(d); if(ready.empty()) return; std::lock_guard<std::mutex> lk(early_mu); early_steps.insert(early_steps.end(),ready.begin(),ready.end()); };
+                        // Ctrl-C cancella il token: il trasferimento viene staccato subito (niente rete/CPU dopo l'interruzione)
+                        autoshell::ai::CancelToken cancel; auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(lc.timeout_seconds);
+                        std::size_t failovers_before=mod->failovers(*client_full);
+                        auto fut=client_full->complete_async(pp.user, g_cfg.llm_stream?autoshell::ai::LLMDeltaFn(on_delta):autoshell::ai::LLMDeltaFn{}, cancel, deadline);
+                        std::cout << "LLM planning"; if(g_cfg.llm_spinner) std::cout << "..."; std::cout.flush();
+                        for(int f=0; fut.wait_for(std::chrono::milliseconds(120))!=std::future_status::ready; ++f){ if(g_interrupted){ cancel.cancel(); std::cout << "\n[AI] Interrupted by user.\n"; aborted=true; break; } show_early(); if(g_cfg.llm_spinner && line_open && f % (1000/120)==0) std::cout << "." << std::flush; }
+                        auto r=fut.get();
+                        if(r && !aborted){ llm_reply=r; llm_series=(r->source==lc.provider || r->source=="error") ? lc.provider+"/"+(lc.model.empty()?"default":lc.model) : r->source; telemetry().record_plan(autoshell::ai::Telemetry::PlanSource::LLM); }
+                        if(r && r->text=="(timeout)"){ std::cout << "\n[AI] LLM timeout after "<<lc.timeout_seconds<<"s.\n"; aborted=true; }
+                        else if(r && !aborted){ llm_text=r->text; llm_source=r->source; usage_prompt=r->prompt_tokens; usage_completion=r->completion_tokens; usage_total=r->total_tokens; usage_cached=r->cached_tokens; cost_prompt=r->prompt_cost; cost_completion=r->completion_cost; cost_total=r->total_cost; }
+                        if(!aborted) show_early();
+                        if(line_open) std::cout << "\n";
+                        if(g_cfg.ai_debug){ auto hs=mod->http_stats(); std::cout << "[DEBUG] HTTP requests="<<hs.requests<<" connections="<<hs.connections<<" cancelled="<<hs.cancelled<<"\n"; }
+                        // Failover (llm_retries/llm_fallback); resilience e hedge li riporta il modulo
+                        if(r && r->source!="error" && r->source!=lc.provider && mod->failovers(*client_full)>failovers_before) std::cout << "[AI] "<<lc.provider<<" unavailable: plan from fallback provider "<<r->source<<"\n";
+                        if(g_cfg.ai_debug) std::cout << mod->debug_report(*client_full, lc);
                         if(g_cfg.ai_debug){
-                            std::cout << "[AI] Tokens: prompt="<<usage_prompt<<" completion="<<usage_completion<<" total="<<usage_total;
+                            std::cout << "[AI] Tokens: prompt="<<usage_prompt<<" completion="<<usage_completion<<" total="<<usage_total; if(usage_cached>=0) std::cout << " cached="<<usage_cached;
                             if(cost_total>=0.0){ std::cout << " | cost est. $"<<std::fixed<<std::setprecision(6)<<cost_total<<" (prompt $"<<cost_prompt<<" + completion $"<<cost_completion<<")"; }
                             else if(usage_total>=0 && (lc.prompt_price_per_1k<=0 || lc.completion_price_per_1k<=0)) { std::cout << " | pricing not configured"; }
                             std::cout << "\n";
                         }
                         else if(llm_source=="openai" && usage_total>=0){
-                            std::cout << "[AI] Token usage: total="<<usage_total<<" (prompt="<<usage_prompt<<", completion="<<usage_completion<<")";
+                            std::cout << "[AI] Token usage: total="<<usage_total<<" (prompt="<<usage_prompt; if(usage_cached>0) std::cout << ", "<<usage_cached<<" cached"; std::cout << ", completion="<<usage_completion<<")";
                             if(cost_total>=0.0){ std::cout << " | est. cost $"<<std::fixed<<std::setprecision(6)<<cost_total; }
                             else if(lc.prompt_price_per_1k<=0 || lc.completion_price_per_1k<=0){ std::cout << " | cost unavailable (pricing prompt="<<lc.prompt_price_per_1k<<" completion="<<lc.completion_price_per_1k<<")"; }
                             std::cout << "\n";
@@ -283,6 +637,7 @@ int main(int argc,char* argv[]){
                     // Distinzione errori
                     if(llm_text.rfind("(openai error",0)==0){ std::cout << "[AI] OpenAI HTTP error: "<<llm_text<<"\n"; }
                     else if(llm_text.rfind("(parse-empty)",0)==0){ std::cout << "[AI] Parse error: content field missing.\n"; }
+                    else if(llm_text=="(circuit-open)"){ std::cout << "[AI] All providers are failing (circuit open): retry in "<<g_cfg.llm_breaker_cooldown_ms/1000<<"s or use a rule/cached plan.\n"; }
                     else if(llm_text.rfind("(env-missing:",0)==0){
                         std::string var = g_cfg.llm_api_key_env;
                         // If the variable name looks like a key (starts with sk-) warn
@@ -301,20 +656,31 @@ int main(int argc,char* argv[]){
                         std::cout << "[AI] Non-JSON response snippet:\n"<<snippet<<"\n";
                     }
                     auto clean=[&](std::string t){ if(t.rfind("```",0)==0){ size_t pos=t.find("```",3); if(pos!=std::string::npos) t=t.substr(3,pos-3); } return t; };
-                    std::string jt=clean(llm_text); auto parsed=autoshell::ai::parse_plan_json(jt);
-                    if(parsed.valid && !parsed.steps.empty()){ std::vector<autoshell::ai::PlanStep> new_steps; bool dangerous=false; int auto_id=1; for(auto &st: parsed.steps){ autoshell::ai::PlanStep ps; ps.id=st.id.empty()?"s"+std::to_string(auto_id++):st.id; ps.description=st.description.empty()?"LLM step":st.description; ps.command=st.command; std::string low=ps.command; std::transform(low.begin(),low.end(),low.begin(),::tolower); ps.confirm=st.confirm || (low.find("rm ")!=std::string::npos||low.find("sudo")!=std::string::npos||low.find("chmod 777")!=std::string::npos||low.find("chown")!=std::string::npos||low.find("dd ")!=std::string::npos||low.find("mkfs")!=std::string::npos|| (low.find("curl")!=std::string::npos && low.find("| sh")!=std::string::npos)); if(ps.confirm) dangerous=true; new_steps.push_back(ps);} plan.steps=new_steps; plan.dangerous=dangerous; if(g_cfg.ai_debug){ std::cout << "[DEBUG] Parsed LLM JSON steps="<<new_steps.size()<<(from_cache?" (cache)":"")<<"\n"; for(auto &s: new_steps){ std::cout << "  * "<<s.id<<" confirm="<<(s.confirm?"true":"false")<<" cmd="<<s.command<<"\n"; } }
+                    auto parse_t0=std::chrono::steady_clock::now(); std::string jt=clean(llm_text); auto parsed=autoshell::ai::parse_plan_json(jt);
+                    if(llm_reply){ bool ok=llm_reply->source!="error"; auto parse_us=ok?std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-parse_t0).count():-1; telemetry().record_request(llm_series, llm_reply->timing, parse_us, llm_reply->completion_tokens, ok, llm_reply->prompt_tokens, llm_reply->cached_tokens);
+                        if(g_cfg.ai_debug){ auto &tm=llm_reply->timing; std::cout << "[DEBUG] Timing (us): dns="<<tm.dns_us<<" connect="<<tm.connect_us<<" tls="<<tm.tls_us<<" ttfb="<<tm.ttfb_us<<" total="<<tm.total_us<<" parse="<<parse_us<<" bytes up="<<tm.bytes_up<<" down="<<tm.bytes_down<<"\n"; } }
+                    if(parsed.valid && !parsed.steps.empty()){ std::vector<autoshell::ai::PlanStep> new_steps; bool dangerous=false; int auto_id=1; for(auto &st: parsed.steps){ autoshell::ai::PlanStep ps; ps.id=st.id.empty()?"s"+std::to_string(auto_id++):st.id; ps.description=st.description.empty()?"LLM step":st.description; ps.command=st.command; ps.depends_on=st.depends_on; ps.parallel=st.parallel; ps.inputs=st.inputs; ps.outputs=st.outputs; ps.confirm=st.confirm || risky_command(ps.command); if(ps.confirm) dangerous=true; new_steps.push_back(ps);} plan.steps=new_steps; plan.dangerous=dangerous; if(g_cfg.plan_cache && !from_cache && llm_source!="error" && llm_source!="stub" && llm_source!="echo") { plan_cache().put(cache_key, request, llm_text); if(g_cfg.plan_template) plan_templates().learn(request, lc.provider, lc.model, pp.cache_version, llm_text); } if(g_cfg.ai_debug){ std::cout << "[DEBUG] Parsed LLM JSON steps="<<new_steps.size()<<(from_cache?" (cache)":"")<<"\n"; for(auto &s: new_steps){ std::cout << "  * "<<s.id<<" confirm="<<(s.confirm?"true":"false")<<" cmd="<<s.command<<"\n"; } }
                     } else { std::cout << "[AI] Unparseable response / no steps:\n" << llm_text << "\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
-                    if(g_cfg.ai_debug){ std::cout << autoshell::ai::to_json(plan); if(mode_kw=="suggest"){ std::cout << "(suggest mode: not executing)\n"; last_status=0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; } } else { std::cout << "AI plan: "<<plan.steps.size()<<" step"<<(plan.steps.size()==1?"":"s"); if(plan.dangerous) std::cout << " (dangerous: confirmation required)"; std::cout << "\n"; for(auto &s: plan.steps){ std::cout << " - "<<s.id<<": "<<s.command<<"\n"; } if(mode_kw=="suggest"){ std::cout << "(suggest mode)\n"; last_status=0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; } }
+                    } // !from_rules
+                    if(g_cfg.ai_debug){ std::cout << autoshell::ai::to_json(plan); if(mode_kw=="suggest"){ std::cout << "(suggest mode: not executing)\n"; last_status=0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; } } else { std::cout << "AI plan: "<<plan.steps.size()<<" step"<<(plan.steps.size()==1?"":"s"); if(plan.dangerous) std::cout << " (dangerous: confirmation required)"; std::cout << "\n"; for(size_t i=std::min(early_shown,plan.steps.size()); i<plan.steps.size(); ++i){ auto &s=plan.steps[i]; std::cout << " - "<<s.id<<": "<<s.command; if(i<done_steps.size() && done_steps[i]) std::cout << "  [done]"; else if(!s.depends_on.empty()){ std::cout << "  (after"; for(size_t d=0; d<s.depends_on.size(); ++d) std::cout << (d?", ":" ")<<s.depends_on[d]; std::cout << ")"; } else if(s.parallel) std::cout << "  (parallel)"; std::cout << "\n"; } if(mode_kw=="suggest"){ std::cout << "(suggest mode)\n"; last_status=0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; } }
+                    auto graph=autoshell::ai::build_plan_graph(plan.steps);
+                    if(!graph.error.empty()){ std::cout << "[AI] Invalid plan: "<<graph.error<<"\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                    // Pre-flight: tutti gli step compilati (AST), eseguibili risolti e redirezioni controllate prima di eseguirne uno
+                    autoshell::ai::PreflightResult compiled;
+                    if(g_cfg.ai_preflight){
+                        autoshell::ai::PreflightOptions popt; popt.native=[](const std::string& c){ return std::regex_match(c, native_for_re()); };
+                        auto pf_t0=std::chrono::steady_clock::now(); compiled=autoshell::ai::preflight_plan(plan.steps, popt);
+                        for(size_t i=0;i<done_steps.size() && i<compiled.steps.size();++i) if(done_steps[i]){ compiled.problems-=compiled.steps[i].problems.size(); compiled.steps[i].problems.clear(); } // gia' eseguiti
+                        if(g_cfg.ai_debug) std::cout << "[DEBUG] Pre-flight: "<<plan.steps.size()<<" steps in "<<std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-pf_t0).count()<<" us\n";
+                        if(!compiled.ok()){ std::cout << "[AI] Pre-flight failed ("<<compiled.problems<<" problem"<<(compiled.problems==1?"":"s")<<"), nothing was executed:\n"; for(size_t i=0;i<plan.steps.size();++i) for(auto &pr: compiled.steps[i].problems) std::cout << "  ["<<plan.steps[i].id<<"] "<<pr<<"\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                    }
                     if(plan.dangerous){ std::cout << "Dangerous steps detected. Type 'yes' to execute: "; std::string resp; std::getline(std::cin,resp); if(resp!="yes"){ std::cout << "Aborted.\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; } }
-                    for(auto &step: plan.steps){
-                        std::cout << "Executing ["<<step.id<<"]: "<<step.command<<"\n";
-                        std::string lowcmd=step.command; std::transform(lowcmd.begin(),lowcmd.end(),lowcmd.begin(),::tolower);
+                    // Un passo del piano: loop nativo oppure Lexer/parser/executor; restituisce lo status
+                    auto run_step=[&](size_t idx)->int { const autoshell::ai::PlanStep& step=plan.steps[idx];
                         // Native execution for loops: for VAR in {A..B}; do BODY; done
                         std::function<bool(const std::string&)> exec_native_for; // forward declaration for recursion
                         exec_native_for = [&](const std::string& cmd)->bool {
-                            // Base regex: for i in {1..10}; do echo $i; done
-                            static const std::regex re(R"(^for\s+([A-Za-z_][A-Za-z0-9_]*)\s+in\s+\{(-?\d+)\.\.(-?\d+)\}\s*;\s*do\s*(.*)\s*;\s*done\s*$)");
-                            std::smatch m; if(!std::regex_match(cmd, m, re)) return false;
+                            std::smatch m; if(!std::regex_match(cmd, m, native_for_re())) return false;
                             std::string var = m[1]; long start = std::stol(m[2]); long end = std::stol(m[3]); std::string body = m[4];
                             bool ascending = start <= end;
                             // Split body by ';' respecting quotes
@@ -334,7 +700,7 @@ int main(int argc,char* argv[]){
                                 pos=0; while((pos=line.find(pattern1,pos))!=std::string::npos){ line.replace(pos, pattern1.size(), sval); pos+=sval.size(); }
                                 return line;
                             };
-                            static autoshell::ExecContext ai_exec_ctx_loop; autoshell::ExecutorPOSIX ex(ai_exec_ctx_loop);
+                            static autoshell::ExecContext ai_exec_ctx_loop; ai_exec_ctx_loop.job_control=!graph.concurrent; autoshell::ExecutorPOSIX ex(ai_exec_ctx_loop);
                             auto run_one = [&](const std::string& raw)->int {
                                 autoshell::Lexer lx(raw); auto ts=lx.run(); autoshell::AST ast_step=autoshell::parse_tokens(ts); return ex.run(ast_step);
                             };
@@ -343,12 +709,62 @@ int main(int argc,char* argv[]){
                             if(ascending){ for(long v=start; v<=end; ++v) run_iter(v); } else { for(long v=start; v>=end; --v) run_iter(v); }
                             return true;
                         };
-                        if(exec_native_for(step.command)) { std::cout << "[AI] Loop executed natively.\n"; continue; }
+                        if(exec_native_for(step.command)) { std::cout << "[AI] Loop executed natively.\n"; return 0; }
                         // TODO: native brace expansion detection here (already handled earlier in expand)
-                        autoshell::Lexer lx(step.command); auto ts=lx.run(); autoshell::AST ast_step=autoshell::parse_tokens(ts); static autoshell::ExecContext ai_exec_ctx; autoshell::ExecutorPOSIX ex(ai_exec_ctx); int st=ex.run(ast_step); if(st!=0) std::cout << "Step "<<step.id<<" failed status="<<st<<" (continuing)\n";
+                        // Step concorrente: i suoi comandi restano nel process group dello step, che l'interruzione termina per intero
+                        static autoshell::ExecContext ai_exec_ctx; ai_exec_ctx.job_control=!graph.concurrent; autoshell::ExecutorPOSIX ex(ai_exec_ctx);
+                        if(idx<compiled.steps.size()) return ex.run(compiled.steps[idx].ast); // AST del pre-flight
+                        autoshell::Lexer lx(step.command); auto ts=lx.run(); autoshell::AST ast_step=autoshell::parse_tokens(ts); return ex.run(ast_step);
+                    };
+                    // Journal: piano e checkpoint di ogni step su disco (ai resume)
+                    if(journal_id.empty()){ std::error_code cwd_ec; journal_id=plan_journal().begin(plan.request, plan.steps, fs::current_path(cwd_ec).string()); }
+                    auto checkpoint=[&](size_t i, const autoshell::ai::StepOutcome& o){ using S=autoshell::ai::PlanJournal::StepState; plan_journal().step_finished(journal_id, i, o.state==autoshell::ai::StepOutcome::State::Ok?S::Ok:o.state==autoshell::ai::StepOutcome::State::Failed?S::Failed:S::Skipped, o.status, o.duration_ms); };
+                    // Step incrementali: outputs aggiornati rispetto agli inputs -> non si esegue; dopo un successo si registra
+                    auto up_to_date=[&](size_t i){ auto &s=plan.steps[i]; if(!g_cfg.plan_incremental || s.outputs.empty()) return false; auto c=step_state().check(s); if(!c.up_to_date && g_cfg.ai_debug) std::cout << "[DEBUG] Step "<<s.id<<" runs: "<<c.reason<<"\n"; return c.up_to_date; };
+                    auto record_outputs=[&](size_t i){ if(g_cfg.plan_incremental && !plan.steps[i].outputs.empty() && !step_state().record(plan.steps[i]) && g_cfg.ai_debug) std::cout << "[DEBUG] Step "<<plan.steps[i].id<<" did not produce its outputs\n"; };
+                    auto resume_hint=[&]{ std::cout << "[AI] 'ai resume "<<journal_id<<"' re-runs the failed and remaining steps (no LLM call).\n"<<std::flush; };
+                    if(graph.concurrent){
+                        // depends_on/parallel: passi indipendenti in parallelo (sottoprocessi), uscita raggruppata in ordine di piano
+                        autoshell::ai::DagRunOptions dopt; dopt.max_parallel=static_cast<size_t>(g_cfg.ai_max_parallel); dopt.run=run_step; dopt.interrupted=[]{ return g_interrupted!=0; }; dopt.done=done_steps;
+                        dopt.on_start=[&](size_t i){ plan_journal().step_started(journal_id, i); }; dopt.up_to_date=up_to_date;
+                        dopt.on_finish=[&](size_t i, const autoshell::ai::StepOutcome& o){ checkpoint(i, o); if(o.state==autoshell::ai::StepOutcome::State::Ok && !o.up_to_date) record_outputs(i); };
+                        auto outcome=autoshell::ai::run_plan_dag(plan.steps, graph, dopt); size_t n_ok=0, n_failed=0, n_skipped=0;
+                        for(auto &o: outcome){ if(o.state==autoshell::ai::StepOutcome::State::Ok) ++n_ok; else if(o.state==autoshell::ai::StepOutcome::State::Failed) ++n_failed; else ++n_skipped; }
+                        if(n_failed || n_skipped){ std::cout << "[AI] Plan: "<<n_ok<<" ok, "<<n_failed<<" failed, "<<n_skipped<<" skipped\n"; resume_hint(); }
+                        last_status=(n_failed||n_skipped)?1:0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue;
                     }
+                    size_t n_failed=0;
+                    for(size_t i=0;i<plan.steps.size();++i){ auto &step=plan.steps[i];
+                        if(i<done_steps.size() && done_steps[i]){ std::cout << "Done ["<<step.id<<"]: "<<step.command<<" (earlier run)\n"; continue; }
+                        if(g_interrupted){ std::cout << "[AI] Interrupted before step "<<step.id<<".\n"; ++n_failed; break; } // Ctrl-C: i restanti restano da eseguire
+                        if(up_to_date(i)){ std::cout << "Up to date ["<<step.id<<"]: "<<step.command<<"\n"; checkpoint(i, {autoshell::ai::StepOutcome::State::Ok, 0, {}, 0, true}); continue; }
+                        std::cout << "Executing ["<<step.id<<"]: "<<step.command<<"\n";
+                        plan_journal().step_started(journal_id, i); auto st_t0=std::chrono::steady_clock::now();
+                        int st=run_step(i); if(st!=0){ std::cout << "Step "<<step.id<<" failed status="<<st<<" (continuing)\n"; ++n_failed; }
+                        checkpoint(i, {st==0?autoshell::ai::StepOutcome::State::Ok:autoshell::ai::StepOutcome::State::Failed, st, {}, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-st_t0).count()});
+                        if(st==0) record_outputs(i);
+                    }
+                    if(n_failed) resume_hint();
                     last_status=0; char buf2[16]; std::snprintf(buf2,sizeof(buf2),"%d",last_status); setenv("?",buf2,1); continue;
                 } else {
+                    // ai cache stats|clear|show: plan cache persistente
+                    if(mode_kw=="cache") {
+                        auto &pc=plan_cache(); std::istringstream iss2(request); std::string sub; iss2>>sub;
+                        if(sub=="stats"||sub.empty()){ auto st=pc.stats(); std::cout << "[AI] Plan cache: "<<st.entries<<" entries, "<<std::fixed<<std::setprecision(1)<<st.bytes/1024.0<<" KB (cap "<<pc.options().max_entries<<" entries / "<<pc.options().max_bytes/1024<<" KB, ttl "<<pc.options().ttl_seconds/3600<<"h)\n"; std::cout << "[AI] Session: hits="<<st.hits<<" misses="<<st.misses<<" hit rate="<<std::setprecision(1)<<st.hit_rate()*100.0<<"% evictions="<<st.evictions<<"\n"; { auto ts=plan_templates().stats(); std::cout << "[AI] Templates: hits="<<ts.hits<<" misses="<<ts.misses<<" learned="<<ts.learned<<" rejected="<<ts.rejected<<" (min confidence "<<std::setprecision(2)<<plan_templates().min_confidence()<<")\n"; } if(pc.options().path.empty()) std::cout << "[AI] Not persisted (plan_cache=false or HOME unset)\n"; else std::cout << "[AI] File: "<<pc.options().path<<"\n"; }
+                        else if(sub=="clear"){ pc.clear(); std::cout << "[AI] Plan cache cleared.\n"; }
+                        else if(sub=="show"){ auto now=std::time(nullptr); for(auto &e: pc.entries()){ std::string k=e.key; size_t a=k.find('|'), b=k.find('|',a+1); std::cout << " - ["<<k.substr(0,a)<<"/"<<k.substr(a+1,b-a-1)<<"] "<<e.request<<"  (hits="<<e.hits<<", age="<<(now-e.created)/60<<"m)\n"; } if(pc.entries().empty()) std::cout << "[AI] Plan cache is empty.\n"; }
+                        else { std::cout << "[AI] Usage: ai cache stats|clear|show\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                        last_status=0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue;
+                    }
+                    // ai stats [reset]: latenze per fase (p50/p95/p99), parsing, token/s, hit rate della cache
+                    if(mode_kw=="stats") {
+                        std::istringstream iss2(request); std::string sub; iss2>>sub;
+                        if(sub=="reset"){ telemetry().reset(); std::cout << "[AI] Stats reset.\n"; }
+                        else if(sub.empty()){ telemetry().report(std::cout);
+                            if(prefetch){ auto ps=prefetch->stats(); std::cout << "[AI] Prefetch: "<<ps.started<<" started, "<<ps.cancelled<<" cancelled, "<<ps.stored<<" stored, "<<ps.used<<" used at Enter, "<<ps.over_budget<<" over budget | ~$"<<std::fixed<<std::setprecision(4)<<ps.spent<<" of $"<<g_cfg.ai_prefetch_max_cost<<", "<<ps.started<<"/"<<g_cfg.ai_prefetch_max_requests<<" calls\n"; } }
+                        else { std::cout << "[AI] Usage: ai stats [reset]\n"; last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue; }
+                        last_status=0; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue;
+                    }
                     // Gestione comando speciale 'ai pricing <prompt_per_1k> <completion_per_1k>'
                     if(mode_kw=="pricing") {
                         std::istringstream iss2(request); double p=0.0,c=0.0; iss2>>p>>c; if(!iss2.fail()){
@@ -360,7 +776,7 @@ int main(int argc,char* argv[]){
                             last_status=1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue;
                         }
                     }
-                    std::cout << "Invalid ai mode. Use: ai suggest <req> | ai auto <req> | ai pricing <p> <c>\n"; last_status = 1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue;
+                    std::cout << "Invalid ai mode. Use: ai suggest <req> | ai auto <req> | ai pricing <p> <c> | ai cache stats|clear|show | ai stats [reset]\n"; last_status = 1; char buf[16]; std::snprintf(buf,sizeof(buf),"%d",last_status); setenv("?",buf,1); continue;
                 }
             }
         }
@@ -1,57 +1,98 @@
 /*
  * AI-AutoShell Script Runner (.ash)
- * Minimal implementation: reads a .ash file line by line, skips comments (#...) and blank lines,
- * runs each line through lexer->parser->executor.
+ * Streams the script through ScriptStream: regular files are mapped and consumed window by
+ * window, pipes/stdin are read in large chunks. Each complete top-level command (which may span
+ * several lines: functions, continuations, quoted newlines) runs as soon as it has been parsed,
+ * so memory stays bounded by the largest single command, not by the script size.
  */
-#include <ai-autoshell/lex/lexer.hpp>
-#include <ai-autoshell/parse/parser.hpp>
+#include <ai-autoshell/parse/script_stream.hpp>
 #include <ai-autoshell/exec/executor_posix.hpp>
 #include <ai-autoshell/expand/expand.hpp>
-#include <fstream>
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <vector>
-#include <filesystem>
 #include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
 
 using namespace autoshell;
 
 static volatile sig_atomic_t g_stop = 0;
 void sigint_handler(int){ g_stop = 1; }
 
+static constexpr size_t kMapWindow = 1 << 20;  // bytes handed to the parser per mmap window
+static constexpr size_t kReadChunk = 1 << 16;  // read() size for pipes / stdin
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: ai-autoshell-script <file.ash>" << std::endl;
+    std::string path = argc >= 2 ? argv[1] : "-";
+    if (path == "-" && argc < 2 && isatty(STDIN_FILENO)) {
+        std::cerr << "Usage: ai-autoshell-script <file.ash|->" << std::endl;
         return 1;
     }
-    std::string path = argv[1];
-    std::ifstream in(path);
-    if (!in) { std::perror("open script"); return 1; }
+    int fd = (path == "-") ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { std::perror("open script"); return 1; }
 
     std::signal(SIGINT, sigint_handler);
 
     ExecContext ctx;
     ExecutorPOSIX executor(ctx);
+    ScriptStream stream;
     int last_status = 0;
 
-    std::string line; size_t lineno=0;
-    while (std::getline(in, line)) {
-        ++lineno;
-        if (g_stop) { std::cerr << "Interrupted" << std::endl; break; }
-        // Trim
-        auto notspace = [](int ch){ return !std::isspace(ch); };
-        line.erase(line.begin(), std::find_if(line.begin(), line.end(), notspace));
-        line.erase(std::find_if(line.rbegin(), line.rend(), notspace).base(), line.end());
-        if (line.empty()) continue;
-        if (line[0]=='#') continue; // comment
-        Lexer lex(line);
-        auto tokens = lex.run();
-        AST ast = parse_tokens(tokens);
-        last_status = executor.run(ast);
-        if (last_status != 0) {
-            std::cerr << "Line " << lineno << " exit status " << last_status << std::endl;
+    // Runs every command completed so far; false once interrupted.
+    auto drain = [&]() -> bool {
+        while (auto cmd = stream.next()) {
+            if (g_stop) { std::cerr << "Interrupted" << std::endl; return false; }
+            last_status = executor.run(cmd->ast);
+            if (last_status != 0) {
+                std::cerr << "Line " << cmd->line << " exit status " << last_status << std::endl;
+            }
+        }
+        return !g_stop;
+    };
+
+    bool running = true;
+    struct stat st{};
+    if (fd != STDIN_FILENO && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t size = static_cast<size_t>(st.st_size);
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) { std::perror("mmap script"); ::close(fd); return 1; }
+        madvise(map, size, MADV_SEQUENTIAL);
+        const char* data = static_cast<const char*>(map);
+        long page = sysconf(_SC_PAGESIZE);
+        for (size_t off = 0; off < size && running; off += kMapWindow) {
+            size_t len = std::min(kMapWindow, size - off);
+            stream.feed(std::string_view(data + off, len));
+            // The stream copied what it still needs: release the consumed pages.
+            size_t done = (off + len) / page * page;
+            if (done > 0) madvise(map, done, MADV_DONTNEED);
+            running = drain();
+        }
+        munmap(map, size);
+    } else {
+        std::vector<char> buf(kReadChunk);
+        while (running) {
+            ssize_t n = ::read(fd, buf.data(), buf.size());
+            if (n < 0 && errno == EINTR) { if (g_stop) break; continue; }
+            if (n < 0) { std::perror("read script"); last_status = 1; break; }
+            if (n == 0) break;
+            stream.feed(std::string_view(buf.data(), static_cast<size_t>(n)));
+            running = drain();
         }
     }
+    if (fd != STDIN_FILENO) ::close(fd);
+    if (!running) return last_status;
 
+    stream.finish();
+    drain();
+    if (stream.unterminated()) {
+        std::cerr << "Line " << stream.unterminated_line() << ": unexpected end of file (unterminated quote, '(' or '{')" << std::endl;
+        return 2;
+    }
     return last_status;
 }
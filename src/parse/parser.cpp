@@ -6,6 +6,8 @@
  */
 #include <ai-autoshell/parse/ast.hpp>
 #include <ai-autoshell/parse/tokens.hpp>
+#include <cctype>
+#include <algorithm>
 #include <iostream>
 #include <optional>
 
@@ -16,20 +18,35 @@ public:
     Parser(const TokenStream& ts) : m_ts(ts) {}
     AST parse_line() {
         AST ast; ast.list = parse_list();
+        if (!eof()) note_error(m_index); // tokens the grammar could not place
         return ast;
     }
+    // First token where the (error tolerant) parse went wrong; npos = clean parse.
+    std::size_t error_at() const { return m_error; }
 private:
     const Token& peek() const { return m_ts[m_index]; }
+    const Token& peek_at(std::size_t ahead) const {
+        std::size_t i = m_index + ahead;
+        return i < m_ts.size() ? m_ts[i] : m_ts.back();
+    }
     bool eof() const { return peek().kind == TokenKind::Eof; }
     const Token& get() { return m_ts[m_index++]; }
+    // '{' e '}' sono parole riservate solo in posizione di comando.
+    bool at_word(const char* w) const { return peek().kind == TokenKind::Word && peek().lexeme == w; }
+
+    void skip_newlines() { while (peek().kind == TokenKind::Newline) get(); }
+    void note_error(std::size_t at) { if (m_error == std::string::npos) m_error = std::min(at, m_ts.size() - 1); }
 
     std::unique_ptr<ListNode> parse_list() {
         auto list = std::make_unique<ListNode>();
         while (true) {
+            skip_newlines();
             auto and_or = parse_and_or();
             if (!and_or) break;
             list->segments.push_back({std::move(and_or)});
-            if (peek().kind == TokenKind::Semi) { get(); continue; }
+            if (peek().kind == TokenKind::Semi || peek().kind == TokenKind::Newline) { get(); continue; }
+            // 'cmd &' already consumed its '&', which also separates the next command
+            if (m_index > 0 && m_ts[m_index-1].kind == TokenKind::Background) continue;
             break;
         }
         return list;
@@ -44,8 +61,9 @@ private:
         while (peek().kind == TokenKind::AndIf || peek().kind == TokenKind::OrIf) {
             std::string op = (peek().kind == TokenKind::AndIf) ? "&&" : "||";
             get();
+            skip_newlines(); // 'a &&' may continue on the next line
             auto pipe_next = parse_pipeline();
-            if (!pipe_next) break; // error tolerant
+            if (!pipe_next) { note_error(m_index); break; } // error tolerant
             node->segments.push_back({std::move(pipe_next), op});
         }
         return node;
@@ -58,14 +76,21 @@ private:
         pipe->elements.push_back(std::move(*first));
         while (peek().kind == TokenKind::Pipe) {
             get();
+            skip_newlines();
             auto next = parse_command_or_subshell();
-            if (!next) break; // error tolerant
+            if (!next) { note_error(m_index); break; } // error tolerant
             pipe->elements.push_back(std::move(*next));
         }
         return pipe;
     }
 
     std::optional<PipelineNode::Element> parse_command_or_subshell() {
+        if (peek().kind == TokenKind::Word && peek_at(1).kind == TokenKind::LeftParen &&
+            peek_at(2).kind == TokenKind::RightParen) {
+            auto fn = parse_function_def();
+            if (!fn) return std::nullopt;
+            return PipelineNode::Element{std::move(fn)};
+        }
         if (peek().kind == TokenKind::LeftParen) {
             auto subshell = parse_subshell();
             if (!subshell) return std::nullopt;
@@ -82,6 +107,7 @@ private:
         auto inner_list = parse_list();
         if (peek().kind != TokenKind::RightParen) {
             // errore: manca ')'
+            note_error(m_index);
             return nullptr;
         }
         get(); // ')'
@@ -91,24 +117,48 @@ private:
         return node;
     }
 
+    // name() { list; }  (the body must be a brace group)
+    std::unique_ptr<FunctionDefNode> parse_function_def() {
+        const std::string& name = peek().lexeme;
+        if (name.empty() || !(std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == '_')) return nullptr;
+        for (char c : name) if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') return nullptr;
+        auto node = std::make_unique<FunctionDefNode>();
+        node->name = get().lexeme;
+        get(); get(); // '(' ')'
+        skip_newlines();
+        if (!at_word("{")) { note_error(m_index); return nullptr; } // errore: corpo mancante
+        get();
+        ++m_brace_depth;
+        auto body = parse_list();
+        --m_brace_depth;
+        if (!at_word("}")) { note_error(m_index); return nullptr; } // errore: manca '}'
+        get();
+        node->body = std::move(body);
+        return node;
+    }
+
     std::unique_ptr<CommandNode> parse_command() {
+        if (m_brace_depth > 0 && at_word("}")) return nullptr; // fine del corpo di una funzione
         auto cmd = std::make_unique<CommandNode>();
         // prefix assigns
         while (peek().kind == TokenKind::Assign) {
             cmd->assigns.push_back(get());
         }
-        // words
-        while (peek().kind == TokenKind::Word) {
+        // words (NAME=VALUE after the command name is a plain argument, e.g. 'local x=1')
+        while (peek().kind == TokenKind::Word || (!cmd->argv.empty() && peek().kind == TokenKind::Assign)) {
+            if (peek().subst) cmd->substs.push_back(cmd->argv.size());
             cmd->argv.push_back(get().lexeme);
         }
         // redirs
         while (true) {
             if (peek().kind == TokenKind::RedirOut || peek().kind == TokenKind::RedirOutAppend ||
                 peek().kind == TokenKind::RedirIn || peek().kind == TokenKind::RedirErr ||
-                peek().kind == TokenKind::RedirErrToOut) {
+                peek().kind == TokenKind::RedirErrToOut || peek().kind == TokenKind::RedirHeredoc ||
+                peek().kind == TokenKind::RedirHeredocStrip || peek().kind == TokenKind::RedirHereString) {
                 Token op = get();
                 if (peek().kind != TokenKind::Word && peek().kind != TokenKind::Assign) {
                     // need a target word (simplified); abort
+                    note_error(m_index - 1);
                     break;
                 }
                 Token target = get();
@@ -119,9 +169,12 @@ private:
                     case TokenKind::RedirIn: type = RedirNode::Type::In; break;
                     case TokenKind::RedirErr: type = RedirNode::Type::Err; break;
                     case TokenKind::RedirErrToOut: type = RedirNode::Type::ErrToOut; break;
+                    case TokenKind::RedirHeredoc:
+                    case TokenKind::RedirHeredocStrip: type = RedirNode::Type::HereDoc; break; // body already read by the lexer
+                    case TokenKind::RedirHereString: type = RedirNode::Type::HereString; break;
                     default: type = RedirNode::Type::Out; break;
                 }
-                cmd->redirs.push_back({type, target.lexeme});
+                cmd->redirs.push_back({type, target.lexeme, target.quoted, target.subst});
                 continue;
             }
             break;
@@ -133,6 +186,8 @@ private:
 
     const TokenStream& m_ts;
     std::size_t m_index = 0;
+    int m_brace_depth = 0; // > 0 while parsing a function body
+    std::size_t m_error = std::string::npos;
 };
 
 // Exposed helper
@@ -141,4 +196,16 @@ AST parse_tokens(const TokenStream& ts) {
     return p.parse_line();
 }
 
+AST parse_tokens(const TokenStream& ts, std::string& error) {
+    Parser p(ts);
+    AST ast = p.parse_line();
+    error.clear();
+    for (auto& t : ts) if (t.kind == TokenKind::Invalid) { error = "syntax error near '" + t.lexeme + "'"; return ast; }
+    if (p.error_at() != std::string::npos) {
+        const Token& t = ts[p.error_at()];
+        error = t.kind == TokenKind::Eof || t.kind == TokenKind::Newline ? "syntax error near end of line" : "syntax error near '" + t.lexeme + "'";
+    }
+    return ast;
+}
+
 } // namespace autoshell
@@ -0,0 +1,191 @@
+/*
+ * AI-AutoShell Script Stream Implementation
+ * Copyright (c) 2025 iDev srl
+ * Author: Luigi De Astis <l.deastis@idev-srl.com>
+ * Description: See header for details.
+ */
+#include <ai-autoshell/parse/script_stream.hpp>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
+#include <cstring>
+
+namespace autoshell {
+
+static bool is_blank(char c) { return c==' ' || c=='\t' || c=='\r'; }
+static bool is_separator(char c) { return is_blank(c) || c=='\n' || std::strchr(";&|()", c) != nullptr; }
+
+void ScriptStream::feed(std::string_view chunk) {
+    // Drop already emitted text once it dominates the buffer (amortized O(1) per byte).
+    if (m_start > 0 && m_start >= m_buf.size() / 2) {
+        m_buf.erase(0, m_start);
+        m_pos -= m_start;
+        m_start = 0;
+    }
+    m_buf.append(chunk.data(), chunk.size());
+    scan();
+}
+
+void ScriptStream::finish() {
+    m_finished = true;
+    scan();
+    if (m_in_body) {
+        // Only a delimiter on the very last line (no trailing newline) closes the body.
+        std::string_view rest(m_buf.data() + m_pos, m_buf.size() - m_pos);
+        if (m_heredocs.front().strip) while (!rest.empty() && rest.front() == '\t') rest.remove_prefix(1);
+        if (m_heredocs.size() == 1 && rest == m_heredocs.front().delim && at_boundary()) emit(m_buf.size());
+        else m_unterminated = true;
+        return;
+    }
+    bool rest_blank = true;
+    for (std::size_t i = m_start; i < m_buf.size(); ++i) if (!is_blank(m_buf[i]) && m_buf[i] != '\n') { rest_blank = false; break; }
+    if (rest_blank) return;
+    if (m_single || m_double || m_escape || m_paren > 0 || m_brace > 0 || continues_on_next_line()) {
+        m_unterminated = true;
+        return;
+    }
+    emit(m_buf.size());
+}
+
+std::optional<ScriptCommand> ScriptStream::next() {
+    if (m_ready.empty()) return std::nullopt;
+    ScriptCommand c = std::move(m_ready.front());
+    m_ready.pop_front();
+    return c;
+}
+
+bool ScriptStream::word_boundary_before(std::size_t pos) const {
+    return pos == m_start || is_separator(m_buf[pos-1]);
+}
+
+// 'a |' or 'a &&' at end of line: the pipeline/and-or goes on with the next line.
+bool ScriptStream::continues_on_next_line() const {
+    return m_last_sig == '|' || (m_last_sig == '&' && m_prev_sig == '&');
+}
+
+bool ScriptStream::at_boundary() const {
+    return m_paren == 0 && m_brace == 0 && !continues_on_next_line();
+}
+
+// At '<': registers '<<[-]WORD' (quotes removed from WORD) or skips '<<<'.
+// Returns -1 when more input is needed, 0 if not a here-doc operator, 1 if consumed.
+int ScriptStream::scan_heredoc_operator() {
+    std::size_t p = m_pos + 1, n = m_buf.size();
+    if (p + 1 >= n) return m_finished ? 0 : -1;
+    if (m_buf[p] != '<') return 0;
+    ++p;
+    if (m_buf[p] == '<') { m_pos = p + 1; m_prev_sig = m_last_sig; m_last_sig = '<'; m_cmd_pos = false; return 1; }
+    bool strip = false;
+    if (m_buf[p] == '-') { strip = true; ++p; }
+    while (p < n && is_blank(m_buf[p])) ++p;
+    std::string delim; char quote = 0; bool complete = false;
+    while (p < n) {
+        char d = m_buf[p];
+        if (quote) { if (d == quote) quote = 0; else delim.push_back(d); ++p; continue; }
+        if (d == '\'' || d == '"') { quote = d; ++p; continue; }
+        if (d == '\\' && p + 1 < n) { delim.push_back(m_buf[p+1]); p += 2; continue; }
+        if (is_separator(d) || d == '<' || d == '>') { complete = true; break; }
+        delim.push_back(d); ++p;
+    }
+    if (!complete && !m_finished) return -1;
+    if (!delim.empty()) m_heredocs.push_back({std::move(delim), strip});
+    m_pos = p; m_prev_sig = m_last_sig; m_last_sig = 'w'; m_cmd_pos = false;
+    return 1;
+}
+
+// Consumes here-doc body lines; true once every pending body is closed by its delimiter.
+bool ScriptStream::scan_heredoc_body() {
+    while (!m_heredocs.empty()) {
+        std::size_t eol = m_buf.find('\n', m_pos);
+        if (eol == std::string::npos) return false; // partial line: wait (or finish())
+        std::string_view line(m_buf.data() + m_pos, eol - m_pos);
+        if (m_heredocs.front().strip) while (!line.empty() && line.front() == '\t') line.remove_prefix(1);
+        ++m_line;
+        bool closes = line == m_heredocs.front().delim;
+        if (closes) m_heredocs.pop_front();
+        if (m_heredocs.empty()) {
+            m_in_body = false;
+            // the delimiter line ends the command line that opened the here-doc
+            if (at_boundary()) emit(eol); else m_pos = eol + 1;
+            return true;
+        }
+        m_pos = eol + 1;
+    }
+    return true;
+}
+
+void ScriptStream::scan() {
+    while (m_pos < m_buf.size()) {
+        if (m_in_body) {
+            if (!scan_heredoc_body()) return;
+            continue;
+        }
+        char c = m_buf[m_pos];
+        if (m_comment) {
+            if (c != '\n') { ++m_pos; continue; }
+            m_comment = false; // the newline is handled below
+        } else if (m_escape) {
+            m_escape = false;
+            if (c == '\n') ++m_line;
+            ++m_pos; continue;
+        } else if (m_single || m_double) {
+            if (c == '\n') ++m_line;
+            else if (m_single && c == '\'') m_single = false;
+            else if (m_double && c == '\\') m_escape = true;
+            else if (m_double && c == '"') m_double = false;
+            ++m_pos; continue;
+        }
+        if (c == '\n') {
+            ++m_line;
+            m_cmd_pos = true;
+            if (!m_heredocs.empty()) { m_in_body = true; ++m_pos; continue; }
+            if (at_boundary()) {
+                emit(m_pos);
+                continue; // emit() moved m_pos past the newline
+            }
+            ++m_pos; continue;
+        }
+        if (is_blank(c)) { ++m_pos; continue; }
+        // '{' / '}' are reserved words only when they stand alone in command position, as in
+        // the parser: 'echo {' or 'find . -exec rm {} \;' keep them as plain arguments.
+        bool reserved = false;
+        if ((c == '{' || c == '}') && m_cmd_pos && word_boundary_before(m_pos)) {
+            if (m_pos + 1 >= m_buf.size() && !m_finished) return; // wait for more input
+            reserved = m_pos + 1 >= m_buf.size() || is_separator(m_buf[m_pos+1]);
+            if (reserved) {
+                if (c == '{') ++m_brace;
+                else if (m_brace > 0) --m_brace;
+            }
+        } else if (c == '#' && word_boundary_before(m_pos)) {
+            m_comment = true; ++m_pos; continue;
+        } else if (c == '<') {
+            int r = scan_heredoc_operator();
+            if (r < 0) return;
+            if (r > 0) continue;
+        } else if (c == '\\') m_escape = true;
+        else if (c == '\'') m_single = true;
+        else if (c == '"') m_double = true;
+        else if (c == '(') ++m_paren;
+        else if (c == ')') { if (m_paren > 0) --m_paren; }
+        m_prev_sig = m_last_sig; m_last_sig = c;
+        m_cmd_pos = reserved || std::strchr(";&|()", c) != nullptr;
+        ++m_pos;
+    }
+}
+
+void ScriptStream::emit(std::size_t end) {
+    std::string text = m_buf.substr(m_start, end - m_start);
+    std::size_t line = m_unit_line;
+    m_start = (end < m_buf.size()) ? end + 1 : end;
+    m_pos = m_start;
+    m_unit_line = m_line;
+    m_last_sig = m_prev_sig = 0;
+    m_cmd_pos = true;
+    m_heredocs.clear(); m_in_body = false;
+    Lexer lx(std::move(text));
+    auto ts = lx.run();
+    AST ast = parse_tokens(ts);
+    if (!ast.list || ast.list->segments.empty()) return; // blank line or comment only
+    m_ready.push_back(ScriptCommand{std::move(ast), line});
+}
+
+} // namespace autoshell
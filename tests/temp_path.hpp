@@ -0,0 +1,53 @@
+/*
+ * Temporary files and directories for the AI layer tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#pragma once
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace autoshell::test {
+
+// Unique per process and instance: tests of one binary may hold several at once.
+inline std::filesystem::path temp_name(const std::string& prefix, const void* self, const std::string& ext = "") {
+    return std::filesystem::temp_directory_path() / (prefix + "_" + std::to_string(::getpid()) + "_" +
+           std::to_string(reinterpret_cast<std::uintptr_t>(self)) + ext);
+}
+
+// Path of an append-only log (log_record.hpp); the file, its rewrite temporary and lock file are removed at the end.
+struct TempLog {
+    std::string path;
+    explicit TempLog(const std::string& prefix = "aas_log") {
+        path = temp_name(prefix, this, ".log").string();
+        std::filesystem::remove(path);
+    }
+    ~TempLog() { std::filesystem::remove(path); std::filesystem::remove(path + ".tmp"); std::filesystem::remove(path + ".lock"); }
+};
+
+// Empty directory removed at the end; enter = also the current directory meanwhile.
+struct TempDir {
+    std::filesystem::path dir, old;
+    explicit TempDir(const std::string& prefix = "aas_dir", bool enter = false) {
+        dir = temp_name(prefix, this);
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        if (enter) { old = std::filesystem::current_path(); std::filesystem::current_path(dir); }
+    }
+    ~TempDir() {
+        if (!old.empty()) std::filesystem::current_path(old);
+        std::filesystem::remove_all(dir);
+    }
+    std::string file(const std::string& name) const { return (dir / name).string(); }
+    void write(const std::string& name, const std::string& text) const { std::ofstream(file(name)) << text; }
+    // mtime relativa esplicita: niente dipendenza dalla granularita' del filesystem
+    void age(const std::string& name, int seconds) const {
+        std::filesystem::last_write_time(file(name), std::filesystem::file_time_type::clock::now() - std::chrono::seconds(seconds));
+    }
+};
+
+} // namespace autoshell::test
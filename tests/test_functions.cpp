@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
+#include <ai-autoshell/exec/executor_posix.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace autoshell;
+
+static int run_line(ExecutorPOSIX& ex, const std::string& line) {
+    Lexer lx(line);
+    auto ts = lx.run();
+    AST ast = parse_tokens(ts);
+    return ex.run(ast);
+}
+
+TEST(Functions, DefineAndCallWithPositional) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    EXPECT_EQ(run_line(ex, "greet() { echo hello $1 $#; }"), 0);
+    ASSERT_EQ(ctx.functions.count("greet"), 1u);
+    testing::internal::CaptureStdout();
+    int st = run_line(ex, "greet world x");
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(st, 0);
+    EXPECT_EQ(out, "hello world 2\n");
+    EXPECT_TRUE(ctx.frames.empty());
+}
+
+TEST(Functions, LocalIsRestoredOnReturn) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    setenv("AIAS_FN_VAR", "outer", 1);
+    run_line(ex, "f() { local AIAS_FN_VAR=inner; echo $AIAS_FN_VAR; }");
+    testing::internal::CaptureStdout();
+    run_line(ex, "f");
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(out, "inner\n");
+    ASSERT_NE(std::getenv("AIAS_FN_VAR"), nullptr);
+    EXPECT_STREQ(std::getenv("AIAS_FN_VAR"), "outer");
+    unsetenv("AIAS_FN_VAR");
+}
+
+TEST(Functions, ReturnStopsBodyAndSetsStatus) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    run_line(ex, "f() { return 3; echo unreachable; }");
+    testing::internal::CaptureStdout();
+    int st = run_line(ex, "f");
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(st, 3);
+    EXPECT_TRUE(out.empty());
+    // after a return the caller keeps running
+    EXPECT_EQ(run_line(ex, "f || echo recovered > /dev/null"), 0);
+}
+
+TEST(Functions, NestedCallsAndForwardedArgs) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    run_line(ex, "inner() { echo $# $2; }");
+    run_line(ex, "outer() { inner \"$@\"; }");
+    testing::internal::CaptureStdout();
+    run_line(ex, "outer a b c");
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(out, "3 b\n");
+}
+
+TEST(Functions, ReturnOutsideFunctionFails) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    testing::internal::CaptureStderr();
+    EXPECT_NE(run_line(ex, "return 0"), 0);
+    testing::internal::GetCapturedStderr();
+}
+
+TEST(Functions, BackgroundCallExpandsArgumentsOnce) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    std::string counter = "/tmp/aias_fn_bg_" + std::to_string(getpid());
+    std::remove(counter.c_str());
+    run_line(ex, "f() { echo $1 > /dev/null; }");
+    testing::internal::CaptureStdout();
+    run_line(ex, "f $(echo run >> " + counter + "; echo arg) &");
+    testing::internal::GetCapturedStdout();
+    for (auto &j : ctx.jobs.list()) { int st=0; waitpid(-j.pgid, &st, 0); }
+    std::ifstream in(counter); std::string all, line;
+    while (std::getline(in, line)) all += line + "\n";
+    EXPECT_EQ(all, "run\n"); // the substitution ran in the parent only
+    std::remove(counter.c_str());
+}
+
+TEST(Functions, PrefixAssignmentsLastForTheCall) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    setenv("AIAS_FN_PREFIX", "outer", 1);
+    unsetenv("AIAS_FN_UNSET");
+    run_line(ex, "f() { echo \"in f: [$AIAS_FN_PREFIX] [$AIAS_FN_UNSET]\"; }");
+    testing::internal::CaptureStdout();
+    run_line(ex, "AIAS_FN_PREFIX=bar AIAS_FN_UNSET=x f");
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(out, "in f: [bar] [x]\n");
+    ASSERT_NE(std::getenv("AIAS_FN_PREFIX"), nullptr);
+    EXPECT_STREQ(std::getenv("AIAS_FN_PREFIX"), "outer"); // ripristinate dopo la chiamata
+    EXPECT_EQ(std::getenv("AIAS_FN_UNSET"), nullptr);
+    // Builtin: cd senza argomenti legge la HOME del prefisso
+    const char* home = std::getenv("HOME");
+    std::string saved_home = home ? home : "";
+    setenv("HOME", "/nonexistent-home", 1);
+    char* cwd = getcwd(nullptr, 0);
+    run_line(ex, "HOME=/ cd");
+    char* now = getcwd(nullptr, 0);
+    EXPECT_STREQ(now, "/");
+    EXPECT_STREQ(std::getenv("HOME"), "/nonexistent-home");
+    if (home) setenv("HOME", saved_home.c_str(), 1); else unsetenv("HOME");
+    ASSERT_EQ(chdir(cwd), 0);
+    std::free(now); std::free(cwd);
+    // Builtin speciale: l'assegnazione resta
+    run_line(ex, "AIAS_FN_UNSET=kept export AIAS_FN_UNSET");
+    EXPECT_STREQ(std::getenv("AIAS_FN_UNSET"), "kept");
+    unsetenv("AIAS_FN_PREFIX");
+    unsetenv("AIAS_FN_UNSET");
+}
+
+TEST(Functions, PrefixAssignmentsReachBackgroundCommands) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    unsetenv("AIAS_BG_PREFIX");
+    std::string out_file = "/tmp/aias_bg_env_" + std::to_string(getpid());
+    std::remove(out_file.c_str());
+    testing::internal::CaptureStdout();
+    run_line(ex, "AIAS_BG_PREFIX=baz env > " + out_file + " &");
+    testing::internal::GetCapturedStdout();
+    for (auto &j : ctx.jobs.list()) { int st=0; waitpid(-j.pgid, &st, 0); }
+    std::ifstream in(out_file); std::string line; bool found = false;
+    while (std::getline(in, line)) found = found || line == "AIAS_BG_PREFIX=baz";
+    EXPECT_TRUE(found);
+    EXPECT_EQ(std::getenv("AIAS_BG_PREFIX"), nullptr); // solo per il figlio
+    std::remove(out_file.c_str());
+}
@@ -0,0 +1,64 @@
+/*
+ * Here-document / here-string tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
+#include <ai-autoshell/exec/executor_posix.hpp>
+#include <cstdlib>
+
+using namespace autoshell;
+
+static std::string run_capture(const std::string& text, int* status = nullptr) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    Lexer lx(text);
+    auto ts = lx.run();
+    AST ast = parse_tokens(ts);
+    testing::internal::CaptureStdout();
+    int st = ex.run(ast);
+    if (status) *status = st;
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(Heredoc, LexerReplacesDelimiterWithBody) {
+    Lexer lx("cat <<EOF | wc -l\nline 1\n  line 2\nEOF\necho next");
+    auto ts = lx.run();
+    ASSERT_GE(ts.size(), 8u);
+    EXPECT_EQ(ts[1].kind, TokenKind::RedirHeredoc);
+    EXPECT_EQ(ts[2].lexeme, "line 1\n  line 2\n");
+    EXPECT_FALSE(ts[2].quoted);
+    EXPECT_EQ(ts[6].kind, TokenKind::Newline);
+    EXPECT_EQ(ts[7].lexeme, "echo");
+}
+
+TEST(Heredoc, ExpandsUnlessDelimiterIsQuoted) {
+    setenv("AIAS_HD", "world", 1);
+    int st = -1;
+    EXPECT_EQ(run_capture("cat <<EOF\nhello $AIAS_HD \\$HOME\nEOF", &st), "hello world $HOME\n");
+    EXPECT_EQ(st, 0);
+    EXPECT_EQ(run_capture("cat <<'EOF'\nhello $AIAS_HD\nEOF\n"), "hello $AIAS_HD\n");
+    unsetenv("AIAS_HD");
+}
+
+TEST(Heredoc, StripVariantRemovesLeadingTabs) {
+    EXPECT_EQ(run_capture("cat <<-END\n\t\tindented\n\tEND\n"), "indented\n");
+}
+
+TEST(Heredoc, HereStringAppendsNewline) {
+    setenv("AIAS_HD", "abc", 1);
+    EXPECT_EQ(run_capture("tr a-z A-Z <<< \"$AIAS_HD\""), "ABC\n");
+    unsetenv("AIAS_HD");
+}
+
+TEST(Heredoc, LargeBodyThroughPipeline) {
+    std::string body;
+    for (int i = 0; i < 20000; ++i) body += "0123456789\n"; // well beyond a pipe buffer
+    EXPECT_EQ(run_capture("cat <<EOF | wc -l\n" + body + "EOF\n"), "20000\n");
+}
+
+TEST(Heredoc, MissingBodyIsEmpty) {
+    // interactive single line: no body lines follow, the command still runs
+    EXPECT_EQ(run_capture("cat <<EOF"), "");
+}
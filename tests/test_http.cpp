@@ -0,0 +1,371 @@
+/*
+ * HTTP transport tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/http.hpp>
+#include <ai-autoshell/ai/llm.hpp>
+#include <ai-autoshell/ai/resilience.hpp>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+
+using namespace autoshell::ai;
+
+// Minimal HTTP/1.1 keep-alive server on 127.0.0.1: answers every request with a fixed body
+// after delay_ms and counts the TCP connections accepted / closed by the client.
+class KeepAliveServer {
+public:
+    explicit KeepAliveServer(std::string body, int delay_ms = 0) : m_body(std::move(body)), m_delay(delay_ms) {
+        m_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in a{}; a.sin_family = AF_INET; a.sin_addr.s_addr = htonl(INADDR_LOOPBACK); a.sin_port = 0;
+        bind(m_fd, reinterpret_cast<sockaddr*>(&a), sizeof(a));
+        socklen_t len = sizeof(a); getsockname(m_fd, reinterpret_cast<sockaddr*>(&a), &len);
+        m_port = ntohs(a.sin_port);
+        listen(m_fd, 8);
+        m_thread = std::thread([this]{ loop(); });
+    }
+    ~KeepAliveServer() { m_stop = true; m_thread.join(); close(m_fd); }
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(m_port) + "/api/generate"; }
+    int accepted() const { return m_accepted; }
+    int requests() const { return m_requests; }
+    int closed() const { return m_closed; }
+    // The next n requests get this status line and headers (empty JSON body) instead of the body.
+    void fail_next(int n, std::string status, std::string headers = {}) { std::lock_guard<std::mutex> lk(m_mu); m_fail_left = n; m_fail_status = std::move(status); m_fail_headers = std::move(headers); }
+private:
+    void loop() {
+        std::vector<pollfd> fds{{m_fd, POLLIN, 0}};
+        std::vector<std::string> bufs{""};
+        while (!m_stop) {
+            flush_due();
+            if (poll(fds.data(), fds.size(), 10) <= 0) continue;
+            if (fds[0].revents & POLLIN) {
+                int c = accept(m_fd, nullptr, nullptr);
+                if (c >= 0) { ++m_accepted; fds.push_back({c, POLLIN, 0}); bufs.emplace_back(); }
+            }
+            for (std::size_t i = 1; i < fds.size(); ++i) {
+                if (!(fds[i].revents & (POLLIN | POLLHUP))) continue;
+                char tmp[4096]; ssize_t n = read(fds[i].fd, tmp, sizeof(tmp));
+                if (n <= 0) { ++m_closed; std::erase_if(m_due, [&](auto& d) { return d.fd == fds[i].fd; }); close(fds[i].fd); fds.erase(fds.begin() + i); bufs.erase(bufs.begin() + i); --i; continue; }
+                bufs[i].append(tmp, static_cast<std::size_t>(n));
+                serve(fds[i].fd, bufs[i]);
+            }
+        }
+        for (std::size_t i = 1; i < fds.size(); ++i) close(fds[i].fd);
+    }
+    void serve(int fd, std::string& buf) {
+        for (;;) {
+            auto hdr_end = buf.find("\r\n\r\n");
+            if (hdr_end == std::string::npos) return;
+            std::size_t clen = 0;
+            auto cl = buf.find("Content-Length:");
+            if (cl != std::string::npos && cl < hdr_end) clen = std::stoul(buf.substr(cl + 15));
+            if (buf.size() < hdr_end + 4 + clen) return;
+            buf.erase(0, hdr_end + 4 + clen);
+            ++m_requests;
+            std::string resp = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                               std::to_string(m_body.size()) + "\r\n\r\n" + m_body;
+            {
+                std::lock_guard<std::mutex> lk(m_mu);
+                if (m_fail_left > 0) { --m_fail_left; resp = "HTTP/1.1 " + m_fail_status + "\r\n" + m_fail_headers + "Content-Length: 2\r\n\r\n{}"; }
+            }
+            m_due.push_back({fd, std::chrono::steady_clock::now() + std::chrono::milliseconds(m_delay), std::move(resp)});
+        }
+    }
+    void flush_due() {
+        auto now = std::chrono::steady_clock::now();
+        std::erase_if(m_due, [&](auto& d) {
+            if (d.at > now) return false;
+            (void)!write(d.fd, d.resp.data(), d.resp.size());
+            return true;
+        });
+    }
+    std::string m_body;
+    int m_delay = 0;
+    struct Due { int fd; std::chrono::steady_clock::time_point at; std::string resp; };
+    std::vector<Due> m_due;
+    std::mutex m_mu;
+    int m_fail_left = 0;
+    std::string m_fail_status, m_fail_headers;
+    int m_fd = -1;
+    int m_port = 0;
+    std::atomic<bool> m_stop{false};
+    std::atomic<int> m_accepted{0}, m_requests{0}, m_closed{0};
+    std::thread m_thread;
+};
+
+TEST(HttpTransport, ReusesKeepAliveConnection) {
+    KeepAliveServer srv("{\"ok\":true}");
+    HttpTransport t;
+    for (int i = 0; i < 3; ++i) {
+        HttpRequest req; req.url = srv.url(); req.body = "{\"n\":" + std::to_string(i) + "}";
+        req.headers = {"Content-Type: application/json"};
+        auto r = t.post(req);
+        EXPECT_TRUE(r.ok()) << r.error;
+        EXPECT_EQ(r.body, "{\"ok\":true}");
+    }
+    EXPECT_EQ(srv.requests(), 3);
+    EXPECT_EQ(srv.accepted(), 1);
+    EXPECT_EQ(t.stats().requests, 3u);
+    EXPECT_EQ(t.stats().connections, 1u);
+}
+
+TEST(HttpTransport, ProviderClientsShareTheSessionPool) {
+    KeepAliveServer srv("{\"model\":\"m\",\"response\":\"ls -la\",\"done\":true}");
+    LLMConfig cfg; cfg.enabled = true; cfg.provider = "ollama"; cfg.endpoint = srv.url(); cfg.timeout_seconds = 5;
+    // Client distinti (come dopo un cambio di config) continuano a usare la stessa connessione
+    for (int i = 0; i < 3; ++i) {
+        auto client = make_llm(cfg);
+        auto r = client->complete("list files");
+        ASSERT_TRUE(r.has_value());
+        EXPECT_EQ(r->text, "ls -la");
+        EXPECT_EQ(r->source, "ollama");
+    }
+    EXPECT_EQ(srv.accepted(), 1);
+}
+
+TEST(HttpTransport, StreamsNdjsonDeltasFromOllama) {
+    KeepAliveServer srv("{\"response\":\"{\\\"steps\\\":\",\"done\":false}\n"
+                        "{\"response\":\"[]}\",\"done\":false}\n"
+                        "{\"response\":\"\",\"done\":true,\"prompt_eval_count\":12,\"eval_count\":2}\n");
+    LLMConfig cfg; cfg.enabled = true; cfg.provider = "ollama"; cfg.endpoint = srv.url(); cfg.timeout_seconds = 5;
+    auto client = make_llm(cfg);
+    std::vector<std::string> deltas;
+    auto r = client->complete_stream("plan", [&](std::string_view d) { deltas.emplace_back(d); });
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(deltas, (std::vector<std::string>{"{\"steps\":", "[]}"}));
+    EXPECT_EQ(r->text, "{\"steps\":[]}");
+    EXPECT_EQ(r->prompt_tokens, 12);
+    EXPECT_EQ(r->completion_tokens, 2);
+}
+
+TEST(HttpTransport, ReportsConnectionFailure) {
+    // Porta chiusa: il server e' distrutto prima della richiesta
+    std::string url;
+    { KeepAliveServer srv("{}"); url = srv.url(); }
+    HttpTransport t;
+    HttpRequest req; req.url = url; req.body = "{}"; req.timeout_seconds = 2;
+    auto r = t.post(req);
+    EXPECT_FALSE(r.ok());
+    EXPECT_EQ(r.status, 0);
+    EXPECT_FALSE(r.error.empty());
+}
+
+TEST(HttpTransport, ReportsTimingBreakdown) {
+    const std::string body = "{\"response\":\"ls\",\"done\":true}";
+    KeepAliveServer srv(body, 30);
+    LLMConfig cfg; cfg.enabled = true; cfg.provider = "ollama"; cfg.endpoint = srv.url(); cfg.timeout_seconds = 5;
+    auto client = make_llm(cfg);
+    auto first = client->complete("a");
+    auto second = client->complete("b");
+    ASSERT_TRUE(first && second);
+    EXPECT_GE(first->timing.ttfb_us, 30000);           // ritardo del server prima del primo byte
+    EXPECT_GE(first->timing.total_us, first->timing.ttfb_us);
+    EXPECT_EQ(first->timing.tls_us, 0);                // http in chiaro
+    EXPECT_EQ(first->timing.bytes_down, static_cast<std::int64_t>(body.size()));
+    EXPECT_GT(first->timing.bytes_up, 0);
+    EXPECT_EQ(second->timing.connect_us, 0);           // connessione riusata
+}
+
+TEST(HttpTransport, RunsOutstandingRequestsConcurrently) {
+    KeepAliveServer srv("{}", 300);
+    HttpTransport t;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<HttpResponse>> futs;
+    for (int i = 0; i < 3; ++i) { HttpRequest req; req.url = srv.url(); req.body = "{}"; futs.push_back(t.post_async(req)); }
+    for (auto& f : futs) EXPECT_TRUE(f.get().ok());
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_LT(ms, 850); // in serie sarebbero >= 900ms
+    EXPECT_EQ(srv.accepted(), 3);
+}
+
+TEST(HttpTransport, CancelDropsTheTransferAtOnce) {
+    KeepAliveServer srv("{}", 10000);
+    HttpTransport t;
+    HttpRequest req; req.url = srv.url(); req.body = "{}";
+    CancelToken tok; req.cancel = tok;
+    auto fut = t.post_async(req);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    tok.cancel();
+    ASSERT_EQ(fut.wait_for(std::chrono::milliseconds(500)), std::future_status::ready);
+    EXPECT_TRUE(fut.get().cancelled());
+    // La connessione viene chiusa: il server vede EOF
+    for (int i = 0; i < 50 && srv.closed() == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(srv.closed(), 1);
+    EXPECT_EQ(t.stats().cancelled, 1u);
+}
+
+TEST(HttpTransport, DeadlineEndsSlowRequest) {
+    KeepAliveServer srv("{}", 10000);
+    HttpTransport t;
+    HttpRequest req; req.url = srv.url(); req.body = "{}";
+    req.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    auto fut = t.post_async(req);
+    ASSERT_EQ(fut.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+    EXPECT_EQ(fut.get().error, "deadline exceeded");
+}
+
+TEST(HttpTransport, ProviderAsyncCancelYieldsNoCompletion) {
+    KeepAliveServer srv("{\"response\":\"late\",\"done\":true}", 10000);
+    LLMConfig cfg; cfg.enabled = true; cfg.provider = "ollama"; cfg.endpoint = srv.url(); cfg.timeout_seconds = 30;
+    auto client = make_llm(cfg);
+    CancelToken tok;
+    auto fut = client->complete_async("plan", {}, tok);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    tok.cancel();
+    ASSERT_EQ(fut.wait_for(std::chrono::milliseconds(500)), std::future_status::ready);
+    EXPECT_FALSE(fut.get().has_value());
+}
+
+static const char* kOllamaPlan = "{\"response\":\"{\\\"steps\\\":[{\\\"command\\\":\\\"ls\\\"}]}\",\"done\":true}";
+
+static LLMConfig hedge_config(const KeepAliveServer& primary, const KeepAliveServer& secondary, int delay_ms) {
+    LLMConfig cfg; cfg.enabled = true; cfg.provider = "ollama"; cfg.endpoint = primary.url(); cfg.timeout_seconds = 30;
+    cfg.hedge_provider = "ollama"; cfg.hedge_endpoint = secondary.url(); cfg.hedge_delay_ms = delay_ms;
+    return cfg;
+}
+
+TEST(LLMHedge, SecondaryWinsWhenPrimaryIsSlow) {
+    KeepAliveServer slow(kOllamaPlan, 10000), fast(kOllamaPlan);
+    auto client = make_llm(hedge_config(slow, fast, 100));
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> deltas;
+    auto r = client->complete_stream("plan", [&](std::string_view d) { deltas.emplace_back(d); });
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->text, "{\"steps\":[{\"command\":\"ls\"}]}");
+    EXPECT_EQ(deltas, std::vector<std::string>{r->text}); // solo le delta del secondario, che ha trasmesso per primo
+    EXPECT_GE(ms, 100);
+    EXPECT_LT(ms, 2000);
+    auto st = dynamic_cast<HedgedLLMClient&>(*client).stats();
+    EXPECT_EQ(st.hedged, 1u);
+    EXPECT_EQ(st.secondary_wins, 1u);
+    EXPECT_EQ(st.losers_cancelled, 1u);
+    // Il trasferimento perdente viene staccato: il server lento vede chiudere la connessione
+    for (int i = 0; i < 100 && slow.closed() == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(slow.closed(), 1);
+}
+
+TEST(LLMHedge, FirstLegToStreamIsForwardedAndTheOtherCancelled) {
+    KeepAliveServer streaming("{\"response\":\"{\\\"steps\\\":\",\"done\":false}\n"
+                              "{\"response\":\"[{\\\"command\\\":\\\"ls\\\"}]}\",\"done\":false}\n"
+                              "{\"response\":\"\",\"done\":true}\n"),
+                    silent(kOllamaPlan, 10000);
+    auto client = make_llm(hedge_config(silent, streaming, 0)); // entrambe subito: trasmette il secondario
+    std::vector<std::string> deltas;
+    auto start = std::chrono::steady_clock::now();
+    auto r = client->complete_stream("plan", [&](std::string_view d) { deltas.emplace_back(d); });
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(deltas, (std::vector<std::string>{"{\"steps\":", "[{\"command\":\"ls\"}]}"})); // a pezzi, come arrivano
+    EXPECT_EQ(r->text, "{\"steps\":[{\"command\":\"ls\"}]}");
+    EXPECT_LT(ms, 2000);
+    auto st = dynamic_cast<HedgedLLMClient&>(*client).stats();
+    EXPECT_EQ(st.secondary_wins, 1u);
+    EXPECT_EQ(st.losers_cancelled, 1u);
+    for (int i = 0; i < 100 && silent.closed() == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(silent.closed(), 1); // il primario muto e' stato staccato al primo byte dell'altro
+}
+
+TEST(LLMHedge, FastPrimaryCostsOneRequest) {
+    KeepAliveServer primary(kOllamaPlan), secondary(kOllamaPlan);
+    auto client = make_llm(hedge_config(primary, secondary, 1000));
+    auto r = client->complete("plan");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->source, "ollama");
+    EXPECT_EQ(primary.requests(), 1);
+    EXPECT_EQ(secondary.requests(), 0);
+    EXPECT_EQ(dynamic_cast<HedgedLLMClient&>(*client).stats().hedged, 0u);
+}
+
+TEST(LLMHedge, InvalidPrimaryAnswerFailsOverAtOnce) {
+    KeepAliveServer primary("{\"response\":\"Sorry, I cannot help.\",\"done\":true}"), secondary(kOllamaPlan, 50);
+    auto client = make_llm(hedge_config(primary, secondary, 10000));
+    auto start = std::chrono::steady_clock::now();
+    auto r = client->complete("plan");
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->text, "{\"steps\":[{\"command\":\"ls\"}]}");
+    EXPECT_LT(ms, 2000); // non aspetta il ritardo di hedge
+    EXPECT_EQ(dynamic_cast<HedgedLLMClient&>(*client).stats().secondary_wins, 1u);
+}
+
+// Risponde dopo un attimo da un altro thread senza mai chiamare on_delta
+struct SilentAsyncClient : LLMClient {
+    std::optional<LLMCompletion> complete(const std::string&) override { return complete_async("", {}, {}, {}).get(); }
+    std::future<std::optional<LLMCompletion>> complete_async(const std::string&, LLMDeltaFn, CancelToken, std::chrono::steady_clock::time_point) override {
+        return std::async(std::launch::async, [] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            LLMCompletion c; c.text = "{\"steps\":[{\"command\":\"ls\"}]}"; c.source = "silent";
+            return std::optional<LLMCompletion>(c);
+        });
+    }
+};
+
+TEST(LLMHedge, NonStreamingWinnerDeliversItsDeltaBeforeTheFutureIsReady) {
+    HedgedLLMClient client(std::make_unique<SilentAsyncClient>(), std::make_unique<SilentAsyncClient>(), std::chrono::milliseconds(10000));
+    std::atomic<int> delivered{0};
+    auto fut = client.complete_async("plan", [&](std::string_view d) {
+        EXPECT_EQ(d, "{\"steps\":[{\"command\":\"ls\"}]}");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // chi chiama lavora ancora sulla delta
+        delivered++;
+    });
+    auto r = fut.get();
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->source, "silent");
+    EXPECT_EQ(delivered.load(), 1); // pronto solo dopo l'ultima delta
+}
+
+TEST(LLMHedge, NeitherValidReturnsPrimaryAnswerAndCancelStopsBoth) {
+    KeepAliveServer a("{\"response\":\"nope\",\"done\":true}"), b("{\"response\":\"also nope\",\"done\":true}");
+    auto client = make_llm(hedge_config(a, b, 0));
+    auto r = client->complete("plan");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->text, "nope");
+
+    KeepAliveServer s1(kOllamaPlan, 10000), s2(kOllamaPlan, 10000);
+    auto slow = make_llm(hedge_config(s1, s2, 0));
+    CancelToken tok;
+    auto fut = slow->complete_async("plan", {}, tok);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    tok.cancel();
+    ASSERT_EQ(fut.wait_for(std::chrono::milliseconds(500)), std::future_status::ready);
+    EXPECT_FALSE(fut.get().has_value());
+    for (int i = 0; i < 100 && s1.closed() + s2.closed() < 2; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(s1.closed() + s2.closed(), 2);
+}
+
+TEST(LLMResilience, RetryAfterFromServerThenFailover) {
+    KeepAliveServer flaky(kOllamaPlan), backup(kOllamaPlan);
+    flaky.fail_next(1, "429 Too Many Requests", "Retry-After: 1\r\n");
+    LLMConfig cfg; cfg.enabled = true; cfg.provider = "ollama"; cfg.endpoint = flaky.url(); cfg.timeout_seconds = 30;
+    cfg.retries = 1; cfg.backoff_base_ms = 1; cfg.backoff_max_ms = 2000;
+    cfg.fallback = {"ollama:llama3@" + backup.url()};
+    auto client = make_llm(cfg);
+    auto start = std::chrono::steady_clock::now();
+    auto r = client->complete("plan");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->text, "{\"steps\":[{\"command\":\"ls\"}]}");
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000)); // Retry-After: 1
+    EXPECT_EQ(flaky.requests(), 2);
+    EXPECT_EQ(backup.requests(), 0);
+
+    // 500 su tutti i tentativi del primario: passa al fallback
+    flaky.fail_next(2, "500 Internal Server Error");
+    r = client->complete("plan");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->source, "ollama");
+    EXPECT_EQ(backup.requests(), 1);
+    auto& rc = dynamic_cast<ResilientLLMClient&>(*client);
+    EXPECT_EQ(rc.stats().failovers, 1u);
+    EXPECT_EQ(rc.status()[1].name, "ollama:llama3");
+}
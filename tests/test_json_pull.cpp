@@ -0,0 +1,152 @@
+/*
+ * Pull JSON reader tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/json_pull.hpp>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include <string>
+#include <vector>
+
+using namespace autoshell::ai;
+using T = JsonReader::Token;
+
+// "tipo:testo" per ogni token fino a End/Error
+static std::vector<std::string> tokens(JsonReader& r) {
+    std::vector<std::string> out;
+    for (;;) {
+        auto t = r.next();
+        if (t == T::NeedMore || t == T::End) break;
+        bool has_text = t == T::Key || t == T::String || t == T::Number;
+        out.push_back(std::to_string(static_cast<int>(t)) + ":" + (has_text ? std::string(r.text()) : std::string()));
+        if (t == T::Error) break;
+    }
+    return out;
+}
+
+static const std::string kDoc =
+    R"({"a":[1,-2.5e3,true,false,null],"s":"plain","e":"q\"b\\n\n\u00e8\uD83D\uDE00","o":{"k":{}},"z":[]})";
+
+TEST(JsonReader, WholeDocumentTokensInOrder) {
+    JsonReader r(kDoc);
+    std::vector<T> kinds;
+    std::vector<std::string> texts;
+    for (auto t = r.next(); t != T::End && t != T::Error; t = r.next()) {
+        kinds.push_back(t);
+        if (t == T::Key || t == T::String || t == T::Number) texts.emplace_back(r.text());
+        if (t == T::String && r.text() == "plain") { // senza escape: vista sull'input, nessuna copia
+            EXPECT_EQ(r.text().data(), kDoc.data() + kDoc.find("plain"));
+        }
+    }
+    EXPECT_EQ(kinds, (std::vector<T>{T::BeginObject, T::Key, T::BeginArray, T::Number, T::Number, T::True, T::False, T::Null,
+                                     T::EndArray, T::Key, T::String, T::Key, T::String, T::Key, T::BeginObject, T::Key,
+                                     T::BeginObject, T::EndObject, T::EndObject, T::Key, T::BeginArray, T::EndArray, T::EndObject}));
+    EXPECT_EQ(texts, (std::vector<std::string>{"a", "1", "-2.5e3", "s", "plain", "e",
+                                               "q\"b\\n\n\xC3\xA8\xF0\x9F\x98\x80", "o", "k", "z"}));
+    EXPECT_TRUE(r.error().empty());
+    EXPECT_EQ(r.offset(), kDoc.size());
+}
+
+TEST(JsonReader, SameTokensForAnyChunking) {
+    JsonReader whole(kDoc);
+    auto expected = tokens(whole);
+    for (std::size_t step : {1u, 2u, 3u, 7u, 64u}) {
+        JsonReader r;
+        std::vector<std::string> got;
+        for (std::size_t off = 0; off < kDoc.size(); off += step) {
+            r.feed(std::string_view(kDoc).substr(off, step));
+            for (auto& t : tokens(r)) got.push_back(t);
+        }
+        r.finish();
+        for (auto& t : tokens(r)) got.push_back(t);
+        EXPECT_EQ(got, expected) << "chunk " << step;
+        EXPECT_EQ(r.next(), T::End);
+    }
+}
+
+TEST(JsonReader, LongStringSplitAcrossManyChunks) {
+    std::string body(200000, 'x');
+    std::size_t escapes = 0;
+    for (std::size_t i = 1000; i + 2 < body.size(); i += 4099, ++escapes) body.replace(i, 2, "\\\""); // escape a cavallo dei chunk
+    std::string doc = "[\"" + body + "\"]";
+    JsonReader r;
+    std::size_t strings = 0, len = 0;
+    for (std::size_t off = 0; off < doc.size(); off += 3) {
+        r.feed(std::string_view(doc).substr(off, 3));
+        for (auto t = r.next(); t != T::NeedMore; t = r.next()) {
+            ASSERT_NE(t, T::Error) << r.error();
+            if (t == T::String) { ++strings; len = r.text().size(); }
+        }
+    }
+    EXPECT_EQ(strings, 1u);
+    EXPECT_EQ(len, body.size() - escapes); // ogni \" diventa un byte
+}
+
+TEST(JsonReader, LenientInputAndErrors) {
+    JsonReader trailing(R"({"a":[1,2,],})");
+    std::size_t numbers = 0;
+    for (auto t = trailing.next(); t != T::End; t = trailing.next()) { ASSERT_NE(t, T::Error) << trailing.error(); numbers += t == T::Number; }
+    EXPECT_EQ(numbers, 2u);
+
+    JsonReader colon(R"({"a" 1})");
+    EXPECT_EQ(colon.next(), T::BeginObject);
+    EXPECT_EQ(colon.next(), T::Key);
+    EXPECT_EQ(colon.next(), T::Error);
+    EXPECT_EQ(colon.error(), "expected ':' at offset 5");
+    EXPECT_EQ(colon.next(), T::Error); // errore persistente
+
+    JsonReader mismatched("[1}");
+    EXPECT_EQ(tokens(mismatched).back().substr(0, 3), std::to_string(static_cast<int>(T::Error)) + ":");
+
+    JsonReader cut;
+    cut.feed(R"({"a":"unterminated)");
+    EXPECT_EQ(cut.next(), T::BeginObject);
+    EXPECT_EQ(cut.next(), T::Key);
+    EXPECT_EQ(cut.next(), T::NeedMore);
+    cut.finish();
+    EXPECT_EQ(cut.next(), T::Error);
+    JsonReader bad(R"(["\u12G4"])");
+    bad.next();
+    EXPECT_EQ(bad.next(), T::Error);
+}
+
+TEST(JsonPick, ReadsSeveralPathsInOnePass) {
+    std::string openai = R"({"id":"x","choices":[{"index":0,"message":{"role":"assistant","content":"{\"steps\":[]}"}}],)"
+                         R"("usage":{"prompt_tokens":12,"completion_tokens":34,"total_tokens":46}})";
+    auto f = json_pick(openai, {{"choices", "0", "message", "content"}, {"usage", "total_tokens"}, {"usage", "missing"}, {"choices", "1", "message", "content"}});
+    ASSERT_EQ(f.size(), 4u);
+    EXPECT_EQ(f[0], "{\"steps\":[]}");
+    EXPECT_EQ(json_to_int(f[1]), 46);
+    EXPECT_FALSE(f[2]);
+    EXPECT_FALSE(f[3]);
+
+    // La prima "text" non e' quella giusta: conta il percorso, non la prima chiave trovata
+    std::string gemini = R"({"promptFeedback":{"text":"no"},"candidates":[{"content":{"parts":[{"text":"ls -la"}]}}],"usageMetadata":{"totalTokenCount":9}})";
+    auto g = json_pick(gemini, {{"candidates", "0", "content", "parts", "0", "text"}, {"usageMetadata", "totalTokenCount"}});
+    EXPECT_EQ(g[0], "ls -la");
+    EXPECT_EQ(json_to_int(g[1]), 9);
+    EXPECT_EQ(json_pick("not json", {{"a"}})[0], std::nullopt);
+    EXPECT_EQ(json_to_int(std::string("-3")), -1);
+    EXPECT_EQ(json_to_int(std::string("true")), -1);
+}
+
+TEST(JsonPlan, UnescapesFieldsAndSkipsSurroundingText) {
+    std::string text = "Sure {not json} here you go:\n```json\n"
+                       R"({"plan":{"request":"x","steps":[{"id":"s1","description":"say \"hi\"","command":"echo \"a\\tb\" > out.txt","confirm":false,"extra":{"command":"no"}},)"
+                       R"({"id":"s2","command":"printf '%s\n' \u00e8","confirm":true},]}})"
+                       "\n```";
+    auto p = parse_plan_json(text);
+    ASSERT_TRUE(p.valid);
+    ASSERT_EQ(p.steps.size(), 2u);
+    EXPECT_EQ(p.steps[0].description, "say \"hi\"");
+    EXPECT_EQ(p.steps[0].command, "echo \"a\\tb\" > out.txt"); // campi annidati non sovrascrivono il comando
+    EXPECT_EQ(p.steps[1].command, "printf '%s\n' \xC3\xA8");
+    EXPECT_TRUE(p.steps[1].confirm);
+
+    EXPECT_FALSE(parse_plan_json(R"({"steps":[{"command":"ls"})").valid); // array mai chiuso
+    auto empty = parse_plan_json(R"({"request":"r","steps":[]})");
+    EXPECT_TRUE(empty.valid);
+    EXPECT_EQ(empty.request, "r");
+    EXPECT_FALSE(parse_plan_json("no braces at all").valid);
+}
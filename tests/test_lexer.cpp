@@ -49,3 +49,16 @@ TEST(LexerRedir, Redirections) {
     EXPECT_TRUE(foundOut);
     EXPECT_TRUE(foundErrToOut);
 }
+
+TEST(LexerMultiline, NewlinesCommentsContinuations) {
+    std::string text = "echo a # commento\necho \\\n  b\n";
+    Lexer lx(text);
+    auto ts = lx.run();
+    std::vector<std::string> words; int newlines = 0;
+    for (auto &t : ts) {
+        if (t.kind == TokenKind::Newline) ++newlines;
+        if (t.kind == TokenKind::Word) words.push_back(t.lexeme);
+    }
+    EXPECT_EQ(newlines, 2); // the escaped newline is a continuation, not a separator
+    EXPECT_EQ(words, (std::vector<std::string>{"echo", "a", "echo", "b"}));
+}
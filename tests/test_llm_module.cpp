@@ -0,0 +1,30 @@
+/*
+ * LLM module loading tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/llm_module.hpp>
+#include <cstdlib>
+
+using namespace autoshell::ai;
+
+TEST(LLMModule, LoadsOnFirstUseThroughDlopen) {
+    EXPECT_FALSE(llm_module_loaded());
+    setenv("AI_AUTOSHELL_LLM_MODULE", TEST_LLM_MODULE_PATH, 1);
+    std::string err;
+    auto* mod = llm_module(&err);
+    ASSERT_NE(mod, nullptr) << err;
+    EXPECT_TRUE(llm_module_loaded());
+    EXPECT_EQ(llm_module(), mod); // caricato una volta sola
+
+    LLMConfig cfg; cfg.enabled = true; cfg.provider = "none"; cfg.retries = 1;
+    auto client = mod->make_llm(cfg);
+    ASSERT_TRUE(client);
+    auto r = client->complete("plan");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->source, "stub_plain");
+    EXPECT_EQ(mod->failovers(*client), 0u);
+    EXPECT_NE(mod->debug_report(*client, cfg).find("[DEBUG] Resilience: requests=1"), std::string::npos);
+    EXPECT_EQ(mod->http_stats().requests, 0u);
+}
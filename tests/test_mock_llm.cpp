@@ -0,0 +1,114 @@
+/*
+ * Mock LLM server tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/llm.hpp>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include "mock_llm_server.hpp"
+#include <chrono>
+#include <string>
+
+using namespace autoshell::ai;
+using namespace std::chrono_literals;
+
+namespace {
+LLMConfig mock_config(const MockLLMServer& srv, const std::string& provider) {
+    LLMConfig cfg; cfg.enabled = true; cfg.provider = provider; cfg.model = "mock-model";
+    cfg.endpoint = srv.endpoint(provider); cfg.api_key = "mock"; cfg.timeout_seconds = 5;
+    return cfg;
+}
+}
+
+TEST(MockLLM, ParsesLatencySpecs) {
+    MockLLMOptions o;
+    ASSERT_TRUE(parse_mock_latency("uniform:100-400", o));
+    EXPECT_EQ(o.latency, MockLLMOptions::Latency::Uniform);
+    EXPECT_EQ(o.latency_max_ms, 400);
+    ASSERT_TRUE(parse_mock_latency("lognormal:200,0.8", o));
+    EXPECT_EQ(o.latency_ms, 200);
+    EXPECT_DOUBLE_EQ(o.latency_sigma, 0.8);
+    ASSERT_TRUE(parse_mock_latency("50", o));
+    EXPECT_EQ(o.latency, MockLLMOptions::Latency::Fixed);
+    EXPECT_FALSE(parse_mock_latency("uniform:400-100", o));
+    EXPECT_FALSE(parse_mock_latency("gamma:3", o));
+}
+
+TEST(MockLLM, SpeaksEveryProviderWireFormat) {
+    MockLLMOptions o;
+    o.prompt_tokens = 1000; o.completion_tokens = 50; o.cached_tokens = 800; o.chunk_bytes = 16;
+    MockLLMServer srv(o);
+    ASSERT_TRUE(srv.ok());
+    for (std::string provider : {"openai", "ollama", "claude", "gemini"}) {
+        SCOPED_TRACE(provider);
+        auto client = make_llm(mock_config(srv, provider));
+        auto r = client->complete("list files");
+        ASSERT_TRUE(r.has_value());
+        EXPECT_EQ(r->source, provider);
+        EXPECT_EQ(parse_plan_json(r->text).steps.size(), 2u) << r->text;
+        EXPECT_EQ(r->prompt_tokens, 1000); // claude: input_tokens + cache_read_input_tokens
+        EXPECT_EQ(r->completion_tokens, 50);
+
+        std::string seen;
+        int deltas = 0;
+        auto s = client->complete_stream("list files", [&](std::string_view d) { seen += d; ++deltas; });
+        ASSERT_TRUE(s.has_value());
+        EXPECT_EQ(s->text, r->text);
+        EXPECT_EQ(seen, s->text);
+        EXPECT_GT(deltas, 5);
+        EXPECT_EQ(s->completion_tokens, 50);
+        if (provider != "ollama") {
+            EXPECT_EQ(s->cached_tokens, 800);
+        }
+    }
+    auto st = srv.stats();
+    EXPECT_EQ(st.requests, 8u);
+    EXPECT_EQ(st.streamed, 4u);
+}
+
+TEST(MockLLM, InjectsThrottlingErrorsAndTimeouts) {
+    MockLLMOptions o;
+    o.retry_after_s = 3;
+    MockLLMServer srv(o);
+    ASSERT_TRUE(srv.ok());
+    auto client = make_llm(mock_config(srv, "openai"));
+    srv.fail_next(1, 429);
+    auto r = client->complete("plan");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->source, "error");
+    EXPECT_EQ(r->http_status, 429);
+    EXPECT_EQ(r->retry_after_ms, 3000);
+
+    srv.fail_next(1, 500);
+    r = client->complete("plan");
+    EXPECT_EQ(r->http_status, 500);
+
+    srv.fail_next(1, 0); // mai risposta: scade la deadline
+    auto start = std::chrono::steady_clock::now();
+    r = client->complete_async("plan", {}, CancelToken{}, start + 300ms).get();
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->source, "error");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 3s);
+
+    r = client->complete("plan"); // nuova connessione, di nuovo servito
+    EXPECT_EQ(r->source, "openai");
+    auto st = srv.stats();
+    EXPECT_EQ(st.throttled, 1u);
+    EXPECT_EQ(st.server_errors, 1u);
+    EXPECT_EQ(st.timeouts, 1u);
+}
+
+TEST(MockLLM, DelaysAnswersByTheLatencyDistribution) {
+    MockLLMOptions o;
+    ASSERT_TRUE(parse_mock_latency("uniform:80-120", o));
+    MockLLMServer srv(o);
+    auto client = make_llm(mock_config(srv, "ollama"));
+    auto start = std::chrono::steady_clock::now();
+    auto r = client->complete("plan");
+    auto took = std::chrono::steady_clock::now() - start;
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->source, "ollama");
+    EXPECT_GE(took, 80ms);
+    EXPECT_LT(took, 2s);
+}
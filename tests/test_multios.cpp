@@ -0,0 +1,74 @@
+/*
+ * Multios (output fan-out) tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
+#include <ai-autoshell/exec/executor_posix.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+using namespace autoshell;
+namespace fs = std::filesystem;
+
+class Multios : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char tmpl[] = "/tmp/aias_multios_XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        dir = tmpl;
+    }
+    void TearDown() override { std::error_code ec; fs::remove_all(dir, ec); }
+    int run_line(const std::string& line) {
+        Lexer lx(line);
+        auto ts = lx.run();
+        AST ast = parse_tokens(ts);
+        return ex.run(ast);
+    }
+    std::string path(const std::string& name) const { return dir + "/" + name; }
+    std::string slurp(const std::string& name) const {
+        std::ifstream in(path(name)); std::stringstream ss; ss << in.rdbuf(); return ss.str();
+    }
+    std::string dir;
+    ExecContext ctx;
+    ExecutorPOSIX ex{ctx};
+};
+
+TEST_F(Multios, ExternalCommandWritesEveryFile) {
+    std::ofstream(path("c.log")) << "old\n";
+    EXPECT_EQ(run_line("seq 200000 > " + path("a.log") + " > " + path("b.log") + " >> " + path("c.log")), 0);
+    std::string a = slurp("a.log");
+    EXPECT_EQ(a.size(), 1288895u); // every byte of seq 1..200000
+    EXPECT_EQ(slurp("b.log"), a);
+    EXPECT_EQ(slurp("c.log"), "old\n" + a); // append target (splice fallback path)
+}
+
+TEST_F(Multios, BuiltinUsesRelayChild) {
+    run_line("echo multi > " + path("x") + " > " + path("y"));
+    EXPECT_EQ(slurp("x"), "multi\n");
+    EXPECT_EQ(slurp("y"), "multi\n");
+}
+
+TEST_F(Multios, PipeStaysATarget) {
+    testing::internal::CaptureStdout();
+    run_line("echo hi > " + path("f") + " | tr a-z A-Z");
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "HI\n");
+    EXPECT_EQ(slurp("f"), "hi\n");
+}
+
+TEST_F(Multios, ClosedReaderDoesNotTruncateFiles) {
+    testing::internal::CaptureStdout();
+    run_line("seq 100000 > " + path("f") + " | head -n 1");
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "1\n");
+    EXPECT_EQ(slurp("f").size(), 588895u);
+}
+
+TEST_F(Multios, StderrFanOut) {
+    run_line("ls /aias_definitely_missing 2> " + path("e1") + " 2> " + path("e2"));
+    EXPECT_FALSE(slurp("e1").empty());
+    EXPECT_EQ(slurp("e1"), slurp("e2"));
+}
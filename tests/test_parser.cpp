@@ -37,3 +37,34 @@ TEST(ParserPipeline, PipeCount) {
     ASSERT_TRUE(pipe);
     EXPECT_EQ(pipe->elements.size(), 3u);
 }
+
+TEST(ParserMultiline, NewlineSeparatesCommands) {
+    std::string text = "echo a\n\necho b &&\n  echo c |\n  wc -l\n";
+    Lexer lx(text);
+    auto ts = lx.run();
+    auto ast = parse_tokens(ts);
+    ASSERT_TRUE(ast.list);
+    ASSERT_EQ(ast.list->segments.size(), 2u);
+    auto &second = ast.list->segments[1];
+    ASSERT_TRUE(second.and_or);
+    ASSERT_EQ(second.and_or->segments.size(), 2u);
+    EXPECT_EQ(second.and_or->segments[1].pipeline->elements.size(), 2u);
+}
+
+TEST(ParserErrors, ReportsFirstSyntaxError) {
+    auto check = [](const std::string& line) {
+        Lexer lx(line);
+        auto ts = lx.run();
+        std::string err;
+        parse_tokens(ts, err);
+        return err;
+    };
+    EXPECT_EQ(check("echo a | grep a && ls > out; (pwd)"), "");
+    EXPECT_EQ(check("sleep 1 &"), "");
+    EXPECT_EQ(check("ls &&"), "syntax error near end of line");
+    EXPECT_EQ(check("echo a |"), "syntax error near end of line");
+    EXPECT_EQ(check("cat >"), "syntax error near '>'");
+    EXPECT_EQ(check("(echo a"), "syntax error near end of line");
+    EXPECT_EQ(check("; ls"), "syntax error near ';'");
+    EXPECT_EQ(check("f() echo"), "syntax error near 'echo'");
+}
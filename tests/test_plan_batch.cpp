@@ -0,0 +1,148 @@
+/*
+ * Batch planning (--plan-batch) tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/plan_batch.hpp>
+#include <atomic>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace autoshell::ai;
+using namespace std::chrono_literals;
+
+namespace {
+// Risponde con un piano "echo <richiesta>"; le richieste impacchettate con un array di piani
+class FakePlanner : public LLMClient {
+public:
+    std::atomic<int> calls{0}, in_flight{0}, max_in_flight{0};
+    std::set<std::string> omit; // lasciate fuori dalle risposte impacchettate
+    std::optional<LLMCompletion> complete(const std::string& prompt) override {
+        ++calls;
+        int now = ++in_flight;
+        for (int m = max_in_flight; now > m && !max_in_flight.compare_exchange_weak(m, now);) {}
+        std::this_thread::sleep_for(20ms);
+        --in_flight;
+        std::string req = prompt.substr(prompt.rfind("Request: ") + 9);
+        if (req == "boom") return LLMCompletion{"(openai error 500)", "error"};
+        std::string text;
+        if (req.rfind("Plan each of these", 0) == 0) {
+            std::istringstream in(req.substr(req.find(':') + 1));
+            std::string line;
+            text = "[";
+            while (std::getline(in, line)) {
+                if (line.empty()) continue;
+                std::string r = line.substr(line.find(". ") + 2);
+                if (!omit.count(r)) text += (text.size() > 1 ? ", " : "") + plan(r);
+            }
+            text += "]";
+        } else text = plan(req);
+        LLMCompletion c{text, "openai"};
+        c.prompt_tokens = 100; c.completion_tokens = 20; c.total_tokens = 120;
+        return c;
+    }
+    static std::string plan(const std::string& req) {
+        return R"({"request": ")" + req + R"(", "steps": [{"id": "s1", "command": "echo )" + req + R"(", "confirm": false}]})";
+    }
+};
+
+std::vector<BatchResult> run(const std::vector<std::string>& reqs, FakePlanner& llm, BatchOptions o, BatchStats* st = nullptr) {
+    std::vector<BatchResult> out;
+    auto s = run_plan_batch(reqs, llm, o, [&](const BatchResult& r) { out.push_back(r); });
+    if (st) *st = s;
+    return out;
+}
+}
+
+TEST(PlanBatch, RateLimiterSpacesRequestsAndTokens) {
+    auto t0 = RateLimiter::Clock::now();
+    RateLimiter rpm(60, 0);
+    for (int i = 0; i < 60; ++i) EXPECT_EQ(rpm.reserve(1, t0), t0);
+    auto wait = rpm.reserve(1, t0) - t0; // secchio vuoto: un posto al secondo
+    EXPECT_NEAR(std::chrono::duration<double>(wait).count(), 1.0, 0.01);
+    EXPECT_EQ(rpm.reserve(1, t0 + 120s), t0 + 120s); // ricaricato
+
+    RateLimiter tpm(0, 1000);
+    EXPECT_EQ(tpm.reserve(600, t0), t0);
+    EXPECT_NEAR(std::chrono::duration<double>(tpm.reserve(600, t0) - t0).count(), 12.0, 0.01);
+    tpm.settle(600, 100); // usati meno token di quelli riservati
+    EXPECT_EQ(tpm.reserve(300, t0), t0);
+    tpm.pause_until(t0 + 5s); // 429 con Retry-After
+    EXPECT_EQ(RateLimiter(0, 0).reserve(1, t0), t0);
+    EXPECT_GE(tpm.reserve(0, t0), t0 + 5s);
+}
+
+TEST(PlanBatch, PlansConcurrentlyInInputOrderWithDedupeAndCache) {
+    FakePlanner llm;
+    std::vector<std::string> reqs = {"list files", "show disk usage", "List   FILES", "cached one", "count lines", "rm build"};
+    std::map<std::string, std::string> cache = {{"cached one", FakePlanner::plan("cached one")}};
+    std::vector<std::string> stored;
+    BatchOptions o;
+    o.jobs = 4;
+    o.cache_get = [&](const std::string& r) -> std::optional<std::string> { auto it = cache.find(r); if (it == cache.end()) return std::nullopt; return it->second; };
+    o.cache_put = [&](const std::string& r, const std::string&) { stored.push_back(r); };
+    o.risky = [](const std::string& c) { return c.find("rm") != std::string::npos; };
+    BatchStats st;
+    auto out = run(reqs, llm, o, &st);
+    ASSERT_EQ(out.size(), reqs.size());
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        EXPECT_EQ(out[i].index, i);
+        EXPECT_EQ(out[i].plan.request, reqs[i]);
+        EXPECT_TRUE(out[i].error.empty());
+    }
+    EXPECT_EQ(out[0].source, "llm");
+    EXPECT_EQ(out[2].source, "duplicate"); // stessa chiave normalizzata di "list files"
+    EXPECT_EQ(out[2].plan.steps[0].command, "echo list files");
+    EXPECT_EQ(out[3].source, "cache");
+    EXPECT_TRUE(out[5].plan.dangerous);
+    EXPECT_EQ(llm.calls, 4);
+    EXPECT_GT(llm.max_in_flight, 1);
+    EXPECT_LE(llm.max_in_flight, 4);
+    EXPECT_EQ(stored.size(), 4u);
+    EXPECT_EQ(st.planned, 6u);
+    EXPECT_EQ(st.cache_hits, 1u);
+    EXPECT_EQ(st.duplicates, 1u);
+    EXPECT_EQ(st.prompt_tokens, 400);
+}
+
+TEST(PlanBatch, PacksShortRequestsAndRetriesMissingOnes) {
+    FakePlanner llm;
+    llm.omit = {"b"};
+    BatchOptions o;
+    o.pack = 3;
+    o.pack_max_chars = 10;
+    o.jobs = 2;
+    BatchStats st;
+    auto out = run({"a", "b", "c", "d", "a long request that is not packed"}, llm, o, &st);
+    ASSERT_EQ(out.size(), 5u);
+    EXPECT_EQ(out[0].source, "packed");
+    EXPECT_EQ(out[0].plan.steps[0].command, "echo a");
+    EXPECT_EQ(out[1].source, "llm"); // mancante dall'array: richiesta di nuovo da sola
+    EXPECT_EQ(out[2].plan.steps[0].command, "echo c");
+    EXPECT_EQ(out[3].source, "llm"); // unico rimasto: nessun pacchetto da uno
+    EXPECT_EQ(st.planned, 5u);
+    EXPECT_EQ(st.packed_calls, 1u);
+    EXPECT_EQ(llm.calls, 4); // {a,b,c} + {d} + lunga + b
+}
+
+TEST(PlanBatch, FailuresBecomeErrorLines) {
+    FakePlanner llm;
+    BatchOptions o;
+    auto out = run({"boom", "ok"}, llm, o);
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[0].source, "error");
+    EXPECT_EQ(out[0].error, "(openai error 500)");
+    auto line = batch_result_json(out[0]);
+    EXPECT_EQ(line.rfind(R"j({"error": "(openai error 500)", "request": "boom")j", 0), 0u) << line;
+    EXPECT_EQ(line.find('\n'), line.size() - 1); // una riga sola
+
+    Plan p;
+    p.request = "say \"hi\"";
+    p.steps.push_back(PlanStep{"s1", "two lines", "printf 'a\\nb'\n", false, {}, false, {}, {}});
+    auto j = to_json(p, false);
+    EXPECT_EQ(j, R"({"request": "say \"hi\"","dangerous": false,"risk_summary": "","steps": [{ "id": "s1", "description": "two lines", "command": "printf 'a\\nb'\n", "confirm": false }]})" "\n");
+}
@@ -0,0 +1,146 @@
+/*
+ * Persistent plan cache tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/plan_cache.hpp>
+#include "temp_path.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace autoshell::ai;
+using autoshell::test::TempLog;
+namespace fs = std::filesystem;
+
+namespace {
+PlanCacheOptions opts(const std::string& path, std::size_t max_entries = 256) {
+    PlanCacheOptions o;
+    o.path = path;
+    o.max_entries = max_entries;
+    return o;
+}
+
+const std::string kPlan = "{\"request\":\"list\",\"steps\":[{\"id\":\"s1\",\"command\":\"ls -la\\tx\",\"confirm\":false}]}\n";
+}
+
+TEST(PlanCache, KeyNormalizesRequestAndSeparatesModels) {
+    auto a = PlanCache::make_key("  List   the FILES\n", "openai", "gpt-4o-mini", "v1");
+    EXPECT_EQ(a, "openai|gpt-4o-mini|v1|list the files");
+    EXPECT_EQ(a, PlanCache::make_key("list the files", "openai", "gpt-4o-mini", "v1"));
+    EXPECT_NE(a, PlanCache::make_key("list the files", "openai", "gpt-4o", "v1"));
+    EXPECT_NE(a, PlanCache::make_key("list the files", "ollama", "gpt-4o-mini", "v1"));
+    EXPECT_NE(a, PlanCache::make_key("list the files", "openai", "gpt-4o-mini", "v2"));
+}
+
+TEST(PlanCache, PersistsAcrossInstances) {
+    TempLog log("plan_cache");
+    {
+        PlanCache c(opts(log.path));
+        EXPECT_FALSE(c.get("k1").has_value());
+        c.put("k1", "List files", kPlan);
+        EXPECT_EQ(c.get("k1"), kPlan);
+        EXPECT_EQ(c.stats().hits, 1u);
+        EXPECT_EQ(c.stats().misses, 1u);
+        EXPECT_DOUBLE_EQ(c.stats().hit_rate(), 0.5);
+    }
+    PlanCache c2(opts(log.path));
+    ASSERT_EQ(c2.entries().size(), 1u);
+    EXPECT_EQ(c2.entries()[0].request, "List files");
+    EXPECT_EQ(c2.entries()[0].hits, 1u);
+    EXPECT_EQ(c2.get("k1"), kPlan); // tab e newline nel piano sopravvivono al log
+}
+
+TEST(PlanCache, EvictsLeastRecentlyUsedAndRemembersIt) {
+    TempLog log("plan_cache");
+    {
+        PlanCache c(opts(log.path, 2));
+        c.put("a", "a", "A");
+        c.put("b", "b", "B");
+        ASSERT_TRUE(c.get("a")); // b diventa la meno recente
+        c.put("c", "c", "C");
+        EXPECT_FALSE(c.get("b"));
+        EXPECT_EQ(c.stats().evictions, 1u);
+        auto e = c.entries();
+        ASSERT_EQ(e.size(), 2u);
+        EXPECT_EQ(e[0].key, "c");
+        EXPECT_EQ(e[1].key, "a");
+    }
+    PlanCache c2(opts(log.path, 2));
+    auto e = c2.entries();
+    ASSERT_EQ(e.size(), 2u);
+    EXPECT_EQ(e[0].key, "c");
+    EXPECT_EQ(e[1].key, "a");
+}
+
+TEST(PlanCache, ByteCapEvictsOldest) {
+    PlanCacheOptions o;
+    o.max_bytes = 10;
+    PlanCache c(o);
+    c.put("a", "a", "1234");
+    c.put("b", "b", "1234");
+    EXPECT_EQ(c.stats().entries, 2u);
+    c.put("c", "c", "1234");
+    EXPECT_EQ(c.stats().entries, 2u);
+    EXPECT_LE(c.stats().bytes, 10u);
+    EXPECT_FALSE(c.get("a"));
+}
+
+TEST(PlanCache, EntriesExpireAfterTtl) {
+    TempLog log("plan_cache");
+    std::int64_t clock = 1000;
+    PlanCacheOptions o = opts(log.path);
+    o.ttl_seconds = 60;
+    o.now = [&] { return clock; };
+    {
+        PlanCache c(o);
+        c.put("k", "k", "plan");
+        clock += 59;
+        EXPECT_TRUE(c.get("k"));
+        clock += 2;
+        EXPECT_FALSE(c.get("k")); // la TTL conta dalla creazione, non dall'ultimo uso
+    }
+    clock = 1000;
+    PlanCache c2(o);
+    EXPECT_TRUE(c2.entries().empty());
+}
+
+TEST(PlanCache, SkipsTornRecordAfterCrash) {
+    TempLog log("plan_cache");
+    { PlanCache c(opts(log.path)); c.put("ok", "ok", "plan"); }
+    {
+        // Scrittura interrotta: record senza checksum ne' newline, poi una riga corrotta
+        std::ofstream out(log.path, std::ios::app);
+        out << "P\t1\t1\t0\tbad\tbad\tcorrupted\t00000000\nP\t1\t1\t0\ttorn\ttorn\t{\"ste";
+    }
+    PlanCache c(opts(log.path));
+    ASSERT_EQ(c.entries().size(), 1u);
+    EXPECT_EQ(c.get("ok"), "plan");
+    c.put("next", "next", "plan2"); // il log e' stato ricompattato: il nuovo record e' leggibile
+    PlanCache c2(opts(log.path));
+    EXPECT_EQ(c2.entries().size(), 2u);
+}
+
+TEST(PlanCache, ClearEmptiesTheLog) {
+    TempLog log("plan_cache");
+    PlanCache c(opts(log.path));
+    c.put("k", "k", "plan");
+    c.clear();
+    EXPECT_EQ(c.stats().entries, 0u);
+    EXPECT_EQ(fs::file_size(log.path), 0u);
+    PlanCache c2(opts(log.path));
+    EXPECT_TRUE(c2.entries().empty());
+}
+
+TEST(PlanCache, CompactionKeepsEntriesWrittenByAnotherShell) {
+    TempLog log("plan_cache_shared");
+    PlanCache a(opts(log.path)), b(opts(log.path));
+    b.put("k-other", "other shell", kPlan);
+    // Abbastanza record da far compattare a: prima rilegge il log, quindi la entry di b resta
+    for (int i = 0; i < 80; ++i) a.put("k-mine", "mine", kPlan);
+    EXPECT_TRUE(a.get("k-other", false).has_value());
+    PlanCache reopened(opts(log.path));
+    EXPECT_EQ(reopened.get("k-other"), kPlan);
+    EXPECT_EQ(reopened.get("k-mine"), kPlan);
+}
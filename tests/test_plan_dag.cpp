@@ -0,0 +1,245 @@
+/*
+ * Plan DAG tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/plan_dag.hpp>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include <ai-autoshell/exec/executor_posix.hpp>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
+#include "temp_path.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <csignal>
+#include <thread>
+#include <unistd.h>
+
+using namespace autoshell::ai;
+
+namespace {
+
+PlanStep step(std::string id, std::string cmd, std::vector<std::string> deps = {}, bool parallel = false) {
+    PlanStep s;
+    s.id = std::move(id);
+    s.description = s.id;
+    s.command = std::move(cmd);
+    s.depends_on = std::move(deps);
+    s.parallel = parallel;
+    return s;
+}
+
+// Il comando di test: "sleep:<ms>", "echo:<testo>", "fail:<codice>" separati da ';'
+int fake_run(const PlanStep& s) {
+    std::istringstream in(s.command);
+    std::string part;
+    while (std::getline(in, part, ';')) {
+        auto colon = part.find(':');
+        auto verb = part.substr(0, colon), arg = part.substr(colon + 1);
+        if (verb == "sleep") std::this_thread::sleep_for(std::chrono::milliseconds(std::stoi(arg)));
+        else if (verb == "echo") { std::cout << arg << std::endl; }
+        else if (verb == "fail") return std::stoi(arg);
+    }
+    return 0;
+}
+
+// pid scritto dal comando di uno step; 0 finche' il file non e' completo
+pid_t read_pid(const std::string& path) {
+    pid_t pid = 0;
+    std::ifstream(path) >> pid;
+    return pid;
+}
+
+// Vivo = esiste e non e' uno zombie (gli orfani li raccoglie init, quando lo fa)
+bool running(pid_t pid) {
+    if (kill(pid, 0) != 0) return false;
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line)) return true;
+    auto paren = line.rfind(')');
+    return paren == std::string::npos || paren + 2 >= line.size() || line[paren + 2] != 'Z';
+}
+
+} // namespace
+
+TEST(PlanGraph, SequentialPlanIsNotConcurrent) {
+    auto g = build_plan_graph({step("1", "a"), step("1", "b"), step("2", "c")}); // id duplicati tollerati nel piano classico
+    EXPECT_FALSE(g.concurrent);
+    EXPECT_TRUE(g.error.empty());
+    ASSERT_EQ(g.deps.size(), 3u);
+    EXPECT_TRUE(g.deps[0].empty());
+    EXPECT_EQ(g.deps[2], std::vector<std::size_t>{1});
+}
+
+TEST(PlanGraph, RejectsStateOnlyStepsWhenConcurrent) {
+    // Sequenziale: gli step girano nella shell, 'cd' vale per i successivi
+    EXPECT_TRUE(build_plan_graph({step("s1", "cd build"), step("s2", "make")}).error.empty());
+    auto g = build_plan_graph({step("s1", "cd build"), step("s2", "make", {"s1"})});
+    EXPECT_NE(g.error.find("step 's1' only changes shell state"), std::string::npos) << g.error;
+    EXPECT_FALSE(build_plan_graph({step("a", "export CC=clang; X=1"), step("b", "make", {}, true)}).error.empty());
+    EXPECT_TRUE(build_plan_graph({step("s1", "cd build && make"), step("s2", "CC=clang make", {"s1"}), step("s3", "ls | cd", {}, true)}).error.empty());
+}
+
+TEST(PlanGraph, DependsOnAndParallel) {
+    auto g = build_plan_graph({step("a", "x"), step("b", "x", {}, true), step("c", "x", {"a", "b", "a"}), step("d", "x")});
+    EXPECT_TRUE(g.concurrent);
+    EXPECT_TRUE(g.error.empty()) << g.error;
+    EXPECT_TRUE(g.deps[1].empty());
+    EXPECT_EQ(g.deps[2], (std::vector<std::size_t>{0, 1}));
+    EXPECT_EQ(g.deps[3], std::vector<std::size_t>{2}); // senza depends_on: dopo il precedente
+}
+
+TEST(PlanGraph, RejectsUnknownDuplicateSelfAndCycles) {
+    EXPECT_NE(build_plan_graph({step("a", "x"), step("b", "x", {"zz"})}).error.find("unknown step 'zz'"), std::string::npos);
+    EXPECT_NE(build_plan_graph({step("a", "x"), step("a", "x", {}, true)}).error.find("duplicate"), std::string::npos);
+    EXPECT_NE(build_plan_graph({step("a", "x", {"a"})}).error.find("itself"), std::string::npos);
+    auto g = build_plan_graph({step("a", "x", {"c"}), step("b", "x", {"a"}), step("c", "x", {"b"}), step("d", "x", {}, true)});
+    EXPECT_NE(g.error.find("cycle"), std::string::npos);
+    EXPECT_NE(g.error.find("a b c"), std::string::npos) << g.error;
+}
+
+TEST(PlanDag, IndependentStepsRunConcurrently) {
+    std::vector<PlanStep> steps{step("a", "sleep:300", {}, true), step("b", "sleep:300", {}, true), step("c", "sleep:300", {}, true)};
+    auto g = build_plan_graph(steps);
+    std::ostringstream out;
+    DagRunOptions o; o.run = [&](std::size_t i) { return fake_run(steps[i]); }; o.out = &out;
+    auto t0 = std::chrono::steady_clock::now();
+    auto r = run_plan_dag(steps, g, o);
+    auto wide = std::chrono::steady_clock::now() - t0;
+    for (auto& x : r) EXPECT_EQ(x.state, StepOutcome::State::Ok);
+    EXPECT_LT(wide, std::chrono::milliseconds(800));
+
+    o.max_parallel = 1;
+    t0 = std::chrono::steady_clock::now();
+    run_plan_dag(steps, g, o);
+    EXPECT_GE(std::chrono::steady_clock::now() - t0, std::chrono::milliseconds(900));
+}
+
+TEST(PlanDag, OutputIsGroupedInPlanOrder) {
+    // b finisce prima di a, ma la sua uscita compare dopo quella di a
+    std::vector<PlanStep> steps{step("a", "echo:a1;sleep:200;echo:a2", {}, true), step("b", "echo:b1;echo:b2", {}, true),
+                                step("c", "echo:c1", {"a", "b"})};
+    std::ostringstream out;
+    DagRunOptions o; o.run = [&](std::size_t i) { return fake_run(steps[i]); }; o.out = &out;
+    run_plan_dag(steps, build_plan_graph(steps), o);
+    EXPECT_EQ(out.str(), "Executing [a]: echo:a1;sleep:200;echo:a2\na1\na2\n"
+                         "Executing [b]: echo:b1;echo:b2\nb1\nb2\n"
+                         "Executing [c]: echo:c1\nc1\n");
+}
+
+TEST(PlanDag, FailureSkipsDependantsOnly) {
+    std::vector<PlanStep> steps{step("a", "fail:3", {}, true), step("b", "echo:b", {}, true), step("c", "echo:c", {"a"}),
+                                step("d", "echo:d", {"c"}), step("e", "echo:e", {"b"})};
+    std::ostringstream out;
+    DagRunOptions o; o.run = [&](std::size_t i) { return fake_run(steps[i]); }; o.out = &out;
+    auto r = run_plan_dag(steps, build_plan_graph(steps), o);
+    EXPECT_EQ(r[0].state, StepOutcome::State::Failed);
+    EXPECT_EQ(r[0].status, 3);
+    EXPECT_EQ(r[1].state, StepOutcome::State::Ok);
+    EXPECT_EQ(r[2].state, StepOutcome::State::Skipped);
+    EXPECT_EQ(r[2].blocked_by, "a");
+    EXPECT_EQ(r[3].blocked_by, "a"); // a catena: la causa resta lo step fallito
+    EXPECT_EQ(r[4].state, StepOutcome::State::Ok);
+    auto text = out.str();
+    EXPECT_NE(text.find("Step a failed status=3\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("Skipped [d]: depends on failed step a\n"), std::string::npos) << text;
+}
+
+TEST(PlanDag, InterruptTerminatesRunningSteps) {
+    std::vector<PlanStep> steps{step("a", "sleep:5000", {}, true), step("b", "echo:b", {"a"})};
+    std::ostringstream out;
+    DagRunOptions o; o.run = [&](std::size_t i) { return fake_run(steps[i]); }; o.out = &out;
+    auto t0 = std::chrono::steady_clock::now();
+    o.interrupted = [&] { return std::chrono::steady_clock::now() - t0 > std::chrono::milliseconds(100); };
+    auto r = run_plan_dag(steps, build_plan_graph(steps), o);
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(3));
+    EXPECT_EQ(r[0].state, StepOutcome::State::Failed);
+    EXPECT_EQ(r[0].status, 128 + SIGTERM);
+    EXPECT_EQ(r[1].blocked_by, "interrupted");
+}
+
+TEST(PlanDag, InterruptKillsTheCommandsOfRunningSteps) {
+    autoshell::test::TempDir td("aas_dag", true);
+    std::vector<PlanStep> steps{step("a", "sh -c 'echo $$ > a.pid; exec sleep 30'", {}, true),
+                                step("b", "(sh -c 'echo $$ > b.pid; exec sleep 30')", {}, true)};
+    std::ostringstream out;
+    DagRunOptions o; o.out = &out;
+    o.run = [&](std::size_t i) {
+        autoshell::ExecContext ctx; ctx.job_control = false; // come negli step concorrenti della shell
+        autoshell::ExecutorPOSIX ex(ctx);
+        autoshell::Lexer lx(steps[i].command);
+        auto ts = lx.run();
+        return ex.run(autoshell::parse_tokens(ts));
+    };
+    auto t0 = std::chrono::steady_clock::now();
+    o.interrupted = [&] { return (read_pid("a.pid") > 0 && read_pid("b.pid") > 0) || std::chrono::steady_clock::now() - t0 > std::chrono::seconds(5); };
+    auto r = run_plan_dag(steps, build_plan_graph(steps), o);
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(10));
+    EXPECT_EQ(r[0].state, StepOutcome::State::Failed);
+    EXPECT_EQ(r[1].state, StepOutcome::State::Failed);
+    pid_t a = read_pid("a.pid"), b = read_pid("b.pid");
+    ASSERT_GT(a, 0);
+    ASSERT_GT(b, 0);
+    EXPECT_FALSE(running(a)); // il sleep dello step, gia' raccolto quando lo step risulta fallito
+    EXPECT_FALSE(running(b)); // anche dentro una subshell, che altrimenti avrebbe un gruppo suo
+}
+
+TEST(PlanDag, JsonPlanCarriesDependencies) {
+    std::string json = R"({"steps":[{"id":"a","description":"d","command":"ls"},)"
+                       R"({"id":"b","description":"d","command":"pwd","parallel":true},)"
+                       R"({"id":"c","description":"d","command":"wc","depends_on":["a","b"],"inputs":["x.txt"],"outputs":"y.txt"}]})";
+    auto parsed = parse_plan_json(json);
+    ASSERT_TRUE(parsed.valid);
+    ASSERT_EQ(parsed.steps.size(), 3u);
+    EXPECT_FALSE(parsed.steps[0].parallel);
+    EXPECT_TRUE(parsed.steps[1].parallel);
+    EXPECT_EQ(parsed.steps[2].depends_on, (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(parsed.steps[2].inputs, std::vector<std::string>{"x.txt"});
+    EXPECT_EQ(parsed.steps[2].outputs, std::vector<std::string>{"y.txt"}); // anche stringa singola
+
+    Plan p;
+    p.steps = {step("a", "ls"), step("c", "wc", {"a"}, true)};
+    p.steps[1].outputs = {"out.txt"};
+    auto j = to_json(p);
+    EXPECT_NE(j.find(R"("outputs": ["out.txt"])"), std::string::npos) << j;
+    EXPECT_NE(j.find(R"("depends_on": ["a"])"), std::string::npos) << j;
+    EXPECT_NE(j.find(R"("parallel": true)"), std::string::npos) << j;
+}
+
+TEST(PlanDag, DoneStepsAreNotRunAgain) {
+    std::vector<PlanStep> steps{step("a", "fail:9"), step("b", "echo:b"), step("c", "echo:c", {"a"})};
+    std::ostringstream out;
+    std::vector<std::size_t> started, finished;
+    DagRunOptions o; o.run = [&](std::size_t i) { return fake_run(steps[i]); }; o.out = &out;
+    o.done = {true, false, false}; // 'a' riuscito in una run precedente
+    o.on_start = [&](std::size_t i) { started.push_back(i); };
+    o.on_finish = [&](std::size_t i, const StepOutcome& r) { finished.push_back(i); EXPECT_GE(r.duration_ms, 0); };
+    auto r = run_plan_dag(steps, build_plan_graph(steps), o);
+    EXPECT_EQ(r[0].state, StepOutcome::State::Ok);
+    EXPECT_EQ(r[2].state, StepOutcome::State::Ok);
+    EXPECT_EQ(started, (std::vector<std::size_t>{1, 2}));
+    EXPECT_EQ(finished, (std::vector<std::size_t>{1, 2}));
+    EXPECT_EQ(out.str().rfind("Done [a]: fail:9 (earlier run)\n", 0), 0u) << out.str();
+}
+
+TEST(PlanDag, UpToDateStepsAreNotRun) {
+    std::vector<PlanStep> steps{step("gen", "fail:3"), step("use", "echo:use", {"gen"}), step("tail", "echo:tail", {}, true)};
+    std::ostringstream out;
+    std::vector<std::size_t> asked, started;
+    DagRunOptions o; o.run = [&](std::size_t i) { return fake_run(steps[i]); }; o.out = &out;
+    o.up_to_date = [&](std::size_t i) { asked.push_back(i); return i == 0; };
+    o.on_start = [&](std::size_t i) { started.push_back(i); };
+    auto r = run_plan_dag(steps, build_plan_graph(steps), o);
+    EXPECT_EQ(r[0].state, StepOutcome::State::Ok);
+    EXPECT_TRUE(r[0].up_to_date);
+    EXPECT_EQ(r[1].state, StepOutcome::State::Ok); // la dipendenza aggiornata non blocca
+    EXPECT_FALSE(r[1].up_to_date);
+    std::sort(started.begin(), started.end());
+    EXPECT_EQ(started, (std::vector<std::size_t>{1, 2}));
+    EXPECT_EQ(asked.size(), 3u);
+    EXPECT_EQ(out.str().rfind("Up to date [gen]: fail:3\n", 0), 0u) << out.str();
+}
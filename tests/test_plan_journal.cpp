@@ -0,0 +1,173 @@
+/*
+ * Plan journal (ai resume) tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/plan_journal.hpp>
+#include <ai-autoshell/exec/executor_posix.hpp>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
+#include "temp_path.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace autoshell::ai;
+using autoshell::test::TempDir;
+using autoshell::test::TempLog;
+using State = PlanJournal::StepState;
+
+namespace {
+PlanJournalOptions opts(const std::string& path, std::size_t max_runs = 20) {
+    PlanJournalOptions o;
+    o.path = path;
+    o.max_runs = max_runs;
+    return o;
+}
+
+std::vector<PlanStep> three_steps() {
+    std::vector<PlanStep> steps(3);
+    steps[0].id = "build"; steps[0].command = "make -j8\tall"; steps[0].description = "Build";
+    steps[1].id = "test"; steps[1].command = "ctest"; steps[1].depends_on = {"build"};
+    steps[1].inputs = {"build/app", "test data.txt"}; steps[1].outputs = {"Testing/log"};
+    steps[2].id = "pack"; steps[2].command = "rm -rf dist && cpack"; steps[2].confirm = true; steps[2].parallel = true;
+    return steps;
+}
+}
+
+TEST(PlanJournal, PersistsStepsAndCheckpoints) {
+    TempLog log("plan_journal");
+    std::string id;
+    {
+        PlanJournal j(opts(log.path));
+        id = j.begin("build and package", three_steps(), "/work/project dir");
+        EXPECT_EQ(id, "1");
+        j.step_started(id, 0);
+        j.step_finished(id, 0, State::Ok, 0, 1200);
+        j.step_started(id, 1);
+        j.step_finished(id, 1, State::Failed, 8, 300);
+        j.step_started(id, 2); // shell uccisa a meta' step
+    }
+    PlanJournal j2(opts(log.path));
+    auto run = j2.find("");
+    ASSERT_TRUE(run.has_value());
+    EXPECT_EQ(run->id, id);
+    EXPECT_EQ(run->request, "build and package");
+    EXPECT_EQ(run->cwd, "/work/project dir");
+    ASSERT_EQ(run->steps.size(), 3u);
+    EXPECT_EQ(run->steps[0].command, "make -j8\tall");
+    EXPECT_EQ(run->steps[0].description, "Build");
+    EXPECT_EQ(run->steps[1].depends_on, std::vector<std::string>{"build"});
+    EXPECT_EQ(run->steps[1].inputs, (std::vector<std::string>{"build/app", "test data.txt"}));
+    EXPECT_EQ(run->steps[1].outputs, std::vector<std::string>{"Testing/log"});
+    EXPECT_TRUE(run->steps[2].confirm);
+    EXPECT_TRUE(run->steps[2].parallel);
+    EXPECT_EQ(run->records[0].state, State::Ok);
+    EXPECT_EQ(run->records[0].duration_ms, 1200);
+    EXPECT_EQ(run->records[1].state, State::Failed);
+    EXPECT_EQ(run->records[1].status, 8);
+    EXPECT_EQ(run->records[2].state, State::Running);
+    EXPECT_FALSE(run->complete());
+    EXPECT_EQ(run->remaining(), 2u);
+    EXPECT_EQ(j2.begin("next", three_steps()), "2"); // gli id proseguono dopo il replay
+}
+
+TEST(PlanJournal, FindSkipsCompletedRuns) {
+    PlanJournal j({});
+    auto a = j.begin("a", three_steps());
+    auto b = j.begin("b", three_steps());
+    for (std::size_t i = 0; i < 3; ++i) j.step_finished(b, i, State::Ok, 0, 1);
+    EXPECT_EQ(j.find("")->id, a); // la piu' recente non completa
+    EXPECT_TRUE(j.find(b)->complete());
+    EXPECT_FALSE(j.find("42").has_value());
+    for (std::size_t i = 0; i < 3; ++i) j.step_finished(a, i, State::Ok, 0, 1);
+    EXPECT_FALSE(j.find("").has_value());
+}
+
+TEST(PlanJournal, ResumeReplaysStateOnlySteps) {
+    TempDir td("aas_resume", true);
+    std::filesystem::create_directory("sub");
+    std::vector<PlanStep> steps(3);
+    steps[0].id = "s1"; steps[0].command = "cd sub";
+    steps[1].id = "s2"; steps[1].command = "echo made > made.txt";
+    steps[2].id = "s3"; steps[2].command = "touch f";
+    PlanJournal j({});
+    auto id = j.begin("touch f in sub", steps, td.dir.string());
+    j.step_finished(id, 0, State::Ok, 0, 1);
+    j.step_finished(id, 1, State::Ok, 0, 1);
+    j.step_finished(id, 2, State::Failed, 1, 1);
+    std::filesystem::current_path(td.dir); // la shell riparte dalla directory del piano
+    auto run = j.find(id);
+    ASSERT_TRUE(run.has_value());
+    EXPECT_EQ(run->resume_done(), (std::vector<bool>{false, true, false})); // il cd si rifa', l'echo no
+    autoshell::ExecContext ctx; autoshell::ExecutorPOSIX ex(ctx);
+    auto done = run->resume_done();
+    for (std::size_t i = 0; i < run->steps.size(); ++i) {
+        if (done[i]) continue;
+        autoshell::Lexer lx(run->steps[i].command);
+        auto ts = lx.run();
+        EXPECT_EQ(ex.run(autoshell::parse_tokens(ts)), 0);
+    }
+    EXPECT_TRUE(std::filesystem::exists(td.dir / "sub" / "f"));
+    EXPECT_FALSE(std::filesystem::exists(td.dir / "f"));
+}
+
+TEST(PlanJournal, KeepsOnlyTheLastRuns) {
+    TempLog log("plan_journal");
+    {
+        PlanJournal j(opts(log.path, 2));
+        for (int i = 0; i < 5; ++i) j.begin("r" + std::to_string(i), three_steps());
+        ASSERT_EQ(j.runs().size(), 2u);
+        EXPECT_EQ(j.runs()[0].request, "r4");
+    }
+    PlanJournal j2(opts(log.path, 2));
+    auto runs = j2.runs();
+    ASSERT_EQ(runs.size(), 2u);
+    EXPECT_EQ(runs[1].request, "r3");
+    EXPECT_EQ(runs[0].id, "5");
+}
+
+TEST(PlanJournal, SkipsTornRecordAfterCrash) {
+    TempLog log("plan_journal");
+    {
+        PlanJournal j(opts(log.path));
+        auto id = j.begin("x", three_steps());
+        j.step_finished(id, 0, State::Ok, 0, 5);
+    }
+    { std::ofstream(log.path, std::ios::app) << "E\t1\t1\t2\t0"; } // record troncato
+    PlanJournal j(opts(log.path));
+    auto run = j.find("1");
+    ASSERT_TRUE(run.has_value());
+    EXPECT_EQ(run->records[0].state, State::Ok);
+    EXPECT_EQ(run->records[1].state, State::Pending);
+}
+
+TEST(PlanJournal, ShellsSharingTheLogGetDistinctIds) {
+    TempLog log("plan_journal");
+    PlanJournal a(opts(log.path, 3)), b(opts(log.path, 3));
+    auto steps = three_steps();
+    auto other = steps;
+    other[0].command = "rm -rf out";
+    auto build = a.begin("build", steps);
+    auto clean = b.begin("clean", other); // b ha letto il log prima che a scrivesse
+    EXPECT_NE(build, clean);
+    b.step_finished(clean, 0, State::Failed, 1, 10);
+    a.step_finished(build, 0, State::Ok, 0, 10);
+    PlanJournal c(opts(log.path, 3));
+    ASSERT_TRUE(c.find(build).has_value());
+    EXPECT_EQ(c.find(build)->steps[0].command, "make -j8\tall");
+    EXPECT_EQ(c.find(build)->records[0].state, State::Ok);
+    EXPECT_EQ(c.find(clean)->steps[0].command, "rm -rf out");
+    EXPECT_EQ(c.find(clean)->records[0].state, State::Failed);
+    // a compatta (oltre max_runs) dopo le aggiunte di b: le run di b restano nel log
+    b.begin("b2", steps);
+    a.begin("a3", steps);
+    PlanJournal d(opts(log.path, 3));
+    auto runs = d.runs();
+    ASSERT_EQ(runs.size(), 3u);
+    EXPECT_EQ(runs[0].request, "a3");
+    EXPECT_EQ(runs[1].request, "b2");
+    EXPECT_EQ(runs[2].request, "clean");
+    EXPECT_EQ(runs[2].records[0].state, State::Failed);
+}
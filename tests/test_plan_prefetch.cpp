@@ -0,0 +1,106 @@
+/*
+ * Speculative plan prefetch tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/plan_prefetch.hpp>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+
+using namespace autoshell::ai;
+using namespace std::chrono_literals;
+
+namespace {
+// LLM finto: le risposte arrivano quando il test completa la promise
+struct FakeLLM {
+    struct Call { std::string request; CancelToken cancel; std::promise<std::optional<LLMCompletion>> reply; };
+    std::vector<std::shared_ptr<Call>> calls;
+    std::map<std::string, std::string> cache;
+    double estimate = 0.01;
+    PlanPrefetcher make(PrefetchOptions o = {}) {
+        return PlanPrefetcher(o,
+            [this](const std::string& r, CancelToken c) { calls.push_back(std::make_shared<Call>(Call{r, c, {}})); return calls.back()->reply.get_future(); },
+            [this](const std::string& r) -> std::optional<double> { if (cache.count(r)) return std::nullopt; return estimate; },
+            [this](const std::string& r, const LLMCompletion& c) { if (c.text.empty()) return false; cache[r] = c.text; return true; });
+    }
+    void answer(std::size_t i, const std::string& text, double cost = -1) {
+        LLMCompletion c{text, "openai"}; c.total_cost = cost;
+        calls[i]->reply.set_value(c);
+    }
+};
+}
+
+TEST(PlanPrefetch, ExtractsTheRequestOfAiLines) {
+    EXPECT_EQ(PlanPrefetcher::request_of("ai suggest  list big files "), "list big files");
+    EXPECT_EQ(PlanPrefetcher::request_of("  ai auto clean build"), "clean build");
+    EXPECT_FALSE(PlanPrefetcher::request_of("ai suggest --fresh list files"));
+    EXPECT_FALSE(PlanPrefetcher::request_of("ai resume"));
+    EXPECT_FALSE(PlanPrefetcher::request_of("ai suggest "));
+    EXPECT_FALSE(PlanPrefetcher::request_of("ls -la"));
+}
+
+TEST(PlanPrefetch, IdleStartsEditsCancelAndEnterWaits) {
+    FakeLLM llm;
+    auto p = llm.make();
+    p.on_idle("ai suggest list");  // troppo corta
+    EXPECT_TRUE(llm.calls.empty());
+    p.on_idle("ai suggest list big files");
+    ASSERT_EQ(llm.calls.size(), 1u);
+    p.on_change("ai suggest  List big files"); // stessa richiesta normalizzata: resta in volo
+    EXPECT_FALSE(llm.calls[0]->cancel.cancelled());
+    p.on_change("ai suggest list big files in /tmp");
+    EXPECT_TRUE(llm.calls[0]->cancel.cancelled());
+    EXPECT_EQ(p.stats().cancelled, 1u);
+
+    p.on_idle("ai suggest list big files in /tmp");
+    ASSERT_EQ(llm.calls.size(), 2u);
+    std::thread late([&] { std::this_thread::sleep_for(30ms); llm.answer(1, "{plan}", 0.002); });
+    EXPECT_TRUE(p.settle("list big files in /tmp")); // Invio mentre e' ancora in volo: aspetta
+    late.join();
+    EXPECT_EQ(llm.cache["list big files in /tmp"], "{plan}");
+    EXPECT_FALSE(p.settle("list big files in /tmp")); // gia' usato: ora e' un normale hit di cache
+    auto st = p.stats();
+    EXPECT_EQ(st.started, 2u);
+    EXPECT_EQ(st.stored, 1u);
+    EXPECT_EQ(st.used, 1u);
+    EXPECT_NEAR(st.spent, 0.01 + 0.002, 1e-9); // preventivo del cancellato + costo reale
+}
+
+TEST(PlanPrefetch, FinishedPrefetchFillsTheCacheWhileTyping) {
+    FakeLLM llm;
+    auto p = llm.make();
+    p.on_idle("ai auto compress the logs folder");
+    llm.answer(0, "{logs}");
+    p.on_change("ai auto compress the logs folder now"); // raccolto qui, non cancellato
+    EXPECT_EQ(llm.cache["compress the logs folder"], "{logs}");
+    EXPECT_EQ(p.stats().cancelled, 0u);
+    p.on_idle("ai auto compress the logs folder"); // gia' in cache (Estimate: nullopt) e gia' provata
+    EXPECT_EQ(llm.calls.size(), 1u);
+    EXPECT_TRUE(p.settle("compress the logs folder"));
+}
+
+TEST(PlanPrefetch, SpendCapStopsSpeculation) {
+    FakeLLM llm;
+    PrefetchOptions o; o.max_requests = 10; o.max_cost = 0.025;
+    auto p = llm.make(o);
+    p.on_idle("ai suggest first request");
+    p.on_change("ai suggest second request"); // cancellato: conta il preventivo (0.01)
+    p.on_idle("ai suggest second request");
+    llm.answer(1, "", 0.01); // risposta inutile: costo reale comunque speso
+    p.on_idle("ai suggest third request");
+    EXPECT_EQ(llm.calls.size(), 2u); // 0.02 + 0.01 > 0.025
+    EXPECT_EQ(p.stats().over_budget, 1u);
+    EXPECT_NEAR(p.stats().spent, 0.02, 1e-9);
+
+    FakeLLM llm2;
+    PrefetchOptions one; one.max_requests = 1;
+    auto q = llm2.make(one);
+    q.on_idle("ai suggest first request");
+    llm2.answer(0, "{a}");
+    q.on_idle("ai suggest second request");
+    EXPECT_EQ(llm2.calls.size(), 1u);
+    EXPECT_EQ(q.stats().over_budget, 1u);
+}
@@ -0,0 +1,84 @@
+/*
+ * Plan pre-flight tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/plan_preflight.hpp>
+#include <ai-autoshell/exec/executor_posix.hpp>
+#include "temp_path.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+using namespace autoshell;
+using namespace autoshell::ai;
+using autoshell::test::TempDir;
+
+namespace {
+
+std::vector<PlanStep> plan(std::initializer_list<const char*> cmds) {
+    std::vector<PlanStep> steps;
+    int n = 1;
+    for (auto c : cmds) { PlanStep s; s.id = "s" + std::to_string(n++); s.command = c; steps.push_back(s); }
+    return steps;
+}
+
+} // namespace
+
+TEST(PlanPreflight, CleanPlanCompiles) {
+    TempDir td("aas_preflight", true);
+    std::ofstream("in.txt") << "x\n";
+    auto r = preflight_plan(plan({"ls -la | wc -l > count.txt", "cd /tmp && pwd", "sort < in.txt >> in.sorted 2> err.log", "echo $HOME > $HOME_NOPE/x"}));
+    EXPECT_TRUE(r.ok()) << (r.steps[0].problems.empty() ? "" : r.steps[0].problems[0]);
+    ASSERT_EQ(r.steps.size(), 4u);
+    EXPECT_TRUE(r.steps[0].ast.list);
+}
+
+TEST(PlanPreflight, ReportsEveryProblemBeforeRunning) {
+    TempDir td("aas_preflight", true);
+    std::filesystem::create_directory("adir");
+    auto r = preflight_plan(plan({"echo ok", "definitely_not_a_binary_xyz --help", "cat < missing.txt", "ls > nodir/out.txt",
+                                  "echo x > adir", "grep a |", "lss -la; definitely_not_a_binary_xyz"}));
+    EXPECT_EQ(r.problems, 7u);
+    EXPECT_TRUE(r.steps[0].problems.empty());
+    EXPECT_EQ(r.steps[1].problems, std::vector<std::string>{"command not found: definitely_not_a_binary_xyz"});
+    EXPECT_EQ(r.steps[2].problems, std::vector<std::string>{"input file not found: missing.txt"});
+    EXPECT_EQ(r.steps[3].problems, std::vector<std::string>{"directory not found for redirection: nodir/out.txt"});
+    EXPECT_EQ(r.steps[4].problems, std::vector<std::string>{"redirection target is a directory: adir"});
+    EXPECT_EQ(r.steps[5].problems, std::vector<std::string>{"syntax error near end of line"});
+    EXPECT_EQ(r.steps[6].problems, (std::vector<std::string>{"command not found: lss", "command not found: definitely_not_a_binary_xyz"}));
+}
+
+TEST(PlanPreflight, EarlierStepsMayCreateFilesAndFunctions) {
+    TempDir td("aas_preflight", true);
+    auto r = preflight_plan(plan({"mkdir -p out/logs && echo a > out/logs/a.txt", "wc -l < out/logs/a.txt", "touch data.csv",
+                                  "sort < data.csv > out/sorted.csv", "greet() { echo hi; }; greet", "cd sub", "cat < relative_unknown.txt"}));
+    EXPECT_TRUE(r.ok()) << r.problems;
+    auto late = preflight_plan(plan({"wc -l < later.txt", "touch later.txt"})); // l'ordine conta
+    EXPECT_EQ(late.problems, 1u);
+}
+
+TEST(PlanPreflight, ProcessSubstitutionTargetsAreDynamic) {
+    TempDir td("aas_preflight", true);
+    auto r = preflight_plan(plan({"cat < <(ls)", "echo x > >(cat)"}));
+    EXPECT_TRUE(r.ok()) << (r.steps[0].problems.empty() ? "" : r.steps[0].problems[0]);
+    auto quoted = preflight_plan(plan({"cat < '<(ls)'"})); // testo, non una sostituzione
+    EXPECT_EQ(quoted.problems, 1u);
+}
+
+TEST(PlanPreflight, NativeStepsAreSkippedAndAstsRun) {
+    TempDir td("aas_preflight", true);
+    PreflightOptions o;
+    o.native = [](const std::string& c) { return c.rfind("for ", 0) == 0; };
+    auto r = preflight_plan(plan({"for i in {1..3}; do nope_cmd $i; done", "echo compiled > out.txt"}), o);
+    ASSERT_TRUE(r.ok());
+    EXPECT_TRUE(r.steps[0].native);
+    ExecContext ctx;
+    ExecutorPOSIX ex(ctx);
+    EXPECT_EQ(ex.run(r.steps[1].ast), 0); // l'AST compilato si esegue senza ripassare dal parser
+    std::ifstream in("out.txt");
+    std::string line;
+    std::getline(in, line);
+    EXPECT_EQ(line, "compiled");
+}
@@ -0,0 +1,94 @@
+/*
+ * Streaming plan parser tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include <ai-autoshell/ai/stream.hpp>
+#include <string>
+#include <vector>
+
+using namespace autoshell::ai;
+
+static const std::string kPlan =
+    "```json\n{\"request\":\"pack logs\",\"steps\":["
+    "{\"id\":\"s1\",\"description\":\"list {1..3}\",\"command\":\"ls -la\",\"confirm\":false},"
+    "{\"description\":\"no id\",\"command\":\"tar czf logs.tgz logs\",\"confirm\":false},"
+    "{\"id\":\"s3\",\"description\":\"cleanup\",\"command\":\"rm -rf logs\",\"confirm\":true}]}\n```";
+
+TEST(PlanStreamParser, EmitsEachStepWhenItsObjectCloses) {
+    PlanStreamParser p;
+    // Tutto fino alla chiusura del primo oggetto: esattamente uno step pronto
+    std::size_t first_end = kPlan.find("false}") + 6;
+    auto a = p.feed(std::string_view(kPlan).substr(0, first_end - 1));
+    EXPECT_TRUE(a.empty());
+    auto b = p.feed(std::string_view(kPlan).substr(first_end - 1, 1));
+    ASSERT_EQ(b.size(), 1u);
+    EXPECT_EQ(b[0].id, "s1");
+    EXPECT_EQ(b[0].command, "ls -la");
+    EXPECT_FALSE(p.complete());
+}
+
+TEST(PlanStreamParser, MatchesFullParserForAnyChunking) {
+    auto full = parse_plan_json(kPlan);
+    ASSERT_EQ(full.steps.size(), 3u);
+    for (std::size_t step : {1u, 2u, 5u, 64u, 4096u}) {
+        PlanStreamParser p;
+        std::vector<ParsedStep> got;
+        for (std::size_t off = 0; off < kPlan.size(); off += step)
+            for (auto& s : p.feed(std::string_view(kPlan).substr(off, step))) got.push_back(s);
+        ASSERT_EQ(got.size(), full.steps.size()) << "chunk " << step;
+        for (std::size_t i = 0; i < got.size(); ++i) {
+            EXPECT_EQ(got[i].id, full.steps[i].id);
+            EXPECT_EQ(got[i].command, full.steps[i].command);
+            EXPECT_EQ(got[i].confirm, full.steps[i].confirm);
+        }
+        EXPECT_EQ(got[1].id, "s2");
+        EXPECT_TRUE(p.complete());
+        EXPECT_EQ(p.text(), kPlan);
+    }
+}
+
+TEST(PlanStreamParser, IgnoresTextWithoutSteps) {
+    PlanStreamParser p;
+    EXPECT_TRUE(p.feed("Sure! Here is {\"request\":\"x\"").empty());
+    EXPECT_TRUE(p.feed(", \"note\": \"}]\"}").empty());
+    EXPECT_FALSE(p.complete());
+}
+
+TEST(StreamDecoder, SplitsSseEventsAcrossChunks) {
+    const std::string body =
+        ": keep-alive\r\n"
+        "event: message\r\ndata: {\"a\":1}\r\n\r\n"
+        "data: line1\ndata: line2\n\n"
+        "data: [DONE]\n\n";
+    for (std::size_t step : {1u, 3u, 4096u}) {
+        StreamDecoder d(StreamDecoder::Format::SSE);
+        std::vector<std::string> ev;
+        auto on = [&](std::string_view e) { ev.emplace_back(e); };
+        for (std::size_t off = 0; off < body.size(); off += step) d.feed(std::string_view(body).substr(off, step), on);
+        d.finish(on);
+        EXPECT_EQ(ev, (std::vector<std::string>{"{\"a\":1}", "line1\nline2", "[DONE]"})) << "chunk " << step;
+    }
+}
+
+TEST(StreamDecoder, NdjsonFlushesUnterminatedLastLine) {
+    StreamDecoder d(StreamDecoder::Format::NDJSON);
+    std::vector<std::string> ev;
+    auto on = [&](std::string_view e) { ev.emplace_back(e); };
+    d.feed("{\"response\":\"ls\"}\n\n{\"resp", on);
+    d.feed("onse\":\" -l\",\"done\":true}", on);
+    d.finish(on);
+    ASSERT_EQ(ev.size(), 2u);
+    EXPECT_EQ(json_string_field(ev[1], "response"), " -l");
+}
+
+TEST(StreamDecoder, JsonFieldHelpersUnescape) {
+    std::string_view ev = R"({"type":"content_block_delta","delta":{"type":"text_delta","text":"{\"cmd\":\"echo \\\"hi\\\"\"}\n\u00e8 \uD83D\uDE00"},"usage":{"output_tokens": 42}})";
+    EXPECT_EQ(json_string_field(ev, "type"), "content_block_delta");
+    EXPECT_EQ(json_string_field(ev, "text"), "{\"cmd\":\"echo \\\"hi\\\"\"}\n\xC3\xA8 \xF0\x9F\x98\x80");
+    EXPECT_EQ(json_int_field(ev, "output_tokens"), 42);
+    EXPECT_EQ(json_int_field(ev, "input_tokens"), -1);
+    EXPECT_EQ(json_string_field(R"({"k":"type","type":"x"})", "type"), "x"); // valore uguale alla chiave
+}
@@ -0,0 +1,91 @@
+/*
+ * Template plan cache tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/plan_template.hpp>
+#include <ai-autoshell/ai/json_plan.hpp>
+#include <string>
+
+using namespace autoshell::ai;
+
+static std::string plan_for(const std::string& cmd, const std::string& request = "x") {
+    return "{\"request\":\"" + request + "\",\"steps\":[{\"id\":\"s1\",\"description\":\"run\",\"command\":\"" + cmd +
+           "\",\"confirm\":false}]}";
+}
+
+TEST(PlanTemplate, ExtractsPathsNumbersQuotedAndNamedSlots) {
+    auto s = extract_slots("Mostra il file docs/A.txt, poi le ultime 20 righe");
+    EXPECT_EQ(s.shape, "mostra il file <path> poi le ultime <num> righe");
+    EXPECT_EQ(s.values, (std::vector<std::string>{"docs/A.txt", "20"}));
+    EXPECT_TRUE(s.safe);
+
+    auto c = extract_slots("crea una cartella chiamata Progetti");
+    EXPECT_EQ(c.shape, "crea una cartella chiamata <name>");
+    EXPECT_EQ(c.values, (std::vector<std::string>{"Progetti"}));
+
+    auto q = extract_slots("crea un file note.txt con scritto \"ciao mondo\"");
+    EXPECT_EQ(q.shape, "crea un file <path> con scritto <str>");
+    EXPECT_EQ(q.values[1], "ciao mondo");
+    EXPECT_FALSE(q.safe); // spliced unquoted: the space would split the argument
+    EXPECT_TRUE(extract_slots("scrivi \"ciao\" nel file note.txt").safe);
+    EXPECT_FALSE(extract_slots("scrivi \"a; rm -rf x\" nel file note.txt").safe);
+    EXPECT_FALSE(extract_slots("cerca \"*.log\"").safe);
+
+    EXPECT_FALSE(extract_slots("mostra il file a.txt;rm").safe);
+    EXPECT_FALSE(extract_slots("scrivi \"$(reboot)\"").safe);
+    EXPECT_TRUE(extract_slots("list files").values.empty());
+}
+
+TEST(PlanTemplate, InstantiatesPlanForNewArguments) {
+    PlanCache store({});
+    TemplateCache tc(store);
+    ASSERT_TRUE(tc.learn("mostra il file a.txt", "openai", "m", "v1", plan_for("cat a.txt", "mostra il file a.txt")));
+    auto m = tc.lookup("Mostra il file  report-2024.md", "openai", "m", "v1");
+    ASSERT_TRUE(m.has_value());
+    EXPECT_DOUBLE_EQ(m->confidence, 1.0);
+    auto p = parse_plan_json(m->plan);
+    ASSERT_EQ(p.steps.size(), 1u);
+    EXPECT_EQ(p.steps[0].command, "cat report-2024.md");
+    EXPECT_EQ(p.request, "mostra il file report-2024.md");
+    // Altro modello o altra forma: niente template
+    EXPECT_FALSE(tc.lookup("mostra il file b.txt", "openai", "other", "v1"));
+    EXPECT_FALSE(tc.lookup("cancella il file b.txt", "openai", "m", "v1"));
+    EXPECT_EQ(tc.stats().hits, 1u);
+    EXPECT_EQ(store.stats().hits + store.stats().misses, 0u); // contatori separati dalla cache esatta
+}
+
+TEST(PlanTemplate, RejectsPlansThatDoNotUseTheSlot) {
+    PlanCache store({});
+    TemplateCache tc(store);
+    // Il comando ignora il nome: istanziarlo per un'altra cartella sarebbe sbagliato
+    EXPECT_FALSE(tc.learn("crea una cartella build", "openai", "m", "v1", plan_for("mkdir -p out")));
+    // Valore solo dentro una parola piu' lunga: confidenza 0.5 < soglia
+    EXPECT_FALSE(tc.learn("mostra il file a.txt", "openai", "m", "v1", plan_for("cat data.txt")));
+    EXPECT_EQ(tc.stats().rejected, 2u);
+    EXPECT_EQ(store.stats().entries, 0u);
+}
+
+TEST(PlanTemplate, ConfidenceThresholdIsConfigurable) {
+    RequestShape s = extract_slots("mostra le ultime 5 righe di log.txt");
+    auto t = make_template(s, plan_for("tail -n 5 log.txt"));
+    ASSERT_TRUE(t.has_value());
+    EXPECT_DOUBLE_EQ(t->confidence, 0.7); // numero di una cifra: facile collisione
+    PlanCache store({});
+    TemplateCache strict(store, 0.8), lax(store, 0.6);
+    EXPECT_FALSE(strict.learn("mostra le ultime 5 righe di log.txt", "p", "m", "v1", plan_for("tail -n 5 log.txt")));
+    EXPECT_TRUE(lax.learn("mostra le ultime 5 righe di log.txt", "p", "m", "v1", plan_for("tail -n 5 log.txt")));
+    auto m = lax.lookup("mostra le ultime 8 righe di app.log", "p", "m", "v1");
+    ASSERT_TRUE(m.has_value());
+    EXPECT_EQ(parse_plan_json(m->plan).steps[0].command, "tail -n 8 app.log");
+    EXPECT_FALSE(strict.lookup("mostra le ultime 8 righe di app.log", "p", "m", "v1"));
+}
+
+TEST(PlanTemplate, UnsafeOrDuplicateValuesFallBackToTheLlm) {
+    PlanCache store({});
+    TemplateCache tc(store);
+    ASSERT_TRUE(tc.learn("mostra il file a.txt", "p", "m", "v1", plan_for("cat a.txt")));
+    EXPECT_FALSE(tc.lookup("mostra il file `id`.txt", "p", "m", "v1"));
+    EXPECT_FALSE(make_template(extract_slots("copia a.txt in a.txt"), plan_for("cp a.txt a.txt")));
+}
@@ -0,0 +1,107 @@
+/*
+ * Process substitution tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/lex/lexer.hpp>
+#include <ai-autoshell/parse/parser.hpp>
+#include <ai-autoshell/exec/executor_posix.hpp>
+#include <sys/wait.h>
+#include <chrono>
+
+using namespace autoshell;
+
+static int run_line(ExecutorPOSIX& ex, const std::string& line) {
+    Lexer lx(line);
+    auto ts = lx.run();
+    AST ast = parse_tokens(ts);
+    return ex.run(ast);
+}
+
+// Waits for every child the shell left running (background jobs, >(cmd) readers).
+static void wait_jobs(const ExecContext& ctx) {
+    for (auto &j : ctx.jobs.list()) { int st=0; while (waitpid(-j.pgid, &st, 0) > 0) {} }
+}
+
+TEST(ProcessSubst, LexerKeepsBalancedWord) {
+    Lexer lx("diff <(sort a) <(echo \"x)\" | tr x y)");
+    auto ts = lx.run();
+    ASSERT_EQ(ts.size(), 4u);
+    EXPECT_EQ(ts[1].lexeme, "<(sort a)");
+    EXPECT_EQ(ts[2].lexeme, "<(echo \"x)\" | tr x y)");
+    EXPECT_TRUE(ts[1].subst);
+    EXPECT_TRUE(ts[2].subst);
+}
+
+TEST(ProcessSubst, QuotedTextIsNotASubstitution) {
+    Lexer lx("echo '<(a)' \"<(b)\" <(c)x");
+    auto ts = lx.run();
+    ASSERT_EQ(ts.size(), 5u);
+    for (std::size_t i = 1; i < 4; ++i) EXPECT_FALSE(ts[i].subst) << ts[i].lexeme;
+}
+
+TEST(ProcessSubst, QuotedWordsArePrintedNotRun) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    testing::internal::CaptureStdout();
+    run_line(ex, "echo '<(echo x)'");
+    run_line(ex, "echo \"<(echo x)\"");
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "<(echo x)\n<(echo x)\n");
+    EXPECT_TRUE(ctx.jobs.list().empty());
+}
+
+TEST(ProcessSubst, InputSubstitutionsStreamToCommand) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    testing::internal::CaptureStdout();
+    int st = run_line(ex, "cat <(echo one) <(echo two | tr a-z A-Z)");
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "one\nTWO\n");
+    EXPECT_EQ(st, 0);
+    EXPECT_TRUE(ctx.jobs.list().empty()); // children reaped and dropped from the job table
+}
+
+TEST(ProcessSubst, OutputSubstitutionAsRedirectTarget) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    testing::internal::CaptureStdout();
+    run_line(ex, "echo data > >(tr a-z A-Z)");
+    wait_jobs(ctx); // the reader is not waited for by the shell
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "DATA\n");
+}
+
+TEST(ProcessSubst, SlowReaderDoesNotBlockTheShell) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    auto t0 = std::chrono::steady_clock::now();
+    run_line(ex, "echo x > >(sleep 2; cat > /dev/null)");
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    EXPECT_LT(ms, 1500);
+    ASSERT_EQ(ctx.substs.size(), 1u); // left to be reaped by a later command
+    wait_jobs(ctx);
+    run_line(ex, "true");
+    EXPECT_TRUE(ctx.substs.empty());
+    EXPECT_TRUE(ctx.jobs.list().empty());
+}
+
+TEST(ProcessSubst, BackgroundCommand) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    testing::internal::CaptureStdout();
+    EXPECT_EQ(run_line(ex, "cat <(echo inner) &"), 0);
+    wait_jobs(ctx);
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_NE(out.find("running in background"), std::string::npos);
+    EXPECT_NE(out.find("inner\n"), std::string::npos);
+}
+
+TEST(ProcessSubst, EarlyExitingConsumerStopsProducer) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    testing::internal::CaptureStdout();
+    int st = run_line(ex, "head -n 1 <(yes)"); // would hang if 'yes' were not terminated
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "y\n");
+    EXPECT_EQ(st, 0);
+}
+
+TEST(ProcessSubst, FunctionReadsSubstitutedPath) {
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    run_line(ex, "f() { cat $1; }");
+    testing::internal::CaptureStdout();
+    run_line(ex, "f <(echo fn)");
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "fn\n");
+}
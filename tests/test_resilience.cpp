@@ -0,0 +1,221 @@
+/*
+ * Provider resilience tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/resilience.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace autoshell::ai;
+using namespace std::chrono_literals;
+using State = CircuitBreaker::State;
+
+// Provider finto: consuma una risposta scriptata per chiamata (l'ultima si ripete)
+class ScriptedClient : public LLMClient {
+public:
+    explicit ScriptedClient(std::vector<LLMCompletion> script, std::chrono::milliseconds latency = 0ms) : m_script(script.begin(), script.end()), m_latency(latency) {}
+    std::optional<LLMCompletion> complete(const std::string&) override {
+        ++*calls;
+        if (m_latency.count()) std::this_thread::sleep_for(m_latency);
+        auto r = m_script.front();
+        if (m_script.size() > 1) m_script.pop_front();
+        return r;
+    }
+    std::shared_ptr<std::atomic<int>> calls = std::make_shared<std::atomic<int>>(0);
+private:
+    std::deque<LLMCompletion> m_script;
+    std::chrono::milliseconds m_latency;
+};
+
+static LLMCompletion ok(std::string text) { return LLMCompletion{std::move(text), "ollama"}; }
+static LLMCompletion failure(long status, long retry_after_ms = -1) {
+    LLMCompletion c{"(ollama error code=" + std::to_string(status) + ")", "error"};
+    c.http_status = status;
+    c.retry_after_ms = retry_after_ms;
+    return c;
+}
+
+static RetryPolicy fast_retry(int retries) {
+    RetryPolicy p; p.retries = retries; p.base = 1ms; p.max = 20ms;
+    return p;
+}
+
+TEST(Backoff, FullJitterIsCappedExponential) {
+    RetryPolicy p; p.base = 100ms; p.max = 1000ms;
+    EXPECT_EQ(backoff_delay(p, 0, 0.999).count(), 99);
+    EXPECT_EQ(backoff_delay(p, 2, 0.5).count(), 200);
+    EXPECT_EQ(backoff_delay(p, 10, 0.5).count(), 500); // cap
+    EXPECT_EQ(backoff_delay(p, 3, 0.0).count(), 0);
+    EXPECT_TRUE(transient_failure(failure(429)));
+    EXPECT_TRUE(transient_failure(failure(503)));
+    EXPECT_TRUE(transient_failure(failure(0)));
+    EXPECT_FALSE(transient_failure(failure(401)));
+    EXPECT_FALSE(transient_failure(LLMCompletion{"(no-key-direct)", "error"})); // nessuna richiesta fatta
+}
+
+TEST(CircuitBreaker, OpensOnErrorRateThenProbesAfterCooldown) {
+    CircuitBreaker::Policy p; p.min_calls = 4; p.error_rate = 0.5; p.cooldown = 1000ms;
+    CircuitBreaker b(p);
+    auto t = CircuitBreaker::Clock::now();
+    b.record(true, 10ms, t);
+    b.record(false, 10ms, t);
+    b.record(true, 10ms, t);
+    EXPECT_EQ(b.state(), State::Closed); // sotto min_calls
+    b.record(false, 10ms, t);
+    EXPECT_EQ(b.state(), State::Open);   // 2/4 fallite
+    EXPECT_FALSE(b.allow(t + 999ms));
+    EXPECT_TRUE(b.allow(t + 1000ms));    // sonda
+    EXPECT_EQ(b.state(), State::HalfOpen);
+    EXPECT_FALSE(b.allow(t + 1001ms));   // una sola sonda alla volta
+    b.record(false, 10ms, t + 1100ms);
+    EXPECT_EQ(b.state(), State::Open);   // sonda fallita: altro cooldown
+    EXPECT_FALSE(b.allow(t + 2000ms));
+    EXPECT_TRUE(b.allow(t + 2100ms));
+    b.record(true, 10ms, t + 2200ms);
+    EXPECT_EQ(b.state(), State::Closed);
+    EXPECT_EQ(b.calls(), 0u);            // finestra ripulita
+}
+
+TEST(CircuitBreaker, SlowCallsAndOldSamples) {
+    CircuitBreaker::Policy p; p.min_calls = 3; p.slow_call = 500ms; p.max_age = 60000ms;
+    CircuitBreaker b(p);
+    auto t = CircuitBreaker::Clock::now();
+    b.record(true, 900ms, t);
+    b.record(true, 800ms, t);
+    b.record(true, 10ms, t + 61000ms); // le due lente sono fuori finestra
+    EXPECT_EQ(b.state(), State::Closed);
+    EXPECT_EQ(b.calls(), 1u);
+    b.record(true, 900ms, t + 61000ms);
+    b.record(true, 10ms, t + 61000ms);
+    b.record(true, 700ms, t + 61000ms);
+    EXPECT_EQ(b.state(), State::Open); // risposte valide ma lente: 2/4
+    b.allow(t + 200000ms);
+    b.abandon(); // sonda cancellata: lo slot si libera
+    EXPECT_TRUE(b.allow(t + 200000ms));
+}
+
+TEST(ResilientLLM, RetriesTransientFailuresThenSucceeds) {
+    auto c = std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{failure(503), failure(429), ok("plan")});
+    auto calls = c->calls;
+    std::vector<ResilientLLMClient::Provider> ps;
+    ps.push_back({"ollama", std::move(c)});
+    ResilientLLMClient client(std::move(ps), fast_retry(2));
+    auto r = client.complete("p");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->text, "plan");
+    EXPECT_EQ(*calls, 3);
+    EXPECT_EQ(client.stats().retries, 2u);
+    EXPECT_EQ(client.stats().failovers, 0u);
+}
+
+TEST(ResilientLLM, FailsOverOnPermanentErrorAndLongRetryAfter) {
+    auto a = std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{failure(401)});
+    auto b = std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{failure(429, 60000)});
+    auto c = std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{ok("from c")});
+    auto ca = a->calls, cb = b->calls;
+    std::vector<ResilientLLMClient::Provider> ps;
+    ps.push_back({"openai", std::move(a)});
+    ps.push_back({"claude", std::move(b)});
+    ps.push_back({"ollama", std::move(c)});
+    ResilientLLMClient client(std::move(ps), fast_retry(3));
+    auto start = std::chrono::steady_clock::now();
+    auto r = client.complete("p");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->text, "from c");
+    EXPECT_EQ(*ca, 1); // 401: niente retry
+    EXPECT_EQ(*cb, 1); // Retry-After oltre il massimo: subito il prossimo
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1000ms);
+    EXPECT_EQ(client.stats().failovers, 2u);
+}
+
+TEST(ResilientLLM, HonoursShortRetryAfter) {
+    auto c = std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{failure(429, 150), ok("plan")});
+    std::vector<ResilientLLMClient::Provider> ps;
+    ps.push_back({"openai", std::move(c)});
+    RetryPolicy p = fast_retry(1); p.max = 1000ms;
+    ResilientLLMClient client(std::move(ps), p);
+    auto start = std::chrono::steady_clock::now();
+    auto r = client.complete("p");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->text, "plan");
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 150ms);
+}
+
+TEST(ResilientLLM, OpenCircuitSkipsProviderUntilProbe) {
+    auto a = std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{failure(500)});
+    auto b = std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{ok("backup")});
+    auto ca = a->calls;
+    std::vector<ResilientLLMClient::Provider> ps;
+    ps.push_back({"openai", std::move(a)});
+    ps.push_back({"ollama", std::move(b)});
+    CircuitBreaker::Policy bp; bp.min_calls = 3; bp.cooldown = 200ms;
+    ResilientLLMClient client(std::move(ps), fast_retry(0), bp);
+    for (int i = 0; i < 6; ++i) EXPECT_EQ(client.complete("p")->text, "backup");
+    EXPECT_EQ(*ca, 3); // dopo 3 errori il circuito e' aperto: niente piu' chiamate
+    EXPECT_EQ(client.stats().short_circuited, 3u);
+    EXPECT_EQ(client.status()[0].state, State::Open);
+    std::this_thread::sleep_for(250ms);
+    EXPECT_EQ(client.complete("p")->text, "backup");
+    EXPECT_EQ(*ca, 4); // sonda dopo il cooldown
+    EXPECT_EQ(client.status()[1].state, State::Closed);
+}
+
+TEST(ResilientLLM, DeltasAlreadyShownAreNotRetriedAndCancelStops) {
+    // Errore a meta' stream: i frammenti gia' mostrati non si ripetono con un secondo tentativo
+    class PartialStream : public LLMClient {
+    public:
+        std::optional<LLMCompletion> complete(const std::string&) override { return failure(0); }
+        std::optional<LLMCompletion> complete_stream(const std::string&, const LLMDeltaFn& d) override { d("{\"st"); return failure(0); }
+    };
+    std::vector<ResilientLLMClient::Provider> ps;
+    ps.push_back({"ollama", std::make_unique<PartialStream>()});
+    ps.push_back({"openai", std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{ok("x")})});
+    ResilientLLMClient client(std::move(ps), fast_retry(3));
+    int deltas = 0;
+    auto r = client.complete_stream("p", [&](std::string_view) { ++deltas; });
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->source, "error");
+    EXPECT_EQ(deltas, 1);
+
+    std::vector<ResilientLLMClient::Provider> slow;
+    slow.push_back({"ollama", std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{failure(503)})});
+    RetryPolicy p; p.retries = 5; p.base = 2000ms; p.max = 2000ms;
+    ResilientLLMClient backoff(std::move(slow), p);
+    CancelToken tok;
+    auto fut = backoff.complete_async("p", {}, tok);
+    std::this_thread::sleep_for(50ms);
+    tok.cancel();
+    ASSERT_EQ(fut.wait_for(500ms), std::future_status::ready); // il backoff non trattiene la cancellazione
+    EXPECT_FALSE(fut.get().has_value());
+}
+
+TEST(ResilientLLM, BackoffWakesOnCancelAndTheFutureCanBeDropped) {
+    // Il token sveglia chi attende, anche attraverso un figlio
+    CancelToken parent;
+    auto leg = parent.child();
+    EXPECT_FALSE(leg.wait_until(std::chrono::steady_clock::now() + 10ms));
+    std::thread([parent] { std::this_thread::sleep_for(50ms); parent.cancel(); }).detach();
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(leg.wait_until(start + 5s));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+
+    // Abbandonare il future durante il backoff non blocca chi chiama (PlanPrefetcher::cancel)
+    std::vector<ResilientLLMClient::Provider> slow;
+    slow.push_back({"ollama", std::make_unique<ScriptedClient>(std::vector<LLMCompletion>{failure(503)})});
+    RetryPolicy p; p.retries = 5; p.base = 2000ms; p.max = 2000ms;
+    ResilientLLMClient backoff(std::move(slow), p);
+    CancelToken tok;
+    start = std::chrono::steady_clock::now();
+    {
+        auto fut = backoff.complete_async("p", {}, tok);
+        std::this_thread::sleep_for(50ms);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+    tok.cancel(); // la richiesta abbandonata si ferma al prossimo controllo
+}
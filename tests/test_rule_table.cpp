@@ -0,0 +1,106 @@
+/*
+ * Declarative planner rule table tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/rule_table.hpp>
+#include <sstream>
+#include <string>
+
+using namespace autoshell::ai;
+
+TEST(RuleTable, BuiltinRulesKeepFormerBehaviour) {
+    auto rs = RuleSet::builtin();
+    auto m = rs.match("Mostra il file Note.TXT");
+    ASSERT_EQ(m.steps.size(), 1u);
+    EXPECT_EQ(m.steps[0].command, "cat Note.TXT"); // il nome mantiene le maiuscole
+    EXPECT_DOUBLE_EQ(m.confidence, 1.0);
+
+    m = rs.match("crea un file saluti.txt con scritto \"Ciao Mondo\"");
+    ASSERT_EQ(m.steps.size(), 1u);
+    EXPECT_EQ(m.steps[0].command, "echo \"Ciao Mondo\" > saluti.txt");
+
+    m = rs.match("elimina la cartella tmp");
+    ASSERT_EQ(m.steps.size(), 1u);
+    EXPECT_EQ(m.steps[0].command, "rm -rf tmp");
+    EXPECT_TRUE(m.steps[0].confirm);
+
+    EXPECT_EQ(rs.match("pwd").steps.size(), 1u);
+    EXPECT_TRUE(rs.match("pwd please now").steps.empty()); // =pwd: solo richiesta intera
+    EXPECT_EQ(rs.match("create out.txt with the list of files").steps[0].command, "ls -la > out.txt");
+    EXPECT_TRUE(rs.match("create out.md with the list of files").steps.empty()); // suffix=.txt
+}
+
+TEST(RuleTable, SeveralRulesInOnePassWithCoverage) {
+    auto rs = RuleSet::builtin();
+    auto m = rs.match("please remove build directory and list files");
+    ASSERT_EQ(m.steps.size(), 2u);
+    EXPECT_EQ(m.steps[0].command, "ls -la");       // ordine della tabella
+    EXPECT_EQ(m.steps[1].command, "rm -rf build");
+    EXPECT_NEAR(m.confidence, 4.0 / 5.0, 1e-9);     // "directory" non coperta
+    auto partial = rs.match("list files and compress them into backup.tgz");
+    ASSERT_EQ(partial.steps.size(), 1u);
+    EXPECT_LT(partial.confidence, 0.5);
+}
+
+TEST(RuleTable, UnsafeSlotValuesDoNotMatch) {
+    auto rs = RuleSet::builtin();
+    EXPECT_TRUE(rs.match("mostra il file a.txt;reboot").steps.empty());
+    EXPECT_TRUE(rs.match("crea una cartella -rf").steps.empty());
+    EXPECT_TRUE(rs.match("crea un file x.txt con scritto \"$(id)\"").steps.empty());
+    EXPECT_TRUE(rs.match("mostra il file").steps.empty()); // slot mancante
+    // {rest}: il resto della richiesta e' un solo valore, rifiutato (non filtrato) se non e' sicuro
+    EXPECT_EQ(rs.match("mostra il contenuto della directory src/app").steps[0].command, "ls -la src/app");
+    EXPECT_TRUE(rs.match("mostra il contenuto della directory foo; rm -rf ~").steps.empty());
+    EXPECT_TRUE(rs.match("mostra il contenuto della directory my docs").steps.empty());
+    EXPECT_TRUE(rs.match("mostra il contenuto della directory $(whoami)").steps.empty());
+}
+
+TEST(RuleTable, TriggersMatchWholeWordsAndExtraWordsLowerConfidence) {
+    auto rs = RuleSet::builtin();
+    EXPECT_TRUE(rs.match("list filesystems").steps.empty());
+    EXPECT_TRUE(rs.match("recreate the database").steps.empty()); // "create" dentro un'altra parola
+    auto m = rs.match("show current directory size");
+    ASSERT_EQ(m.steps.size(), 1u);
+    EXPECT_LT(m.confidence, 1.0); // "size" non coperta: sotto la soglia di default, decide l'LLM
+}
+
+TEST(RuleTable, LoadsTableFromText) {
+    RuleSet rs;
+    std::istringstream in(
+        "# git\n"
+        "git status|stato del repo => git status --short :: Stato del repository\n"
+        "\n"
+        "comprimi la cartella => tar czf {word}.tgz {word} :: Archivia {word}\n"
+        "disk usage|spazio su disco => du -sh {rest} :: Spazio usato da {rest} :: also=of\n");
+    std::string err;
+    ASSERT_TRUE(rs.load(in, &err)) << err;
+    EXPECT_EQ(rs.size(), 3u);
+    EXPECT_EQ(rs.match("mostrami lo stato del repo").steps[0].command, "git status --short");
+    auto m = rs.match("comprimi la cartella logs");
+    ASSERT_EQ(m.steps.size(), 1u);
+    EXPECT_EQ(m.steps[0].command, "tar czf logs.tgz logs");
+    EXPECT_EQ(m.steps[0].description, "Archivia logs");
+    EXPECT_TRUE(rs.match("disk usage src").steps.empty()); // also=of mancante
+}
+
+TEST(RuleTable, ReportsBadLines) {
+    RuleSet rs;
+    std::istringstream in("list => ls\nbroken line without arrow\n");
+    std::string err;
+    EXPECT_FALSE(rs.load(in, &err));
+    EXPECT_EQ(err, "line 2: missing '=>'");
+    EXPECT_EQ(rs.size(), 0u); // tabella applicata solo se valida per intero
+    EXPECT_FALSE(RuleSet::parse_rule("x => echo {between}"));
+    EXPECT_FALSE(RuleSet::parse_rule("x => ls :: d :: bogus"));
+}
+
+TEST(RuleTable, OverlappingPatternsAreAllFound) {
+    RuleSet rs;
+    std::istringstream in("git => echo git\ngit log => echo log\nlog stat => echo stat\n");
+    ASSERT_TRUE(rs.load(in));
+    auto m = rs.match("git log stat");
+    ASSERT_EQ(m.steps.size(), 3u);
+    EXPECT_TRUE(rs.match("digit logs").steps.empty()); // occorrenze dentro altre parole
+}
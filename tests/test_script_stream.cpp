@@ -0,0 +1,120 @@
+/*
+ * Script stream tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/parse/script_stream.hpp>
+#include <ai-autoshell/exec/executor_posix.hpp>
+#include <vector>
+
+using namespace autoshell;
+
+// Feeds the script in chunks of 'step' bytes and collects the start line of every command.
+static std::vector<std::size_t> command_lines(const std::string& script, std::size_t step, ScriptStream& st) {
+    std::vector<std::size_t> lines;
+    for (std::size_t off = 0; off < script.size(); off += step) {
+        st.feed(std::string_view(script).substr(off, step));
+        while (auto c = st.next()) lines.push_back(c->line);
+    }
+    st.finish();
+    while (auto c = st.next()) lines.push_back(c->line);
+    return lines;
+}
+
+TEST(ScriptStream, SplitsCommandsAcrossArbitraryChunks) {
+    const std::string script =
+        "# header\n"
+        "greet() {\n"
+        "  echo \"hello\n"
+        "world\" $1\n"
+        "}\n"
+        "\n"
+        "echo one \\\n"
+        "  two\n"
+        "echo a |\n"
+        "  wc -l\n"
+        "(echo sub\n"
+        " echo shell)\n"
+        "echo last";
+    // Every chunk size must produce the same boundaries: 1 byte is the worst case.
+    for (std::size_t step : {1u, 3u, 7u, 4096u}) {
+        ScriptStream st;
+        auto lines = command_lines(script, step, st);
+        EXPECT_EQ(lines, (std::vector<std::size_t>{2, 7, 9, 11, 13})) << "chunk " << step;
+        EXPECT_FALSE(st.unterminated());
+    }
+}
+
+TEST(ScriptStream, RunsFunctionDefinedOverSeveralLines) {
+    ScriptStream st;
+    st.feed("add() {\n  echo $1$2\n}\nadd x y\n");
+    st.finish();
+    ExecContext ctx; ExecutorPOSIX ex(ctx);
+    testing::internal::CaptureStdout();
+    while (auto c = st.next()) ex.run(c->ast);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "xy\n");
+}
+
+TEST(ScriptStream, BufferStaysBoundedOnLongScripts) {
+    ScriptStream st;
+    std::size_t commands = 0, peak = 0;
+    for (int i = 0; i < 20000; ++i) {
+        st.feed("echo line" + std::to_string(i) + "\n");
+        peak = std::max(peak, st.buffered());
+        while (st.next()) ++commands;
+    }
+    st.finish();
+    EXPECT_EQ(commands, 20000u);
+    EXPECT_LT(peak, 64u);
+}
+
+TEST(ScriptStream, BraceArgumentsDoNotOpenAGroup) {
+    const std::string script =
+        "echo {\n"
+        "find . -name x -exec echo {} \\;\n"
+        "echo } {\n"
+        "f() { echo {; }\n"
+        "echo last";
+    for (std::size_t step : {1u, 4096u}) {
+        ScriptStream st;
+        auto lines = command_lines(script, step, st);
+        EXPECT_EQ(lines, (std::vector<std::size_t>{1, 2, 3, 4, 5})) << "chunk " << step;
+        EXPECT_FALSE(st.unterminated());
+    }
+}
+
+TEST(ScriptStream, ReportsUnterminatedConstructs) {
+    for (const char* bad : {"echo ok\nf() {\n  echo x\n", "echo \"open\n", "echo a |\n"}) {
+        ScriptStream st;
+        st.feed(bad);
+        st.finish();
+        EXPECT_TRUE(st.unterminated()) << bad;
+    }
+    ScriptStream st;
+    st.feed("echo ok\nf() {\n  echo x\n");
+    st.finish();
+    EXPECT_EQ(st.unterminated_line(), 2u);
+    ASSERT_TRUE(st.next().has_value()); // the complete command before is still delivered
+}
+
+TEST(ScriptStream, HeredocBodyBelongsToItsCommand) {
+    const std::string script =
+        "cat <<EOF | wc -l\n"
+        "} ( \"unbalanced ' # not a comment\n"
+        "EOF\n"
+        "cat <<-'X'\n"
+        "\tbody\n"
+        "\tX\n"
+        "echo done";
+    for (std::size_t step : {1u, 5u, 4096u}) {
+        ScriptStream st;
+        auto lines = command_lines(script, step, st);
+        EXPECT_EQ(lines, (std::vector<std::size_t>{1, 4, 7})) << "chunk " << step;
+        EXPECT_FALSE(st.unterminated());
+    }
+    ScriptStream st;
+    st.feed("cat <<EOF\nno delimiter\n");
+    st.finish();
+    EXPECT_TRUE(st.unterminated());
+}
@@ -0,0 +1,94 @@
+/*
+ * Incremental plan steps (step state DB) tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/step_state.hpp>
+#include "temp_path.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace autoshell::ai;
+using autoshell::test::TempDir;
+namespace fs = std::filesystem;
+
+namespace {
+
+PlanStep step(const TempDir& t, const std::string& cmd, std::vector<std::string> in, std::vector<std::string> out) {
+    PlanStep s;
+    s.id = "s1"; s.command = cmd;
+    for (auto& f : in) s.inputs.push_back(t.file(f));
+    for (auto& f : out) s.outputs.push_back(t.file(f));
+    return s;
+}
+}
+
+TEST(StepState, MissingOutputsOrNoOutputsRun) {
+    TempDir t("step_state");
+    StepStateDb db({});
+    t.write("in.txt", "a");
+    auto s = step(t, "sort in.txt > out.txt", {"in.txt"}, {"out.txt"});
+    auto c = db.check(s);
+    EXPECT_FALSE(c.up_to_date);
+    EXPECT_EQ(c.reason, "output missing: " + t.file("out.txt"));
+    EXPECT_FALSE(db.record(s)); // output non prodotto: niente da registrare
+    EXPECT_FALSE(db.check(step(t, "ls", {"in.txt"}, {})).up_to_date);
+    t.write("out.txt", "a");
+    EXPECT_FALSE(db.check(step(t, "touch out.txt", {}, {"out.txt"})).up_to_date); // mai eseguito, senza input
+}
+
+TEST(StepState, MakeRuleWithoutRecord) {
+    TempDir t("step_state");
+    StepStateDb db({});
+    t.write("in.txt", "a"); t.write("out.txt", "a");
+    t.age("in.txt", 60); t.age("out.txt", 30);
+    auto s = step(t, "cp in.txt out.txt", {"in.txt"}, {"out.txt"});
+    EXPECT_TRUE(db.check(s).up_to_date);
+    t.age("in.txt", 10);
+    auto c = db.check(s);
+    EXPECT_FALSE(c.up_to_date);
+    EXPECT_EQ(c.reason, "input newer than outputs: " + t.file("in.txt"));
+}
+
+TEST(StepState, RecordedStepsUseContentHashAndCommand) {
+    TempDir t("step_state");
+    t.write("in.txt", "hello"); t.write("out.txt", "HELLO");
+    std::string log = t.file("state.log");
+    auto s = step(t, "tr a-z A-Z < in.txt > out.txt", {"in.txt"}, {"out.txt"});
+    {
+        StepStateDb db({log, 16});
+        ASSERT_TRUE(db.record(s));
+        EXPECT_TRUE(db.check(s).up_to_date);
+    }
+    StepStateDb db({log, 16}); // dal log su disco
+    EXPECT_EQ(db.size(), 1u);
+    t.age("in.txt", -5); // toccato, contenuto identico: ancora aggiornato
+    EXPECT_TRUE(db.check(s).up_to_date);
+    auto other = s; other.command = "tr a-z A-Z < in.txt | rev > out.txt";
+    EXPECT_EQ(db.check(other).reason, "command changed");
+    t.write("in.txt", "world"); t.age("in.txt", -5);
+    EXPECT_EQ(db.check(s).reason, "input changed: " + t.file("in.txt"));
+    fs::remove(t.file("out.txt"));
+    EXPECT_FALSE(db.check(s).up_to_date);
+}
+
+TEST(StepState, KeepsOnlyTheLastEntries) {
+    TempDir t("step_state");
+    std::string log = t.file("state.log");
+    {
+        StepStateDb db({log, 2});
+        for (int i = 0; i < 4; ++i) {
+            t.write("o" + std::to_string(i), "x");
+            ASSERT_TRUE(db.record(step(t, "gen", {}, {"o" + std::to_string(i)})));
+        }
+        EXPECT_EQ(db.size(), 2u);
+    }
+    StepStateDb db({log, 2});
+    EXPECT_EQ(db.size(), 2u);
+    EXPECT_TRUE(db.check(step(t, "gen", {}, {"o3"})).up_to_date);
+    EXPECT_FALSE(db.check(step(t, "gen", {}, {"o0"})).up_to_date);
+    db.clear();
+    EXPECT_EQ(StepStateDb({log, 2}).size(), 0u);
+}
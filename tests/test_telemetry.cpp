@@ -0,0 +1,82 @@
+/*
+ * AI telemetry tests - AI-AutoShell
+ * Copyright (c) 2025 iDev srl - Luigi De Astis <l.deastis@idev-srl.com>
+ * MIT License.
+ */
+#include <gtest/gtest.h>
+#include <ai-autoshell/ai/telemetry.hpp>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+using namespace autoshell::ai;
+
+TEST(LatencyHistogram, PercentilesWithinBucketPrecision) {
+    LatencyHistogram h;
+    EXPECT_EQ(h.percentile(50), -1);
+    std::vector<std::int64_t> values;
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> dist(11.0, 1.0); // ~60 ms di mediana, coda lunga
+    for (int i = 0; i < 20000; ++i) { values.push_back(static_cast<std::int64_t>(dist(rng))); h.record(values.back()); }
+    std::sort(values.begin(), values.end());
+    for (double p : {50.0, 95.0, 99.0, 99.9}) {
+        auto exact = values[static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(values.size()))) - 1];
+        auto got = h.percentile(p);
+        EXPECT_GE(got, exact) << p;                              // limite superiore del bucket
+        EXPECT_LE(got, exact + exact / 32 + 1) << p;            // 32 sotto-bucket per potenza di 2
+    }
+    EXPECT_EQ(h.count(), values.size());
+    EXPECT_EQ(h.max(), values.back());
+    EXPECT_EQ(h.percentile(100), values.back());
+}
+
+TEST(LatencyHistogram, SmallAndHugeValues) {
+    LatencyHistogram h;
+    for (std::int64_t v = 0; v < 32; ++v) h.record(v); // valori piccoli: esatti
+    EXPECT_EQ(h.percentile(50), 15);
+    h.record(-5); // ignorato
+    EXPECT_EQ(h.count(), 32u);
+    h.record(std::int64_t{1} << 50); // oltre il range: nell'ultimo bucket, max esatto
+    EXPECT_EQ(h.max(), std::int64_t{1} << 50);
+    EXPECT_EQ(h.percentile(100), std::int64_t{1} << 50);
+}
+
+TEST(Telemetry, SeriesTokensAndCacheHitRate) {
+    Telemetry t;
+    HttpTiming tm; tm.dns_us = 1000; tm.connect_us = 2000; tm.tls_us = 0; tm.ttfb_us = 300000; tm.total_us = 2000000; tm.bytes_down = 2048; tm.bytes_up = 1024;
+    t.record_request("openai/gpt-4o-mini", tm, 150, 100, true, 1200, 900);
+    t.record_request("openai/gpt-4o-mini", tm, -1, -1, false);
+    HttpTiming local; // client locale: nessuna fase misurata
+    t.record_request("ollama/llama3", local, 80, -1, true);
+    t.record_plan(Telemetry::PlanSource::Rules);
+    t.record_plan(Telemetry::PlanSource::Cache);
+    t.record_plan(Telemetry::PlanSource::Template);
+    t.record_plan(Telemetry::PlanSource::LLM);
+    t.record_plan(Telemetry::PlanSource::LLM);
+    EXPECT_DOUBLE_EQ(t.cache_hit_rate(), 0.5); // le regole non contano: (1+1)/(1+1+2)
+
+    auto s = t.series();
+    ASSERT_EQ(s.size(), 2u);
+    auto& o = s["openai/gpt-4o-mini"];
+    EXPECT_EQ(o.requests, 2u);
+    EXPECT_EQ(o.errors, 1u);
+    EXPECT_EQ(o.total.count(), 2u);
+    EXPECT_EQ(o.parse.count(), 1u);
+    EXPECT_DOUBLE_EQ(o.tokens_per_second(), 50.0); // solo le risposte riuscite con token
+    EXPECT_EQ(o.bytes_down, 4096);
+    EXPECT_DOUBLE_EQ(o.cached_share(), 0.75);
+    EXPECT_EQ(s["ollama/llama3"].total.count(), 0u);
+
+    std::ostringstream out;
+    t.report(out);
+    auto text = out.str();
+    EXPECT_NE(text.find("cache hit rate 50.0%"), std::string::npos) << text;
+    EXPECT_NE(text.find("(50.0 tokens/s)"), std::string::npos) << text;
+    EXPECT_NE(text.find("1200 tokens in (75.0% cached)"), std::string::npos) << text;
+    EXPECT_NE(text.find("ttfb"), std::string::npos);
+    EXPECT_NE(text.find("[AI] ollama/llama3: 1 request,"), std::string::npos);
+    t.reset();
+    EXPECT_TRUE(t.series().empty());
+}